@@ -0,0 +1,153 @@
+#include "AnimationClip.h"
+
+#include <math.h>
+#include <algorithm>
+
+AnimationClip::AnimationClip()
+	: numJoints(0)
+	, stride(0)
+	, numKeys(0)
+	, frameRate(30.f)
+	, loop(false)
+	, loopStart(0.f)
+{
+}
+
+AnimationClip::~AnimationClip()
+{
+}
+
+void AnimationClip::Create(const std::string& name, unsigned numJoints, unsigned numKeys, float frameRate, bool loop, float loopStart)
+{
+	this->name = name;
+	this->numJoints = numJoints;
+	this->numKeys = std::max(numKeys, 1u);
+	this->frameRate = frameRate;
+	this->loop = loop;
+	this->loopStart = loopStart;
+
+	AnimationPose identity;
+	identity.Resize(numJoints);
+	stride = identity.GetStride();
+	unsigned keySize = AnimationPose::NUM_CHANNELS * stride;
+	keys.resize(this->numKeys * keySize);
+	for (unsigned k = 0; k < this->numKeys; ++k)
+		std::copy(identity.GetChannel(AnimationPose::CHANNEL_TX), identity.GetChannel(AnimationPose::CHANNEL_TX) + keySize, GetKeyData(k));
+}
+
+void AnimationClip::SetKey(unsigned key, const AnimationPose& pose)
+{
+	float* dst = GetKeyData(key);
+	std::copy(pose.GetChannel(AnimationPose::CHANNEL_TX), pose.GetChannel(AnimationPose::CHANNEL_TX) + AnimationPose::NUM_CHANNELS * stride, dst);
+	if (key == 0)
+		return;
+
+	const float* prev = GetKeyData(key - 1);
+	for (unsigned j = 0; j < numJoints; ++j)
+	{
+		float dot = 0.f;
+		for (int c = AnimationPose::CHANNEL_RX; c <= AnimationPose::CHANNEL_RW; ++c)
+			dot += prev[c * stride + j] * dst[c * stride + j];
+		if (dot < 0.f)
+		{
+			for (int c = AnimationPose::CHANNEL_RX; c <= AnimationPose::CHANNEL_RW; ++c)
+				dst[c * stride + j] = -dst[c * stride + j];
+		}
+	}
+}
+
+void AnimationClip::GetKey(unsigned key, AnimationPose& out) const
+{
+	if (out.GetNumJoints() != numJoints)
+		out.Resize(numJoints);
+	const float* src = GetKeyData(key);
+	std::copy(src, src + AnimationPose::NUM_CHANNELS * stride, out.GetChannel(AnimationPose::CHANNEL_TX));
+}
+
+float AnimationClip::WrapTime(float time) const
+{
+	float duration = GetDuration();
+	if (time <= duration)
+		return std::max(time, 0.f);
+	if (!loop || duration <= loopStart)
+		return duration;
+	return loopStart + fmodf(time - loopStart, duration - loopStart);
+}
+
+void AnimationClip::FindKeys(float time, unsigned& key0, unsigned& key1, float& weight) const
+{
+	float frame = WrapTime(time) * frameRate;
+	key0 = std::min(static_cast<unsigned>(frame), numKeys - 1);
+	key1 = std::min(key0 + 1, numKeys - 1);
+	weight = frame - static_cast<float>(key0);
+}
+
+void AnimationClip::Sample(float time, AnimationPose& out) const
+{
+	if (out.GetNumJoints() != numJoints)
+		out.Resize(numJoints);
+	unsigned key0, key1;
+	float weight;
+	FindKeys(time, key0, key1, weight);
+	AnimationPose::Lerp(GetKeyData(key0), GetKeyData(key1), weight, stride, out.GetChannel(AnimationPose::CHANNEL_TX));
+}
+
+void AnimationClip::SampleScalar(float time, AnimationPose& out) const
+{
+	if (out.GetNumJoints() != numJoints)
+		out.Resize(numJoints);
+	unsigned key0, key1;
+	float weight;
+	FindKeys(time, key0, key1, weight);
+	AnimationPose::LerpScalar(GetKeyData(key0), GetKeyData(key1), weight, stride, out.GetChannel(AnimationPose::CHANNEL_TX));
+}
+
+const std::string& AnimationClip::GetName(void) const
+{
+	return name;
+}
+
+unsigned AnimationClip::GetNumJoints(void) const
+{
+	return numJoints;
+}
+
+unsigned AnimationClip::GetNumKeys(void) const
+{
+	return numKeys;
+}
+
+float AnimationClip::GetFrameRate(void) const
+{
+	return frameRate;
+}
+
+float AnimationClip::GetDuration(void) const
+{
+	return static_cast<float>(numKeys - 1) / frameRate;
+}
+
+bool AnimationClip::IsLooping(void) const
+{
+	return loop;
+}
+
+float AnimationClip::GetLoopStart(void) const
+{
+	return loopStart;
+}
+
+unsigned AnimationClip::GetStride(void) const
+{
+	return stride;
+}
+
+float* AnimationClip::GetKeyData(unsigned key)
+{
+	return &keys[key * AnimationPose::NUM_CHANNELS * stride];
+}
+
+const float* AnimationClip::GetKeyData(unsigned key) const
+{
+	return &keys[key * AnimationPose::NUM_CHANNELS * stride];
+}
@@ -0,0 +1,68 @@
+#ifndef ANIMATION_CLIP_H
+#define ANIMATION_CLIP_H
+
+#include <string>
+#include <vector>
+#include "AnimationPose.h"
+
+/******************************************************************************/
+/*!
+		Class AnimationClip:
+\brief	Keyframed translation, rotation and scale tracks for every joint of
+		a skeleton, sampled at a fixed frame rate. Each key is stored in the
+		same channel-major layout as AnimationPose, so sampling finds the two
+		keys around the time once and then blends whole poses four joints
+		at a time.
+
+		Looping clips wrap back to loopStart, so a clip can start with a
+		lead-in that plays once before the loop. Other clips hold their
+		last key.
+*/
+/******************************************************************************/
+class AnimationClip
+{
+public:
+	AnimationClip();
+	~AnimationClip();
+
+	// Every key starts as the identity pose
+	void Create(const std::string& name, unsigned numJoints, unsigned numKeys, float frameRate, bool loop, float loopStart = 0.f);
+
+	// Rotations are flipped into the hemisphere of the previous key's, so tracks stay continuous
+	void SetKey(unsigned key, const AnimationPose& pose);
+	void GetKey(unsigned key, AnimationPose& out) const;
+
+	// Wraps or clamps time into the clip
+	float WrapTime(float time) const;
+	void Sample(float time, AnimationPose& out) const;
+	// Same result through AnimationPose::LerpScalar
+	void SampleScalar(float time, AnimationPose& out) const;
+
+	const std::string& GetName(void) const;
+	unsigned GetNumJoints(void) const;
+	unsigned GetNumKeys(void) const;
+	float GetFrameRate(void) const;
+	float GetDuration(void) const;
+	bool IsLooping(void) const;
+	float GetLoopStart(void) const;
+
+	// Raw key data, NUM_CHANNELS * GetStride() floats per key; for loading and saving
+	unsigned GetStride(void) const;
+	float* GetKeyData(unsigned key);
+	const float* GetKeyData(unsigned key) const;
+
+private:
+	// The two keys around time and how far between them it is
+	void FindKeys(float time, unsigned& key0, unsigned& key1, float& weight) const;
+
+	std::string name;
+	unsigned numJoints;
+	unsigned stride;
+	unsigned numKeys;
+	float frameRate;
+	bool loop;
+	float loopStart;
+	std::vector<float> keys;
+};
+
+#endif
@@ -0,0 +1,72 @@
+#include "AnimationPlayer.h"
+
+AnimationPlayer::AnimationPlayer()
+	: current(nullptr)
+	, previous(nullptr)
+	, time(0.f)
+	, previousTime(0.f)
+	, fade(0.f)
+	, fadeTime(0.f)
+{
+}
+
+AnimationPlayer::~AnimationPlayer()
+{
+}
+
+void AnimationPlayer::Play(const AnimationClip* clip, float fadeTime)
+{
+	if (current && fadeTime > 0.f)
+	{
+		// A fade that is cut short restarts from the clip that was fading in
+		previous = current;
+		previousTime = time;
+		fade = 0.f;
+		this->fadeTime = fadeTime;
+	}
+	else
+	{
+		previous = nullptr;
+	}
+	current = clip;
+	time = 0.f;
+}
+
+void AnimationPlayer::Update(float dt)
+{
+	time += dt;
+	if (previous)
+	{
+		previousTime += dt;
+		fade += dt;
+		if (fade >= fadeTime)
+			previous = nullptr;
+	}
+}
+
+void AnimationPlayer::Sample(AnimationPose& out)
+{
+	if (!current)
+		return;
+	current->Sample(time, out);
+	if (previous)
+	{
+		previous->Sample(previousTime, fadePose);
+		AnimationPose::Blend(fadePose, out, fade / fadeTime, out);
+	}
+}
+
+const AnimationClip* AnimationPlayer::GetClip(void) const
+{
+	return current;
+}
+
+float AnimationPlayer::GetTime(void) const
+{
+	return time;
+}
+
+bool AnimationPlayer::IsFinished(void) const
+{
+	return current && !current->IsLooping() && time >= current->GetDuration();
+}
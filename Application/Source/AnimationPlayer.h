@@ -0,0 +1,41 @@
+#ifndef ANIMATION_PLAYER_H
+#define ANIMATION_PLAYER_H
+
+#include "AnimationClip.h"
+
+/******************************************************************************/
+/*!
+		Class AnimationPlayer:
+\brief	Plays one clip at a time and cross-fades into the next. While a fade
+		is running the outgoing clip keeps advancing, and both are sampled
+		and blended by how far the fade has got.
+*/
+/******************************************************************************/
+class AnimationPlayer
+{
+public:
+	AnimationPlayer();
+	~AnimationPlayer();
+
+	// Starts clip from the beginning, fading out of the current one over fadeTime seconds
+	void Play(const AnimationClip* clip, float fadeTime = 0.f);
+	void Update(float dt);
+	// Leaves out untouched when nothing is playing
+	void Sample(AnimationPose& out);
+
+	const AnimationClip* GetClip(void) const;
+	float GetTime(void) const;
+	// A clip that does not loop has reached its last key
+	bool IsFinished(void) const;
+
+private:
+	const AnimationClip* current;
+	const AnimationClip* previous;
+	float time;
+	float previousTime;
+	float fade;
+	float fadeTime;
+	AnimationPose fadePose;
+};
+
+#endif
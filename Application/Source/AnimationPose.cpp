@@ -0,0 +1,197 @@
+#include "AnimationPose.h"
+
+#include "SSE.h"
+
+#include <math.h>
+
+#ifdef HAS_SSE
+#include <xmmintrin.h>
+#endif
+
+AnimationPose::AnimationPose()
+	: numJoints(0)
+	, stride(0)
+{
+}
+
+AnimationPose::~AnimationPose()
+{
+}
+
+void AnimationPose::Resize(unsigned numJoints)
+{
+	this->numJoints = numJoints;
+	stride = (numJoints + 3) & ~3u;
+	data.assign(NUM_CHANNELS * stride, 0.f);
+	// Padding joints are identity too, so normalizing them never divides by zero
+	for (unsigned j = 0; j < stride; ++j)
+	{
+		data[CHANNEL_RW * stride + j] = 1.f;
+		data[CHANNEL_SX * stride + j] = 1.f;
+		data[CHANNEL_SY * stride + j] = 1.f;
+		data[CHANNEL_SZ * stride + j] = 1.f;
+	}
+}
+
+unsigned AnimationPose::GetNumJoints(void) const
+{
+	return numJoints;
+}
+
+unsigned AnimationPose::GetStride(void) const
+{
+	return stride;
+}
+
+float* AnimationPose::GetChannel(CHANNEL channel)
+{
+	return &data[channel * stride];
+}
+
+const float* AnimationPose::GetChannel(CHANNEL channel) const
+{
+	return &data[channel * stride];
+}
+
+void AnimationPose::SetJoint(unsigned joint, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale)
+{
+	data[CHANNEL_TX * stride + joint] = translation.x;
+	data[CHANNEL_TY * stride + joint] = translation.y;
+	data[CHANNEL_TZ * stride + joint] = translation.z;
+	data[CHANNEL_RX * stride + joint] = rotation.x;
+	data[CHANNEL_RY * stride + joint] = rotation.y;
+	data[CHANNEL_RZ * stride + joint] = rotation.z;
+	data[CHANNEL_RW * stride + joint] = rotation.w;
+	data[CHANNEL_SX * stride + joint] = scale.x;
+	data[CHANNEL_SY * stride + joint] = scale.y;
+	data[CHANNEL_SZ * stride + joint] = scale.z;
+}
+
+glm::vec3 AnimationPose::GetTranslation(unsigned joint) const
+{
+	return glm::vec3(data[CHANNEL_TX * stride + joint], data[CHANNEL_TY * stride + joint], data[CHANNEL_TZ * stride + joint]);
+}
+
+glm::quat AnimationPose::GetRotation(unsigned joint) const
+{
+	return glm::quat(data[CHANNEL_RW * stride + joint], data[CHANNEL_RX * stride + joint],
+		data[CHANNEL_RY * stride + joint], data[CHANNEL_RZ * stride + joint]);
+}
+
+glm::vec3 AnimationPose::GetScale(unsigned joint) const
+{
+	return glm::vec3(data[CHANNEL_SX * stride + joint], data[CHANNEL_SY * stride + joint], data[CHANNEL_SZ * stride + joint]);
+}
+
+glm::mat4 AnimationPose::GetMatrix(unsigned joint) const
+{
+	glm::mat3 r = glm::mat3_cast(GetRotation(joint));
+	glm::vec3 s = GetScale(joint);
+	glm::mat4 m(1.f);
+	m[0] = glm::vec4(r[0] * s.x, 0.f);
+	m[1] = glm::vec4(r[1] * s.y, 0.f);
+	m[2] = glm::vec4(r[2] * s.z, 0.f);
+	m[3] = glm::vec4(GetTranslation(joint), 1.f);
+	return m;
+}
+
+void AnimationPose::Blend(const AnimationPose& a, const AnimationPose& b, float weight, AnimationPose& out)
+{
+	if (out.stride != a.stride)
+		out.Resize(a.numJoints);
+	Lerp(&a.data[0], &b.data[0], weight, a.stride, &out.data[0]);
+}
+
+void AnimationPose::BlendScalar(const AnimationPose& a, const AnimationPose& b, float weight, AnimationPose& out)
+{
+	if (out.stride != a.stride)
+		out.Resize(a.numJoints);
+	LerpScalar(&a.data[0], &b.data[0], weight, a.stride, &out.data[0]);
+}
+
+void AnimationPose::Lerp(const float* a, const float* b, float weight, unsigned stride, float* out)
+{
+#ifdef HAS_SSE
+	const __m128 w = _mm_set1_ps(weight);
+	const __m128 signBit = _mm_set1_ps(-0.f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 threeHalves = _mm_set1_ps(1.5f);
+
+	for (unsigned j = 0; j < stride; j += 4)
+	{
+		// Translation and scale: a + (b - a) * w
+		const int linear[6] = { CHANNEL_TX, CHANNEL_TY, CHANNEL_TZ, CHANNEL_SX, CHANNEL_SY, CHANNEL_SZ };
+		for (int i = 0; i < 6; ++i)
+		{
+			unsigned offset = linear[i] * stride + j;
+			__m128 va = _mm_loadu_ps(a + offset);
+			__m128 vb = _mm_loadu_ps(b + offset);
+			_mm_storeu_ps(out + offset, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), w)));
+		}
+
+		// Rotation: flip b where it is in the other hemisphere, lerp, renormalize
+		__m128 ax = _mm_loadu_ps(a + CHANNEL_RX * stride + j);
+		__m128 ay = _mm_loadu_ps(a + CHANNEL_RY * stride + j);
+		__m128 az = _mm_loadu_ps(a + CHANNEL_RZ * stride + j);
+		__m128 aw = _mm_loadu_ps(a + CHANNEL_RW * stride + j);
+		__m128 bx = _mm_loadu_ps(b + CHANNEL_RX * stride + j);
+		__m128 by = _mm_loadu_ps(b + CHANNEL_RY * stride + j);
+		__m128 bz = _mm_loadu_ps(b + CHANNEL_RZ * stride + j);
+		__m128 bw = _mm_loadu_ps(b + CHANNEL_RW * stride + j);
+
+		__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+		__m128 flip = _mm_and_ps(_mm_cmplt_ps(dot, _mm_setzero_ps()), signBit);
+		bx = _mm_xor_ps(bx, flip);
+		by = _mm_xor_ps(by, flip);
+		bz = _mm_xor_ps(bz, flip);
+		bw = _mm_xor_ps(bw, flip);
+
+		__m128 x = _mm_add_ps(ax, _mm_mul_ps(_mm_sub_ps(bx, ax), w));
+		__m128 y = _mm_add_ps(ay, _mm_mul_ps(_mm_sub_ps(by, ay), w));
+		__m128 z = _mm_add_ps(az, _mm_mul_ps(_mm_sub_ps(bz, az), w));
+		__m128 q = _mm_add_ps(aw, _mm_mul_ps(_mm_sub_ps(bw, aw), w));
+
+		// Reciprocal square root estimate refined by one Newton-Raphson step
+		__m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(q, q)));
+		__m128 r = _mm_rsqrt_ps(lengthSq);
+		r = _mm_mul_ps(r, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, lengthSq), _mm_mul_ps(r, r))));
+
+		_mm_storeu_ps(out + CHANNEL_RX * stride + j, _mm_mul_ps(x, r));
+		_mm_storeu_ps(out + CHANNEL_RY * stride + j, _mm_mul_ps(y, r));
+		_mm_storeu_ps(out + CHANNEL_RZ * stride + j, _mm_mul_ps(z, r));
+		_mm_storeu_ps(out + CHANNEL_RW * stride + j, _mm_mul_ps(q, r));
+	}
+#else
+	LerpScalar(a, b, weight, stride, out);
+#endif
+}
+
+void AnimationPose::LerpScalar(const float* a, const float* b, float weight, unsigned stride, float* out)
+{
+	for (unsigned j = 0; j < stride; ++j)
+	{
+		glm::vec3 ta(a[CHANNEL_TX * stride + j], a[CHANNEL_TY * stride + j], a[CHANNEL_TZ * stride + j]);
+		glm::vec3 tb(b[CHANNEL_TX * stride + j], b[CHANNEL_TY * stride + j], b[CHANNEL_TZ * stride + j]);
+		glm::vec3 sa(a[CHANNEL_SX * stride + j], a[CHANNEL_SY * stride + j], a[CHANNEL_SZ * stride + j]);
+		glm::vec3 sb(b[CHANNEL_SX * stride + j], b[CHANNEL_SY * stride + j], b[CHANNEL_SZ * stride + j]);
+		glm::quat ra(a[CHANNEL_RW * stride + j], a[CHANNEL_RX * stride + j], a[CHANNEL_RY * stride + j], a[CHANNEL_RZ * stride + j]);
+		glm::quat rb(b[CHANNEL_RW * stride + j], b[CHANNEL_RX * stride + j], b[CHANNEL_RY * stride + j], b[CHANNEL_RZ * stride + j]);
+
+		glm::vec3 t = glm::mix(ta, tb, weight);
+		glm::vec3 s = glm::mix(sa, sb, weight);
+		if (glm::dot(ra, rb) < 0.f)
+			rb = -rb;
+		glm::quat r = glm::normalize(ra * (1.f - weight) + rb * weight);
+
+		out[CHANNEL_TX * stride + j] = t.x;
+		out[CHANNEL_TY * stride + j] = t.y;
+		out[CHANNEL_TZ * stride + j] = t.z;
+		out[CHANNEL_RX * stride + j] = r.x;
+		out[CHANNEL_RY * stride + j] = r.y;
+		out[CHANNEL_RZ * stride + j] = r.z;
+		out[CHANNEL_RW * stride + j] = r.w;
+		out[CHANNEL_SX * stride + j] = s.x;
+		out[CHANNEL_SY * stride + j] = s.y;
+		out[CHANNEL_SZ * stride + j] = s.z;
+	}
+}
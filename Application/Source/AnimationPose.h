@@ -0,0 +1,75 @@
+#ifndef ANIMATION_POSE_H
+#define ANIMATION_POSE_H
+
+#include <vector>
+#include <glm\glm.hpp>
+#include <glm\gtc\quaternion.hpp>
+
+/******************************************************************************/
+/*!
+		Class AnimationPose:
+\brief	Local translation, rotation and scale of every joint of a skeleton,
+		stored channel by channel: all joints' x translations, then all
+		y translations, and so on. The joint count is padded to a multiple
+		of four, so every channel is whole SSE registers and sampling and
+		blending process four joints per instruction.
+
+		Rotations are unit quaternions. Blend takes the shorter way round
+		per joint and renormalizes (nlerp), which is close enough to slerp
+		for the small angles between neighbouring keys or cross-faded poses.
+*/
+/******************************************************************************/
+class AnimationPose
+{
+public:
+	enum CHANNEL
+	{
+		CHANNEL_TX,
+		CHANNEL_TY,
+		CHANNEL_TZ,
+		CHANNEL_RX,
+		CHANNEL_RY,
+		CHANNEL_RZ,
+		CHANNEL_RW,
+		CHANNEL_SX,
+		CHANNEL_SY,
+		CHANNEL_SZ,
+
+		NUM_CHANNELS,
+	};
+
+	AnimationPose();
+	~AnimationPose();
+
+	// Every joint at identity
+	void Resize(unsigned numJoints);
+
+	unsigned GetNumJoints(void) const;
+	// Floats between one channel and the next
+	unsigned GetStride(void) const;
+	float* GetChannel(CHANNEL channel);
+	const float* GetChannel(CHANNEL channel) const;
+
+	void SetJoint(unsigned joint, const glm::vec3& translation, const glm::quat& rotation, const glm::vec3& scale);
+	glm::vec3 GetTranslation(unsigned joint) const;
+	glm::quat GetRotation(unsigned joint) const;
+	glm::vec3 GetScale(unsigned joint) const;
+	// translate * rotate * scale
+	glm::mat4 GetMatrix(unsigned joint) const;
+
+	// out = a * (1 - weight) + b * weight; out may be a or b
+	static void Blend(const AnimationPose& a, const AnimationPose& b, float weight, AnimationPose& out);
+	// One joint at a time, for comparison
+	static void BlendScalar(const AnimationPose& a, const AnimationPose& b, float weight, AnimationPose& out);
+
+	// Blend on raw channel data laid out like a pose with the given stride; AnimationClip samples with it
+	static void Lerp(const float* a, const float* b, float weight, unsigned stride, float* out);
+	static void LerpScalar(const float* a, const float* b, float weight, unsigned stride, float* out);
+
+private:
+	unsigned numJoints;
+	unsigned stride;
+	std::vector<float> data;
+};
+
+#endif
@@ -18,7 +18,15 @@
 #include "SceneLightSource.h"
 #include "SceneTexture.h"
 #include "SceneModel.h"
+#include "SceneCrowd.h"
 #include "KeyboardController.h"
+#include "GeometryArena.h"
+#include "GLStateCache.h"
+#include "UniformBlocks.h"
+#include "DeferredRenderer.h"
+#include "ShaderCache.h"
+#include "ThreadPool.h"
+#include "FramePipeline.h"
 
 GLFWwindow* m_window;
 const unsigned char FPS = 60; // FPS of this game
@@ -42,7 +50,9 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
 
 void resize_callback(GLFWwindow* window, int w, int h)
 {
-	glViewport(0, 0, w, h); //update opengl the new window size
+	// The pipelined loop owns the context on its render thread and sets the viewport there
+	if (glfwGetCurrentContext())
+		glViewport(0, 0, w, h); //update opengl the new window size
 }
 
 bool Application::IsKeyPressed(unsigned short key)
@@ -51,6 +61,9 @@ bool Application::IsKeyPressed(unsigned short key)
 }
 
 Application::Application()
+	: m_pipelined(false)
+	, m_crowd(0)
+	, m_lights(0)
 {
 }
 
@@ -108,20 +121,53 @@ void Application::Init()
 	}
 }
 
+void Application::SetPipelined(bool pipelined)
+{
+	m_pipelined = pipelined;
+}
+
+void Application::SetCrowd(unsigned numObjects)
+{
+	m_crowd = numObjects;
+}
+
+void Application::SetLights(unsigned numLights)
+{
+	m_lights = numLights;
+}
+
 void Application::Run()
 {
 	//Main Loop
 	//Load the new texture scene.
-	Scene* scene = new SceneModel();
+	// Lights alone get a crowd small enough to see them on
+	unsigned crowd = m_crowd == 0 && m_lights > 0 ? 10000 : m_crowd;
+	Scene* scene = crowd > 0 ? static_cast<Scene*>(new SceneCrowd(crowd, m_lights)) : new SceneModel();
 	scene->Init();
 
+	// Update, Render and swap buffers, on this thread or split across a render thread
+	FramePipeline pipeline(m_window);
+	if (!pipeline.Start(scene, m_pipelined) && m_pipelined)
+		printf("Scene cannot be recorded, running serially\n");
+
 	m_timer.startTimer();    // Start timer to calculate how long it takes to render this frame
 	while (!glfwWindowShouldClose(m_window) && !IsKeyPressed(VK_ESCAPE))
 	{
-		scene->Update(m_timer.getElapsedTime());
-		scene->Render();
-		//Swap buffers
-		glfwSwapBuffers(m_window);
+		pipeline.Frame(m_timer.getElapsedTime());
+
+		if (KeyboardController::GetInstance()->IsKeyPressed(GLFW_KEY_F2))
+		{
+			pipeline.PrintStats();
+			if (scene->GetEntities())
+				scene->GetEntities()->PrintStats();
+			// The GL-side counters, background shader compiles included, belong to the render thread while it runs
+			if (!pipeline.IsPipelined())
+			{
+				GLStateCache::GetInstance()->PrintStats();
+				UniformBlocks::GetInstance()->PrintStats();
+				ShaderCache::GetInstance()->PrintStats();
+			}
+		}
 
 		KeyboardController::GetInstance()->PostUpdate();
 
@@ -130,6 +176,8 @@ void Application::Run()
         m_timer.waitUntil(frameTime);       // Frame rate limiter. Limits each frame to a specified time in ms.   
 
 	} //Check if the ESC key had been pressed or if the window had been closed
+	pipeline.Stop();
+	pipeline.PrintStats();
 	scene->Exit();
 	delete scene;
 }
@@ -137,6 +185,12 @@ void Application::Run()
 void Application::Exit()
 {
 	KeyboardController::DestroyInstance();
+	ThreadPool::DestroyInstance();
+	GeometryArena::DestroyInstance();
+	DeferredRenderer::DestroyInstance();
+	ShaderCache::DestroyInstance();
+	UniformBlocks::DestroyInstance();
+	GLStateCache::DestroyInstance();
 
 	//Close OpenGL window and terminate GLFW
 	glfwDestroyWindow(m_window);
@@ -14,7 +14,17 @@ public:
 	void Exit();
 	static bool IsKeyPressed(unsigned short key);
 
+	// Update the next frame while the previous one is drawn on a render thread
+	void SetPipelined(bool pipelined);
+	// Run SceneCrowd with this many objects instead of the default scene; 0 keeps the default
+	void SetCrowd(unsigned numObjects);
+	// Light SceneCrowd with this many clustered point lights as well
+	void SetLights(unsigned numLights);
+
 private:
+	bool m_pipelined;
+	unsigned m_crowd;
+	unsigned m_lights;
 
 	//Declare a window object
 	StopWatch m_timer;
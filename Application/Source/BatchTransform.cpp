@@ -0,0 +1,283 @@
+#include "BatchTransform.h"
+#include <glm\gtc\matrix_inverse.hpp>
+
+#include <math.h>
+
+#ifdef HAS_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Relative tolerance when deciding whether the 3x3 is orthogonal with equal column lengths
+	const float EPSILON = 1e-4f;
+}
+
+BatchTransform::BatchTransform()
+	: projection(1.f)
+{
+	for (int i = 0; i < NUM_TRANSFORM_TYPES; ++i)
+		numTransforms[i] = 0;
+}
+
+BatchTransform::~BatchTransform()
+{
+}
+
+void BatchTransform::Begin(const glm::mat4& projection)
+{
+	this->projection = projection;
+	modelViews.clear();
+}
+
+unsigned BatchTransform::Add(const glm::mat4& modelView)
+{
+	modelViews.push_back(modelView);
+	return static_cast<unsigned>(modelViews.size() - 1);
+}
+
+BatchTransform::TRANSFORM_TYPE BatchTransform::Classify(const glm::mat4& modelView)
+{
+	if (modelView[0][3] != 0.f || modelView[1][3] != 0.f || modelView[2][3] != 0.f || modelView[3][3] != 1.f)
+		return TRANSFORM_PROJECTIVE;
+
+	glm::vec3 a(modelView[0]), b(modelView[1]), c(modelView[2]);
+	float aa = glm::dot(a, a);
+	float tolerance = EPSILON * aa;
+	if (fabsf(glm::dot(b, b) - aa) > tolerance || fabsf(glm::dot(c, c) - aa) > tolerance ||
+		fabsf(glm::dot(a, b)) > tolerance || fabsf(glm::dot(a, c)) > tolerance || fabsf(glm::dot(b, c)) > tolerance)
+		return TRANSFORM_AFFINE;
+	return fabsf(aa - 1.f) <= EPSILON ? TRANSFORM_RIGID : TRANSFORM_UNIFORM_SCALE;
+}
+
+glm::mat4 BatchTransform::NormalMatrix(const glm::mat4& modelView, TRANSFORM_TYPE type)
+{
+	glm::vec3 a(modelView[0]), b(modelView[1]), c(modelView[2]);
+	switch (type)
+	{
+	case TRANSFORM_RIGID:
+		return glm::mat4(glm::mat3(a, b, c));
+	case TRANSFORM_UNIFORM_SCALE:
+		return glm::mat4(glm::mat3(a, b, c) * (1.f / glm::dot(a, a)));
+	case TRANSFORM_AFFINE:
+	{
+		// Columns of the inverse transpose are the cofactors: b x c, c x a, a x b over the determinant
+		glm::vec3 bc = glm::cross(b, c);
+		float inverseDet = 1.f / glm::dot(a, bc);
+		return glm::mat4(glm::mat3(bc, glm::cross(c, a), glm::cross(a, b)) * inverseDet);
+	}
+	default:
+		return glm::inverseTranspose(modelView);
+	}
+}
+
+void BatchTransform::ComputeScalar(void)
+{
+	unsigned count = static_cast<unsigned>(modelViews.size());
+	MVPs.resize(count);
+	normalMatrices.resize(count);
+	for (int i = 0; i < NUM_TRANSFORM_TYPES; ++i)
+		numTransforms[i] = 0;
+
+	for (unsigned i = 0; i < count; ++i)
+	{
+		TRANSFORM_TYPE type = Classify(modelViews[i]);
+		MVPs[i] = projection * modelViews[i];
+		normalMatrices[i] = NormalMatrix(modelViews[i], type);
+		++numTransforms[type];
+	}
+}
+
+#ifdef HAS_SSE
+
+void BatchTransform::Compute(void)
+{
+	unsigned count = static_cast<unsigned>(modelViews.size());
+	for (int i = 0; i < NUM_TRANSFORM_TYPES; ++i)
+		numTransforms[i] = 0;
+
+	// Pad to whole blocks with identities, which count as rigid and are taken off again below
+	unsigned padded = (count + 3) & ~3u;
+	modelViews.resize(padded, glm::mat4(1.f));
+	MVPs.resize(padded);
+	normalMatrices.resize(padded);
+	for (unsigned first = 0; first < padded; first += 4)
+		ComputeBlock(first);
+
+	numTransforms[TRANSFORM_RIGID] -= padded - count;
+	modelViews.resize(count);
+	MVPs.resize(count);
+	normalMatrices.resize(count);
+}
+
+void BatchTransform::ComputeBlock(unsigned first)
+{
+	const glm::mat4* in = &modelViews[first];
+
+	// m[c * 4 + r] holds element (column c, row r) of the four model-views, one per lane
+	__m128 m[16];
+	for (int c = 0; c < 4; ++c)
+	{
+		__m128 r0 = _mm_loadu_ps(&in[0][c][0]);
+		__m128 r1 = _mm_loadu_ps(&in[1][c][0]);
+		__m128 r2 = _mm_loadu_ps(&in[2][c][0]);
+		__m128 r3 = _mm_loadu_ps(&in[3][c][0]);
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		m[c * 4 + 0] = r0;
+		m[c * 4 + 1] = r1;
+		m[c * 4 + 2] = r2;
+		m[c * 4 + 3] = r3;
+	}
+
+	// Classify all four lanes at once, as Classify does for one
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.f);
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	__m128 affine = _mm_and_ps(_mm_and_ps(_mm_cmpeq_ps(m[3], zero), _mm_cmpeq_ps(m[7], zero)),
+		_mm_and_ps(_mm_cmpeq_ps(m[11], zero), _mm_cmpeq_ps(m[15], one)));
+
+	__m128 aa = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0], m[0]), _mm_mul_ps(m[1], m[1])), _mm_mul_ps(m[2], m[2]));
+	__m128 bb = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[4], m[4]), _mm_mul_ps(m[5], m[5])), _mm_mul_ps(m[6], m[6]));
+	__m128 cc = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[8], m[8]), _mm_mul_ps(m[9], m[9])), _mm_mul_ps(m[10], m[10]));
+	__m128 ab = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0], m[4]), _mm_mul_ps(m[1], m[5])), _mm_mul_ps(m[2], m[6]));
+	__m128 ac = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0], m[8]), _mm_mul_ps(m[1], m[9])), _mm_mul_ps(m[2], m[10]));
+	__m128 bc = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[4], m[8]), _mm_mul_ps(m[5], m[9])), _mm_mul_ps(m[6], m[10]));
+	__m128 tolerance = _mm_mul_ps(_mm_set1_ps(EPSILON), aa);
+	__m128 uniform = _mm_cmple_ps(_mm_and_ps(_mm_sub_ps(bb, aa), absMask), tolerance);
+	uniform = _mm_and_ps(uniform, _mm_cmple_ps(_mm_and_ps(_mm_sub_ps(cc, aa), absMask), tolerance));
+	uniform = _mm_and_ps(uniform, _mm_cmple_ps(_mm_and_ps(ab, absMask), tolerance));
+	uniform = _mm_and_ps(uniform, _mm_cmple_ps(_mm_and_ps(ac, absMask), tolerance));
+	uniform = _mm_and_ps(uniform, _mm_cmple_ps(_mm_and_ps(bc, absMask), tolerance));
+	uniform = _mm_and_ps(uniform, affine);
+	__m128 rigid = _mm_and_ps(uniform, _mm_cmple_ps(_mm_and_ps(_mm_sub_ps(aa, one), absMask), _mm_set1_ps(EPSILON)));
+
+	int affineBits = _mm_movemask_ps(affine);
+	int uniformBits = _mm_movemask_ps(uniform);
+	int rigidBits = _mm_movemask_ps(rigid);
+	for (int lane = 0; lane < 4; ++lane)
+	{
+		int bit = 1 << lane;
+		if (rigidBits & bit)
+			++numTransforms[TRANSFORM_RIGID];
+		else if (uniformBits & bit)
+			++numTransforms[TRANSFORM_UNIFORM_SCALE];
+		else if (affineBits & bit)
+			++numTransforms[TRANSFORM_AFFINE];
+		else
+			++numTransforms[TRANSFORM_PROJECTIVE];
+	}
+
+	// MVP = projection * modelView, with the projection broadcast across lanes
+	__m128 mvp[16];
+	for (int c = 0; c < 4; ++c)
+	{
+		for (int r = 0; r < 4; ++r)
+		{
+			__m128 sum = _mm_mul_ps(_mm_set1_ps(projection[0][r]), m[c * 4 + 0]);
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(projection[1][r]), m[c * 4 + 1]));
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(projection[2][r]), m[c * 4 + 2]));
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(projection[3][r]), m[c * 4 + 3]));
+			mvp[c * 4 + r] = sum;
+		}
+	}
+
+	// Normal matrix in the same layout; fourth row and column stay identity
+	__m128 n[16];
+	n[3] = n[7] = n[11] = n[12] = n[13] = n[14] = zero;
+	n[15] = one;
+	if (rigidBits == 0xF)
+	{
+		for (int c = 0; c < 3; ++c)
+			for (int r = 0; r < 3; ++r)
+				n[c * 4 + r] = m[c * 4 + r];
+	}
+	else if (uniformBits == 0xF)
+	{
+		__m128 inverseScale = _mm_div_ps(one, aa);
+		for (int c = 0; c < 3; ++c)
+			for (int r = 0; r < 3; ++r)
+				n[c * 4 + r] = _mm_mul_ps(m[c * 4 + r], inverseScale);
+	}
+	else
+	{
+		// Cofactors: columns b x c, c x a, a x b, where a, b, c are the 3x3's columns
+		const __m128* a = &m[0];
+		const __m128* b = &m[4];
+		const __m128* c = &m[8];
+		n[0] = _mm_sub_ps(_mm_mul_ps(b[1], c[2]), _mm_mul_ps(b[2], c[1]));
+		n[1] = _mm_sub_ps(_mm_mul_ps(b[2], c[0]), _mm_mul_ps(b[0], c[2]));
+		n[2] = _mm_sub_ps(_mm_mul_ps(b[0], c[1]), _mm_mul_ps(b[1], c[0]));
+		n[4] = _mm_sub_ps(_mm_mul_ps(c[1], a[2]), _mm_mul_ps(c[2], a[1]));
+		n[5] = _mm_sub_ps(_mm_mul_ps(c[2], a[0]), _mm_mul_ps(c[0], a[2]));
+		n[6] = _mm_sub_ps(_mm_mul_ps(c[0], a[1]), _mm_mul_ps(c[1], a[0]));
+		n[8] = _mm_sub_ps(_mm_mul_ps(a[1], b[2]), _mm_mul_ps(a[2], b[1]));
+		n[9] = _mm_sub_ps(_mm_mul_ps(a[2], b[0]), _mm_mul_ps(a[0], b[2]));
+		n[10] = _mm_sub_ps(_mm_mul_ps(a[0], b[1]), _mm_mul_ps(a[1], b[0]));
+		__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], n[0]), _mm_mul_ps(a[1], n[1])), _mm_mul_ps(a[2], n[2]));
+		__m128 inverseDet = _mm_div_ps(one, det);
+		for (int i = 0; i < 11; ++i)
+		{
+			if (i % 4 != 3)
+				n[i] = _mm_mul_ps(n[i], inverseDet);
+		}
+	}
+
+	// Back to one matrix per draw
+	glm::mat4* outMVP = &MVPs[first];
+	glm::mat4* outNormal = &normalMatrices[first];
+	for (int c = 0; c < 4; ++c)
+	{
+		__m128 r0 = mvp[c * 4 + 0], r1 = mvp[c * 4 + 1], r2 = mvp[c * 4 + 2], r3 = mvp[c * 4 + 3];
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		_mm_storeu_ps(&outMVP[0][c][0], r0);
+		_mm_storeu_ps(&outMVP[1][c][0], r1);
+		_mm_storeu_ps(&outMVP[2][c][0], r2);
+		_mm_storeu_ps(&outMVP[3][c][0], r3);
+
+		r0 = n[c * 4 + 0]; r1 = n[c * 4 + 1]; r2 = n[c * 4 + 2]; r3 = n[c * 4 + 3];
+		_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+		_mm_storeu_ps(&outNormal[0][c][0], r0);
+		_mm_storeu_ps(&outNormal[1][c][0], r1);
+		_mm_storeu_ps(&outNormal[2][c][0], r2);
+		_mm_storeu_ps(&outNormal[3][c][0], r3);
+	}
+
+	// Rare enough that the lanes are redone one by one
+	if (affineBits != 0xF)
+	{
+		for (int lane = 0; lane < 4; ++lane)
+		{
+			if (!(affineBits & (1 << lane)))
+				outNormal[lane] = glm::inverseTranspose(in[lane]);
+		}
+	}
+}
+
+#else
+
+void BatchTransform::Compute(void)
+{
+	ComputeScalar();
+}
+
+#endif
+
+unsigned BatchTransform::GetSize(void) const
+{
+	return static_cast<unsigned>(modelViews.size());
+}
+
+const glm::mat4& BatchTransform::GetMVP(unsigned index) const
+{
+	return MVPs[index];
+}
+
+const glm::mat4& BatchTransform::GetNormalMatrix(unsigned index) const
+{
+	return normalMatrices[index];
+}
+
+unsigned BatchTransform::GetNumTransforms(TRANSFORM_TYPE type) const
+{
+	return numTransforms[type];
+}
@@ -0,0 +1,76 @@
+#ifndef BATCH_TRANSFORM_H
+#define BATCH_TRANSFORM_H
+
+#include <vector>
+#include <glm\glm.hpp>
+#include "SSE.h"
+
+/******************************************************************************/
+/*!
+		Class BatchTransform:
+\brief	Computes the MVP and normal matrix of a whole frame's draws in one
+		pass instead of one glm call chain per draw. Model-views are
+		gathered contiguously, then processed four at a time: each block is
+		transposed into SSE registers so every lane holds one draw, and the
+		products and inverses run lane-parallel.
+
+		The normal matrix only needs the inverse transpose of the upper 3x3,
+		so most draws avoid a general inverse:
+		- rigid (orthonormal) transforms use the 3x3 as it is,
+		- uniform scale divides it by the squared scale,
+		- other affine transforms use the cofactor matrix over the determinant.
+		A block only takes the cheaper path when all four lanes allow it.
+		Projective model-views fall back to glm::inverseTranspose.
+
+		The normal matrix has an identity fourth row and column, so it only
+		matches glm::inverseTranspose on the 3x3 the shaders use (w = 0).
+*/
+/******************************************************************************/
+class BatchTransform
+{
+public:
+	enum TRANSFORM_TYPE
+	{
+		TRANSFORM_RIGID,
+		TRANSFORM_UNIFORM_SCALE,
+		TRANSFORM_AFFINE,
+		TRANSFORM_PROJECTIVE,
+
+		NUM_TRANSFORM_TYPES,
+	};
+
+	BatchTransform();
+	~BatchTransform();
+
+	// Clears the batch; the projection applies to every model-view added
+	void Begin(const glm::mat4& projection);
+	// Returns the index to read the results with
+	unsigned Add(const glm::mat4& modelView);
+
+	// SSE2 where the compiler targets it, otherwise the same as ComputeScalar
+	void Compute(void);
+	// One draw at a time with the same fast paths, for comparison
+	void ComputeScalar(void);
+
+	unsigned GetSize(void) const;
+	const glm::mat4& GetMVP(unsigned index) const;
+	const glm::mat4& GetNormalMatrix(unsigned index) const;
+	// Draws of each type in the last Compute
+	unsigned GetNumTransforms(TRANSFORM_TYPE type) const;
+
+	static TRANSFORM_TYPE Classify(const glm::mat4& modelView);
+	static glm::mat4 NormalMatrix(const glm::mat4& modelView, TRANSFORM_TYPE type);
+
+private:
+#ifdef HAS_SSE
+	void ComputeBlock(unsigned first);
+#endif
+
+	glm::mat4 projection;
+	std::vector<glm::mat4> modelViews;
+	std::vector<glm::mat4> MVPs;
+	std::vector<glm::mat4> normalMatrices;
+	unsigned numTransforms[NUM_TRANSFORM_TYPES];
+};
+
+#endif
@@ -0,0 +1,2591 @@
+#include "Benchmark.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <math.h>
+#include <float.h>
+#include <stack>
+#include <fstream>
+#include <sstream>
+
+#include <GL\glew.h>
+#include "GLStateCache.h"
+#include <GLFW/glfw3.h>
+#include <glm\gtc\matrix_transform.hpp>
+
+#include "LoadOBJ.h"
+#include "MeshBuilder.h"
+#include "GeometryArena.h"
+#include "shader.hpp"
+#include "ShaderBatch.h"
+#include "Stripifier.h"
+#include "TessellationCache.h"
+#include "IndirectRenderer.h"
+#include "RenderQueue.h"
+#include "UniformBlocks.h"
+#include "CommandList.h"
+#include "ThreadPool.h"
+#include "MatrixStack.h"
+#include "Scene.h"
+#include "FramePipeline.h"
+#include "BatchTransform.h"
+#include "SceneGraph.h"
+#include "EntityStore.h"
+#include "AnimationClip.h"
+#include "LoadAnimation.h"
+#include "SkinnedMesh.h"
+#include "LoadGLB.h"
+#include "LoadSTL.h"
+#include "LightClusters.h"
+#include "DeferredRenderer.h"
+#include "ShaderCache.h"
+#include <glm\gtc\matrix_inverse.hpp>
+
+namespace
+{
+	double Seconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// Triangle list of a (numSlice + 1) x (numStack + 1) vertex grid, the topology of GenerateSphere / GenerateTorus
+	void BuildGridList(unsigned numSlice, unsigned numStack, std::vector<unsigned>& out_triangles)
+	{
+		out_triangles.clear();
+		for (unsigned stack = 0; stack < numStack; ++stack)
+		{
+			for (unsigned slice = 0; slice < numSlice; ++slice)
+			{
+				unsigned v0 = (numSlice + 1) * stack + slice;
+				unsigned v1 = (numSlice + 1) * (stack + 1) + slice;
+				out_triangles.push_back(v0); out_triangles.push_back(v1); out_triangles.push_back(v0 + 1);
+				out_triangles.push_back(v0 + 1); out_triangles.push_back(v1); out_triangles.push_back(v1 + 1);
+			}
+		}
+	}
+
+	void ReportStrip(const char* name, const std::vector<unsigned>& triangles)
+	{
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		std::vector<unsigned> strips;
+		Stripify(triangles, strips);
+		double elapsed = Seconds(start);
+
+		unsigned numStrips = 1 + static_cast<unsigned>(std::count(strips.begin(), strips.end(), STRIP_RESTART_INDEX));
+		printf("%-24s %10u %10u %8u %10.3f %10.3f %10.2f\n", name,
+			static_cast<unsigned>(triangles.size()), static_cast<unsigned>(strips.size()), numStrips,
+			ComputeACMR(triangles, false), ComputeACMR(strips, true), elapsed * 1000.0);
+	}
+
+	// Index count and post-transform cache efficiency of triangle lists versus restarted strips
+	void BenchmarkStrip(int argc, char* argv[])
+	{
+		printf("%-24s %10s %10s %8s %10s %10s %10s\n", "mesh", "list idx", "strip idx", "strips", "list ACMR", "strip ACMR", "ms");
+
+		const unsigned resolutions[] = { 6, 12, 64, 360 };
+		std::vector<unsigned> triangles;
+		for (unsigned i = 0; i < sizeof(resolutions) / sizeof(resolutions[0]); ++i)
+		{
+			char name[64];
+			snprintf(name, sizeof(name), "grid %ux%u", resolutions[i], resolutions[i]);
+			BuildGridList(resolutions[i], resolutions[i], triangles);
+			ReportStrip(name, triangles);
+		}
+
+		// Any OBJ files given on the command line
+		for (int i = 0; i < argc; ++i)
+		{
+			std::vector<glm::vec3> vertices, normals;
+			std::vector<glm::vec2> uvs;
+			if (!LoadOBJ(argv[i], vertices, uvs, normals))
+				continue;
+			std::vector<Vertex> vertex_buffer_data;
+			IndexVBO(vertices, uvs, normals, triangles, vertex_buffer_data);
+			ReportStrip(argv[i], triangles);
+		}
+	}
+
+	// Segments and sphere triangle count chosen for a range of on-screen sizes
+	void BenchmarkTessellation(int argc, char* argv[])
+	{
+		float maxError = argc > 0 ? static_cast<float>(atof(argv[0])) : 0.5f;
+		printf("chord error %.2f px\n", maxError);
+		printf("%12s %10s %10s %10s %12s\n", "radius px", "needed", "level", "segments", "triangles");
+
+		const float radii[] = { 1.f, 2.f, 5.f, 10.f, 25.f, 50.f, 100.f, 250.f, 500.f, 1000.f };
+		for (unsigned i = 0; i < sizeof(radii) / sizeof(radii[0]); ++i)
+		{
+			int needed = TessellationCache::SegmentsForChordError(radii[i], maxError);
+			int level = 0;
+			while (level < TessellationCache::NUM_LEVELS - 1 && (TessellationCache::MIN_SEGMENTS << level) < needed)
+				++level;
+			int segments = TessellationCache::MIN_SEGMENTS << level;
+			// GenerateSphere with segments slices and segments / 2 stacks
+			printf("%12.1f %10d %10d %10d %12d\n", radii[i], needed, level, segments, segments * (segments / 2) * 2);
+		}
+	}
+
+	// How SubmitFrame issues each draw
+	enum SUBMIT_PATH
+	{
+		SUBMIT_RESPECIFY,	// attribute setup on every draw, as Mesh::Render used to do
+		SUBMIT_VAO,			// Mesh::Render, arena page VAO bind plus a base vertex draw
+		SUBMIT_INDIRECT,	// IndirectRenderer, one multi-draw per bucket
+		NUM_SUBMIT_PATH,
+	};
+
+	const char* submitPathNames[NUM_SUBMIT_PATH] = { "respecify", "vao", "indirect" };
+
+	struct SubmitScene
+	{
+		std::vector<Mesh*> meshes;
+		std::vector<glm::mat4> models;
+		glm::mat4 view, projection;
+		unsigned legacyVertexArray;	// single shared VAO, as scenes used to create in Init
+		unsigned programID;
+		Light light;
+		IndirectRenderer indirect;
+		bool indirectReady;
+	};
+
+	void RenderRespecify(Mesh* mesh)
+	{
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glEnableVertexAttribArray(2);
+		// Same buffers as the arena page, but with the layout set up again per draw
+		GeometryArena* arena = GeometryArena::GetInstance();
+		size_t baseVertex = mesh->allocation.baseVertex * sizeof(Vertex);
+		GLStateCache::GetInstance()->BindBuffer(GL_ARRAY_BUFFER, arena->GetVertexBuffer(mesh->allocation.page));
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)baseVertex);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(baseVertex + sizeof(glm::vec3)));
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(baseVertex + sizeof(glm::vec3) + sizeof(glm::vec3)));
+		GLStateCache::GetInstance()->BindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena->GetIndexBuffer(mesh->allocation.page));
+		glDrawElements(Mesh::BeginDraw(mesh->mode), mesh->indexSize, GL_UNSIGNED_INT, (void*)(mesh->allocation.firstIndex * sizeof(GLuint)));
+		glDisableVertexAttribArray(0);
+		glDisableVertexAttribArray(1);
+		glDisableVertexAttribArray(2);
+	}
+
+	// Issue one frame of draws the way a scene's RenderMesh does; returns CPU seconds spent submitting
+	double SubmitFrame(SubmitScene& scene, SUBMIT_PATH path)
+	{
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		UniformBlocks::GetInstance()->SetFrame(scene.view, scene.projection, &scene.light, 1);
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		if (path == SUBMIT_INDIRECT)
+		{
+			scene.indirect.Begin(scene.view, scene.projection);
+			for (size_t i = 0; i < scene.models.size(); ++i)
+				scene.indirect.Submit(scene.meshes[i % scene.meshes.size()], scene.models[i], true);
+			scene.indirect.End();
+			double elapsed = Seconds(start);
+			glFinish();
+			return elapsed;
+		}
+
+		GLStateCache::GetInstance()->UseProgram(scene.programID);
+		if (path == SUBMIT_RESPECIFY)
+			GLStateCache::GetInstance()->BindVertexArray(scene.legacyVertexArray);
+		for (size_t i = 0; i < scene.models.size(); ++i)
+		{
+			Mesh* mesh = scene.meshes[i % scene.meshes.size()];
+			glm::mat4 modelView = scene.view * scene.models[i];
+			UniformBlocks::GetInstance()->SetObject(scene.projection * modelView, modelView, mesh->material, true, false);
+
+			if (path == SUBMIT_RESPECIFY)
+				RenderRespecify(mesh);
+			else
+				mesh->Render();
+		}
+		double elapsed = Seconds(start);
+
+		// Wait for the GPU outside the timed region so only CPU submission is measured
+		glFinish();
+		return elapsed;
+	}
+
+	// CPU time to submit a frame of thousands of lit draws through each path
+	void BenchmarkSubmit(int argc, char* argv[])
+	{
+		unsigned numDraws = argc > 0 ? static_cast<unsigned>(atoi(argv[0])) : 5000;
+		unsigned numFrames = argc > 1 ? static_cast<unsigned>(atoi(argv[1])) : 100;
+
+		SubmitScene scene;
+		glGenVertexArrays(1, &scene.legacyVertexArray);
+		scene.programID = LoadShaders("Shader//Shading.vertexshader", "Shader//Shading.fragmentshader");
+		UniformBlocks::GetInstance()->BindProgram(scene.programID);
+
+		scene.meshes.push_back(MeshBuilder::GenerateSphere("Sphere", glm::vec3(1.f, 0.5f, 0.5f), 0.4f, 12, 6));
+		scene.meshes.push_back(MeshBuilder::GenerateTorus("Torus", glm::vec3(0.5f, 1.f, 0.5f), 0.1f, 0.3f, 12, 12));
+		scene.meshes.push_back(MeshBuilder::GenerateCylinder("Cylinder", glm::vec3(0.5f, 0.5f, 1.f), 0.3f, 0.3f, 1, 12));
+		scene.meshes.push_back(MeshBuilder::GenerateQuad("Quad", glm::vec3(1.f), 0.8f));
+		for (size_t i = 0; i < scene.meshes.size(); ++i)
+		{
+			scene.meshes[i]->material.kAmbient = glm::vec3(0.1f);
+			scene.meshes[i]->material.kDiffuse = glm::vec3(0.6f);
+			scene.meshes[i]->material.kSpecular = glm::vec3(0.3f);
+			scene.meshes[i]->material.kShininess = 5.f;
+		}
+
+		// Objects on a square grid in front of the camera
+		unsigned side = static_cast<unsigned>(ceil(sqrt(static_cast<double>(numDraws))));
+		for (unsigned i = 0; i < numDraws; ++i)
+		{
+			float x = (static_cast<float>(i % side) - side * 0.5f);
+			float y = (static_cast<float>(i / side) - side * 0.5f);
+			scene.models.push_back(glm::translate(glm::mat4(1.f), glm::vec3(x, y, 0.f)));
+		}
+		scene.view = glm::lookAt(glm::vec3(0.f, 0.f, side * 1.2f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+		scene.projection = glm::perspective(glm::radians(60.f), 4.f / 3.f, 0.1f, 1000.f);
+
+		GLStateCache::GetInstance()->Enable(GL_DEPTH_TEST);
+		GLStateCache::GetInstance()->Enable(GL_CULL_FACE);
+
+		// Every path reads the same light from the frame block
+		scene.light.type = Light::LIGHT_POINT;
+		scene.light.position = glm::vec3(0.f, 0.f, side * 0.5f);
+		UniformBlocks::GetInstance()->ReserveObjects(numDraws);
+		scene.indirectReady = scene.indirect.Init();
+
+		printf("%u draws, %u frames\n", numDraws, numFrames);
+		printf("%-12s %12s %12s\n", "path", "ms/frame", "us/draw");
+		for (int path = 0; path < NUM_SUBMIT_PATH; ++path)
+		{
+			if (path == SUBMIT_INDIRECT && !scene.indirectReady)
+			{
+				printf("%-12s %12s\n", submitPathNames[path], "unsupported");
+				continue;
+			}
+			// One untimed warm-up frame
+			SubmitFrame(scene, static_cast<SUBMIT_PATH>(path));
+			double total = 0.0;
+			for (unsigned f = 0; f < numFrames; ++f)
+				total += SubmitFrame(scene, static_cast<SUBMIT_PATH>(path));
+			printf("%-12s %12.3f %12.3f\n", submitPathNames[path],
+				total * 1000.0 / numFrames, total * 1e6 / (static_cast<double>(numFrames) * numDraws));
+		}
+		if (scene.indirectReady)
+			printf("indirect: %u draws in %u multi-draws\n", scene.indirect.GetNumDraws(), scene.indirect.GetNumMultiDraws());
+		scene.indirect.Exit();
+
+		for (size_t i = 0; i < scene.meshes.size(); ++i)
+			delete scene.meshes[i];
+		GLStateCache::GetInstance()->DeleteVertexArray(scene.legacyVertexArray);
+		GLStateCache::GetInstance()->DeleteProgram(scene.programID);
+	}
+
+	// Fragment the geometry arena with mixed-size meshes, then compact it
+	void BenchmarkArena(int argc, char* argv[])
+	{
+		unsigned numMeshes = argc > 0 ? static_cast<unsigned>(atoi(argv[0])) : 2000;
+
+		std::vector<Mesh*> meshes;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (unsigned i = 0; i < numMeshes; ++i)
+		{
+			int segments = 4 + static_cast<int>(i % 29);
+			meshes.push_back(MeshBuilder::GenerateSphere("Sphere", glm::vec3(1.f), 1.f, segments, segments));
+		}
+		glFinish();
+		printf("built %u meshes in %.2f ms\n", numMeshes, Seconds(start) * 1000.0);
+		GeometryArena::GetInstance()->PrintStats();
+
+		// Free every other mesh to leave holes everywhere
+		for (unsigned i = 0; i < numMeshes; i += 2)
+		{
+			delete meshes[i];
+			meshes[i] = nullptr;
+		}
+		printf("after freeing half\n");
+		GeometryArena::GetInstance()->PrintStats();
+
+		start = std::chrono::high_resolution_clock::now();
+		GeometryArena::GetInstance()->Compact();
+		glFinish();
+		printf("compacted in %.2f ms\n", Seconds(start) * 1000.0);
+		GeometryArena::GetInstance()->PrintStats();
+
+		for (unsigned i = 0; i < numMeshes; ++i)
+			delete meshes[i];
+	}
+
+	// Sort and submit cost of the render queue for items submitted in scrambled state order
+	void BenchmarkQueue(int argc, char* argv[])
+	{
+		unsigned numItems = argc > 0 ? static_cast<unsigned>(atoi(argv[0])) : 5000;
+		unsigned numFrames = argc > 1 ? static_cast<unsigned>(atoi(argv[1])) : 100;
+
+		unsigned programs[2];
+		programs[0] = LoadShaders("Shader//Shading.vertexshader", "Shader//Shading.fragmentshader");
+		programs[1] = LoadShaders("Shader//Texture.vertexshader", "Shader//Texture.fragmentshader");
+		UniformBlocks::GetInstance()->BindProgram(programs[0]);
+		UniformBlocks::GetInstance()->BindProgram(programs[1]);
+
+		// A few 1x1 textures so texture binds show up in the counts
+		const unsigned NUM_TEXTURES = 4;
+		unsigned textures[NUM_TEXTURES];
+		glGenTextures(NUM_TEXTURES, textures);
+		for (unsigned i = 0; i < NUM_TEXTURES; ++i)
+		{
+			unsigned char texel[3] = { static_cast<unsigned char>(64 * i), 128, 255 };
+			GLStateCache::GetInstance()->BindTexture(GL_TEXTURE_2D, textures[i]);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, texel);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		}
+		GLStateCache::GetInstance()->BindTexture(GL_TEXTURE_2D, 0);
+
+		std::vector<Mesh*> meshes;
+		meshes.push_back(MeshBuilder::GenerateSphere("Sphere", glm::vec3(1.f, 0.5f, 0.5f), 0.4f, 12, 6));
+		meshes.push_back(MeshBuilder::GenerateTorus("Torus", glm::vec3(0.5f, 1.f, 0.5f), 0.1f, 0.3f, 12, 12));
+		meshes.push_back(MeshBuilder::GenerateCylinder("Cylinder", glm::vec3(0.5f, 0.5f, 1.f), 0.3f, 0.3f, 1, 12));
+		meshes.push_back(MeshBuilder::GenerateQuad("Quad", glm::vec3(1.f), 0.8f));
+
+		// Pseudo-random but repeatable state per item, in the order a scene graph walk might produce
+		struct QueueItem { unsigned mesh, program, texture; bool transparent; glm::mat4 model; };
+		std::vector<QueueItem> items(numItems);
+		unsigned seed = 12345;
+		unsigned side = static_cast<unsigned>(ceil(sqrt(static_cast<double>(numItems))));
+		unsigned unsortedProgramChanges = 0, unsortedTextureChanges = 0;
+		for (unsigned i = 0; i < numItems; ++i)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			items[i].mesh = (seed >> 8) % meshes.size();
+			items[i].program = (seed >> 12) % 2;
+			items[i].texture = (seed >> 16) % (NUM_TEXTURES + 1);
+			items[i].transparent = (seed >> 20) % 10 == 0;
+			float x = (static_cast<float>(i % side) - side * 0.5f);
+			float y = (static_cast<float>(i / side) - side * 0.5f);
+			items[i].model = glm::translate(glm::mat4(1.f), glm::vec3(x, y, -static_cast<float>((seed >> 24) % 16)));
+
+			if (i == 0 || items[i].program != items[i - 1].program)
+				++unsortedProgramChanges;
+			if (items[i].texture > 0 && (i == 0 || items[i].texture != items[i - 1].texture))
+				++unsortedTextureChanges;
+		}
+
+		glm::mat4 view = glm::lookAt(glm::vec3(0.f, 0.f, side * 1.2f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+		glm::mat4 projection = glm::perspective(glm::radians(60.f), 4.f / 3.f, 0.1f, 1000.f);
+		GLStateCache::GetInstance()->Enable(GL_DEPTH_TEST);
+
+		Light light;
+		light.type = Light::LIGHT_POINT;
+		UniformBlocks::GetInstance()->SetFrame(view, projection, &light, 1);
+
+		RenderQueue queue;
+		double sortTime = 0.0, submitTime = 0.0;
+		for (unsigned f = 0; f <= numFrames; ++f)
+		{
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			queue.Begin(view, projection);
+			for (unsigned i = 0; i < numItems; ++i)
+			{
+				Mesh* mesh = meshes[items[i].mesh];
+				mesh->textureID = items[i].texture > 0 ? textures[items[i].texture - 1] : 0;
+				queue.Submit(mesh, items[i].model, programs[items[i].program], true, items[i].transparent);
+			}
+			queue.Flush();
+			glFinish();
+
+			// Frame 0 warms up the uniform location cache
+			if (f > 0)
+			{
+				sortTime += queue.GetSortTime();
+				submitTime += queue.GetSubmitTime();
+			}
+		}
+
+		printf("%u items, %u frames\n", numItems, numFrames);
+		printf("sort %.3f ms/frame, submit %.3f ms/frame\n", sortTime / numFrames, submitTime / numFrames);
+		printf("program changes %u (unsorted %u), texture changes %u (unsorted %u), material changes %u\n",
+			queue.GetNumProgramChanges(), unsortedProgramChanges,
+			queue.GetNumTextureChanges(), unsortedTextureChanges, queue.GetNumMaterialChanges());
+
+		for (size_t i = 0; i < meshes.size(); ++i)
+		{
+			meshes[i]->textureID = 0;
+			delete meshes[i];
+		}
+		for (unsigned i = 0; i < NUM_TEXTURES; ++i)
+			GLStateCache::GetInstance()->DeleteTexture(textures[i]);
+		GLStateCache::GetInstance()->DeleteProgram(programs[0]);
+		GLStateCache::GetInstance()->DeleteProgram(programs[1]);
+	}
+
+	// Per-draw object data through the persistently mapped ring versus glBufferSubData on one buffer
+	void BenchmarkStream(int argc, char* argv[])
+	{
+		unsigned numDraws = argc > 0 ? static_cast<unsigned>(atoi(argv[0])) : 50000;
+		unsigned numFrames = argc > 1 ? static_cast<unsigned>(atoi(argv[1])) : 30;
+
+		unsigned programID = LoadShaders("Shader//Shading.vertexshader", "Shader//Shading.fragmentshader");
+		UniformBlocks* blocks = UniformBlocks::GetInstance();
+		blocks->BindProgram(programID);
+		blocks->ReserveObjects(numDraws);
+
+		// Small meshes so the GPU is never the bottleneck
+		Mesh* mesh = MeshBuilder::GenerateQuad("Quad", glm::vec3(1.f), 0.8f);
+		mesh->material.kAmbient = glm::vec3(0.1f);
+		mesh->material.kDiffuse = glm::vec3(0.6f);
+		mesh->material.kSpecular = glm::vec3(0.3f);
+
+		unsigned side = static_cast<unsigned>(ceil(sqrt(static_cast<double>(numDraws))));
+		std::vector<glm::mat4> models(numDraws);
+		for (unsigned i = 0; i < numDraws; ++i)
+		{
+			float x = (static_cast<float>(i % side) - side * 0.5f);
+			float y = (static_cast<float>(i / side) - side * 0.5f);
+			models[i] = glm::translate(glm::mat4(1.f), glm::vec3(x, y, 0.f));
+		}
+		glm::mat4 view = glm::lookAt(glm::vec3(0.f, 0.f, side * 1.2f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+		glm::mat4 projection = glm::perspective(glm::radians(60.f), 4.f / 3.f, 0.1f, 1000.f);
+		Light light;
+		light.type = Light::LIGHT_POINT;
+		light.position = glm::vec3(0.f, 0.f, side * 0.5f);
+
+		GLStateCache::GetInstance()->Enable(GL_DEPTH_TEST);
+		GLStateCache::GetInstance()->UseProgram(programID);
+
+		printf("%u draws, %u frames\n", numDraws, numFrames);
+		printf("%-12s %12s %12s\n", "path", "ms/frame", "us/draw");
+		const char* names[2] = { "subdata", "ring" };
+		for (int ring = 0; ring < 2; ++ring)
+		{
+			blocks->SetStreaming(ring != 0);
+
+			// Frames run back to back without glFinish, so any driver synchronization shows up in the time
+			std::chrono::high_resolution_clock::time_point start;
+			for (unsigned f = 0; f <= numFrames; ++f)
+			{
+				if (f == 1)
+				{
+					glFinish();
+					start = std::chrono::high_resolution_clock::now();
+				}
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				blocks->SetFrame(view, projection, &light, 1);
+				for (unsigned i = 0; i < numDraws; ++i)
+				{
+					glm::mat4 modelView = view * models[i];
+					blocks->SetObject(projection * modelView, modelView, mesh->material, true, false);
+					mesh->Render();
+				}
+				glFlush();
+			}
+			glFinish();
+			double total = Seconds(start);
+			printf("%-12s %12.3f %12.3f\n", names[ring],
+				total * 1000.0 / numFrames, total * 1e6 / (static_cast<double>(numFrames) * numDraws));
+		}
+		blocks->PrintStats();
+		blocks->SetStreaming(true);
+
+		delete mesh;
+		GLStateCache::GetInstance()->DeleteProgram(programID);
+	}
+
+	// One robot-like subtree: a body with limbs made of chained joints, as SceneLight builds by hand
+	void RecordSubtree(MatrixStack& stack, CommandList& list, const std::vector<Mesh*>& meshes, unsigned programID, unsigned index, float time)
+	{
+		const unsigned LIMBS = 4, JOINTS = 4;
+		unsigned side = 64;
+		stack.LoadIdentity();
+		stack.Translate((index % side) * 4.f - side * 2.f, 0.f, -static_cast<float>(index / side) * 4.f);
+		stack.Rotate(time * 20.f + index, 0.f, 1.f, 0.f);
+		list.Submit(meshes[0], stack.Top(), programID, true);
+		for (unsigned limb = 0; limb < LIMBS; ++limb)
+		{
+			stack.PushMatrix();
+			stack.Rotate(limb * 90.f, 0.f, 1.f, 0.f);
+			stack.Translate(0.8f, 0.f, 0.f);
+			for (unsigned joint = 0; joint < JOINTS; ++joint)
+			{
+				stack.Rotate(sinf(time + joint + index) * 30.f, 0.f, 0.f, 1.f);
+				stack.Translate(0.f, -0.5f, 0.f);
+				stack.PushMatrix();
+				stack.Scale(0.2f, 0.5f, 0.2f);
+				list.Submit(meshes[1 + joint % (meshes.size() - 1)], stack.Top(), programID, true);
+				stack.PopMatrix();
+			}
+			stack.PopMatrix();
+		}
+	}
+
+	// Scene preparation (matrices, culling, sort keys) recorded on worker threads, replayed on the GL thread
+	void BenchmarkPrepare(int argc, char* argv[])
+	{
+		unsigned numSubtrees = argc > 0 ? static_cast<unsigned>(atoi(argv[0])) : 4096;
+		unsigned numFrames = argc > 1 ? static_cast<unsigned>(atoi(argv[1])) : 30;
+
+		unsigned programID = LoadShaders("Shader//Shading.vertexshader", "Shader//Shading.fragmentshader");
+		UniformBlocks::GetInstance()->BindProgram(programID);
+		UniformBlocks::GetInstance()->ReserveObjects(numSubtrees * 17);	// body plus 4 limbs of 4 joints
+
+		std::vector<Mesh*> meshes;
+		meshes.push_back(MeshBuilder::GenerateSphere("Body", glm::vec3(1.f, 0.5f, 0.5f), 0.6f, 12, 6));
+		meshes.push_back(MeshBuilder::GenerateCylinder("Limb", glm::vec3(0.5f, 0.5f, 1.f), 0.5f, 0.5f, 1, 8));
+		meshes.push_back(MeshBuilder::GenerateCube("Joint", glm::vec3(0.5f, 1.f, 0.5f), 1, 1, 1, 1));
+
+		// Far enough back to see most of the grid, so some but not all subtrees are culled
+		glm::mat4 view = glm::lookAt(glm::vec3(0.f, 30.f, 40.f), glm::vec3(0.f, 0.f, -60.f), glm::vec3(0.f, 1.f, 0.f));
+		glm::mat4 projection = glm::perspective(glm::radians(60.f), 4.f / 3.f, 0.1f, 1000.f);
+		Light light;
+		light.type = Light::LIGHT_DIRECTIONAL;
+		GLStateCache::GetInstance()->Enable(GL_DEPTH_TEST);
+
+		ThreadPool* pool = ThreadPool::GetInstance();
+		unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+		std::vector<unsigned> threadCounts;
+		for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+			threadCounts.push_back(threads);
+		threadCounts.push_back(maxThreads);
+		RenderQueue queue;
+		double baseline = 0.0;
+
+		printf("%u subtrees, %u frames, %u hardware threads\n", numSubtrees, numFrames, maxThreads);
+		printf("%-8s %14s %10s %14s %10s %10s\n", "threads", "prepare ms", "speedup", "replay ms", "draws", "culled");
+		for (size_t t = 0; t < threadCounts.size(); ++t)
+		{
+			unsigned threads = threadCounts[t];
+			pool->SetNumThreads(threads);
+			std::vector<CommandList> lists(pool->GetNumThreads());
+			std::vector<MatrixStack> stacks(pool->GetNumThreads());
+			double prepareTime = 0.0, replayTime = 0.0;
+			unsigned numDraws = 0, numCulled = 0;
+
+			for (unsigned f = 0; f <= numFrames; ++f)
+			{
+				float time = f * 0.016f;
+				std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+				for (size_t i = 0; i < lists.size(); ++i)
+					lists[i].Begin(view, projection);
+				pool->Run(numSubtrees, [&](unsigned index, unsigned thread)
+				{
+					RecordSubtree(stacks[thread], lists[thread], meshes, programID, index, time);
+				});
+				double prepare = Seconds(start);
+
+				start = std::chrono::high_resolution_clock::now();
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				UniformBlocks::GetInstance()->SetFrame(view, projection, &light, 1);
+				queue.Begin(view, projection);
+				for (size_t i = 0; i < lists.size(); ++i)
+					queue.Append(lists[i]);
+				queue.Flush();
+				glFinish();
+				double replay = Seconds(start);
+
+				// Frame 0 warms up the lists' capacity
+				if (f > 0)
+				{
+					prepareTime += prepare;
+					replayTime += replay;
+				}
+			}
+
+			numDraws = numCulled = 0;
+			for (size_t i = 0; i < lists.size(); ++i)
+			{
+				numDraws += lists[i].GetNumCommands();
+				numCulled += lists[i].GetNumCulled();
+			}
+			double prepareMs = prepareTime * 1000.0 / numFrames;
+			if (threads == 1)
+				baseline = prepareMs;
+			printf("%-8u %14.3f %10.2f %14.3f %10u %10u\n", threads, prepareMs, prepareMs > 0.0 ? baseline / prepareMs : 0.0,
+				replayTime * 1000.0 / numFrames, numDraws, numCulled);
+		}
+		pool->SetNumThreads(0);
+
+		for (size_t i = 0; i < meshes.size(); ++i)
+			delete meshes[i];
+		GLStateCache::GetInstance()->DeleteProgram(programID);
+	}
+
+	// Stand-in for a game scene: Update burns a fixed amount of CPU, Record lays out a grid of quads
+	class PipelineScene : public Scene
+	{
+	public:
+		PipelineScene(Mesh* mesh, unsigned programID, unsigned numDraws, double updateMs)
+			: mesh(mesh), programID(programID), numDraws(numDraws), updateMs(updateMs), time(0.0) {}
+
+		virtual void Init() {}
+		virtual void Exit() {}
+
+		virtual void Update(double dt)
+		{
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			while (Seconds(start) * 1000.0 < updateMs)
+			{
+			}
+			time += dt;
+		}
+
+		virtual void Render()
+		{
+			Record(serialFrame);
+			serialFrame.Replay(queue);
+		}
+
+		virtual bool SupportsRecord() const { return true; }
+
+		virtual void Record(FrameSnapshot& frame)
+		{
+			unsigned side = static_cast<unsigned>(ceil(sqrt(static_cast<double>(numDraws))));
+			frame.view = glm::lookAt(glm::vec3(0.f, 0.f, side * 1.2f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+			frame.projection = glm::perspective(glm::radians(60.f), 4.f / 3.f, 0.1f, 1000.f);
+			frame.lights.resize(1);
+			frame.lights[0].type = Light::LIGHT_POINT;
+			frame.lights[0].position = glm::vec3(0.f, 0.f, side * 0.5f);
+
+			frame.commands.Begin(frame.view, frame.projection);
+			for (unsigned i = 0; i < numDraws; ++i)
+			{
+				float x = (static_cast<float>(i % side) - side * 0.5f);
+				float y = (static_cast<float>(i / side) - side * 0.5f);
+				glm::mat4 model = glm::rotate(glm::translate(glm::mat4(1.f), glm::vec3(x, y, 0.f)), static_cast<float>(time), glm::vec3(0.f, 0.f, 1.f));
+				frame.commands.Submit(mesh, model, programID, true);
+			}
+		}
+
+	private:
+		Mesh* mesh;
+		unsigned programID;
+		unsigned numDraws;
+		double updateMs;
+		double time;
+		FrameSnapshot serialFrame;
+		RenderQueue queue;
+	};
+
+	// Frame time and input-to-present latency of the serial loop versus the pipelined render thread
+	void BenchmarkPipeline(int argc, char* argv[])
+	{
+		unsigned numDraws = argc > 0 ? static_cast<unsigned>(atoi(argv[0])) : 5000;
+		double updateMs = argc > 1 ? atof(argv[1]) : 4.0;
+		unsigned numFrames = argc > 2 ? static_cast<unsigned>(atoi(argv[2])) : 200;
+
+		unsigned programID = LoadShaders("Shader//Shading.vertexshader", "Shader//Shading.fragmentshader");
+		UniformBlocks::GetInstance()->BindProgram(programID);
+		UniformBlocks::GetInstance()->ReserveObjects(numDraws);
+		GLStateCache::GetInstance()->Enable(GL_DEPTH_TEST);
+
+		Mesh* mesh = MeshBuilder::GenerateQuad("Quad", glm::vec3(1.f), 0.8f);
+		PipelineScene scene(mesh, programID, numDraws, updateMs);
+
+		// Without vsync the swap does not hide how much the two threads overlap
+		GLFWwindow* window = glfwGetCurrentContext();
+		glfwSwapInterval(0);
+
+		printf("%u draws, %.1f ms update, %u frames\n", numDraws, updateMs, numFrames);
+		printf("%-12s %12s %10s %12s\n", "mode", "ms/frame", "fps", "latency ms");
+		const char* names[2] = { "serial", "pipelined" };
+		for (int mode = 0; mode < 2; ++mode)
+		{
+			FramePipeline pipeline(window);
+			if (!pipeline.Start(&scene, mode != 0) && mode != 0)
+				break;
+			for (unsigned f = 0; f < numFrames; ++f)
+			{
+				pipeline.Frame(1.0 / 60.0);
+				glfwPollEvents();
+			}
+			pipeline.Stop();
+
+			double frameTime = pipeline.GetFrameTime();
+			printf("%-12s %12.3f %10.1f %12.3f\n", names[mode], frameTime,
+				frameTime > 0.0 ? 1000.0 / frameTime : 0.0, pipeline.GetLatency());
+		}
+		glfwSwapInterval(1);
+
+		delete mesh;
+		GLStateCache::GetInstance()->DeleteProgram(programID);
+	}
+
+	// Model-views of one kind: 0 rigid, 1 uniform scale, 2 non-uniform scale, 3 an even mix of the three
+	void BuildModelViews(int kind, unsigned count, const glm::mat4& view, std::vector<glm::mat4>& out_modelViews)
+	{
+		out_modelViews.resize(count);
+		for (unsigned i = 0; i < count; ++i)
+		{
+			glm::mat4 model = glm::translate(glm::mat4(1.f), glm::vec3((i % 100) * 2.f, 0.f, -static_cast<float>(i / 100)));
+			model = glm::rotate(model, i * 0.37f, glm::normalize(glm::vec3(1.f, static_cast<float>(i % 7), 2.f)));
+			int k = kind < 3 ? kind : static_cast<int>(i % 3);
+			if (k == 1)
+				model = glm::scale(model, glm::vec3(2.5f));
+			else if (k == 2)
+				model = glm::scale(model, glm::vec3(1.f, 3.f, 0.5f));
+			out_modelViews[i] = view * model;
+		}
+	}
+
+	// Per-draw MVP and normal matrix: glm one draw at a time versus BatchTransform, per transform type
+	void BenchmarkTransform(int argc, char* argv[])
+	{
+		unsigned count = argc > 0 ? static_cast<unsigned>(atoi(argv[0])) : 100000;
+		unsigned numRuns = argc > 1 ? static_cast<unsigned>(atoi(argv[1])) : 20;
+
+		glm::mat4 view = glm::lookAt(glm::vec3(0.f, 30.f, 40.f), glm::vec3(0.f, 0.f, -60.f), glm::vec3(0.f, 1.f, 0.f));
+		glm::mat4 projection = glm::perspective(glm::radians(60.f), 4.f / 3.f, 0.1f, 1000.f);
+		std::vector<glm::mat4> modelViews, MVPs(count), normals(count);
+		BatchTransform batch;
+
+		printf("%u transforms, best of %u runs\n", count, numRuns);
+		printf("%-14s %12s %12s %12s %10s %12s\n", "type", "glm ms", "scalar ms", "batch ms", "speedup", "max error");
+		const char* names[4] = { "rigid", "uniform", "non-uniform", "mixed" };
+		for (int kind = 0; kind < 4; ++kind)
+		{
+			BuildModelViews(kind, count, view, modelViews);
+			double glmTime = 1e30, scalarTime = 1e30, batchTime = 1e30;
+			for (unsigned run = 0; run < numRuns; ++run)
+			{
+				// What RenderQueue::Flush and UniformBlocks::SetObject did per draw before
+				std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+				for (unsigned i = 0; i < count; ++i)
+				{
+					MVPs[i] = projection * modelViews[i];
+					normals[i] = glm::inverseTranspose(modelViews[i]);
+				}
+				glmTime = std::min(glmTime, Seconds(start));
+
+				batch.Begin(projection);
+				for (unsigned i = 0; i < count; ++i)
+					batch.Add(modelViews[i]);
+				start = std::chrono::high_resolution_clock::now();
+				batch.ComputeScalar();
+				scalarTime = std::min(scalarTime, Seconds(start));
+
+				start = std::chrono::high_resolution_clock::now();
+				batch.Compute();
+				batchTime = std::min(batchTime, Seconds(start));
+			}
+
+			// Only the 3x3 reaches the shaders
+			float maxError = 0.f;
+			for (unsigned i = 0; i < count; ++i)
+			{
+				for (int c = 0; c < 3; ++c)
+					for (int r = 0; r < 3; ++r)
+						maxError = std::max(maxError, fabsf(normals[i][c][r] - batch.GetNormalMatrix(i)[c][r]));
+			}
+			printf("%-14s %12.3f %12.3f %12.3f %10.2f %12g\n", names[kind], glmTime * 1000.0, scalarTime * 1000.0,
+				batchTime * 1000.0, batchTime > 0.0 ? glmTime / batchTime : 0.0, maxError);
+		}
+	}
+
+	// The std::stack<glm::mat4> MatrixStack this tree used before, kept as the baseline
+	class ReferenceStack
+	{
+	public:
+		ReferenceStack() { ms.push(glm::mat4(1.f)); }
+		const glm::mat4& Top() const { return ms.top(); }
+		void PushMatrix() { ms.push(ms.top()); }
+		void PopMatrix() { ms.pop(); }
+		void LoadIdentity() { ms.top() = glm::mat4(1.f); }
+		void Rotate(float degrees, float x, float y, float z) { ms.top() = ms.top() * glm::rotate(glm::mat4(1.f), glm::radians(degrees), glm::vec3(x, y, z)); }
+		void Scale(float x, float y, float z) { ms.top() = ms.top() * glm::scale(glm::mat4(1.f), glm::vec3(x, y, z)); }
+		void Translate(float x, float y, float z) { ms.top() = ms.top() * glm::translate(glm::mat4(1.f), glm::vec3(x, y, z)); }
+
+	private:
+		std::stack<glm::mat4> ms;
+	};
+
+	enum STACK_OP
+	{
+		OP_IDENTITY,
+		OP_PUSH,
+		OP_POP,
+		OP_TRANSLATE,
+		OP_SCALE,
+		OP_ROTATE,
+		OP_DRAW,
+	};
+
+	struct StackOp
+	{
+		STACK_OP op;
+		float a, b, c, d;
+
+		// Push, pop and draw take no arguments
+		StackOp(STACK_OP op, float a = 0.f, float b = 0.f, float c = 0.f, float d = 0.f)
+			: op(op), a(a), b(b), c(c), d(d)
+		{
+		}
+	};
+
+	// modelStack calls SceneLight::Render made for the robot before it became a SceneGraph, in order, with every animation branch taken and the
+	// animation values frozen mid-swing; OP_DRAW is where RenderMesh reads the top
+	const StackOp ROBOT_OPS[] =
+	{
+		{ OP_IDENTITY }, { OP_PUSH }, { OP_DRAW }, { OP_POP }, { OP_PUSH }, { OP_TRANSLATE, 0.f, 5.f + 4, 0.f },
+		{ OP_SCALE, 0.1f, 0.1f, 0.1f }, { OP_DRAW }, { OP_POP }, { OP_PUSH }, { OP_ROTATE, 100, 1, 0, 0 },
+		{ OP_TRANSLATE, 0, 0.1f, 0 }, { OP_TRANSLATE, 0, 0.5f, 0.3f }, { OP_ROTATE, 45.f, 1, 0, 0 },
+		{ OP_ROTATE, 45.f, 0, 1, 0 }, { OP_ROTATE, 0.3f * 3, 0, 0, 1 }, { OP_PUSH }, { OP_ROTATE, 10.f, 0, 0, 1 },
+		{ OP_ROTATE, -45, 1, 0, 0 }, { OP_ROTATE, 10.f, 0, 1, 0 }, { OP_ROTATE, 10.f, 1, 0, 0 },
+		{ OP_ROTATE, -45.f, 0, 1, 0 }, { OP_PUSH }, { OP_PUSH }, { OP_PUSH }, { OP_TRANSLATE, -1, 2.2f, 1.1f },
+		{ OP_SCALE, 0.3f, 0.3f, 0.3f }, { OP_ROTATE, 90, 1, 0, 0 }, { OP_DRAW }, { OP_POP },
+		{ OP_TRANSLATE, -1, 2.2f, 1.15f }, { OP_SCALE, 0.3f, 0.3f, 0.3f }, { OP_ROTATE, 90, 1, 0, 0 },
+		{ OP_ROTATE, 45, 0, 0, 1 }, { OP_DRAW }, { OP_POP }, { OP_PUSH }, { OP_PUSH }, { OP_TRANSLATE, 1, 2.2f, 1.1f },
+		{ OP_SCALE, 0.3f, 0.3f, 0.3f }, { OP_ROTATE, 90, 1, 0, 0 }, { OP_DRAW }, { OP_POP },
+		{ OP_TRANSLATE, 1, 2.2f, 1.15f }, { OP_SCALE, 0.3f, 0.3f, 0.3f }, { OP_ROTATE, 90, 1, 0, 0 },
+		{ OP_ROTATE, -45, 0, 0, 1 }, { OP_DRAW }, { OP_POP }, { OP_TRANSLATE, 0, 2, 0 }, { OP_SCALE, 1.9f, 1.5f, 1.5f },
+		{ OP_DRAW }, { OP_POP }, { OP_TRANSLATE, 0, 0.45f, 0 }, { OP_SCALE, 0.35f, 0.35f, 0.35f }, { OP_DRAW }, { OP_POP },
+		{ OP_PUSH }, { OP_TRANSLATE, 0, -0.9f, 0 }, { OP_SCALE, 1.f, 2.65f, 1.f }, { OP_DRAW }, { OP_POP }, { OP_PUSH },
+		{ OP_TRANSLATE, -1, 0, 0 }, { OP_ROTATE, -0.3f, 0, 0, 1 }, { OP_ROTATE, 0.3f, 0, 0, 1 }, { OP_ROTATE, 45, 0, 0, 1 },
+		{ OP_ROTATE, -0.3f, 0, 1, 0 }, { OP_ROTATE, 15.f, 0, 0, 1 }, { OP_ROTATE, 15.f, 0, 1, 0 },
+		{ OP_ROTATE, 45.f * 2, 0, 0, 1 }, { OP_ROTATE, 0.3f * 5, 0, 1, 0 }, { OP_PUSH }, { OP_PUSH },
+		{ OP_TRANSLATE, -1.3f, 0, 0 }, { OP_ROTATE, 15.f * 3.5f, 0, 1, 0 }, { OP_ROTATE, -0.3f * 7, 0, 1, 0 }, { OP_PUSH },
+		{ OP_PUSH }, { OP_PUSH }, { OP_TRANSLATE, -1.5f, 0.25f, 0 }, { OP_SCALE, 0.4f / 3, 0.4f / 3, 0.4f / 3 }, { OP_DRAW },
+		{ OP_POP }, { OP_PUSH }, { OP_TRANSLATE, -1.65f, 0, 0 }, { OP_SCALE, 0.4f / 3, 0.4f / 3, 0.4f / 3 }, { OP_DRAW },
+		{ OP_POP }, { OP_PUSH }, { OP_TRANSLATE, -1.5f, -0.2f, 0 }, { OP_SCALE, 0.4f / 3, 0.4f / 3, 0.4f / 3 }, { OP_DRAW },
+		{ OP_POP }, { OP_TRANSLATE, -1.25f, 0, 0 }, { OP_SCALE, 0.4f, 0.4f, 0.4f }, { OP_DRAW }, { OP_POP },
+		{ OP_TRANSLATE, -.2f, 0, 0 }, { OP_SCALE, 0.5f, 0.25f, 0.25f }, { OP_ROTATE, 90, 0, 0, 1 }, { OP_DRAW }, { OP_POP },
+		{ OP_SCALE, 0.4f, 0.4f, 0.4f }, { OP_DRAW }, { OP_POP }, { OP_TRANSLATE, -.2f, 0, 0 }, { OP_ROTATE, 90, 0, 0, 1 },
+		{ OP_SCALE, 0.25f, 0.5f, 0.25f }, { OP_DRAW }, { OP_POP }, { OP_SCALE, 0.4f, 0.4f, 0.4f }, { OP_DRAW }, { OP_POP },
+		{ OP_PUSH }, { OP_TRANSLATE, 1, 0, 0 }, { OP_ROTATE, 0.3f, 0, 0, 1 }, { OP_ROTATE, 0.3f, 0, 0, 1 },
+		{ OP_ROTATE, -45, 0, 0, 1 }, { OP_ROTATE, 0.3f, 0, 1, 0 }, { OP_ROTATE, -15.f, 0, 0, 1 },
+		{ OP_ROTATE, -15.f, 0, 1, 0 }, { OP_ROTATE, -45.f * 2, 0, 0, 1 }, { OP_ROTATE, -0.3f * 5, 0, 1, 0 }, { OP_PUSH },
+		{ OP_PUSH }, { OP_TRANSLATE, 1.3f, 0, 0 }, { OP_ROTATE, 30.f, 0, 0, 1 }, { OP_ROTATE, -15.f * 3.5f, 0, 1, 0 },
+		{ OP_ROTATE, 0.3f * 7, 0, 1, 0 }, { OP_PUSH }, { OP_PUSH }, { OP_PUSH }, { OP_TRANSLATE, 1.5f, 0.25f, 0 },
+		{ OP_SCALE, 0.4f/3, 0.4f/3, 0.4f/3 }, { OP_DRAW }, { OP_POP }, { OP_PUSH }, { OP_TRANSLATE, 1.65f, 0, 0 },
+		{ OP_SCALE, 0.4f / 3, 0.4f / 3, 0.4f / 3 }, { OP_DRAW }, { OP_POP }, { OP_PUSH }, { OP_TRANSLATE, 1.5f, -0.2f, 0 },
+		{ OP_SCALE, 0.4f / 3, 0.4f / 3, 0.4f / 3 }, { OP_DRAW }, { OP_POP }, { OP_TRANSLATE, 1.25f, 0, 0 },
+		{ OP_SCALE, 0.4f, 0.4f, 0.4f }, { OP_DRAW }, { OP_POP }, { OP_TRANSLATE, .15f, 0, 0 },
+		{ OP_SCALE, 0.5f, 0.25f, 0.25f }, { OP_ROTATE, -90, 0, 0, 1 }, { OP_DRAW }, { OP_POP },
+		{ OP_SCALE, 0.4f, 0.4f, 0.4f }, { OP_DRAW }, { OP_POP }, { OP_TRANSLATE, 1.2f, 0, 0 }, { OP_ROTATE, 90, 0, 0, 1 },
+		{ OP_SCALE, 0.25f, 0.5f, 0.25f }, { OP_DRAW }, { OP_POP }, { OP_SCALE, 0.4f, 0.4f, 0.4f }, { OP_DRAW }, { OP_POP },
+		{ OP_PUSH }, { OP_TRANSLATE, -1, -2, 0 }, { OP_TRANSLATE, 0, -0.1f * 0.5f, 0 }, { OP_ROTATE, -0.5f, 1, 0, 0 },
+		{ OP_ROTATE, 20.f, 1, 0, 0 }, { OP_ROTATE, -20.f, 1, 0, 1 }, { OP_ROTATE, -0.3f * 3, 0, 0, 1 }, { OP_PUSH },
+		{ OP_TRANSLATE, 0, -1.25f, 0 }, { OP_PUSH }, { OP_TRANSLATE, 0, -0.15f, 0 }, { OP_ROTATE, 0.5f * 2, 1, 0, 0 },
+		{ OP_ROTATE, 20.f, 1, 0, 1 }, { OP_PUSH }, { OP_TRANSLATE, 0, -1.25f, 0 }, { OP_PUSH },
+		{ OP_TRANSLATE, 0, -0.25f, 0 }, { OP_ROTATE, -0.5f / 1.5f, 1, 0, 0 }, { OP_PUSH }, { OP_TRANSLATE, 0, -0.45f, 0.1f },
+		{ OP_TRANSLATE, 0, 0.1f, 0 }, { OP_SCALE, 0.55f, 0.15f, 0.55f }, { OP_ROTATE, 35, 0, 1, 0 }, { OP_DRAW }, { OP_POP },
+		{ OP_SCALE, 0.4f, 0.4f, 0.4f }, { OP_DRAW }, { OP_POP }, { OP_SCALE, 0.25f, 0.65f, 0.25f }, { OP_DRAW }, { OP_POP },
+		{ OP_SCALE, 0.4f, 0.4f, 0.4f }, { OP_DRAW }, { OP_POP }, { OP_SCALE, 0.25f, 0.65f, 0.25f }, { OP_DRAW }, { OP_POP },
+		{ OP_SCALE, 0.4f, 0.4f, 0.4f }, { OP_DRAW }, { OP_POP }, { OP_PUSH }, { OP_TRANSLATE, 1.f, -2, 0 },
+		{ OP_TRANSLATE, 0, -0.1f * 0.5f, 0 }, { OP_ROTATE, -0.5f, 1, 0, 0 }, { OP_ROTATE, -20.f, 1, 0, 0 },
+		{ OP_ROTATE, 20.f, 1, 0, 1 }, { OP_ROTATE, -0.5f * 5, 1, 0, 0 }, { OP_PUSH }, { OP_TRANSLATE, 0, -1.25f, 0 },
+		{ OP_PUSH }, { OP_TRANSLATE, 0, -0.15f, 0 }, { OP_ROTATE, 0.5f * 2, 1, 0, 0 }, { OP_ROTATE, 0.5f * 5, 1, 0, 0 },
+		{ OP_PUSH }, { OP_TRANSLATE, 0, -1.25f, 0 }, { OP_PUSH }, { OP_TRANSLATE, 0, -0.25f, 0 },
+		{ OP_ROTATE, -0.5f/1.5f, 1, 0, 0 }, { OP_PUSH }, { OP_TRANSLATE, 0, -0.45f, 0.1f }, { OP_TRANSLATE, 0, 0.1f, 0 },
+		{ OP_SCALE, 0.55f, 0.15f, 0.55f }, { OP_ROTATE, -35, 0, 1, 0 }, { OP_DRAW }, { OP_POP },
+		{ OP_SCALE, 0.4f, 0.4f, 0.4f }, { OP_DRAW }, { OP_POP }, { OP_SCALE, 0.25f, 0.65f, 0.25f }, { OP_DRAW }, { OP_POP },
+		{ OP_SCALE, 0.4f, 0.4f, 0.4f }, { OP_DRAW }, { OP_POP }, { OP_SCALE, 0.25f, 0.65f, 0.25f }, { OP_DRAW }, { OP_POP },
+		{ OP_SCALE, 0.4f, 0.4f, 0.4f }, { OP_DRAW }, { OP_POP }, { OP_TRANSLATE, 0, -1.8f, 0 }, { OP_SCALE, .4f, .4f, .4f },
+		{ OP_DRAW }, { OP_POP },
+	};
+
+	// Replays the robot once; the returned matrix sums the drawn tops so nothing is optimized away
+	template <typename Stack>
+	glm::mat4 ReplayRobot(Stack& stack)
+	{
+		glm::mat4 sum(0.f);
+		for (size_t i = 0; i < sizeof(ROBOT_OPS) / sizeof(ROBOT_OPS[0]); ++i)
+		{
+			const StackOp& op = ROBOT_OPS[i];
+			switch (op.op)
+			{
+			case OP_IDENTITY: stack.LoadIdentity(); break;
+			case OP_PUSH: stack.PushMatrix(); break;
+			case OP_POP: stack.PopMatrix(); break;
+			case OP_TRANSLATE: stack.Translate(op.a, op.b, op.c); break;
+			case OP_SCALE: stack.Scale(op.a, op.b, op.c); break;
+			case OP_ROTATE: stack.Rotate(op.a, op.b, op.c, op.d); break;
+			case OP_DRAW: sum += stack.Top(); break;
+			}
+		}
+		return sum;
+	}
+
+	template <typename Stack>
+	double TimeRobot(unsigned numFrames, glm::mat4& out_sum)
+	{
+		Stack stack;
+		out_sum = glm::mat4(0.f);
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (unsigned f = 0; f < numFrames; ++f)
+			out_sum += ReplayRobot(stack);
+		return Seconds(start);
+	}
+
+	// SceneLight's robot push/pop sequence on the old std::stack MatrixStack and the fixed-capacity one
+	void BenchmarkMatrixStack(int argc, char* argv[])
+	{
+		unsigned numFrames = argc > 0 ? static_cast<unsigned>(atoi(argv[0])) : 100000;
+		unsigned numOps = static_cast<unsigned>(sizeof(ROBOT_OPS) / sizeof(ROBOT_OPS[0]));
+
+		glm::mat4 referenceSum, stackSum;
+		double referenceTime = TimeRobot<ReferenceStack>(numFrames, referenceSum);
+		double stackTime = TimeRobot<MatrixStack>(numFrames, stackSum);
+
+		float maxError = 0.f;
+		for (int c = 0; c < 4; ++c)
+			for (int r = 0; r < 4; ++r)
+				maxError = std::max(maxError, fabsf(referenceSum[c][r] - stackSum[c][r]) / (1.f + fabsf(referenceSum[c][r])));
+
+		printf("%u robot frames of %u stack calls\n", numFrames, numOps);
+		printf("%-14s %12s %12s\n", "stack", "us/frame", "ns/call");
+		printf("%-14s %12.3f %12.2f\n", "std::stack", referenceTime * 1e6 / numFrames, referenceTime * 1e9 / (static_cast<double>(numFrames) * numOps));
+		printf("%-14s %12.3f %12.2f\n", "MatrixStack", stackTime * 1e6 / numFrames, stackTime * 1e9 / (static_cast<double>(numFrames) * numOps));
+		printf("speedup %.2f, max relative difference %g\n", stackTime > 0.0 ? referenceTime / stackTime : 0.0, maxError);
+	}
+
+	// Rebuilds the robot's push/pop sequence as a SceneGraph. Each push opens a node that collects the
+	// transforms after it; a transform that follows a child only affects later siblings, so it opens a
+	// fresh segment node instead. Draws become leaves, and nodes that rotate are taken as the joints
+	struct RobotGraph
+	{
+		SceneGraph graph;
+		std::vector<unsigned> draws;
+		std::vector<unsigned> joints;
+
+		void Build()
+		{
+			struct Level
+			{
+				unsigned node;
+				unsigned segments;
+				bool hasChildren;
+			};
+			std::vector<Level> levels;
+			MatrixStack local;
+
+			graph.Clear();
+			Level root = { graph.BeginNode(glm::mat4(1.f)), 0, false };
+			levels.push_back(root);
+			for (size_t i = 0; i < sizeof(ROBOT_OPS) / sizeof(ROBOT_OPS[0]); ++i)
+			{
+				const StackOp& op = ROBOT_OPS[i];
+				Level& level = levels.back();
+				switch (op.op)
+				{
+				case OP_IDENTITY:
+					break;
+				case OP_PUSH:
+				{
+					level.hasChildren = true;
+					Level child = { graph.BeginNode(glm::mat4(1.f)), 0, false };
+					levels.push_back(child);
+					break;
+				}
+				case OP_POP:
+					for (unsigned s = 0; s <= level.segments; ++s)
+						graph.EndNode();
+					levels.pop_back();
+					break;
+				case OP_DRAW:
+					level.hasChildren = true;
+					draws.push_back(graph.AddNode(glm::mat4(1.f), nullptr, Material()));
+					break;
+				default:
+					if (level.hasChildren)
+					{
+						level.node = graph.BeginNode(glm::mat4(1.f));
+						level.hasChildren = false;
+						++level.segments;
+					}
+					local.LoadMatrix(graph.GetLocal(level.node));
+					if (op.op == OP_TRANSLATE)
+						local.Translate(op.a, op.b, op.c);
+					else if (op.op == OP_SCALE)
+						local.Scale(op.a, op.b, op.c);
+					else
+					{
+						local.Rotate(op.a, op.b, op.c, op.d);
+						if (joints.empty() || joints.back() != level.node)
+							joints.push_back(level.node);
+					}
+					graph.SetLocal(level.node, local.Top());
+					break;
+				}
+			}
+			while (!levels.empty())
+			{
+				for (unsigned s = 0; s <= levels.back().segments; ++s)
+					graph.EndNode();
+				levels.pop_back();
+			}
+			graph.Update();
+		}
+
+		glm::mat4 SumDraws() const
+		{
+			glm::mat4 sum(0.f);
+			for (size_t i = 0; i < draws.size(); ++i)
+				sum += graph.GetWorld(draws[i]);
+			return sum;
+		}
+	};
+
+	// Per frame, either replays the whole robot on the MatrixStack as SceneLight used to, or sets the
+	// moving joints of a retained graph and lets Update recompute only what hangs under them
+	void BenchmarkSceneGraph(int argc, char* argv[])
+	{
+		unsigned numFrames = argc > 0 ? static_cast<unsigned>(atoi(argv[0])) : 100000;
+
+		RobotGraph robot;
+		robot.Build();
+		unsigned numJoints = static_cast<unsigned>(robot.joints.size());
+
+		glm::mat4 stackSum;
+		{
+			MatrixStack stack;
+			stackSum = ReplayRobot(stack);
+		}
+		glm::mat4 graphSum = robot.SumDraws();
+		float maxError = 0.f;
+		for (int c = 0; c < 4; ++c)
+			for (int r = 0; r < 4; ++r)
+				maxError = std::max(maxError, fabsf(stackSum[c][r] - graphSum[c][r]) / (1.f + fabsf(stackSum[c][r])));
+
+		// Each joint swings between its rest pose and a few degrees off it
+		std::vector<glm::mat4> rest(numJoints), swung(numJoints);
+		for (unsigned j = 0; j < numJoints; ++j)
+		{
+			rest[j] = robot.graph.GetLocal(robot.joints[j]);
+			swung[j] = glm::rotate(rest[j], glm::radians(5.f), glm::vec3(0, 0, 1));
+		}
+
+		printf("%u frames, robot of %u nodes, %u draws, %u joints, max relative difference %g\n",
+			numFrames, robot.graph.GetNumNodes(), static_cast<unsigned>(robot.draws.size()), numJoints, maxError);
+		printf("%-14s %12s %14s\n", "path", "us/frame", "nodes/frame");
+
+		MatrixStack stack;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (unsigned f = 0; f < numFrames; ++f)
+			stackSum += ReplayRobot(stack);
+		double elapsed = Seconds(start);
+		printf("%-14s %12.3f %14u\n", "immediate", elapsed * 1e6 / numFrames, robot.graph.GetNumNodes());
+
+		// All joints moving, the last one only (a single hand), and none (the default pose)
+		const unsigned moving[3] = { numJoints, 1, 0 };
+		const char* names[3] = { "graph all", "graph one", "graph still" };
+		for (int m = 0; m < 3; ++m)
+		{
+			unsigned long long numUpdated = 0;
+			start = std::chrono::high_resolution_clock::now();
+			for (unsigned f = 0; f < numFrames; ++f)
+			{
+				const std::vector<glm::mat4>& pose = (f & 1) ? swung : rest;
+				for (unsigned j = numJoints - moving[m]; j < numJoints; ++j)
+					robot.graph.SetLocal(robot.joints[j], pose[j]);
+				robot.graph.Update();
+				numUpdated += robot.graph.GetNumUpdated();
+			}
+			elapsed = Seconds(start);
+			printf("%-14s %12.3f %14.1f\n", names[m], elapsed * 1e6 / numFrames, static_cast<double>(numUpdated) / numFrames);
+		}
+	}
+
+	// What a scene object looked like before EntityStore: every field of one object together
+	struct SceneObject
+	{
+		glm::vec3 position, scale, axis;
+		float angle;
+		glm::mat4 world;
+		Mesh* mesh;
+		Material material;
+		float spinSpeed, bobHeight, bobFrequency, bobPhase;
+		glm::vec4 bounds;
+	};
+
+	// Entity systems on 1..N threads against the same objects as an array of structs on one thread
+	void BenchmarkEntities(int argc, char* argv[])
+	{
+		unsigned numEntities = argc > 0 ? static_cast<unsigned>(atoi(argv[0])) : 100000;
+		unsigned numFrames = argc > 1 ? static_cast<unsigned>(atoi(argv[1])) : 60;
+		const float dt = 1.f / 60.f;
+
+		Mesh* mesh = MeshBuilder::GenerateSphere("Sphere", glm::vec3(1.f), 0.5f, 12, 6);
+		glm::mat4 view = glm::lookAt(glm::vec3(0.f, 60.f, 60.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+		glm::mat4 projection = glm::perspective(glm::radians(45.f), 4.f / 3.f, 0.1f, 1000.f);
+		unsigned side = static_cast<unsigned>(ceil(sqrt(static_cast<double>(numEntities))));
+
+		EntityStore store;
+		store.Reserve(numEntities);
+		unsigned handle = store.AddMesh(mesh);
+		std::vector<SceneObject> objects(numEntities);
+		for (unsigned i = 0; i < numEntities; ++i)
+		{
+			glm::vec3 position((static_cast<float>(i % side) - side * 0.5f) * 2.5f, 0.f, (static_cast<float>(i / side) - side * 0.5f) * 2.5f);
+			EntityStore::Entity entity = store.Create(handle, mesh->material, position);
+			store.SetRotation(entity, glm::vec3(0.f, 1.f, 0.f), static_cast<float>(i % 360));
+			store.SetSpin(entity, 90.f);
+			store.SetBob(entity, 0.5f, 0.5f, static_cast<float>(i) * 0.1f);
+
+			SceneObject& object = objects[i];
+			object.position = position;
+			object.scale = glm::vec3(1.f);
+			object.axis = glm::vec3(0.f, 1.f, 0.f);
+			object.angle = static_cast<float>(i % 360);
+			object.mesh = mesh;
+			object.material = mesh->material;
+			object.spinSpeed = 90.f;
+			object.bobHeight = 0.5f;
+			object.bobFrequency = 0.5f;
+			object.bobPhase = static_cast<float>(i) * 0.1f;
+		}
+
+		// The per-object loop a scene would have written by hand
+		double objectTime = 0.0;
+		float time = 0.f;
+		for (unsigned f = 0; f < numFrames; ++f)
+		{
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			time += dt;
+			for (size_t i = 0; i < objects.size(); ++i)
+			{
+				SceneObject& object = objects[i];
+				object.angle = fmodf(object.angle + object.spinSpeed * dt, 360.f);
+				float bob = object.bobHeight * sinf(6.2831853f * object.bobFrequency * time + object.bobPhase);
+				object.world = glm::translate(glm::mat4(1.f), object.position + glm::vec3(0.f, bob, 0.f));
+				object.world = glm::rotate(object.world, glm::radians(object.angle), object.axis);
+				object.world = glm::scale(object.world, object.scale);
+				object.bounds = glm::vec4(glm::vec3(object.world * glm::vec4(mesh->boundsCenter, 1.f)), mesh->boundsRadius);
+			}
+			objectTime += Seconds(start);
+		}
+
+		ThreadPool* pool = ThreadPool::GetInstance();
+		unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+		std::vector<unsigned> threadCounts;
+		for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+			threadCounts.push_back(threads);
+		threadCounts.push_back(maxThreads);
+		std::vector<CommandList> lists;
+
+		printf("%u entities, %u frames, %u hardware threads\n", numEntities, numFrames, maxThreads);
+		printf("%-14s %12s %12s %10s\n", "path", "update ms", "record ms", "drawn");
+		printf("%-14s %12.3f %12s %10s\n", "objects", objectTime * 1000.0 / numFrames, "-", "-");
+		for (size_t t = 0; t < threadCounts.size(); ++t)
+		{
+			pool->SetNumThreads(threadCounts[t]);
+			double updateTime = 0.0, recordTime = 0.0;
+			unsigned numDrawn = 0;
+			for (unsigned f = 0; f < numFrames; ++f)
+			{
+				store.Update(dt);
+				store.Record(lists, view, projection, 0, true);
+				updateTime += store.GetUpdateTime();
+				recordTime += store.GetRecordTime();
+			}
+			for (size_t i = 0; i < lists.size(); ++i)
+				numDrawn += lists[i].GetNumCommands();
+
+			char name[32];
+			snprintf(name, sizeof(name), "store x%u", threadCounts[t]);
+			printf("%-14s %12.3f %12.3f %10u\n", name, updateTime / numFrames, recordTime / numFrames, numDrawn);
+		}
+		pool->SetNumThreads(0);
+
+		delete mesh;
+	}
+
+	// A looping clip with every joint turning and sliding differently, like a motion-captured skeleton
+	void BuildBenchmarkClip(AnimationClip& clip, const char* name, unsigned numJoints, unsigned numKeys, float phase)
+	{
+		clip.Create(name, numJoints, numKeys, 30.f, true);
+		AnimationPose key;
+		key.Resize(numJoints);
+		for (unsigned k = 0; k < numKeys; ++k)
+		{
+			float t = 6.2831853f * k / (numKeys - 1);
+			for (unsigned j = 0; j < numJoints; ++j)
+			{
+				float angle = 0.6f * sinf(t + j * 0.37f + phase);
+				glm::vec3 axis = glm::normalize(glm::vec3(sinf(j * 1.3f), 1.f, cosf(j * 0.7f)));
+				key.SetJoint(j, glm::vec3(0.f, 0.5f + 0.1f * sinf(t + j), 0.f), glm::angleAxis(angle, axis), glm::vec3(1.f));
+			}
+			clip.SetKey(k, key);
+		}
+	}
+
+	// Clip sampling and cross-fading, one joint at a time against four, then the SIMD path across threads
+	void BenchmarkAnimation(int argc, char* argv[])
+	{
+		unsigned numInstances = argc > 0 ? static_cast<unsigned>(atoi(argv[0])) : 1000;
+		unsigned numJoints = argc > 1 ? static_cast<unsigned>(atoi(argv[1])) : 64;
+		unsigned numFrames = argc > 2 ? static_cast<unsigned>(atoi(argv[2])) : 60;
+		const float dt = 1.f / 60.f;
+
+		std::vector<AnimationClip> clips(2);
+		BuildBenchmarkClip(clips[0], "walk", numJoints, 121, 0.f);
+		BuildBenchmarkClip(clips[1], "run", numJoints, 61, 1.f);
+
+		// Every instance owns its pose and is at a different point in the clips
+		std::vector<AnimationPose> poses(numInstances);
+		std::vector<float> offsets(numInstances);
+		for (unsigned i = 0; i < numInstances; ++i)
+		{
+			poses[i].Resize(numJoints);
+			offsets[i] = i * 0.0137f;
+		}
+
+		ThreadPool* pool = ThreadPool::GetInstance();
+		unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+		std::vector<AnimationPose> scratch(maxThreads);
+		const unsigned INSTANCES_PER_TASK = 64;
+		unsigned numTasks = (numInstances + INSTANCES_PER_TASK - 1) / INSTANCES_PER_TASK;
+
+		printf("%u instances, %u joints, %u frames, %u hardware threads\n", numInstances, numJoints, numFrames, maxThreads);
+		printf("%-16s %12s %14s %12s %14s\n", "path", "sample ms", "Mjoints/s", "fade ms", "Mjoints/s");
+
+		const char* names[] = { "scalar", "sse", "sse threaded" };
+		AnimationPose checkSse, checkScalar;
+		for (int m = 0; m < 3; ++m)
+		{
+			pool->SetNumThreads(m == 2 ? maxThreads : 1);
+			double elapsed[2] = { 0.0, 0.0 };
+			for (int fade = 0; fade < 2; ++fade)
+			{
+				float time = 0.f;
+				for (unsigned f = 0; f < numFrames; ++f)
+				{
+					std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+					time += dt;
+					pool->Run(numTasks, [&](unsigned task, unsigned thread)
+					{
+						unsigned end = std::min((task + 1) * INSTANCES_PER_TASK, numInstances);
+						for (unsigned i = task * INSTANCES_PER_TASK; i < end; ++i)
+						{
+							float t = time + offsets[i];
+							if (m == 0)
+								clips[0].SampleScalar(t, poses[i]);
+							else
+								clips[0].Sample(t, poses[i]);
+							if (!fade)
+								continue;
+							// Halfway through a cross-fade into the other clip
+							if (m == 0)
+							{
+								clips[1].SampleScalar(t, scratch[thread]);
+								AnimationPose::BlendScalar(poses[i], scratch[thread], 0.5f, poses[i]);
+							}
+							else
+							{
+								clips[1].Sample(t, scratch[thread]);
+								AnimationPose::Blend(poses[i], scratch[thread], 0.5f, poses[i]);
+							}
+						}
+					});
+					elapsed[fade] += Seconds(start);
+				}
+			}
+			double joints = static_cast<double>(numInstances) * numJoints * numFrames;
+			printf("%-16s %12.3f %14.1f %12.3f %14.1f\n", names[m], elapsed[0] * 1000.0 / numFrames, joints / elapsed[0] * 1e-6,
+				elapsed[1] * 1000.0 / numFrames, joints / elapsed[1] * 1e-6);
+		}
+		pool->SetNumThreads(0);
+
+		// The SSE path renormalizes with an estimate; it should still agree with the scalar one
+		float maxDifference = 0.f;
+		for (unsigned i = 0; i < 97; ++i)
+		{
+			clips[0].Sample(i * 0.05f, checkSse);
+			clips[0].SampleScalar(i * 0.05f, checkScalar);
+			for (unsigned c = 0; c < AnimationPose::NUM_CHANNELS; ++c)
+			{
+				const float* a = checkSse.GetChannel(static_cast<AnimationPose::CHANNEL>(c));
+				const float* b = checkScalar.GetChannel(static_cast<AnimationPose::CHANNEL>(c));
+				for (unsigned j = 0; j < numJoints; ++j)
+					maxDifference = std::max(maxDifference, fabsf(a[j] - b[j]));
+			}
+		}
+		printf("sse against scalar: max difference %g\n", maxDifference);
+
+		// Round trip through the file format
+		const char* path = "benchmark.anim";
+		std::vector<AnimationClip> loaded;
+		if (SaveAnimation(path, clips) && LoadAnimation(path, loaded))
+		{
+			float maxError = 0.f;
+			size_t rawBytes = 0;
+			for (size_t c = 0; c < clips.size(); ++c)
+			{
+				unsigned numFloats = AnimationPose::NUM_CHANNELS * clips[c].GetStride() * clips[c].GetNumKeys();
+				rawBytes += numFloats * sizeof(float);
+				const float* a = clips[c].GetKeyData(0);
+				const float* b = loaded[c].GetKeyData(0);
+				for (unsigned i = 0; i < numFloats; ++i)
+					maxError = std::max(maxError, fabsf(a[i] - b[i]));
+			}
+			long long fileBytes = std::ifstream(path, std::ios::binary | std::ios::ate).tellg();
+			printf("file: %lld bytes for %u raw, max error %g\n", fileBytes, static_cast<unsigned>(rawBytes), maxError);
+		}
+		remove(path);
+	}
+
+	// Model space pose of a bent chain of joints up the y axis, as a tentacle or spine would be
+	void BendChain(unsigned numJoints, float segment, float time, glm::mat4* pose)
+	{
+		glm::mat4 joint(1.f);
+		for (unsigned j = 0; j < numJoints; ++j)
+		{
+			if (j > 0)
+				joint = glm::translate(joint, glm::vec3(0.f, segment, 0.f));
+			joint = glm::rotate(joint, 0.3f * sinf(time + j * 0.5f), glm::vec3(0.f, 0.f, 1.f));
+			joint = glm::rotate(joint, 0.2f * cosf(time * 0.7f + j * 0.3f), glm::vec3(1.f, 0.f, 0.f));
+			pose[j] = joint;
+		}
+	}
+
+	// Skinning.vertexshader on its own, capturing its camera space outputs with transform feedback
+	unsigned LoadSkinningCapture(void)
+	{
+		std::ifstream stream("Shader//Skinning.vertexshader");
+		std::string code((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+		if (code.empty())
+			return 0;
+
+		const char* source = code.c_str();
+		GLuint shader = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(shader, 1, &source, NULL);
+		glCompileShader(shader);
+
+		GLuint program = glCreateProgram();
+		glAttachShader(program, shader);
+		const char* varyings[] = { "vertexPosition_cameraspace", "vertexNormal_cameraspace" };
+		glTransformFeedbackVaryings(program, 2, varyings, GL_INTERLEAVED_ATTRIBS);
+		glLinkProgram(program);
+		glDeleteShader(shader);
+
+		GLint linked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (!linked)
+		{
+			glDeleteProgram(program);
+			return 0;
+		}
+		UniformBlocks::GetInstance()->BindProgram(program);
+		return program;
+	}
+
+	// One skinned draw per character against one rigid draw per bone, and the GPU skin checked against the CPU one
+	void BenchmarkSkinning(int argc, char* argv[])
+	{
+		unsigned numCharacters = argc > 0 ? static_cast<unsigned>(atoi(argv[0])) : 200;
+		unsigned numJoints = argc > 1 ? static_cast<unsigned>(atoi(argv[1])) : 32;
+		unsigned numFrames = argc > 2 ? static_cast<unsigned>(atoi(argv[2])) : 100;
+		numJoints = std::max(1u, std::min(numJoints, static_cast<unsigned>(UniformBlocks::MAX_SKIN_JOINTS)));
+		const float length = 4.f;
+		float segment = length / numJoints;
+
+		SkinnedMesh* skinned = MeshBuilder::GenerateSkinnedCylinder("Skinned", glm::vec3(1.f), 0.2f, length, numJoints, 16, numJoints * 4);
+		skinned->material.kAmbient = glm::vec3(0.1f);
+		skinned->material.kDiffuse = glm::vec3(0.6f);
+		// The rigid character: one cylinder per bone, drawn with that bone's matrix
+		Mesh* bone = MeshBuilder::GenerateCylinder("Bone", glm::vec3(1.f), 0.2f, 0.2f, 1, 16);
+		bone->material = skinned->material;
+
+		unsigned shadingProgram = LoadShaders("Shader//Shading.vertexshader", "Shader//Shading.fragmentshader");
+		unsigned skinningProgram = LoadShaders("Shader//Skinning.vertexshader", "Shader//Shading.fragmentshader");
+		UniformBlocks::GetInstance()->BindProgram(shadingProgram);
+		UniformBlocks::GetInstance()->BindProgram(skinningProgram);
+		UniformBlocks::GetInstance()->ReserveObjects(numCharacters * (numJoints + 16));
+
+		unsigned side = static_cast<unsigned>(ceil(sqrt(static_cast<double>(numCharacters))));
+		glm::mat4 view = glm::lookAt(glm::vec3(0.f, side * 0.5f, side * 1.5f), glm::vec3(0.f, length * 0.5f, 0.f), glm::vec3(0.f, 1.f, 0.f));
+		glm::mat4 projection = glm::perspective(glm::radians(60.f), 4.f / 3.f, 0.1f, 1000.f);
+		Light light;
+		light.type = Light::LIGHT_DIRECTIONAL;
+		light.position = glm::vec3(0.f, 1.f, 1.f);
+
+		std::vector<glm::mat4> pose(numJoints), palette(numJoints);
+		glm::mat4 boneScale = glm::scale(glm::mat4(1.f), glm::vec3(1.f, segment, 1.f));
+		GLStateCache::GetInstance()->Enable(GL_DEPTH_TEST);
+
+		printf("%u characters, %u joints, %u vertices each, %u frames\n", numCharacters, numJoints, skinned->GetNumVertices(), numFrames);
+		printf("%-12s %12s %12s\n", "path", "ms/frame", "draws");
+		const char* names[] = { "rigid bones", "skinned" };
+		for (int path = 0; path < 2; ++path)
+		{
+			double total = 0.0;
+			for (unsigned f = 0; f <= numFrames; ++f)
+			{
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				UniformBlocks::GetInstance()->SetFrame(view, projection, &light, 1);
+				std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+				GLStateCache::GetInstance()->UseProgram(path == 0 ? shadingProgram : skinningProgram);
+				for (unsigned c = 0; c < numCharacters; ++c)
+				{
+					glm::mat4 model = glm::translate(glm::mat4(1.f), glm::vec3((static_cast<float>(c % side) - side * 0.5f) * 1.5f, 0.f, -static_cast<float>(c / side) * 1.5f));
+					BendChain(numJoints, segment, f * 0.05f + c, &pose[0]);
+					if (path == 0)
+					{
+						for (unsigned j = 0; j < numJoints; ++j)
+						{
+							glm::mat4 modelView = view * model * pose[j] * boneScale;
+							UniformBlocks::GetInstance()->SetObject(projection * modelView, modelView, bone->material, true, false);
+							bone->Render();
+						}
+					}
+					else
+					{
+						glm::mat4 modelView = view * model;
+						skinned->ComputePalette(&pose[0], &palette[0]);
+						UniformBlocks::GetInstance()->SetObject(projection * modelView, modelView, skinned->material, true, false);
+						UniformBlocks::GetInstance()->SetSkin(&palette[0], numJoints);
+						skinned->Render();
+					}
+				}
+				// The first frame is an untimed warm-up
+				if (f > 0)
+					total += Seconds(start);
+				glFinish();
+			}
+			printf("%-12s %12.3f %12u\n", names[path], total * 1000.0 / numFrames, path == 0 ? numCharacters * numJoints : numCharacters);
+		}
+
+		// The same skin on the CPU, the reference and what skinning without the shader would cost
+		std::vector<glm::vec3> positions, normals;
+		std::chrono::high_resolution_clock::time_point cpuStart = std::chrono::high_resolution_clock::now();
+		for (unsigned c = 0; c < numCharacters; ++c)
+		{
+			BendChain(numJoints, segment, static_cast<float>(c), &pose[0]);
+			skinned->ComputePalette(&pose[0], &palette[0]);
+			skinned->Skin(&palette[0], positions, normals);
+		}
+		printf("%-12s %12.3f %12s\n", "cpu skin", Seconds(cpuStart) * 1000.0, "-");
+
+		// Capture the shader's output for one pose and compare it with the CPU skin of the same pose
+		unsigned captureProgram = LoadSkinningCapture();
+		if (captureProgram)
+		{
+			unsigned numVertices = skinned->GetNumVertices();
+			GLuint feedback;
+			glGenBuffers(1, &feedback);
+			GLStateCache::GetInstance()->BindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, feedback);
+			glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, numVertices * 2 * sizeof(glm::vec3), NULL, GL_STATIC_READ);
+
+			BendChain(numJoints, segment, 1.f, &pose[0]);
+			skinned->ComputePalette(&pose[0], &palette[0]);
+			skinned->Skin(&palette[0], positions, normals);
+
+			GLStateCache::GetInstance()->UseProgram(captureProgram);
+			UniformBlocks::GetInstance()->SetObject(glm::mat4(1.f), glm::mat4(1.f), glm::mat4(1.f), skinned->material, true, false);
+			UniformBlocks::GetInstance()->SetSkin(&palette[0], numJoints);
+			GLStateCache::GetInstance()->BindVertexArray(skinned->vertexArray);
+			GLStateCache::GetInstance()->Enable(GL_RASTERIZER_DISCARD);
+			GLStateCache::GetInstance()->BindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, feedback);
+			glBeginTransformFeedback(GL_POINTS);
+			glDrawArrays(GL_POINTS, 0, numVertices);
+			glEndTransformFeedback();
+			GLStateCache::GetInstance()->Disable(GL_RASTERIZER_DISCARD);
+
+			std::vector<glm::vec3> captured(numVertices * 2);
+			GLStateCache::GetInstance()->BindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, feedback);
+			glGetBufferSubData(GL_TRANSFORM_FEEDBACK_BUFFER, 0, captured.size() * sizeof(glm::vec3), &captured[0]);
+			float positionError = 0.f, normalError = 0.f;
+			for (unsigned i = 0; i < numVertices; ++i)
+			{
+				positionError = std::max(positionError, glm::length(captured[i * 2] - positions[i]));
+				normalError = std::max(normalError, glm::length(captured[i * 2 + 1] - normals[i]));
+			}
+			printf("gpu against cpu skin: max position error %g, max normal error %g\n", positionError, normalError);
+
+			GLStateCache::GetInstance()->DeleteBuffer(feedback);
+			GLStateCache::GetInstance()->DeleteProgram(captureProgram);
+		}
+		else
+		{
+			printf("gpu against cpu skin: could not build the capture program\n");
+		}
+
+		delete skinned;
+		delete bone;
+		GLStateCache::GetInstance()->DeleteProgram(shadingProgram);
+		GLStateCache::GetInstance()->DeleteProgram(skinningProgram);
+	}
+
+	// Unit UV sphere, the stand-in model the GLB benchmark writes as both OBJ and GLB
+	void BuildSphere(unsigned numSlice, unsigned numStack, std::vector<Vertex>& out_vertices, std::vector<unsigned>& out_indices)
+	{
+		const float pi = 3.14159265f;
+		out_vertices.clear();
+		for (unsigned stack = 0; stack <= numStack; ++stack)
+		{
+			for (unsigned slice = 0; slice <= numSlice; ++slice)
+			{
+				float phi = pi * stack / numStack;
+				float theta = 2.f * pi * slice / numSlice;
+				Vertex v;
+				v.normal = glm::vec3(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta));
+				v.pos = v.normal;
+				v.color = glm::vec3(1.f);
+				v.texCoord = glm::vec2(static_cast<float>(slice) / numSlice, static_cast<float>(stack) / numStack);
+				out_vertices.push_back(v);
+			}
+		}
+		BuildGridList(numSlice, numStack, out_indices);
+	}
+
+	void WriteOBJ(const char* path, const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices)
+	{
+		std::ofstream stream(path);
+		for (size_t i = 0; i < vertices.size(); ++i)
+			stream << "v " << vertices[i].pos.x << ' ' << vertices[i].pos.y << ' ' << vertices[i].pos.z << '\n';
+		for (size_t i = 0; i < vertices.size(); ++i)
+			stream << "vt " << vertices[i].texCoord.x << ' ' << vertices[i].texCoord.y << '\n';
+		for (size_t i = 0; i < vertices.size(); ++i)
+			stream << "vn " << vertices[i].normal.x << ' ' << vertices[i].normal.y << ' ' << vertices[i].normal.z << '\n';
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			stream << 'f';
+			for (int k = 0; k < 3; ++k)
+			{
+				unsigned index = indices[i + k] + 1;
+				stream << ' ' << index << '/' << index << '/' << index;
+			}
+			stream << '\n';
+		}
+	}
+
+	/******************************************************************************/
+	/*!
+	\brief
+	Write the mesh as a GLB with one material, under a translated root node.
+	Interleaved lays the vertices out exactly as Vertex with 32-bit indices,
+	which LoadGLB uploads without a copy; otherwise every attribute has a view
+	of its own and indices are 16-bit where they fit, which it converts.
+	*/
+	/******************************************************************************/
+	void WriteGLB(const char* path, const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices, bool interleaved)
+	{
+		std::vector<unsigned char> bin;
+		std::ostringstream views, accessors;
+		unsigned numViews = 0;
+		// Each view starts 4 byte aligned, as float accessors must
+		auto addView = [&](const void* data, size_t size, unsigned stride, unsigned target) -> unsigned
+		{
+			views << (numViews ? "," : "") << "{\"buffer\":0,\"byteOffset\":" << bin.size() << ",\"byteLength\":" << size;
+			if (stride)
+				views << ",\"byteStride\":" << stride;
+			views << ",\"target\":" << target << "}";
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+			bin.insert(bin.end(), bytes, bytes + size);
+			bin.resize((bin.size() + 3) & ~static_cast<size_t>(3), 0);
+			return numViews++;
+		};
+		unsigned numAccessors = 0;
+		auto addAccessor = [&](unsigned view, size_t offset, unsigned componentType, size_t count, const char* type) -> unsigned
+		{
+			accessors << (numAccessors ? "," : "") << "{\"bufferView\":" << view << ",\"byteOffset\":" << offset
+				<< ",\"componentType\":" << componentType << ",\"count\":" << count << ",\"type\":\"" << type << "\"";
+			if (numAccessors == 0)
+				accessors << ",\"min\":[-1,-1,-1],\"max\":[1,1,1]";
+			accessors << "}";
+			return numAccessors++;
+		};
+
+		size_t numVertices = vertices.size();
+		std::ostringstream attributes;
+		unsigned indexAccessor;
+		if (interleaved)
+		{
+			unsigned vertexView = addView(&vertices[0], numVertices * sizeof(Vertex), sizeof(Vertex), GL_ARRAY_BUFFER);
+			unsigned indexView = addView(&indices[0], indices.size() * sizeof(unsigned), 0, GL_ELEMENT_ARRAY_BUFFER);
+			attributes << "\"POSITION\":" << addAccessor(vertexView, offsetof(Vertex, pos), GL_FLOAT, numVertices, "VEC3")
+				<< ",\"COLOR_0\":" << addAccessor(vertexView, offsetof(Vertex, color), GL_FLOAT, numVertices, "VEC3")
+				<< ",\"NORMAL\":" << addAccessor(vertexView, offsetof(Vertex, normal), GL_FLOAT, numVertices, "VEC3")
+				<< ",\"TEXCOORD_0\":" << addAccessor(vertexView, offsetof(Vertex, texCoord), GL_FLOAT, numVertices, "VEC2");
+			indexAccessor = addAccessor(indexView, 0, GL_UNSIGNED_INT, indices.size(), "SCALAR");
+		}
+		else
+		{
+			std::vector<glm::vec3> positions(numVertices), normals(numVertices);
+			std::vector<glm::vec2> texCoords(numVertices);
+			for (size_t i = 0; i < numVertices; ++i)
+			{
+				positions[i] = vertices[i].pos;
+				normals[i] = vertices[i].normal;
+				texCoords[i] = vertices[i].texCoord;
+			}
+			attributes << "\"POSITION\":" << addAccessor(addView(&positions[0], numVertices * sizeof(glm::vec3), 0, GL_ARRAY_BUFFER), 0, GL_FLOAT, numVertices, "VEC3")
+				<< ",\"NORMAL\":" << addAccessor(addView(&normals[0], numVertices * sizeof(glm::vec3), 0, GL_ARRAY_BUFFER), 0, GL_FLOAT, numVertices, "VEC3")
+				<< ",\"TEXCOORD_0\":" << addAccessor(addView(&texCoords[0], numVertices * sizeof(glm::vec2), 0, GL_ARRAY_BUFFER), 0, GL_FLOAT, numVertices, "VEC2");
+			if (numVertices <= 0xFFFF)
+			{
+				std::vector<unsigned short> shortIndices(indices.begin(), indices.end());
+				indexAccessor = addAccessor(addView(&shortIndices[0], shortIndices.size() * sizeof(unsigned short), 0, GL_ELEMENT_ARRAY_BUFFER), 0, GL_UNSIGNED_SHORT, indices.size(), "SCALAR");
+			}
+			else
+				indexAccessor = addAccessor(addView(&indices[0], indices.size() * sizeof(unsigned), 0, GL_ELEMENT_ARRAY_BUFFER), 0, GL_UNSIGNED_INT, indices.size(), "SCALAR");
+		}
+
+		std::ostringstream json;
+		json << "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],"
+			<< "\"nodes\":[{\"name\":\"root\",\"translation\":[0,1,0],\"children\":[1]},{\"name\":\"sphere\",\"mesh\":0}],"
+			<< "\"meshes\":[{\"name\":\"sphere\",\"primitives\":[{\"attributes\":{" << attributes.str() << "},\"indices\":" << indexAccessor << ",\"material\":0}]}],"
+			<< "\"materials\":[{\"pbrMetallicRoughness\":{\"baseColorFactor\":[0.8,0.6,0.4,1],\"metallicFactor\":0,\"roughnessFactor\":0.5}}],"
+			<< "\"buffers\":[{\"byteLength\":" << bin.size() << "}],"
+			<< "\"bufferViews\":[" << views.str() << "],\"accessors\":[" << accessors.str() << "]}";
+		std::string text = json.str();
+		text.resize((text.size() + 3) & ~static_cast<size_t>(3), ' ');
+
+		unsigned header[5] = { 0x46546C67, 2, static_cast<unsigned>(12 + 8 + text.size() + 8 + bin.size()), static_cast<unsigned>(text.size()), 0x4E4F534A };
+		unsigned binHeader[2] = { static_cast<unsigned>(bin.size()), 0x004E4942 };
+		std::ofstream stream(path, std::ios::binary);
+		stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+		stream.write(text.data(), text.size());
+		stream.write(reinterpret_cast<const char*>(binHeader), sizeof(binHeader));
+		stream.write(reinterpret_cast<const char*>(&bin[0]), bin.size());
+	}
+
+	// Load time of one model from OBJ, which is parsed and re-indexed, and from GLB with and without the zero copy layout
+	void BenchmarkGLB(int argc, char* argv[])
+	{
+		unsigned resolution = argc > 0 ? static_cast<unsigned>(atoi(argv[0])) : 256;
+		unsigned numRuns = argc > 1 ? static_cast<unsigned>(atoi(argv[1])) : 5;
+		resolution = std::max(resolution, 3u);
+		numRuns = std::max(numRuns, 1u);
+
+		std::vector<Vertex> vertices;
+		std::vector<unsigned> indices;
+		BuildSphere(resolution, resolution, vertices, indices);
+		const char* objPath = "benchmark.obj";
+		const char* glbPaths[2] = { "benchmark.glb", "benchmark_split.glb" };
+		WriteOBJ(objPath, vertices, indices);
+		WriteGLB(glbPaths[0], vertices, indices, true);
+		WriteGLB(glbPaths[1], vertices, indices, false);
+
+		printf("%u vertices, %u triangles, best of %u loads\n", static_cast<unsigned>(vertices.size()), static_cast<unsigned>(indices.size() / 3), numRuns);
+		printf("%-20s %12s %10s %10s %10s\n", "file", "bytes", "ms", "indices", "zero copy");
+
+		double best = 0.0;
+		unsigned numIndices = 0;
+		for (unsigned run = 0; run < numRuns; ++run)
+		{
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			Mesh* mesh = MeshBuilder::GenerateOBJ("OBJ", objPath);
+			glFinish();
+			double elapsed = Seconds(start);
+			best = run == 0 ? elapsed : std::min(best, elapsed);
+			numIndices = mesh ? mesh->indexSize : 0;
+			delete mesh;
+		}
+		long long objBytes = std::ifstream(objPath, std::ios::binary | std::ios::ate).tellg();
+		printf("%-20s %12lld %10.3f %10u %10s\n", objPath, objBytes, best * 1000.0, numIndices, "-");
+
+		for (int i = 0; i < 2; ++i)
+		{
+			GLBModel model;
+			for (unsigned run = 0; run < numRuns; ++run)
+			{
+				model.Clear();
+				std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+				LoadGLB(glbPaths[i], model);
+				glFinish();
+				double elapsed = Seconds(start);
+				best = run == 0 ? elapsed : std::min(best, elapsed);
+			}
+			numIndices = 0;
+			if (!model.meshes.empty() && !model.meshes[0].primitives.empty() && model.meshes[0].primitives[0].mesh)
+				numIndices = model.meshes[0].primitives[0].mesh->indexSize;
+			long long glbBytes = std::ifstream(glbPaths[i], std::ios::binary | std::ios::ate).tellg();
+			printf("%-20s %12lld %10.3f %10u %5u of %u\n", glbPaths[i], glbBytes, best * 1000.0, numIndices, model.numZeroCopy, model.numZeroCopy + model.numConverted);
+			if (i == 0)
+				printf("hierarchy: %u nodes, %u roots, root child \"%s\"\n", static_cast<unsigned>(model.nodes.size()), static_cast<unsigned>(model.roots.size()),
+					model.nodes.size() > 1 ? model.nodes[1].name.c_str() : "");
+		}
+
+		remove(objPath);
+		remove(glbPaths[0]);
+		remove(glbPaths[1]);
+	}
+
+	/******************************************************************************/
+	/*!
+	\brief
+	Write the grid sphere of BuildSphere as binary PLY: position, normal,
+	byte colour and texture coordinate per vertex, and either the grid's
+	quads, which the reader has to triangulate, or its triangles. Without
+	faces only positions are written, as a scanner's point cloud would be.
+	*/
+	/******************************************************************************/
+	void WritePLY(const char* path, const std::vector<Vertex>& vertices, unsigned numSlice, unsigned numStack, bool bigEndian, bool quads, bool faces)
+	{
+		unsigned short one = 1;
+		bool swap = bigEndian != (*reinterpret_cast<unsigned char*>(&one) == 0);
+		std::ofstream stream(path, std::ios::binary);
+		auto put = [&](const void* value, size_t size)
+		{
+			char bytes[8];
+			memcpy(bytes, value, size);
+			if (swap)
+				std::reverse(bytes, bytes + size);
+			stream.write(bytes, size);
+		};
+
+		unsigned numFaces = faces ? numSlice * numStack * (quads ? 1 : 2) : 0;
+		stream << "ply\nformat " << (bigEndian ? "binary_big_endian" : "binary_little_endian") << " 1.0\n"
+			<< "comment benchmark sphere\nelement vertex " << vertices.size() << "\nproperty float x\nproperty float y\nproperty float z\n";
+		if (faces)
+		{
+			stream << "property float nx\nproperty float ny\nproperty float nz\nproperty uchar red\nproperty uchar green\nproperty uchar blue\n"
+				<< "property float s\nproperty float t\nelement face " << numFaces << "\nproperty list uchar int vertex_indices\n";
+		}
+		stream << "end_header\n";
+
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			const Vertex& v = vertices[i];
+			put(&v.pos.x, 4); put(&v.pos.y, 4); put(&v.pos.z, 4);
+			if (!faces)
+				continue;
+			put(&v.normal.x, 4); put(&v.normal.y, 4); put(&v.normal.z, 4);
+			for (int c = 0; c < 3; ++c)
+			{
+				unsigned char color = static_cast<unsigned char>(v.color[c] * 255.f + 0.5f);
+				put(&color, 1);
+			}
+			put(&v.texCoord.x, 4); put(&v.texCoord.y, 4);
+		}
+
+		for (unsigned stack = 0; stack < numStack && faces; ++stack)
+		{
+			for (unsigned slice = 0; slice < numSlice; ++slice)
+			{
+				int v0 = (numSlice + 1) * stack + slice;
+				int v1 = (numSlice + 1) * (stack + 1) + slice;
+				if (quads)
+				{
+					// The fan of v0 splits it along the other diagonal from BuildGridList
+					int quad[4] = { v0, v1, v1 + 1, v0 + 1 };
+					unsigned char count = 4;
+					put(&count, 1);
+					for (int k = 0; k < 4; ++k)
+						put(&quad[k], 4);
+				}
+				else
+				{
+					int triangles[6] = { v0, v1, v0 + 1, v0 + 1, v1, v1 + 1 };
+					unsigned char count = 3;
+					for (int t = 0; t < 2; ++t)
+					{
+						put(&count, 1);
+						for (int k = 0; k < 3; ++k)
+							put(&triangles[t * 3 + k], 4);
+					}
+				}
+			}
+		}
+	}
+
+	// Load time of one model from OBJ and from binary PLY in both byte orders, and of its points alone
+	void BenchmarkPLY(int argc, char* argv[])
+	{
+		unsigned resolution = argc > 0 ? static_cast<unsigned>(atoi(argv[0])) : 512;
+		unsigned numRuns = argc > 1 ? static_cast<unsigned>(atoi(argv[1])) : 3;
+		resolution = std::max(resolution, 3u);
+		numRuns = std::max(numRuns, 1u);
+
+		std::vector<Vertex> vertices;
+		std::vector<unsigned> indices;
+		BuildSphere(resolution, resolution, vertices, indices);
+		const char* paths[4] = { "benchmark.obj", "benchmark_le.ply", "benchmark_be.ply", "benchmark_points.ply" };
+		WriteOBJ(paths[0], vertices, indices);
+		WritePLY(paths[1], vertices, resolution, resolution, false, true, true);
+		WritePLY(paths[2], vertices, resolution, resolution, true, false, true);
+		WritePLY(paths[3], vertices, resolution, resolution, false, false, false);
+
+		printf("%u vertices, %u triangles, best of %u loads\n", static_cast<unsigned>(vertices.size()), static_cast<unsigned>(indices.size() / 3), numRuns);
+		printf("%-22s %12s %10s %12s %10s %8s\n", "file", "bytes", "ms", "Mvertices/s", "indices", "mode");
+		for (int i = 0; i < 4; ++i)
+		{
+			double best = 0.0;
+			unsigned numIndices = 0;
+			int mode = -1;
+			for (unsigned run = 0; run < numRuns; ++run)
+			{
+				std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+				Mesh* mesh = i == 0 ? MeshBuilder::GenerateOBJ("OBJ", paths[i]) : MeshBuilder::GeneratePLY("PLY", paths[i]);
+				glFinish();
+				double elapsed = Seconds(start);
+				best = run == 0 ? elapsed : std::min(best, elapsed);
+				numIndices = mesh ? mesh->indexSize : 0;
+				mode = mesh ? mesh->mode : -1;
+				delete mesh;
+			}
+			long long bytes = std::ifstream(paths[i], std::ios::binary | std::ios::ate).tellg();
+			printf("%-22s %12lld %10.3f %12.2f %10u %8s\n", paths[i], bytes, best * 1000.0, vertices.size() / best * 1e-6, numIndices,
+				mode == Mesh::DRAW_TRIANGLES ? "tris" : mode == Mesh::DRAW_POINTS ? "points" : "-");
+			remove(paths[i]);
+		}
+	}
+
+	// Binary STL of a triangle list, every corner nudged by up to jitter on each axis as a mesher's rounding would
+	void WriteSTL(const char* path, const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices, float jitter)
+	{
+		std::ofstream stream(path, std::ios::binary);
+		char header[80] = "benchmark sphere";
+		unsigned numTriangles = static_cast<unsigned>(indices.size() / 3);
+		stream.write(header, sizeof(header));
+		stream.write(reinterpret_cast<const char*>(&numTriangles), sizeof(numTriangles));
+
+		srand(45);
+		for (unsigned t = 0; t < numTriangles; ++t)
+		{
+			// The stored normal is left zero, as some exporters do
+			float record[12] = {};
+			for (int k = 0; k < 3; ++k)
+			{
+				for (int axis = 0; axis < 3; ++axis)
+					record[3 + k * 3 + axis] = vertices[indices[t * 3 + k]].pos[axis] + jitter * (rand() * 2.f / RAND_MAX - 1.f);
+			}
+			unsigned short attributes = 0;
+			stream.write(reinterpret_cast<const char*>(record), sizeof(record));
+			stream.write(reinterpret_cast<const char*>(&attributes), sizeof(attributes));
+		}
+	}
+
+	// Weld throughput over thread counts and the vertex counts crease angles give, for a sphere saved as jittered STL
+	void BenchmarkSTL(int argc, char* argv[])
+	{
+		unsigned resolution = argc > 0 ? static_cast<unsigned>(atoi(argv[0])) : 512;
+		unsigned numRuns = argc > 1 ? static_cast<unsigned>(atoi(argv[1])) : 3;
+		resolution = std::max(resolution, 3u);
+		numRuns = std::max(numRuns, 1u);
+
+		std::vector<Vertex> vertices;
+		std::vector<unsigned> indices;
+		BuildSphere(resolution, resolution, vertices, indices);
+		const char* objPath = "benchmark.obj";
+		const char* stlPath = "benchmark.stl";
+		WriteOBJ(objPath, vertices, indices);
+		WriteSTL(stlPath, vertices, indices, 5e-7f);
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		std::vector<glm::vec3> corners;
+		LoadSTL(stlPath, corners);
+		double loadTime = Seconds(start);
+		unsigned numCorners = static_cast<unsigned>(corners.size());
+
+		// The same tolerance as MeshBuilder::GenerateSTL: a millionth of the bounding box diagonal
+		glm::vec3 minimum(FLT_MAX), maximum(-FLT_MAX);
+		for (unsigned i = 0; i < numCorners; ++i)
+		{
+			minimum = glm::min(minimum, corners[i]);
+			maximum = glm::max(maximum, corners[i]);
+		}
+		float epsilon = numCorners ? glm::length(maximum - minimum) * 1e-6f : 0.f;
+
+		// Poles and the seam of the grid sphere coincide too
+		unsigned expected = (resolution - 1) * resolution + 2;
+		std::vector<unsigned> remap, reference;
+		std::vector<glm::vec3> positions;
+		unsigned numExact = WeldVertices(corners, 0.f, remap, positions);
+		printf("%u triangles, %u corners loaded in %.3f ms, %u distinct points on the sphere\n", numCorners / 3, numCorners, loadTime * 1000.0, expected);
+		printf("exact weld: %u vertices; weld within %g: ", numExact, epsilon);
+
+		ThreadPool* pool = ThreadPool::GetInstance();
+		unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+		std::vector<unsigned> threadCounts;
+		for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+			threadCounts.push_back(threads);
+		threadCounts.push_back(maxThreads);
+
+		unsigned numWelded = 0;
+		std::vector<double> weldTimes(threadCounts.size());
+		bool identical = true;
+		for (size_t t = 0; t < threadCounts.size(); ++t)
+		{
+			pool->SetNumThreads(threadCounts[t]);
+			for (unsigned run = 0; run < numRuns; ++run)
+			{
+				start = std::chrono::high_resolution_clock::now();
+				numWelded = WeldVertices(corners, epsilon, remap, positions);
+				double elapsed = Seconds(start);
+				weldTimes[t] = run == 0 ? elapsed : std::min(weldTimes[t], elapsed);
+			}
+			if (t == 0)
+				reference = remap;
+			identical = identical && remap == reference;
+		}
+		printf("%u vertices\n", numWelded);
+		printf("%-14s %10s %14s\n", "threads", "weld ms", "Mcorners/s");
+		for (size_t t = 0; t < threadCounts.size(); ++t)
+			printf("%-14u %10.3f %14.2f\n", threadCounts[t], weldTimes[t] * 1000.0, numCorners / weldTimes[t] * 1e-6);
+		printf("welds identical across thread counts: %s\n", identical ? "yes" : "NO");
+
+		printf("%-14s %10s %10s %10s\n", "crease", "ms", "vertices", "dropped");
+		const float creaseAngles[3] = { 0.f, 30.f, 180.f };
+		for (int c = 0; c < 3; ++c)
+		{
+			std::vector<Vertex> creased;
+			std::vector<unsigned> creasedIndices;
+			start = std::chrono::high_resolution_clock::now();
+			unsigned numDropped = BuildCreasedMesh(positions, remap, creaseAngles[c], creased, creasedIndices);
+			double elapsed = Seconds(start);
+			printf("%-14g %10.3f %10u %10u\n", creaseAngles[c], elapsed * 1000.0, static_cast<unsigned>(creased.size()), numDropped);
+		}
+		pool->SetNumThreads(0);
+
+		printf("%-14s %12s %10s %10s\n", "file", "bytes", "ms", "indices");
+		const char* paths[2] = { objPath, stlPath };
+		for (int i = 0; i < 2; ++i)
+		{
+			double best = 0.0;
+			unsigned numIndices = 0;
+			for (unsigned run = 0; run < numRuns; ++run)
+			{
+				start = std::chrono::high_resolution_clock::now();
+				Mesh* mesh = i == 0 ? MeshBuilder::GenerateOBJ("OBJ", paths[i]) : MeshBuilder::GenerateSTL("STL", paths[i]);
+				glFinish();
+				double elapsed = Seconds(start);
+				best = run == 0 ? elapsed : std::min(best, elapsed);
+				numIndices = mesh ? mesh->indexSize : 0;
+				delete mesh;
+			}
+			long long bytes = std::ifstream(paths[i], std::ios::binary | std::ios::ate).tellg();
+			printf("%-14s %12lld %10.3f %10u\n", paths[i], bytes, best * 1000.0, numIndices);
+			remove(paths[i]);
+		}
+	}
+
+	// Point lights of one fade distance, scattered over a ground of side x side units just above it
+	void ScatterLights(unsigned numLights, float side, std::vector<Light>& out_lights)
+	{
+		srand(46);
+		out_lights.assign(numLights, Light());
+		for (unsigned i = 0; i < numLights; ++i)
+		{
+			Light& light = out_lights[i];
+			light.type = i % 8 == 7 ? Light::LIGHT_SPOT : Light::LIGHT_POINT;
+			light.position = glm::vec3((rand() / static_cast<float>(RAND_MAX) - 0.5f) * side, 0.5f + rand() * 1.5f / RAND_MAX,
+				(rand() / static_cast<float>(RAND_MAX) - 0.5f) * side);
+			light.color = glm::normalize(glm::vec3(rand() % 256, rand() % 256, rand() % 256) + glm::vec3(25.f));
+			light.kC = 1.f;
+			light.kL = 0.f;
+			light.kQ = 2.f;
+			light.spotDirection = glm::vec3(0.f, -1.f, 0.f);
+			light.cosCutoff = 45.f;
+			light.cosInner = 30.f;
+		}
+	}
+
+	// Lights missing from the cluster of points they reach, over a grid of points in the view
+	unsigned CountMissedLights(const LightClusters& clusters, const std::vector<Light>& lights, const glm::mat4& view, const glm::mat4& projection)
+	{
+		unsigned missed = 0;
+		for (int i = 0; i < 40; ++i)
+		{
+			for (int j = 0; j < 30; ++j)
+			{
+				for (int k = 0; k < 20; ++k)
+				{
+					// The point's cluster, found as the shaders find it
+					float depth = 0.2f * powf(1.35f, static_cast<float>(k));
+					glm::vec2 ndc(-0.99f + 1.98f * i / 39.f, -0.99f + 1.98f * j / 29.f);
+					glm::vec3 p((ndc.x + projection[2][0]) * depth / projection[0][0], (ndc.y + projection[2][1]) * depth / projection[1][1], -depth);
+					glm::ivec2 tile = glm::clamp(glm::ivec2((ndc * 0.5f + 0.5f) * glm::vec2(clusters.grid.x, clusters.grid.y)), glm::ivec2(0), glm::ivec2(clusters.grid.x - 1, clusters.grid.y - 1));
+					int slice = glm::clamp(static_cast<int>(logf(depth) * clusters.depthScaleBias.x + clusters.depthScaleBias.y), 0, clusters.grid.z - 1);
+					int cluster = (slice * clusters.grid.y + tile.y) * clusters.grid.x + tile.x;
+					const unsigned* first = clusters.indices.empty() ? nullptr : &clusters.indices[0] + clusters.cells[cluster * 2];
+					const unsigned* last = first + clusters.cells[cluster * 2 + 1];
+
+					for (unsigned l = 0; l < lights.size(); ++l)
+					{
+						glm::vec3 position = glm::vec3(view * glm::vec4(lights[l].position, 1.f));
+						float range = LightClusters::GetRange(lights[l]);
+						if (glm::dot(position - p, position - p) < range * range * 0.999f && std::find(first, last, l) == last)
+							++missed;
+					}
+				}
+			}
+		}
+		return missed;
+	}
+
+	// Binning cost of clustered lights over thread counts, and frame time with every fragment
+	// looping over its cluster's lights against looping over all of them
+	void BenchmarkClusters(int argc, char* argv[])
+	{
+		unsigned numFrames = argc > 0 ? static_cast<unsigned>(atoi(argv[0])) : 50;
+		numFrames = std::max(numFrames, 1u);
+
+		const float side = 60.f;
+		glm::mat4 view = glm::lookAt(glm::vec3(0.f, 12.f, side * 0.5f), glm::vec3(0.f, 0.f, 0.f), glm::vec3(0.f, 1.f, 0.f));
+		glm::mat4 projection = glm::perspective(glm::radians(60.f), 4.f / 3.f, 0.1f, 1000.f);
+
+		ThreadPool* pool = ThreadPool::GetInstance();
+		unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+		std::vector<unsigned> threadCounts;
+		for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+			threadCounts.push_back(threads);
+		threadCounts.push_back(maxThreads);
+
+		printf("%d x %d x %d clusters, %u hardware threads\n", LightClusters::CLUSTERS_X, LightClusters::CLUSTERS_Y, LightClusters::CLUSTERS_Z, maxThreads);
+		printf("%-8s %-8s %10s %10s %10s %10s %8s\n", "lights", "threads", "build ms", "indices", "per cell", "max", "missed");
+		const unsigned lightCounts[] = { 64, 256, 1024, 4096 };
+		std::vector<Light> lights;
+		for (unsigned n = 0; n < sizeof(lightCounts) / sizeof(lightCounts[0]); ++n)
+		{
+			ScatterLights(lightCounts[n], side, lights);
+			LightClusters reference;
+			for (size_t t = 0; t < threadCounts.size(); ++t)
+			{
+				pool->SetNumThreads(threadCounts[t]);
+				LightClusters clusters;
+				double best = 0.0;
+				for (unsigned run = 0; run < 10; ++run)
+				{
+					clusters.Build(view, projection, &lights[0], static_cast<int>(lights.size()));
+					best = run == 0 ? clusters.GetBuildTime() : std::min(best, clusters.GetBuildTime());
+				}
+				if (t == 0)
+					reference = clusters;
+
+				char missed[16];
+				if (t == 0)
+					snprintf(missed, sizeof(missed), "%u", CountMissedLights(clusters, lights, view, projection));
+				else
+					snprintf(missed, sizeof(missed), "%s", clusters.indices == reference.indices && clusters.cells == reference.cells ? "same" : "DIFFER");
+				printf("%-8u %-8u %10.3f %10u %10.2f %10u %8s\n", lightCounts[n], threadCounts[t], best, static_cast<unsigned>(clusters.indices.size()),
+					static_cast<double>(clusters.indices.size()) / LightClusters::NUM_CLUSTERS, clusters.GetMaxPerCluster(), missed);
+			}
+		}
+		pool->SetNumThreads(0);
+
+		// A lit field of spheres on a ground plane filling the view
+		unsigned programID = LoadShaders("Shader//Shading.vertexshader", "Shader//Shading.fragmentshader");
+		UniformBlocks::GetInstance()->BindProgram(programID);
+		Mesh* ground = MeshBuilder::GenerateQuad("Ground", glm::vec3(0.8f), 1.f);
+		Mesh* sphere = MeshBuilder::GenerateSphere("Sphere", glm::vec3(0.9f), 0.5f, 16, 8);
+		Mesh* meshes[2] = { ground, sphere };
+		for (int i = 0; i < 2; ++i)
+		{
+			meshes[i]->material.kAmbient = glm::vec3(0.05f);
+			meshes[i]->material.kDiffuse = glm::vec3(0.8f);
+			meshes[i]->material.kSpecular = glm::vec3(0.3f);
+			meshes[i]->material.kShininess = 8.f;
+		}
+		std::vector<glm::mat4> models;
+		models.push_back(glm::scale(glm::rotate(glm::mat4(1.f), glm::radians(-90.f), glm::vec3(1.f, 0.f, 0.f)), glm::vec3(side, side, 1.f)));
+		for (float x = -side * 0.5f; x < side * 0.5f; x += 3.f)
+		{
+			for (float z = -side * 0.5f; z < side * 0.5f; z += 3.f)
+				models.push_back(glm::translate(glm::mat4(1.f), glm::vec3(x, 0.5f, z)));
+		}
+		GLStateCache::GetInstance()->Enable(GL_DEPTH_TEST);
+		GLStateCache::GetInstance()->Enable(GL_CULL_FACE);
+		UniformBlocks::GetInstance()->ReserveObjects(static_cast<unsigned>(models.size()));
+
+		printf("%u draws, %u frames\n", static_cast<unsigned>(models.size()), numFrames);
+		printf("%-8s %-12s %12s %12s\n", "lights", "shading", "ms/frame", "build ms");
+		for (unsigned n = 0; n < sizeof(lightCounts) / sizeof(lightCounts[0]); ++n)
+		{
+			ScatterLights(lightCounts[n], side, lights);
+			for (int clustered = 1; clustered >= 0; --clustered)
+			{
+				// Without a perspective projection LightClusters puts every light in one cluster
+				LightClusters clusters;
+				double total = 0.0, buildTotal = 0.0;
+				for (unsigned f = 0; f <= numFrames; ++f)
+				{
+					std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+					clusters.Build(view, clustered ? projection : glm::mat4(1.f), &lights[0], static_cast<int>(lights.size()));
+					glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+					UniformBlocks::GetInstance()->SetFrame(view, projection, nullptr, 0);
+					UniformBlocks::GetInstance()->SetClusters(&clusters);
+					GLStateCache::GetInstance()->UseProgram(programID);
+					for (size_t i = 0; i < models.size(); ++i)
+					{
+						Mesh* mesh = meshes[i == 0 ? 0 : 1];
+						glm::mat4 modelView = view * models[i];
+						UniformBlocks::GetInstance()->SetObject(projection * modelView, modelView, mesh->material, true, false);
+						mesh->Render();
+					}
+					glFinish();
+					// The first frame warms up
+					if (f > 0)
+					{
+						total += Seconds(start);
+						buildTotal += clusters.GetBuildTime();
+					}
+				}
+				printf("%-8u %-12s %12.3f %12.3f\n", lightCounts[n], clustered ? "clustered" : "all lights", total * 1000.0 / numFrames, buildTotal / numFrames);
+			}
+		}
+		UniformBlocks::GetInstance()->SetClusters(nullptr);
+
+		delete ground;
+		delete sphere;
+		GLStateCache::GetInstance()->DeleteProgram(programID);
+	}
+
+	// Frame time of forward and deferred shading, both with clustered lights, over a
+	// field of spheres seen at a low angle so that they hide each other
+	void BenchmarkDeferred(int argc, char* argv[])
+	{
+		unsigned numFrames = argc > 0 ? static_cast<unsigned>(atoi(argv[0])) : 50;
+		numFrames = std::max(numFrames, 1u);
+
+		const float side = 60.f;
+		FrameSnapshot frame;
+		frame.view = glm::lookAt(glm::vec3(0.f, 3.f, side * 0.5f), glm::vec3(0.f, 0.f, 0.f), glm::vec3(0.f, 1.f, 0.f));
+		frame.projection = glm::perspective(glm::radians(60.f), 4.f / 3.f, 0.1f, 1000.f);
+		frame.lights.assign(1, Light());
+		frame.lights[0].type = Light::LIGHT_DIRECTIONAL;
+		frame.lights[0].position = glm::vec3(0.f, 20.f, 0.f);
+		frame.lights[0].power = 0.2f;
+
+		// Same lighting terms as the deferred pass, so only the shading path differs
+		unsigned programID = LoadShaders("Shader//Texture.vertexshader", "Shader//Texture.fragmentshader");
+		UniformBlocks::GetInstance()->BindProgram(programID);
+		Mesh* ground = MeshBuilder::GenerateQuad("Ground", glm::vec3(0.8f), 1.f);
+		Mesh* sphere = MeshBuilder::GenerateSphere("Sphere", glm::vec3(0.9f), 0.5f, 16, 8);
+		Mesh* meshes[2] = { ground, sphere };
+		for (int i = 0; i < 2; ++i)
+		{
+			meshes[i]->material.kAmbient = glm::vec3(0.05f);
+			meshes[i]->material.kDiffuse = glm::vec3(0.8f);
+			meshes[i]->material.kSpecular = glm::vec3(0.3f);
+			meshes[i]->material.kShininess = 8.f;
+		}
+
+		frame.commands.Begin(frame.view, frame.projection);
+		frame.commands.Submit(ground, glm::scale(glm::rotate(glm::mat4(1.f), glm::radians(-90.f), glm::vec3(1.f, 0.f, 0.f)), glm::vec3(side, side, 1.f)), programID, true);
+		unsigned numDraws = 1;
+		for (float x = -side * 0.5f; x < side * 0.5f; x += 1.5f)
+		{
+			for (float z = -side * 0.5f; z < side * 0.5f; z += 1.5f)
+			{
+				frame.commands.Submit(sphere, glm::translate(glm::mat4(1.f), glm::vec3(x, 0.5f, z)), programID, true);
+				++numDraws;
+			}
+		}
+		GLStateCache::GetInstance()->Enable(GL_DEPTH_TEST);
+		UniformBlocks::GetInstance()->ReserveObjects(numDraws);
+
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		printf("%u draws, %u in view, %d x %d pixels, %u frames\n", numDraws, frame.commands.GetNumCommands(), viewport[2], viewport[3], numFrames);
+		printf("%-8s %12s %12s %10s\n", "lights", "forward ms", "deferred ms", "speedup");
+
+		RenderQueue queue;
+		const unsigned lightCounts[] = { 16, 64, 256, 1024, 4096 };
+		std::vector<Light> lights;
+		for (unsigned n = 0; n < sizeof(lightCounts) / sizeof(lightCounts[0]); ++n)
+		{
+			// Binning is the same for both paths and timed by the clusters benchmark, so it is done once
+			ScatterLights(lightCounts[n], side, lights);
+			frame.clusters.Build(frame.view, frame.projection, &lights[0], static_cast<int>(lights.size()));
+
+			double ms[2];
+			for (int deferred = 0; deferred < 2; ++deferred)
+			{
+				frame.deferred = deferred != 0;
+				double total = 0.0;
+				for (unsigned f = 0; f <= numFrames; ++f)
+				{
+					std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+					frame.Replay(queue);
+					glFinish();
+					// The first frame warms up, and makes the G-buffer
+					if (f > 0)
+						total += Seconds(start);
+				}
+				ms[deferred] = total * 1000.0 / numFrames;
+			}
+			printf("%-8u %12.3f %12.3f %9.2fx\n", lightCounts[n], ms[0], ms[1], ms[0] / ms[1]);
+		}
+		UniformBlocks::GetInstance()->SetClusters(nullptr);
+
+		delete ground;
+		delete sphere;
+		GLStateCache::GetInstance()->DeleteProgram(programID);
+	}
+
+	// Size of the program as the driver stores it, the nearest portable stand-in for an instruction count; 0 when unavailable
+	int ProgramBinaryLength(unsigned programID)
+	{
+		GLint length = 0;
+		if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)
+			glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &length);
+		return length;
+	}
+
+	// Build time, driver binary size and frame time of specialized Texture programs against the uber program,
+	// for lighting set-ups from unlit to many clustered lights
+	void BenchmarkPermutations(int argc, char* argv[])
+	{
+		unsigned numFrames = argc > 0 ? static_cast<unsigned>(atoi(argv[0])) : 50;
+		numFrames = std::max(numFrames, 1u);
+		const char* vertexPath = "Shader//Texture.vertexshader";
+		const char* fragmentPath = "Shader//Texture.fragmentshader";
+		ShaderCache* cache = ShaderCache::GetInstance();
+
+		// A checker for the textured cases
+		const int TEXTURE_SIZE = 64;
+		std::vector<unsigned char> texels(TEXTURE_SIZE * TEXTURE_SIZE * 3);
+		for (int i = 0; i < TEXTURE_SIZE * TEXTURE_SIZE; ++i)
+		{
+			unsigned char value = ((i % TEXTURE_SIZE) / 8 + (i / TEXTURE_SIZE) / 8) % 2 ? 255 : 96;
+			texels[i * 3] = texels[i * 3 + 1] = texels[i * 3 + 2] = value;
+		}
+		unsigned texture;
+		glGenTextures(1, &texture);
+		GLStateCache::GetInstance()->ActiveTexture(GL_TEXTURE0);
+		GLStateCache::GetInstance()->BindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, TEXTURE_SIZE, TEXTURE_SIZE, 0, GL_RGB, GL_UNSIGNED_BYTE, &texels[0]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		GLStateCache::GetInstance()->BindTexture(GL_TEXTURE_2D, 0);
+
+		const float side = 40.f;
+		Mesh* ground = MeshBuilder::GenerateQuad("Ground", glm::vec3(0.8f), 1.f);
+		Mesh* sphere = MeshBuilder::GenerateSphere("Sphere", glm::vec3(0.9f), 0.5f, 16, 8);
+		Mesh* meshes[2] = { ground, sphere };
+		for (int i = 0; i < 2; ++i)
+		{
+			meshes[i]->material.kAmbient = glm::vec3(0.1f);
+			meshes[i]->material.kDiffuse = glm::vec3(0.8f);
+			meshes[i]->material.kSpecular = glm::vec3(0.3f);
+			meshes[i]->material.kShininess = 8.f;
+		}
+		std::vector<glm::mat4> models;
+		models.push_back(glm::scale(glm::rotate(glm::mat4(1.f), glm::radians(-90.f), glm::vec3(1.f, 0.f, 0.f)), glm::vec3(side, side, 1.f)));
+		for (float x = -side * 0.5f; x < side * 0.5f; x += 2.f)
+		{
+			for (float z = -side * 0.5f; z < side * 0.5f; z += 2.f)
+				models.push_back(glm::translate(glm::mat4(1.f), glm::vec3(x, 0.5f, z)));
+		}
+
+		FrameSnapshot frame;
+		frame.view = glm::lookAt(glm::vec3(0.f, 15.f, side * 0.6f), glm::vec3(0.f, 0.f, 0.f), glm::vec3(0.f, 1.f, 0.f));
+		frame.projection = glm::perspective(glm::radians(60.f), 4.f / 3.f, 0.1f, 1000.f);
+		GLStateCache::GetInstance()->Enable(GL_DEPTH_TEST);
+		UniformBlocks::GetInstance()->ReserveObjects(static_cast<unsigned>(models.size()));
+		RenderQueue queue;
+
+		// The uber program serves every case, so it is built once up front
+		double buildStart = cache->GetBuildTime();
+		unsigned uber = cache->GetUberProgram(vertexPath, fragmentPath);
+		double uberBuild = cache->GetBuildTime() - buildStart;
+		printf("%u draws, %u frames, uber program built in %.1f ms, %d bytes\n", static_cast<unsigned>(models.size()), numFrames, uberBuild, ProgramBinaryLength(uber));
+		printf("%-18s %10s %10s %10s %10s %8s\n", "case", "build ms", "bytes", "uber ms", "spec. ms", "speedup");
+
+		struct Case
+		{
+			const char* name;
+			bool lighting;
+			bool textured;
+			const char* lightTypes;		// one letter per FrameData light: Point, Directional, Spot
+			unsigned clusteredLights;
+		};
+		const Case cases[] =
+		{
+			{ "unlit", false, false, "", 0 },
+			{ "unlit textured", false, true, "", 0 },
+			{ "1 point", true, false, "P", 0 },
+			{ "1 point textured", true, true, "P", 0 },
+			{ "4 mixed", true, false, "DPSP", 0 },
+			{ "8 point", true, false, "PPPPPPPP", 0 },
+			{ "1 dir + 256", true, false, "D", 256 },
+		};
+		std::vector<Light> clustered;
+		for (unsigned c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c)
+		{
+			const Case& test = cases[c];
+			frame.lights.clear();
+			for (const char* type = test.lightTypes; *type; ++type)
+			{
+				Light light;
+				light.type = *type == 'D' ? Light::LIGHT_DIRECTIONAL : *type == 'S' ? Light::LIGHT_SPOT : Light::LIGHT_POINT;
+				float angle = static_cast<float>(frame.lights.size()) * 0.785f;
+				light.position = glm::vec3(cosf(angle) * side * 0.25f, 4.f, sinf(angle) * side * 0.25f);
+				light.power = 1.f / strlen(test.lightTypes);
+				light.spotDirection = glm::vec3(0.f, -1.f, 0.f);
+				light.cosCutoff = 45.f;
+				light.cosInner = 30.f;
+				frame.lights.push_back(light);
+			}
+			if (test.clusteredLights > 0)
+			{
+				ScatterLights(test.clusteredLights, side, clustered);
+				frame.clusters.Build(frame.view, frame.projection, &clustered[0], static_cast<int>(clustered.size()));
+			}
+			else
+				frame.clusters.Clear();
+
+			ShaderFeatures features;
+			features.lighting = test.lighting;
+			features.colorTexture = test.textured;
+			features.clusteredLights = test.clusteredLights > 0;
+			features.SetLights(frame.lights.empty() ? nullptr : &frame.lights[0], static_cast<int>(frame.lights.size()));
+			buildStart = cache->GetBuildTime();
+			unsigned specialized = cache->GetProgram(vertexPath, fragmentPath, features);
+			double build = cache->GetBuildTime() - buildStart;
+
+			ground->textureID = sphere->textureID = test.textured ? texture : 0;
+			double ms[2];
+			for (int spec = 0; spec < 2; ++spec)
+			{
+				unsigned programID = spec ? specialized : uber;
+				frame.commands.Begin(frame.view, frame.projection);
+				for (size_t i = 0; i < models.size(); ++i)
+					frame.commands.Submit(meshes[i == 0 ? 0 : 1], models[i], programID, test.lighting);
+
+				double total = 0.0;
+				for (unsigned f = 0; f <= numFrames; ++f)
+				{
+					std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+					frame.Replay(queue);
+					glFinish();
+					// The first frame warms up
+					if (f > 0)
+						total += Seconds(start);
+				}
+				ms[spec] = total * 1000.0 / numFrames;
+			}
+			printf("%-18s %10.1f %10d %10.3f %10.3f %7.2fx\n", test.name, build, ProgramBinaryLength(specialized), ms[0], ms[1], ms[0] / ms[1]);
+		}
+		UniformBlocks::GetInstance()->SetClusters(nullptr);
+		cache->PrintStats();
+
+		delete ground;
+		delete sphere;
+		GLStateCache::GetInstance()->DeleteTexture(texture);
+	}
+
+	// Startup cost of the programs the scenes build, compiled from source against loaded from the
+	// on-disk binary cache. A define unique to this run keeps earlier runs' binaries out of it
+	void BenchmarkProgramBinaries(int /*argc*/, char* /*argv*/[])
+	{
+		struct ProgramSources
+		{
+			const char* vertexPath;
+			const char* fragmentPath;
+			std::string defines;
+		};
+		std::vector<ProgramSources> sources;
+		const char* pairs[][2] =
+		{
+			{ "Shader//Shading.vertexshader", "Shader//Shading.fragmentshader" },
+			{ "Shader//Skinning.vertexshader", "Shader//Shading.fragmentshader" },
+			{ "Shader//Texture.vertexshader", "Shader//Texture.fragmentshader" },
+			{ "Shader//Texture.vertexshader", "Shader//GBuffer.fragmentshader" },
+			{ "Shader//Deferred.vertexshader", "Shader//Deferred.fragmentshader" },
+		};
+		for (unsigned i = 0; i < sizeof(pairs) / sizeof(pairs[0]); ++i)
+		{
+			ProgramSources program = { pairs[i][0], pairs[i][1], std::string() };
+			sources.push_back(program);
+		}
+		// The Texture variants SceneModel builds: one light of each type, textured or not, lit or not
+		std::vector<unsigned long long> keys;
+		for (int type = 0; type < Light::NUM_LIGHT_TYPES; ++type)
+		{
+			for (int variant = 0; variant < 4; ++variant)
+			{
+				Light light;
+				light.type = static_cast<Light::LIGHT_TYPE>(type);
+				ShaderFeatures features;
+				features.SetLights(&light, 1);
+				features.colorTexture = (variant & 1) != 0;
+				features.lighting = (variant & 2) != 0;
+				if (std::find(keys.begin(), keys.end(), features.GetKey()) != keys.end())
+					continue;
+				keys.push_back(features.GetKey());
+				ProgramSources program = { "Shader//Texture.vertexshader", "Shader//Texture.fragmentshader", features.GetDefines() };
+				sources.push_back(program);
+			}
+		}
+
+		char salt[64];
+		snprintf(salt, sizeof(salt), "#define PROGRAM_BINARY_RUN %lld\n",
+			static_cast<long long>(std::chrono::system_clock::now().time_since_epoch().count()));
+		for (size_t i = 0; i < sources.size(); ++i)
+			sources[i].defines = salt + sources[i].defines;
+
+		bool supported = GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary;
+		printf("%u programs, program binaries %s\n", static_cast<unsigned>(sources.size()), supported ? "supported" : "not supported, every run compiles");
+		printf("%-14s %10s %8s %8s %8s\n", "startup", "ms", "loaded", "compiled", "rejected");
+
+		const char* runs[3] = { "no cache", "cold cache", "warm cache" };
+		double ms[3];
+		std::vector<unsigned> programs(sources.size());
+		for (int run = 0; run < 3; ++run)
+		{
+			SetProgramBinaryDirectory(run == 0 ? nullptr : "ProgramCache");
+			ProgramBinaryStats before = GetProgramBinaryStats();
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			for (size_t i = 0; i < sources.size(); ++i)
+				programs[i] = LoadShaders(sources[i].vertexPath, sources[i].fragmentPath, sources[i].defines.c_str());
+			ms[run] = Seconds(start) * 1000.0;
+			const ProgramBinaryStats& after = GetProgramBinaryStats();
+			printf("%-14s %10.1f %8u %8u %8u\n", runs[run], ms[run], after.loaded - before.loaded, after.compiled - before.compiled, after.rejected - before.rejected);
+
+			for (size_t i = 0; i < programs.size(); ++i)
+				GLStateCache::GetInstance()->DeleteProgram(programs[i]);
+		}
+		printf("warm start saves %.1f ms, %.1fx faster than compiling\n", ms[0] - ms[2], ms[0] / std::max(ms[2], 0.001));
+
+		// This run's binaries can never be hit again
+		for (size_t i = 0; i < sources.size(); ++i)
+			RemoveProgramBinary(sources[i].vertexPath, sources[i].fragmentPath, sources[i].defines.c_str());
+	}
+
+	// What a scene's start costs when it builds its Texture variants: LoadShaders one after the other
+	// against a ShaderBatch drawing frames with the uber program while they compile. The binary cache
+	// is off and each run's sources carry a define of their own, so every program really compiles
+	void BenchmarkShaderBatch(int /*argc*/, char* /*argv*/[])
+	{
+		const char* vertexPath = "Shader//Texture.vertexshader";
+		const char* fragmentPath = "Shader//Texture.fragmentshader";
+		std::vector<std::string> variants;
+		std::vector<unsigned long long> keys;
+		for (int type = 0; type < Light::NUM_LIGHT_TYPES; ++type)
+		{
+			for (int variant = 0; variant < 8; ++variant)
+			{
+				Light light;
+				light.type = static_cast<Light::LIGHT_TYPE>(type);
+				ShaderFeatures features;
+				features.SetLights(&light, 1);
+				features.colorTexture = (variant & 1) != 0;
+				features.lighting = (variant & 2) != 0;
+				features.clusteredLights = (variant & 4) != 0;
+				if (std::find(keys.begin(), keys.end(), features.GetKey()) != keys.end())
+					continue;
+				keys.push_back(features.GetKey());
+				variants.push_back(features.GetDefines());
+			}
+		}
+		SetProgramBinaryDirectory(nullptr);
+
+		const float side = 20.f;
+		Mesh* sphere = MeshBuilder::GenerateSphere("Sphere", glm::vec3(0.9f), 0.5f, 16, 8);
+		sphere->material.kDiffuse = glm::vec3(0.8f);
+		std::vector<glm::mat4> models;
+		for (float x = -side * 0.5f; x < side * 0.5f; x += 1.f)
+		{
+			for (float z = -side * 0.5f; z < side * 0.5f; z += 1.f)
+				models.push_back(glm::translate(glm::mat4(1.f), glm::vec3(x, 0.5f, z)));
+		}
+		FrameSnapshot frame;
+		frame.view = glm::lookAt(glm::vec3(0.f, 10.f, side * 0.6f), glm::vec3(0.f, 0.f, 0.f), glm::vec3(0.f, 1.f, 0.f));
+		frame.projection = glm::perspective(glm::radians(60.f), 4.f / 3.f, 0.1f, 1000.f);
+		Light light;
+		light.position = glm::vec3(0.f, 5.f, 0.f);
+		frame.lights.push_back(light);
+		GLStateCache::GetInstance()->Enable(GL_DEPTH_TEST);
+		UniformBlocks::GetInstance()->ReserveObjects(static_cast<unsigned>(models.size()));
+		RenderQueue queue;
+		unsigned uber = ShaderCache::GetInstance()->GetUberProgram(vertexPath, fragmentPath);
+
+		printf("%u programs, %u draws a frame, parallel shader compile %s\n", static_cast<unsigned>(variants.size()),
+			static_cast<unsigned>(models.size()), ShaderBatch::IsParallelSupported() ? "supported" : "not supported");
+
+		long long salt = static_cast<long long>(std::chrono::system_clock::now().time_since_epoch().count());
+		std::vector<std::string> defines(variants.size());
+		for (int run = 0; run < 2; ++run)
+		{
+			for (size_t i = 0; i < variants.size(); ++i)
+				defines[i] = "#define SHADER_BATCH_RUN " + std::to_string(salt + run) + "\n" + variants[i];
+			std::vector<unsigned> programs(variants.size());
+
+			if (run == 0)
+			{
+				// Nothing is drawn until the last one has linked
+				std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+				for (size_t i = 0; i < variants.size(); ++i)
+					programs[i] = LoadShaders(vertexPath, fragmentPath, defines[i].c_str());
+				printf("LoadShaders: first frame after %.1f ms\n", Seconds(start) * 1000.0);
+			}
+			else
+			{
+				ShaderBatch batch;
+				std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+				for (size_t i = 0; i < variants.size(); ++i)
+					programs[i] = batch.Add(vertexPath, fragmentPath, defines[i].c_str(), uber);
+				batch.Submit();
+				double submitMs = Seconds(start) * 1000.0;
+
+				// Each frame polls, then draws every model with its variant or the uber program standing in
+				unsigned numFrames = 0;
+				double longestFrame = 0.0;
+				std::vector<unsigned> linked;
+				while (batch.GetNumPending() > 0)
+				{
+					std::chrono::high_resolution_clock::time_point frameStart = std::chrono::high_resolution_clock::now();
+					batch.Poll(&linked);
+					for (size_t i = 0; i < linked.size(); ++i)
+						UniformBlocks::GetInstance()->BindProgram(linked[i]);
+					linked.clear();
+					frame.commands.Begin(frame.view, frame.projection);
+					for (size_t i = 0; i < models.size(); ++i)
+						frame.commands.Submit(sphere, models[i], batch.Resolve(programs[i % programs.size()]), true);
+					glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+					frame.Replay(queue);
+					glFinish();
+					longestFrame = std::max(longestFrame, Seconds(frameStart) * 1000.0);
+					++numFrames;
+				}
+				printf("ShaderBatch: first frame after %.1f ms, %u frames drawn while compiling, longest %.1f ms, all linked after %.1f ms\n",
+					submitMs, numFrames, longestFrame, Seconds(start) * 1000.0);
+			}
+
+			for (size_t i = 0; i < programs.size(); ++i)
+				GLStateCache::GetInstance()->DeleteProgram(programs[i]);
+		}
+
+		SetProgramBinaryDirectory("ProgramCache");
+		delete sphere;
+	}
+
+	struct BenchmarkEntry
+	{
+		const char* name;
+		void (*run)(int argc, char* argv[]);
+	};
+
+	const BenchmarkEntry benchmarks[] =
+	{
+		{ "strip", BenchmarkStrip },
+		{ "tessellation", BenchmarkTessellation },
+		{ "submit", BenchmarkSubmit },
+		{ "arena", BenchmarkArena },
+		{ "queue", BenchmarkQueue },
+		{ "stream", BenchmarkStream },
+		{ "prepare", BenchmarkPrepare },
+		{ "pipeline", BenchmarkPipeline },
+		{ "transform", BenchmarkTransform },
+		{ "matrixstack", BenchmarkMatrixStack },
+		{ "scenegraph", BenchmarkSceneGraph },
+		{ "entities", BenchmarkEntities },
+		{ "animation", BenchmarkAnimation },
+		{ "skinning", BenchmarkSkinning },
+		{ "glb", BenchmarkGLB },
+		{ "ply", BenchmarkPLY },
+		{ "stl", BenchmarkSTL },
+		{ "clusters", BenchmarkClusters },
+		{ "deferred", BenchmarkDeferred },
+		{ "permutations", BenchmarkPermutations },
+		{ "programbinaries", BenchmarkProgramBinaries },
+		{ "shaderbatch", BenchmarkShaderBatch },
+	};
+}
+
+bool RunBenchmark(const std::string& name, int argc, char* argv[])
+{
+	for (unsigned i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); ++i)
+	{
+		if (name == benchmarks[i].name)
+		{
+			benchmarks[i].run(argc, argv);
+			return true;
+		}
+	}
+
+	printf("Unknown benchmark %s. Available:", name.c_str());
+	for (unsigned i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); ++i)
+		printf(" %s", benchmarks[i].name);
+	printf("\n");
+	return false;
+}
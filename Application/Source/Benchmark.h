@@ -0,0 +1,11 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+
+// Run the named benchmark and print its report to stdout.
+// Extra command line arguments after the name are passed through.
+// Returns false if there is no benchmark with that name.
+bool RunBenchmark(const std::string& name, int argc, char* argv[]);
+
+#endif
@@ -0,0 +1,108 @@
+#include "CommandList.h"
+
+#include <algorithm>
+
+CommandList::CommandList()
+	: numCulled(0)
+{
+}
+
+CommandList::~CommandList()
+{
+}
+
+void CommandList::Begin(const glm::mat4& view, const glm::mat4& projection)
+{
+	this->view = view;
+	items.clear();
+	keys.clear();
+	numCulled = 0;
+
+	// Clip planes straight from the rows of the projection (Gribb & Hartmann)
+	glm::vec4 row[4];
+	for (int i = 0; i < 4; ++i)
+		row[i] = glm::vec4(projection[0][i], projection[1][i], projection[2][i], projection[3][i]);
+	planes[0] = row[3] + row[0];	// left
+	planes[1] = row[3] - row[0];	// right
+	planes[2] = row[3] + row[1];	// bottom
+	planes[3] = row[3] - row[1];	// top
+	planes[4] = row[3] + row[2];	// near
+	planes[5] = row[3] - row[2];	// far
+	for (int i = 0; i < 6; ++i)
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+bool CommandList::IsVisible(const Mesh* mesh, const glm::mat4& modelView) const
+{
+	glm::vec3 center = glm::vec3(modelView * glm::vec4(mesh->boundsCenter, 1.f));
+
+	// Largest axis scale keeps the sphere conservative under non-uniform scaling
+	float scale = std::max(glm::length(glm::vec3(modelView[0])),
+		std::max(glm::length(glm::vec3(modelView[1])), glm::length(glm::vec3(modelView[2]))));
+	return IsVisible(center, mesh->boundsRadius * scale);
+}
+
+bool CommandList::IsVisible(const glm::vec3& viewCenter, float radius) const
+{
+	for (int i = 0; i < 6; ++i)
+	{
+		if (glm::dot(glm::vec3(planes[i]), viewCenter) + planes[i].w < -radius)
+			return false;
+	}
+	return true;
+}
+
+bool CommandList::Submit(Mesh* mesh, const glm::mat4& model, unsigned programID, bool enableLight, bool transparent)
+{
+	return Submit(mesh, mesh->material, model, programID, enableLight, transparent);
+}
+
+bool CommandList::Submit(Mesh* mesh, const Material& material, const glm::mat4& model, unsigned programID, bool enableLight, bool transparent)
+{
+	glm::mat4 modelView = view * model;
+	if (!IsVisible(mesh, modelView))
+	{
+		++numCulled;
+		return false;
+	}
+	Add(mesh, material, modelView, programID, enableLight, transparent);
+	return true;
+}
+
+bool CommandList::Submit(Mesh* mesh, const Material& material, const glm::mat4& model, const glm::vec4& bounds, unsigned programID, bool enableLight, bool transparent)
+{
+	// The view has no scale, so the radius carries over as it is
+	if (!IsVisible(glm::vec3(view * glm::vec4(glm::vec3(bounds), 1.f)), bounds.w))
+	{
+		++numCulled;
+		return false;
+	}
+	Add(mesh, material, view * model, programID, enableLight, transparent);
+	return true;
+}
+
+void CommandList::Add(Mesh* mesh, const Material& material, const glm::mat4& modelView, unsigned programID, bool enableLight, bool transparent)
+{
+	RenderQueue::Item item;
+	item.modelView = modelView;
+	item.mesh = mesh;
+	item.material = material;
+	item.textureID = mesh->textureID;
+	item.programID = programID;
+	item.lightEnabled = enableLight;
+	item.transparent = transparent;
+
+	// Camera looks down -z, so the distance in front of it is -z of the object's origin
+	keys.push_back(RenderQueue::MakeKey(item, mesh, -item.modelView[3].z));
+	items.push_back(item);
+}
+
+unsigned CommandList::GetNumCommands(void) const
+{
+	return static_cast<unsigned>(items.size());
+}
+
+unsigned CommandList::GetNumCulled(void) const
+{
+	return numCulled;
+}
@@ -0,0 +1,55 @@
+#ifndef COMMAND_LIST_H
+#define COMMAND_LIST_H
+
+#include <vector>
+#include <glm\glm.hpp>
+#include "Mesh.h"
+#include "Material.h"
+#include "RenderQueue.h"
+
+/******************************************************************************/
+/*!
+		Class CommandList:
+\brief	Draws recorded off the GL thread. A worker composes matrices, culls
+		against the view frustum and makes the sort key; the GL thread only
+		hands the list to RenderQueue::Append and flushes. Nothing in here
+		calls GL, so each worker can fill its own list in parallel.
+
+		The view must be the one the RenderQueue was begun with, since
+		model-view matrices are baked in at record time.
+*/
+/******************************************************************************/
+class CommandList
+{
+public:
+	CommandList();
+	~CommandList();
+
+	// Clears the list and sets up the frustum planes
+	void Begin(const glm::mat4& view, const glm::mat4& projection);
+
+	// Return false when the mesh's bounding sphere is outside the frustum and nothing was recorded
+	bool Submit(Mesh* mesh, const glm::mat4& model, unsigned programID, bool enableLight, bool transparent = false);
+	// Records the given material instead of the mesh's, so workers never write to shared meshes
+	bool Submit(Mesh* mesh, const Material& material, const glm::mat4& model, unsigned programID, bool enableLight, bool transparent = false);
+	// Culls with a world-space bounding sphere (radius in w) the caller already keeps up to date
+	bool Submit(Mesh* mesh, const Material& material, const glm::mat4& model, const glm::vec4& bounds, unsigned programID, bool enableLight, bool transparent = false);
+
+	unsigned GetNumCommands(void) const;
+	unsigned GetNumCulled(void) const;
+
+private:
+	friend class RenderQueue;
+
+	bool IsVisible(const Mesh* mesh, const glm::mat4& modelView) const;
+	bool IsVisible(const glm::vec3& viewCenter, float radius) const;
+	void Add(Mesh* mesh, const Material& material, const glm::mat4& modelView, unsigned programID, bool enableLight, bool transparent);
+
+	glm::mat4 view;
+	glm::vec4 planes[6];	// view space, normals pointing inwards
+	std::vector<RenderQueue::Item> items;
+	std::vector<unsigned long long> keys;
+	unsigned numCulled;
+};
+
+#endif
@@ -0,0 +1,196 @@
+#include "DeferredRenderer.h"
+#include <GL\glew.h>
+#include "GLStateCache.h"
+#include "UniformBlocks.h"
+#include "FrameSnapshot.h"
+#include "shader.hpp"
+
+#include <stdio.h>
+
+DeferredRenderer* DeferredRenderer::m_instance = nullptr;
+
+DeferredRenderer* DeferredRenderer::GetInstance(void)
+{
+	if (m_instance == nullptr)
+		m_instance = new DeferredRenderer();
+	return m_instance;
+}
+
+void DeferredRenderer::DestroyInstance(void)
+{
+	if (m_instance)
+	{
+		delete m_instance;
+		m_instance = nullptr;
+	}
+}
+
+DeferredRenderer::DeferredRenderer(void)
+	: geometryProgram(0)
+	, lightingProgram(0)
+	, inverseProjectionLocation(-1)
+	, vertexArray(0)
+	, framebuffer(0)
+	, depthTexture(0)
+	, width(0)
+	, height(0)
+	, complete(false)
+{
+	for (int i = 0; i < NUM_TARGETS; ++i)
+		textures[i] = 0;
+}
+
+DeferredRenderer::~DeferredRenderer(void)
+{
+	GLStateCache* state = GLStateCache::GetInstance();
+	if (geometryProgram)
+		state->DeleteProgram(geometryProgram);
+	if (lightingProgram)
+		state->DeleteProgram(lightingProgram);
+	if (vertexArray)
+		state->DeleteVertexArray(vertexArray);
+	for (int i = 0; i < NUM_TARGETS; ++i)
+	{
+		if (textures[i])
+			state->DeleteTexture(textures[i]);
+	}
+	if (depthTexture)
+		state->DeleteTexture(depthTexture);
+	if (framebuffer)
+		glDeleteFramebuffers(1, &framebuffer);
+}
+
+void DeferredRenderer::CreatePrograms(void)
+{
+	GLStateCache* state = GLStateCache::GetInstance();
+
+	// RenderQueue sets the colorTexture sampler of the G-buffer program like any other
+	geometryProgram = LoadShaders("Shader//Texture.vertexshader", "Shader//GBuffer.fragmentshader");
+	UniformBlocks::GetInstance()->BindProgram(geometryProgram);
+
+	lightingProgram = LoadShaders("Shader//Deferred.vertexshader", "Shader//Deferred.fragmentshader");
+	UniformBlocks::GetInstance()->BindProgram(lightingProgram);
+	state->UseProgram(lightingProgram);
+	const char* samplers[NUM_TARGETS + 1] = { "gNormalShininess", "gDiffuse", "gSpecular", "gEmissive", "gDepth" };
+	for (int i = 0; i <= NUM_TARGETS; ++i)
+		glUniform1i(glGetUniformLocation(lightingProgram, samplers[i]), i);
+	inverseProjectionLocation = glGetUniformLocation(lightingProgram, "inverseProjection");
+
+	glGenVertexArrays(1, &vertexArray);
+}
+
+bool DeferredRenderer::Resize(int width, int height)
+{
+	GLStateCache* state = GLStateCache::GetInstance();
+	this->width = width;
+	this->height = height;
+
+	for (int i = 0; i < NUM_TARGETS; ++i)
+	{
+		if (textures[i])
+			state->DeleteTexture(textures[i]);
+	}
+	if (depthTexture)
+		state->DeleteTexture(depthTexture);
+	if (framebuffer == 0)
+		glGenFramebuffers(1, &framebuffer);
+
+	GLint previous = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+	// Normals need the sign and precision of half floats; the colours are fine in bytes
+	const GLenum formats[NUM_TARGETS] = { GL_RGBA16F, GL_RGBA8, GL_RGBA8, GL_RGBA8 };
+	GLenum drawBuffers[NUM_TARGETS];
+	glGenTextures(NUM_TARGETS, textures);
+	glGenTextures(1, &depthTexture);
+	state->ActiveTexture(GL_TEXTURE0);
+	for (int i = 0; i <= NUM_TARGETS; ++i)
+	{
+		unsigned texture = i < NUM_TARGETS ? textures[i] : depthTexture;
+		state->BindTexture(GL_TEXTURE_2D, texture);
+		if (i < NUM_TARGETS)
+			glTexImage2D(GL_TEXTURE_2D, 0, formats[i], width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		else
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+		// Read back with texelFetch, one texel per pixel
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		if (i < NUM_TARGETS)
+		{
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, texture, 0);
+			drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+		}
+		else
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+	}
+	state->BindTexture(GL_TEXTURE_2D, 0);
+	glDrawBuffers(NUM_TARGETS, drawBuffers);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, previous);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		printf("G-buffer of %d x %d is incomplete (0x%x), drawing forward instead\n", width, height, status);
+		return false;
+	}
+	return true;
+}
+
+void DeferredRenderer::Flush(const FrameSnapshot& frame, RenderQueue& queue)
+{
+	GLStateCache* state = GLStateCache::GetInstance();
+	if (geometryProgram == 0)
+		CreatePrograms();
+
+	// Sized to cover the viewport wherever it sits in the window
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	if (viewport[0] + viewport[2] != width || viewport[1] + viewport[3] != height)
+		complete = Resize(viewport[0] + viewport[2], viewport[1] + viewport[3]);
+	if (!complete)
+	{
+		queue.Flush();
+		return;
+	}
+
+	GLint target = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);
+
+	// Cleared to "nothing here": no normal, no colour, far depth
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	const GLfloat zero[4] = { 0.f, 0.f, 0.f, 0.f };
+	const GLfloat farDepth = 1.f;
+	for (int i = 0; i < NUM_TARGETS; ++i)
+		glClearBufferfv(GL_COLOR, i, zero);
+	glClearBufferfv(GL_DEPTH, 0, &farDepth);
+	queue.FlushOpaque(geometryProgram);
+
+	// The lighting pass fills the screen, whatever the scene's polygon mode
+	glBindFramebuffer(GL_FRAMEBUFFER, target);
+	state->UseProgram(lightingProgram);
+	glm::mat4 inverseProjection = glm::inverse(frame.projection);
+	glUniformMatrix4fv(inverseProjectionLocation, 1, GL_FALSE, &inverseProjection[0][0]);
+	for (int i = 0; i <= NUM_TARGETS; ++i)
+	{
+		state->ActiveTexture(GL_TEXTURE0 + i);
+		state->BindTexture(GL_TEXTURE_2D, i < NUM_TARGETS ? textures[i] : depthTexture);
+	}
+	if (frame.wireframe)
+		state->PolygonMode(GL_FILL);
+	state->BindVertexArray(vertexArray);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	if (frame.wireframe)
+		state->PolygonMode(GL_LINE);
+
+	// Left bound, the attachments would be sampled while the next G-buffer pass draws into them
+	for (int i = NUM_TARGETS; i >= 0; --i)
+	{
+		state->ActiveTexture(GL_TEXTURE0 + i);
+		state->BindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	queue.FlushTransparent();
+}
@@ -0,0 +1,64 @@
+#ifndef DEFERRED_RENDERER_H
+#define DEFERRED_RENDERER_H
+
+#include "RenderQueue.h"
+
+struct FrameSnapshot;
+
+/******************************************************************************/
+/*!
+		Class DeferredRenderer:
+\brief	Deferred shading for a RenderQueue. The opaque items are drawn once
+		into a G-buffer (camera space normal and shininess, diffuse colour,
+		specular colour, the ambient or unlit colour, and depth), then a
+		single screen-covering pass lights each pixel from it: the FrameData
+		lights plus the lights of the pixel's LightClusters cluster. So every
+		light is evaluated once per visible pixel however much is hidden
+		behind it. Transparent items are drawn forward on top as usual.
+
+		Lights and materials reach it through the same UniformBlocks as the
+		forward programs. The G-buffer follows the viewport size and is
+		single sampled, so this path has no multisampling.
+*/
+/******************************************************************************/
+class DeferredRenderer
+{
+public:
+	enum GBUFFER_TARGET
+	{
+		TARGET_NORMAL_SHININESS = 0,	// RGBA16F
+		TARGET_DIFFUSE,					// RGBA8
+		TARGET_SPECULAR,				// RGBA8
+		TARGET_EMISSIVE,				// RGBA8
+		NUM_TARGETS,
+	};
+
+	static DeferredRenderer* GetInstance(void);
+	static void DestroyInstance(void);
+
+	// In place of queue.Flush: G-buffer pass, lighting pass into the framebuffer bound now, transparent pass.
+	// queue must have been begun with the frame's view and projection
+	void Flush(const FrameSnapshot& frame, RenderQueue& queue);
+
+private:
+	DeferredRenderer(void);
+	~DeferredRenderer(void);
+
+	static DeferredRenderer* m_instance;
+
+	void CreatePrograms(void);
+	// (Re)make the attachments; returns whether the framebuffer is complete
+	bool Resize(int width, int height);
+
+	unsigned geometryProgram;	// Texture.vertexshader with GBuffer.fragmentshader
+	unsigned lightingProgram;
+	int inverseProjectionLocation;
+	unsigned vertexArray;		// empty, the lighting pass makes its vertices from gl_VertexID
+	unsigned framebuffer;
+	unsigned textures[NUM_TARGETS];
+	unsigned depthTexture;
+	int width, height;
+	bool complete;
+};
+
+#endif
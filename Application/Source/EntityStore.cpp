@@ -0,0 +1,327 @@
+#include "EntityStore.h"
+#include "ThreadPool.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <algorithm>
+
+namespace
+{
+	double Milliseconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// Moves the last element into slot and drops the last
+	template <typename T>
+	void RemoveSlot(std::vector<T>& components, unsigned slot)
+	{
+		components[slot] = components.back();
+		components.pop_back();
+	}
+}
+
+EntityStore::EntityStore()
+	: time(0.0)
+	, updateTime(0.0)
+	, recordTime(0.0)
+	, numRecorded(0)
+	, numCulled(0)
+{
+}
+
+EntityStore::~EntityStore()
+{
+}
+
+void EntityStore::Clear(void)
+{
+	meshes.clear();
+	slotOf.clear();
+	entityAt.clear();
+	freeEntities.clear();
+	position.clear();
+	scale.clear();
+	axis.clear();
+	angle.clear();
+	world.clear();
+	mesh.clear();
+	material.clear();
+	spinSpeed.clear();
+	bobHeight.clear();
+	bobFrequency.clear();
+	bobPhase.clear();
+	bobOffset.clear();
+	bounds.clear();
+	time = 0.0;
+}
+
+void EntityStore::Reserve(unsigned numEntities)
+{
+	slotOf.reserve(numEntities);
+	entityAt.reserve(numEntities);
+	position.reserve(numEntities);
+	scale.reserve(numEntities);
+	axis.reserve(numEntities);
+	angle.reserve(numEntities);
+	world.reserve(numEntities);
+	mesh.reserve(numEntities);
+	material.reserve(numEntities);
+	spinSpeed.reserve(numEntities);
+	bobHeight.reserve(numEntities);
+	bobFrequency.reserve(numEntities);
+	bobPhase.reserve(numEntities);
+	bobOffset.reserve(numEntities);
+	bounds.reserve(numEntities);
+}
+
+unsigned EntityStore::AddMesh(Mesh* shape)
+{
+	meshes.push_back(shape);
+	return static_cast<unsigned>(meshes.size() - 1);
+}
+
+EntityStore::Entity EntityStore::Create(unsigned meshHandle, const Material& mat, const glm::vec3& pos, const glm::vec3& size)
+{
+	Entity entity;
+	if (!freeEntities.empty())
+	{
+		entity = freeEntities.back();
+		freeEntities.pop_back();
+	}
+	else
+	{
+		entity = static_cast<Entity>(slotOf.size());
+		slotOf.resize(entity + 1);
+	}
+
+	slotOf[entity] = static_cast<unsigned>(entityAt.size());
+	entityAt.push_back(entity);
+	position.push_back(pos);
+	scale.push_back(size);
+	axis.push_back(glm::vec3(0.f, 1.f, 0.f));
+	angle.push_back(0.f);
+	world.push_back(glm::mat4(1.f));
+	mesh.push_back(meshHandle);
+	material.push_back(mat);
+	spinSpeed.push_back(0.f);
+	bobHeight.push_back(0.f);
+	bobFrequency.push_back(0.f);
+	bobPhase.push_back(0.f);
+	bobOffset.push_back(0.f);
+	bounds.push_back(glm::vec4(0.f));
+
+	// Valid world and bounds straight away, without waiting for the next UpdateTransforms
+	unsigned slot = slotOf[entity];
+	TransformRange(slot, slot + 1);
+	return entity;
+}
+
+void EntityStore::Destroy(Entity entity)
+{
+	if (!IsAlive(entity))
+	{
+		printf("EntityStore: Destroy of entity %u that does not exist\n", entity);
+		return;
+	}
+
+	unsigned slot = slotOf[entity];
+	Entity moved = entityAt.back();
+	RemoveSlot(entityAt, slot);
+	RemoveSlot(position, slot);
+	RemoveSlot(scale, slot);
+	RemoveSlot(axis, slot);
+	RemoveSlot(angle, slot);
+	RemoveSlot(world, slot);
+	RemoveSlot(mesh, slot);
+	RemoveSlot(material, slot);
+	RemoveSlot(spinSpeed, slot);
+	RemoveSlot(bobHeight, slot);
+	RemoveSlot(bobFrequency, slot);
+	RemoveSlot(bobPhase, slot);
+	RemoveSlot(bobOffset, slot);
+	RemoveSlot(bounds, slot);
+
+	slotOf[moved] = slot;
+	slotOf[entity] = INVALID_ENTITY;
+	freeEntities.push_back(entity);
+}
+
+bool EntityStore::IsAlive(Entity entity) const
+{
+	return entity < slotOf.size() && slotOf[entity] != INVALID_ENTITY;
+}
+
+void EntityStore::SetPosition(Entity entity, const glm::vec3& pos)
+{
+	position[slotOf[entity]] = pos;
+}
+
+void EntityStore::SetScale(Entity entity, const glm::vec3& size)
+{
+	scale[slotOf[entity]] = size;
+}
+
+void EntityStore::SetRotation(Entity entity, const glm::vec3& rotationAxis, float degrees)
+{
+	unsigned slot = slotOf[entity];
+	axis[slot] = glm::normalize(rotationAxis);
+	angle[slot] = degrees;
+}
+
+void EntityStore::SetMaterial(Entity entity, const Material& mat)
+{
+	material[slotOf[entity]] = mat;
+}
+
+void EntityStore::SetSpin(Entity entity, float degreesPerSecond)
+{
+	spinSpeed[slotOf[entity]] = degreesPerSecond;
+}
+
+void EntityStore::SetBob(Entity entity, float height, float frequency, float phase)
+{
+	unsigned slot = slotOf[entity];
+	bobHeight[slot] = height;
+	bobFrequency[slot] = frequency;
+	bobPhase[slot] = phase;
+}
+
+const glm::vec3& EntityStore::GetPosition(Entity entity) const
+{
+	return position[slotOf[entity]];
+}
+
+const glm::mat4& EntityStore::GetWorld(Entity entity) const
+{
+	return world[slotOf[entity]];
+}
+
+const glm::vec4& EntityStore::GetBounds(Entity entity) const
+{
+	return bounds[slotOf[entity]];
+}
+
+unsigned EntityStore::GetNumChunks(void) const
+{
+	return (static_cast<unsigned>(entityAt.size()) + CHUNK_SIZE - 1) / CHUNK_SIZE;
+}
+
+void EntityStore::AnimateRange(unsigned first, unsigned last, float dt)
+{
+	float t = static_cast<float>(time);
+	for (unsigned i = first; i < last; ++i)
+	{
+		// Kept within one turn so the angle does not lose precision over a long run
+		angle[i] = fmodf(angle[i] + spinSpeed[i] * dt, 360.f);
+		bobOffset[i] = bobHeight[i] * sinf(6.2831853f * bobFrequency[i] * t + bobPhase[i]);
+	}
+}
+
+void EntityStore::TransformRange(unsigned first, unsigned last)
+{
+	for (unsigned i = first; i < last; ++i)
+	{
+		// Translate * rotate(axis, angle) * scale, written out instead of three 4x4 products
+		const glm::vec3& a = axis[i];
+		float radians = glm::radians(angle[i]);
+		float c = cosf(radians);
+		float s = sinf(radians);
+		glm::vec3 t = (1.f - c) * a;
+
+		glm::mat4& m = world[i];
+		m[0] = glm::vec4(c + t.x * a.x, t.x * a.y + s * a.z, t.x * a.z - s * a.y, 0.f) * scale[i].x;
+		m[1] = glm::vec4(t.y * a.x - s * a.z, c + t.y * a.y, t.y * a.z + s * a.x, 0.f) * scale[i].y;
+		m[2] = glm::vec4(t.z * a.x + s * a.y, t.z * a.y - s * a.x, c + t.z * a.z, 0.f) * scale[i].z;
+		m[3] = glm::vec4(position[i].x, position[i].y + bobOffset[i], position[i].z, 1.f);
+
+		// Largest axis scale keeps the sphere conservative, as in CommandList
+		const Mesh* shape = meshes[mesh[i]];
+		glm::vec3 center = glm::vec3(m * glm::vec4(shape->boundsCenter, 1.f));
+		float maxScale = std::max(fabsf(scale[i].x), std::max(fabsf(scale[i].y), fabsf(scale[i].z)));
+		bounds[i] = glm::vec4(center, shape->boundsRadius * maxScale);
+	}
+}
+
+void EntityStore::Animate(float dt)
+{
+	time += dt;
+	unsigned count = static_cast<unsigned>(entityAt.size());
+	ThreadPool::GetInstance()->Run(GetNumChunks(), [&](unsigned index, unsigned /*thread*/)
+	{
+		AnimateRange(index * CHUNK_SIZE, std::min(count, (index + 1) * CHUNK_SIZE), dt);
+	});
+}
+
+void EntityStore::UpdateTransforms(void)
+{
+	unsigned count = static_cast<unsigned>(entityAt.size());
+	ThreadPool::GetInstance()->Run(GetNumChunks(), [&](unsigned index, unsigned /*thread*/)
+	{
+		TransformRange(index * CHUNK_SIZE, std::min(count, (index + 1) * CHUNK_SIZE));
+	});
+}
+
+void EntityStore::Update(float dt)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	time += dt;
+	unsigned count = static_cast<unsigned>(entityAt.size());
+	// Both systems on a chunk while it is still in cache
+	ThreadPool::GetInstance()->Run(GetNumChunks(), [&](unsigned index, unsigned /*thread*/)
+	{
+		unsigned first = index * CHUNK_SIZE;
+		unsigned last = std::min(count, first + CHUNK_SIZE);
+		AnimateRange(first, last, dt);
+		TransformRange(first, last);
+	});
+	updateTime = Milliseconds(start);
+}
+
+void EntityStore::Record(std::vector<CommandList>& lists, const glm::mat4& view, const glm::mat4& projection, unsigned programID, bool enableLight)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	ThreadPool* pool = ThreadPool::GetInstance();
+	lists.resize(pool->GetNumThreads());
+	for (size_t i = 0; i < lists.size(); ++i)
+		lists[i].Begin(view, projection);
+
+	unsigned count = static_cast<unsigned>(entityAt.size());
+	pool->Run(GetNumChunks(), [&](unsigned index, unsigned thread)
+	{
+		CommandList& list = lists[thread];
+		unsigned last = std::min(count, (index + 1) * CHUNK_SIZE);
+		for (unsigned i = index * CHUNK_SIZE; i < last; ++i)
+			list.Submit(meshes[mesh[i]], material[i], world[i], bounds[i], programID, enableLight);
+	});
+
+	numRecorded = numCulled = 0;
+	for (size_t i = 0; i < lists.size(); ++i)
+	{
+		numRecorded += lists[i].GetNumCommands();
+		numCulled += lists[i].GetNumCulled();
+	}
+	recordTime = Milliseconds(start);
+}
+
+unsigned EntityStore::GetNumEntities(void) const
+{
+	return static_cast<unsigned>(entityAt.size());
+}
+
+double EntityStore::GetUpdateTime(void) const
+{
+	return updateTime;
+}
+
+double EntityStore::GetRecordTime(void) const
+{
+	return recordTime;
+}
+
+void EntityStore::PrintStats(void) const
+{
+	printf("entities: %u in %u chunks, update %.3f ms, record %.3f ms, %u drawn, %u culled\n",
+		GetNumEntities(), GetNumChunks(), updateTime, recordTime, numRecorded, numCulled);
+}
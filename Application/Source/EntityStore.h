@@ -0,0 +1,114 @@
+#ifndef ENTITY_STORE_H
+#define ENTITY_STORE_H
+
+#include <vector>
+#include <glm\glm.hpp>
+#include "Mesh.h"
+#include "Material.h"
+#include "CommandList.h"
+
+/******************************************************************************/
+/*!
+		Class EntityStore:
+\brief	Scene objects as components in parallel arrays rather than as scene
+		members and hand-written render code. Each component (transform,
+		mesh handle, material, animation state, bounds) is its own array,
+		indexed by a dense slot, so a system only streams through the arrays
+		it uses.
+
+		Systems split the slots into CHUNK_SIZE chunks and run them on the
+		ThreadPool. A chunk only writes its own slots, so no locking is
+		needed; Record gives each pool thread its own CommandList.
+
+		Entities are handles that stay valid until destroyed. Destroy moves
+		the last slot into the hole, which keeps the arrays dense.
+*/
+/******************************************************************************/
+class EntityStore
+{
+public:
+	typedef unsigned Entity;
+
+	static const Entity INVALID_ENTITY = 0xFFFFFFFF;
+	static const unsigned CHUNK_SIZE = 1024;	// slots per task
+
+	EntityStore();
+	~EntityStore();
+
+	void Clear(void);
+	void Reserve(unsigned numEntities);
+
+	// Meshes are shared and not owned; entities refer to them by the returned handle
+	unsigned AddMesh(Mesh* shape);
+
+	Entity Create(unsigned meshHandle, const Material& mat, const glm::vec3& pos, const glm::vec3& size = glm::vec3(1.f));
+	void Destroy(Entity entity);
+	bool IsAlive(Entity entity) const;
+
+	// Take effect in the world matrix and bounds at the next UpdateTransforms or Update
+	void SetPosition(Entity entity, const glm::vec3& pos);
+	void SetScale(Entity entity, const glm::vec3& size);
+	void SetRotation(Entity entity, const glm::vec3& rotationAxis, float degrees);
+	void SetMaterial(Entity entity, const Material& mat);
+	// Turns about the rotation axis at a steady rate
+	void SetSpin(Entity entity, float degreesPerSecond);
+	// Moves up and down around its position
+	void SetBob(Entity entity, float height, float frequency, float phase);
+
+	const glm::vec3& GetPosition(Entity entity) const;
+	const glm::mat4& GetWorld(Entity entity) const;
+	const glm::vec4& GetBounds(Entity entity) const;	// world-space sphere, radius in w
+
+	// Systems
+	void Animate(float dt);
+	// World matrices and bounds from the transform and animation state
+	void UpdateTransforms(void);
+	// Animate and UpdateTransforms in one pass over each chunk
+	void Update(float dt);
+	// Records the visible entities; lists is resized to one per pool thread and begun with view and projection
+	void Record(std::vector<CommandList>& lists, const glm::mat4& view, const glm::mat4& projection, unsigned programID, bool enableLight);
+
+	unsigned GetNumEntities(void) const;
+	double GetUpdateTime(void) const;	// milliseconds spent in the last Update
+	double GetRecordTime(void) const;	// milliseconds spent in the last Record
+	void PrintStats(void) const;
+
+private:
+	void AnimateRange(unsigned first, unsigned last, float dt);
+	void TransformRange(unsigned first, unsigned last);
+	unsigned GetNumChunks(void) const;
+
+	std::vector<Mesh*> meshes;
+
+	// Handle to slot and back
+	std::vector<unsigned> slotOf;
+	std::vector<Entity> entityAt;
+	std::vector<Entity> freeEntities;
+
+	// Transform
+	std::vector<glm::vec3> position;
+	std::vector<glm::vec3> scale;
+	std::vector<glm::vec3> axis;
+	std::vector<float> angle;		// degrees about axis
+	std::vector<glm::mat4> world;
+
+	// Render
+	std::vector<unsigned> mesh;
+	std::vector<Material> material;
+
+	// Animation state
+	std::vector<float> spinSpeed;	// degrees per second
+	std::vector<float> bobHeight;
+	std::vector<float> bobFrequency;
+	std::vector<float> bobPhase;
+	std::vector<float> bobOffset;	// current height above position
+
+	// Bounds
+	std::vector<glm::vec4> bounds;
+
+	double time;
+	double updateTime, recordTime;
+	unsigned numRecorded, numCulled;
+};
+
+#endif
@@ -0,0 +1,181 @@
+#include "FramePipeline.h"
+#include <GL\glew.h>
+#include <GLFW/glfw3.h>
+#include "GLStateCache.h"
+#include "ShaderCache.h"
+
+#include <stdio.h>
+
+namespace
+{
+	double Milliseconds(std::chrono::high_resolution_clock::duration duration)
+	{
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+}
+
+FramePipeline::FramePipeline(GLFWwindow* window, unsigned maxQueuedFrames)
+	: window(window)
+	, scene(nullptr)
+	, maxQueuedFrames(maxQueuedFrames > 0 ? maxQueuedFrames : 1)
+	, pipelined(false)
+	, stopping(false)
+	, numFrames(0)
+	, totalLatency(0.0)
+{
+}
+
+FramePipeline::~FramePipeline()
+{
+	Stop();
+}
+
+bool FramePipeline::Start(Scene* scene, bool pipelined)
+{
+	Stop();
+	this->scene = scene;
+	this->pipelined = pipelined && scene->SupportsRecord();
+	numFrames = 0;
+	totalLatency = 0.0;
+	if (!this->pipelined)
+		return false;
+
+	// One snapshot more than may queue, for the one being drawn
+	snapshots.clear();
+	snapshots.resize(maxQueuedFrames + 1);
+	freeSnapshots.clear();
+	queuedSnapshots.clear();
+	for (size_t i = 0; i < snapshots.size(); ++i)
+		freeSnapshots.push_back(&snapshots[i]);
+	stopping = false;
+
+	// A context can only be current on one thread at a time
+	glFinish();
+	glfwMakeContextCurrent(NULL);
+	renderThread = std::thread(&FramePipeline::RenderLoop, this);
+	return true;
+}
+
+void FramePipeline::Frame(double dt)
+{
+	if (!pipelined)
+	{
+		std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+		scene->Update(dt);
+		ShaderCache::GetInstance()->Poll();
+		scene->Render();
+		glfwSwapBuffers(window);
+		GLStateCache::GetInstance()->EndFrame();
+		Presented(startTime);
+		return;
+	}
+
+	// Blocks while maxQueuedFrames are already waiting, so the main thread cannot run away
+	FrameSnapshot* frame;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		changed.wait(lock, [this] { return !freeSnapshots.empty(); });
+		frame = freeSnapshots.front();
+		freeSnapshots.pop_front();
+	}
+
+	frame->startTime = std::chrono::high_resolution_clock::now();
+	// The resize callback has no context to call glViewport with, so the size travels with the frame
+	glfwGetFramebufferSize(window, &frame->viewportWidth, &frame->viewportHeight);
+	scene->Update(dt);
+	scene->Record(*frame);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queuedSnapshots.push_back(frame);
+	}
+	changed.notify_all();
+}
+
+void FramePipeline::Stop(void)
+{
+	if (!renderThread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	changed.notify_all();
+	renderThread.join();
+	glfwMakeContextCurrent(window);
+}
+
+void FramePipeline::RenderLoop(void)
+{
+	glfwMakeContextCurrent(window);
+	for (;;)
+	{
+		FrameSnapshot* frame;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [this] { return stopping || !queuedSnapshots.empty(); });
+			// Frames already queued are still drawn, so Stop never drops input
+			if (queuedSnapshots.empty())
+				break;
+			frame = queuedSnapshots.front();
+			queuedSnapshots.pop_front();
+		}
+
+		// The only GL thread there is while pipelined, so background compiles are picked up here
+		ShaderCache::GetInstance()->Poll();
+		frame->Replay(renderQueue);
+		glfwSwapBuffers(window);
+		GLStateCache::GetInstance()->EndFrame();
+		Presented(frame->startTime);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			freeSnapshots.push_back(frame);
+		}
+		changed.notify_all();
+	}
+	glFinish();
+	glfwMakeContextCurrent(NULL);
+}
+
+void FramePipeline::Presented(std::chrono::high_resolution_clock::time_point startTime)
+{
+	std::chrono::high_resolution_clock::time_point now = std::chrono::high_resolution_clock::now();
+	std::lock_guard<std::mutex> lock(mutex);
+	if (numFrames == 0)
+		firstPresent = now;
+	lastPresent = now;
+	++numFrames;
+	totalLatency += Milliseconds(now - startTime);
+}
+
+bool FramePipeline::IsPipelined(void) const
+{
+	return pipelined;
+}
+
+double FramePipeline::GetFrameTime(void) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return numFrames > 1 ? Milliseconds(lastPresent - firstPresent) / (numFrames - 1) : 0.0;
+}
+
+double FramePipeline::GetLatency(void) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return numFrames > 0 ? totalLatency / numFrames : 0.0;
+}
+
+unsigned FramePipeline::GetNumFrames(void) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return numFrames;
+}
+
+void FramePipeline::PrintStats(void) const
+{
+	double frameTime = GetFrameTime();
+	printf("%s: %u frames, %.3f ms/frame (%.1f fps), %.3f ms latency\n", pipelined ? "pipelined" : "serial",
+		GetNumFrames(), frameTime, frameTime > 0.0 ? 1000.0 / frameTime : 0.0, GetLatency());
+}
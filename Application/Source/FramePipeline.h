@@ -0,0 +1,73 @@
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "Scene.h"
+#include "FrameSnapshot.h"
+#include "RenderQueue.h"
+
+struct GLFWwindow;
+
+/******************************************************************************/
+/*!
+		Class FramePipeline:
+\brief	Runs the frame loop either serially (Update, Render and swap on the
+		calling thread) or pipelined: the GL context moves to a render
+		thread that replays frame N's snapshot while the calling thread
+		updates and records frame N+1. At most maxQueuedFrames snapshots
+		wait for the render thread, which bounds the added latency.
+
+		Pipelined mode needs a scene whose Update makes no GL calls and
+		which implements Scene::Record; other scenes stay serial.
+*/
+/******************************************************************************/
+class FramePipeline
+{
+public:
+	FramePipeline(GLFWwindow* window, unsigned maxQueuedFrames = 2);
+	~FramePipeline();
+
+	// Returns whether the pipelined mode was actually started
+	bool Start(Scene* scene, bool pipelined);
+	void Frame(double dt);
+	// Waits for queued frames and gives the GL context back to the calling thread
+	void Stop(void);
+
+	bool IsPipelined(void) const;
+
+	// Averages since Start; latency is from the start of Update to after the swap
+	double GetFrameTime(void) const;	// milliseconds between presented frames
+	double GetLatency(void) const;		// milliseconds
+	unsigned GetNumFrames(void) const;
+	void PrintStats(void) const;
+
+private:
+	void RenderLoop(void);
+	void Presented(std::chrono::high_resolution_clock::time_point startTime);
+
+	GLFWwindow* window;
+	Scene* scene;
+	unsigned maxQueuedFrames;
+	bool pipelined;
+
+	std::thread renderThread;
+	mutable std::mutex mutex;
+	std::condition_variable changed;	// a snapshot was queued or freed, or stopping
+	std::vector<FrameSnapshot> snapshots;
+	std::deque<FrameSnapshot*> freeSnapshots;
+	std::deque<FrameSnapshot*> queuedSnapshots;
+	bool stopping;
+
+	RenderQueue renderQueue;	// used by the render thread only
+
+	std::chrono::high_resolution_clock::time_point firstPresent, lastPresent;
+	unsigned numFrames;
+	double totalLatency;
+};
+
+#endif
@@ -0,0 +1,37 @@
+#include "FrameSnapshot.h"
+#include <GL\glew.h>
+#include "GLStateCache.h"
+#include "UniformBlocks.h"
+#include "DeferredRenderer.h"
+
+void FrameSnapshot::ApplyState(void) const
+{
+	if (viewportWidth > 0 && viewportHeight > 0)
+		glViewport(0, 0, viewportWidth, viewportHeight);
+
+	GLStateCache* state = GLStateCache::GetInstance();
+	glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+	if (cullFace)
+		state->Enable(GL_CULL_FACE);
+	else
+		state->Disable(GL_CULL_FACE);
+	state->PolygonMode(wireframe ? GL_LINE : GL_FILL);
+
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	UniformBlocks::GetInstance()->SetFrame(view, projection, lights.empty() ? nullptr : &lights[0], static_cast<int>(lights.size()));
+	UniformBlocks::GetInstance()->SetClusters(&clusters);
+}
+
+void FrameSnapshot::Replay(RenderQueue& queue) const
+{
+	ApplyState();
+	queue.Begin(view, projection);
+	queue.Append(commands);
+	for (size_t i = 0; i < workerCommands.size(); ++i)
+		queue.Append(workerCommands[i]);
+	if (deferred)
+		DeferredRenderer::GetInstance()->Flush(*this, queue);
+	else
+		queue.Flush();
+}
@@ -0,0 +1,51 @@
+#ifndef FRAME_SNAPSHOT_H
+#define FRAME_SNAPSHOT_H
+
+#include <vector>
+#include <chrono>
+#include <glm\glm.hpp>
+#include "Light.h"
+#include "CommandList.h"
+#include "RenderQueue.h"
+#include "LightClusters.h"
+
+/******************************************************************************/
+/*!
+		Struct FrameSnapshot:
+\brief	Everything the GL side needs to draw one frame, copied out of the
+		scene so the scene can move on to the next frame while this one is
+		drawn. Meshes are referenced, not copied; their geometry does not
+		change after Init.
+*/
+/******************************************************************************/
+struct FrameSnapshot
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	std::vector<Light> lights;
+	// Lights past the few in the frame block, binned by the scene; left empty when there are none
+	LightClusters clusters;
+	CommandList commands;
+	// Recorded in parallel, one list per ThreadPool thread; replayed after commands
+	std::vector<CommandList> workerCommands;
+
+	// Render state the scene would otherwise set from Update
+	glm::vec4 clearColor;
+	bool cullFace;
+	bool wireframe;
+	bool deferred;		// shade the opaque draws through DeferredRenderer instead of forward
+	int viewportWidth, viewportHeight;	// 0 leaves the viewport as it is
+
+	// When the main thread started building this frame, for latency
+	std::chrono::high_resolution_clock::time_point startTime;
+
+	FrameSnapshot() : clearColor(0.f, 0.f, 0.4f, 0.f), cullFace(true), wireframe(false), deferred(false), viewportWidth(0), viewportHeight(0) {}
+
+	// Both must run on the thread owning the GL context
+	// Sets the render state, clears and uploads the frame uniforms and light clusters
+	void ApplyState(void) const;
+	// ApplyState, then issues the recorded commands through queue, deferred or forward
+	void Replay(RenderQueue& queue) const;
+};
+
+#endif
@@ -0,0 +1,309 @@
+#include "GLStateCache.h"
+#include <GL\glew.h>
+
+#include <stdio.h>
+
+GLStateCache* GLStateCache::m_instance = nullptr;
+
+GLStateCache* GLStateCache::GetInstance(void)
+{
+	if (m_instance == nullptr)
+		m_instance = new GLStateCache();
+	return m_instance;
+}
+
+void GLStateCache::DestroyInstance(void)
+{
+	if (m_instance)
+	{
+		delete m_instance;
+		m_instance = nullptr;
+	}
+}
+
+GLStateCache::GLStateCache(void)
+	: issued(0)
+	, elided(0)
+	, lastIssued(0)
+	, lastElided(0)
+{
+	Invalidate();
+}
+
+GLStateCache::~GLStateCache(void)
+{
+}
+
+void GLStateCache::Invalidate(void)
+{
+	program = UNKNOWN;
+	vertexArray = UNKNOWN;
+	for (int i = 0; i < NUM_BUFFER_SLOTS; ++i)
+		buffers[i] = UNKNOWN;
+	activeTexture = UNKNOWN;
+	for (int i = 0; i < MAX_TEXTURE_UNITS; ++i)
+		textures[i] = UNKNOWN;
+	for (int i = 0; i < NUM_CAP_SLOTS; ++i)
+		caps[i] = -1;
+	polygonMode = UNKNOWN;
+	depthMask = -1;
+	blendSrc = blendDst = UNKNOWN;
+	restartIndex = UNKNOWN;
+}
+
+int GLStateCache::BufferSlot(unsigned target)
+{
+	switch (target)
+	{
+	case GL_ARRAY_BUFFER:			return SLOT_ARRAY;
+	case GL_ELEMENT_ARRAY_BUFFER:	return SLOT_ELEMENT_ARRAY;
+	case GL_UNIFORM_BUFFER:			return SLOT_UNIFORM;
+	case GL_SHADER_STORAGE_BUFFER:	return SLOT_SHADER_STORAGE;
+	case GL_DRAW_INDIRECT_BUFFER:	return SLOT_DRAW_INDIRECT;
+	case GL_COPY_READ_BUFFER:		return SLOT_COPY_READ;
+	case GL_COPY_WRITE_BUFFER:		return SLOT_COPY_WRITE;
+	case GL_TEXTURE_BUFFER:			return SLOT_TEXTURE;
+	default:						return -1;
+	}
+}
+
+int GLStateCache::CapSlot(unsigned cap)
+{
+	switch (cap)
+	{
+	case GL_DEPTH_TEST:							return CAP_DEPTH_TEST;
+	case GL_CULL_FACE:							return CAP_CULL_FACE;
+	case GL_BLEND:								return CAP_BLEND;
+	case GL_PRIMITIVE_RESTART:					return CAP_PRIMITIVE_RESTART;
+	case GL_PRIMITIVE_RESTART_FIXED_INDEX:		return CAP_PRIMITIVE_RESTART_FIXED_INDEX;
+	default:									return -1;
+	}
+}
+
+void GLStateCache::UseProgram(unsigned program)
+{
+	if (this->program == program)
+	{
+		++elided;
+		return;
+	}
+	glUseProgram(program);
+	this->program = program;
+	++issued;
+}
+
+void GLStateCache::BindVertexArray(unsigned vertexArray)
+{
+	if (this->vertexArray == vertexArray)
+	{
+		++elided;
+		return;
+	}
+	glBindVertexArray(vertexArray);
+	this->vertexArray = vertexArray;
+	buffers[SLOT_ELEMENT_ARRAY] = UNKNOWN;
+	++issued;
+}
+
+void GLStateCache::BindBuffer(unsigned target, unsigned buffer)
+{
+	int slot = BufferSlot(target);
+	if (slot >= 0 && buffers[slot] == buffer)
+	{
+		++elided;
+		return;
+	}
+	glBindBuffer(target, buffer);
+	if (slot >= 0)
+		buffers[slot] = buffer;
+	++issued;
+}
+
+void GLStateCache::BindBufferBase(unsigned target, unsigned index, unsigned buffer)
+{
+	// Indexed bindings are not shadowed, but the call also sets the generic binding
+	glBindBufferBase(target, index, buffer);
+	int slot = BufferSlot(target);
+	if (slot >= 0)
+		buffers[slot] = buffer;
+	++issued;
+}
+
+void GLStateCache::BindBufferRange(unsigned target, unsigned index, unsigned buffer, unsigned offset, unsigned size)
+{
+	glBindBufferRange(target, index, buffer, offset, size);
+	int slot = BufferSlot(target);
+	if (slot >= 0)
+		buffers[slot] = buffer;
+	++issued;
+}
+
+void GLStateCache::ActiveTexture(unsigned unit)
+{
+	unsigned index = unit - GL_TEXTURE0;
+	if (activeTexture == index)
+	{
+		++elided;
+		return;
+	}
+	glActiveTexture(unit);
+	activeTexture = index;
+	++issued;
+}
+
+void GLStateCache::BindTexture(unsigned target, unsigned texture)
+{
+	bool tracked = target == GL_TEXTURE_2D && activeTexture < MAX_TEXTURE_UNITS;
+	if (tracked && textures[activeTexture] == texture)
+	{
+		++elided;
+		return;
+	}
+	glBindTexture(target, texture);
+	if (tracked)
+		textures[activeTexture] = texture;
+	else if (target == GL_TEXTURE_2D)
+	{
+		// Some unit changed but it is not known which one
+		for (int i = 0; i < MAX_TEXTURE_UNITS; ++i)
+			textures[i] = UNKNOWN;
+	}
+	++issued;
+}
+
+bool GLStateCache::SetCap(unsigned cap, bool enabled)
+{
+	int slot = CapSlot(cap);
+	if (slot >= 0 && caps[slot] == (enabled ? 1 : 0))
+	{
+		++elided;
+		return false;
+	}
+	if (slot >= 0)
+		caps[slot] = enabled ? 1 : 0;
+	++issued;
+	return true;
+}
+
+void GLStateCache::Enable(unsigned cap)
+{
+	if (SetCap(cap, true))
+		glEnable(cap);
+}
+
+void GLStateCache::Disable(unsigned cap)
+{
+	if (SetCap(cap, false))
+		glDisable(cap);
+}
+
+void GLStateCache::PolygonMode(unsigned mode)
+{
+	if (polygonMode == mode)
+	{
+		++elided;
+		return;
+	}
+	glPolygonMode(GL_FRONT_AND_BACK, mode);
+	polygonMode = mode;
+	++issued;
+}
+
+void GLStateCache::DepthMask(bool flag)
+{
+	if (depthMask == (flag ? 1 : 0))
+	{
+		++elided;
+		return;
+	}
+	glDepthMask(flag ? GL_TRUE : GL_FALSE);
+	depthMask = flag ? 1 : 0;
+	++issued;
+}
+
+void GLStateCache::BlendFunc(unsigned sfactor, unsigned dfactor)
+{
+	if (blendSrc == sfactor && blendDst == dfactor)
+	{
+		++elided;
+		return;
+	}
+	glBlendFunc(sfactor, dfactor);
+	blendSrc = sfactor;
+	blendDst = dfactor;
+	++issued;
+}
+
+void GLStateCache::PrimitiveRestartIndex(unsigned index)
+{
+	if (restartIndex == index)
+	{
+		++elided;
+		return;
+	}
+	glPrimitiveRestartIndex(index);
+	restartIndex = index;
+	++issued;
+}
+
+void GLStateCache::DeleteProgram(unsigned program)
+{
+	// A deleted program stays in use until another one is bound, but its name may be reused
+	glDeleteProgram(program);
+	if (this->program == program)
+		this->program = UNKNOWN;
+}
+
+void GLStateCache::DeleteVertexArray(unsigned vertexArray)
+{
+	glDeleteVertexArrays(1, &vertexArray);
+	if (this->vertexArray == vertexArray)
+	{
+		this->vertexArray = 0;
+		buffers[SLOT_ELEMENT_ARRAY] = UNKNOWN;
+	}
+}
+
+void GLStateCache::DeleteBuffer(unsigned buffer)
+{
+	glDeleteBuffers(1, &buffer);
+	for (int i = 0; i < NUM_BUFFER_SLOTS; ++i)
+	{
+		if (buffers[i] == buffer)
+			buffers[i] = 0;
+	}
+}
+
+void GLStateCache::DeleteTexture(unsigned texture)
+{
+	glDeleteTextures(1, &texture);
+	for (int i = 0; i < MAX_TEXTURE_UNITS; ++i)
+	{
+		if (textures[i] == texture)
+			textures[i] = 0;
+	}
+}
+
+void GLStateCache::EndFrame(void)
+{
+	lastIssued = issued;
+	lastElided = elided;
+	issued = elided = 0;
+}
+
+unsigned GLStateCache::GetNumIssued(void) const
+{
+	return lastIssued;
+}
+
+unsigned GLStateCache::GetNumElided(void) const
+{
+	return lastElided;
+}
+
+void GLStateCache::PrintStats(void) const
+{
+	unsigned total = lastIssued + lastElided;
+	printf("GL state calls last frame: %u issued, %u elided (%.1f%% redundant)\n",
+		lastIssued, lastElided, total ? 100.0 * lastElided / total : 0.0);
+}
@@ -0,0 +1,99 @@
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+/******************************************************************************/
+/*!
+		Class GLStateCache:
+\brief	Shadows the GL bindings and enable bits the renderer touches and drops
+		calls that would not change them. Every bind of a tracked object has
+		to go through here, otherwise the shadow copy goes stale; call
+		Invalidate after GL code that bypasses it.
+*/
+/******************************************************************************/
+class GLStateCache
+{
+public:
+	static GLStateCache* GetInstance(void);
+	static void DestroyInstance(void);
+
+	// Forget everything, so the next call of each kind is issued
+	void Invalidate(void);
+
+	void UseProgram(unsigned program);
+	void BindVertexArray(unsigned vertexArray);
+	void BindBuffer(unsigned target, unsigned buffer);
+	void BindBufferBase(unsigned target, unsigned index, unsigned buffer);
+	void BindBufferRange(unsigned target, unsigned index, unsigned buffer, unsigned offset, unsigned size);
+	void ActiveTexture(unsigned unit);
+	void BindTexture(unsigned target, unsigned texture);
+	void Enable(unsigned cap);
+	void Disable(unsigned cap);
+	void PolygonMode(unsigned mode);	// GL_FRONT_AND_BACK
+	void DepthMask(bool flag);
+	void BlendFunc(unsigned sfactor, unsigned dfactor);
+	void PrimitiveRestartIndex(unsigned index);
+
+	// Deleting an object unbinds it, so the shadow copy must forget it too
+	void DeleteProgram(unsigned program);
+	void DeleteVertexArray(unsigned vertexArray);
+	void DeleteBuffer(unsigned buffer);
+	void DeleteTexture(unsigned texture);
+
+	// Latch this frame's counts and start counting the next frame
+	void EndFrame(void);
+	unsigned GetNumIssued(void) const;	// calls that reached GL last frame
+	unsigned GetNumElided(void) const;	// calls dropped as redundant last frame
+	void PrintStats(void) const;
+
+private:
+	GLStateCache(void);
+	~GLStateCache(void);
+
+	static GLStateCache* m_instance;
+
+	static const unsigned UNKNOWN = 0xFFFFFFFF;
+	static const int MAX_TEXTURE_UNITS = 16;
+
+	enum BUFFER_SLOT
+	{
+		SLOT_ARRAY = 0,
+		SLOT_ELEMENT_ARRAY,		// part of the VAO, so reset whenever the VAO changes
+		SLOT_UNIFORM,
+		SLOT_SHADER_STORAGE,
+		SLOT_DRAW_INDIRECT,
+		SLOT_COPY_READ,
+		SLOT_COPY_WRITE,
+		SLOT_TEXTURE,
+		NUM_BUFFER_SLOTS,
+	};
+
+	enum CAP_SLOT
+	{
+		CAP_DEPTH_TEST = 0,
+		CAP_CULL_FACE,
+		CAP_BLEND,
+		CAP_PRIMITIVE_RESTART,
+		CAP_PRIMITIVE_RESTART_FIXED_INDEX,
+		NUM_CAP_SLOTS,
+	};
+
+	static int BufferSlot(unsigned target);
+	static int CapSlot(unsigned cap);
+	bool SetCap(unsigned cap, bool enabled);
+
+	unsigned program;
+	unsigned vertexArray;
+	unsigned buffers[NUM_BUFFER_SLOTS];
+	unsigned activeTexture;		// unit index, not GL_TEXTURE0 + unit
+	unsigned textures[MAX_TEXTURE_UNITS];	// GL_TEXTURE_2D binding of each unit
+	int caps[NUM_CAP_SLOTS];	// -1 unknown, 0 disabled, 1 enabled
+	unsigned polygonMode;
+	int depthMask;
+	unsigned blendSrc, blendDst;
+	unsigned restartIndex;
+
+	unsigned issued, elided;
+	unsigned lastIssued, lastElided;
+};
+
+#endif
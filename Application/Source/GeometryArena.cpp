@@ -0,0 +1,388 @@
+#include "GeometryArena.h"
+#include <GL\glew.h>
+#include "GLStateCache.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+GeometryArena* GeometryArena::m_instance = nullptr;
+
+namespace
+{
+	bool ByBaseVertex(const GeometryArena::Allocation* a, const GeometryArena::Allocation* b)
+	{
+		return a->baseVertex < b->baseVertex;
+	}
+
+	bool ByFirstIndex(const GeometryArena::Allocation* a, const GeometryArena::Allocation* b)
+	{
+		return a->firstIndex < b->firstIndex;
+	}
+}
+
+GeometryArena* GeometryArena::GetInstance(void)
+{
+	if (m_instance == nullptr)
+		m_instance = new GeometryArena();
+	return m_instance;
+}
+
+void GeometryArena::DestroyInstance(void)
+{
+	if (m_instance)
+	{
+		delete m_instance;
+		m_instance = nullptr;
+	}
+}
+
+GeometryArena::GeometryArena(void)
+{
+}
+
+GeometryArena::~GeometryArena(void)
+{
+	for (size_t i = 0; i < pages.size(); ++i)
+	{
+		DeletePage(pages[i]);
+	}
+}
+
+/******************************************************************************/
+/*!
+\brief
+Create one page: a VBO and IBO of fixed capacity and a VAO with the Vertex
+layout recorded once
+
+\param vertexCapacity - number of vertices the page can hold
+\param indexCapacity - number of indices the page can hold
+*/
+/******************************************************************************/
+void GeometryArena::CreatePage(unsigned vertexCapacity, unsigned indexCapacity)
+{
+	GLStateCache* state = GLStateCache::GetInstance();
+	Page page;
+	page.vertexCapacity = vertexCapacity;
+	page.indexCapacity = indexCapacity;
+
+	glGenVertexArrays(1, &page.vertexArray);
+	glGenBuffers(1, &page.vertexBuffer);
+	glGenBuffers(1, &page.indexBuffer);
+
+	state->BindVertexArray(page.vertexArray);
+	state->BindBuffer(GL_ARRAY_BUFFER, page.vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertexCapacity * sizeof(Vertex), NULL, GL_STATIC_DRAW);
+	state->BindBuffer(GL_ELEMENT_ARRAY_BUFFER, page.indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * sizeof(GLuint), NULL, GL_STATIC_DRAW);
+
+	glEnableVertexAttribArray(0); // 1st attribute buffer : positions
+	glEnableVertexAttribArray(1); // 2nd attribute buffer : colors
+	glEnableVertexAttribArray(2); // 3rd attribute : normals
+	glEnableVertexAttribArray(3); // 4th attribute : texture coordinate
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)sizeof(glm::vec3));
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+		(void*)(sizeof(glm::vec3) + sizeof(glm::vec3)));
+	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+		(void*)(sizeof(glm::vec3) + sizeof(glm::vec3) + sizeof(glm::vec3)));
+
+	Range all;
+	all.offset = 0;
+	all.count = vertexCapacity;
+	page.freeVertices.push_back(all);
+	all.count = indexCapacity;
+	page.freeIndices.push_back(all);
+
+	pages.push_back(page);
+}
+
+void GeometryArena::DeletePage(Page& page)
+{
+	GLStateCache* state = GLStateCache::GetInstance();
+	for (size_t i = 0; i < page.allocations.size(); ++i)
+	{
+		page.allocations[i]->page = NO_PAGE;
+	}
+	page.allocations.clear();
+
+	state->DeleteVertexArray(page.vertexArray);
+	state->DeleteBuffer(page.vertexBuffer);
+	state->DeleteBuffer(page.indexBuffer);
+}
+
+/******************************************************************************/
+/*!
+\brief
+Copy a mesh into the first page with room for it, compacting a page whose
+free space is only fragmented, or opening a new page
+
+\param vertices - vertex data
+\param indices - indices relative to the first vertex of this mesh
+\param allocation - receives page and offsets; must outlive the allocation
+
+\return true if the data was placed
+*/
+/******************************************************************************/
+bool GeometryArena::Allocate(const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices, Allocation* allocation)
+{
+	return Allocate(vertices.empty() ? NULL : &vertices[0], static_cast<unsigned>(vertices.size()),
+		indices.empty() ? NULL : &indices[0], static_cast<unsigned>(indices.size()), allocation);
+}
+
+bool GeometryArena::Allocate(const Vertex* vertices, unsigned vertexCount, const unsigned* indices, unsigned indexCount, Allocation* allocation)
+{
+	if (vertexCount == 0 || indexCount == 0)
+		return false;
+
+	bool placed = false;
+	for (unsigned i = 0; i < pages.size() && !placed; ++i)
+	{
+		placed = AllocateInPage(i, vertexCount, indexCount, allocation);
+	}
+
+	for (unsigned i = 0; i < pages.size() && !placed; ++i)
+	{
+		if (TotalFree(pages[i].freeVertices) >= vertexCount && TotalFree(pages[i].freeIndices) >= indexCount)
+		{
+			CompactPage(i);
+			placed = AllocateInPage(i, vertexCount, indexCount, allocation);
+		}
+	}
+
+	if (!placed)
+	{
+		CreatePage(std::max(vertexCount, PAGE_VERTICES), std::max(indexCount, PAGE_INDICES));
+		placed = AllocateInPage(static_cast<unsigned>(pages.size()) - 1, vertexCount, indexCount, allocation);
+	}
+
+	if (!placed)
+		return false;
+
+	Page& page = pages[allocation->page];
+	GLStateCache::GetInstance()->BindVertexArray(page.vertexArray);
+	GLStateCache::GetInstance()->BindBuffer(GL_ARRAY_BUFFER, page.vertexBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, allocation->baseVertex * sizeof(Vertex), vertexCount * sizeof(Vertex), vertices);
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, allocation->firstIndex * sizeof(GLuint), indexCount * sizeof(GLuint), indices);
+	return true;
+}
+
+bool GeometryArena::AllocateInPage(unsigned page, unsigned vertexCount, unsigned indexCount, Allocation* allocation)
+{
+	Page& p = pages[page];
+	unsigned baseVertex, firstIndex;
+	if (!TakeRange(p.freeVertices, vertexCount, baseVertex))
+		return false;
+	if (!TakeRange(p.freeIndices, indexCount, firstIndex))
+	{
+		ReturnRange(p.freeVertices, baseVertex, vertexCount);
+		return false;
+	}
+
+	allocation->page = page;
+	allocation->baseVertex = baseVertex;
+	allocation->vertexCount = vertexCount;
+	allocation->firstIndex = firstIndex;
+	allocation->indexCount = indexCount;
+	p.allocations.push_back(allocation);
+	return true;
+}
+
+void GeometryArena::Free(Allocation* allocation)
+{
+	if (allocation->page >= pages.size())
+		return;
+
+	Page& page = pages[allocation->page];
+	std::vector<Allocation*>::iterator it = std::find(page.allocations.begin(), page.allocations.end(), allocation);
+	if (it == page.allocations.end())
+		return;
+	*it = page.allocations.back();
+	page.allocations.pop_back();
+
+	ReturnRange(page.freeVertices, allocation->baseVertex, allocation->vertexCount);
+	ReturnRange(page.freeIndices, allocation->firstIndex, allocation->indexCount);
+	allocation->page = NO_PAGE;
+}
+
+void GeometryArena::Compact(void)
+{
+	for (unsigned i = 0; i < pages.size(); ++i)
+	{
+		// Already compact if each buffer has at most one free range and it runs to the end
+		const Page& p = pages[i];
+		bool vertexCompact = p.freeVertices.empty() ||
+			(p.freeVertices.size() == 1 && p.freeVertices[0].offset + p.freeVertices[0].count == p.vertexCapacity);
+		bool indexCompact = p.freeIndices.empty() ||
+			(p.freeIndices.size() == 1 && p.freeIndices[0].offset + p.freeIndices[0].count == p.indexCapacity);
+		if (!vertexCompact || !indexCompact)
+			CompactPage(i);
+	}
+}
+
+/******************************************************************************/
+/*!
+\brief
+Pack the live ranges of a page to its start. Ranges are gathered into a
+scratch buffer first because glCopyBufferSubData may not overlap within one
+buffer. Indices are relative to baseVertex so they need no rewriting.
+
+\param page - index of the page
+*/
+/******************************************************************************/
+void GeometryArena::CompactPage(unsigned page)
+{
+	GLStateCache* state = GLStateCache::GetInstance();
+	Page& p = pages[page];
+	std::vector<Allocation*> live = p.allocations;
+
+	unsigned usedVertices = p.vertexCapacity - TotalFree(p.freeVertices);
+	unsigned usedIndices = p.indexCapacity - TotalFree(p.freeIndices);
+
+	GLuint scratch;
+	glGenBuffers(1, &scratch);
+	state->BindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+	glBufferData(GL_COPY_WRITE_BUFFER, std::max(usedVertices * sizeof(Vertex), usedIndices * sizeof(GLuint)), NULL, GL_STREAM_COPY);
+
+	// Vertices
+	std::sort(live.begin(), live.end(), ByBaseVertex);
+	state->BindBuffer(GL_COPY_READ_BUFFER, p.vertexBuffer);
+	unsigned offset = 0;
+	for (size_t i = 0; i < live.size(); ++i)
+	{
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+			live[i]->baseVertex * sizeof(Vertex), offset * sizeof(Vertex), live[i]->vertexCount * sizeof(Vertex));
+		live[i]->baseVertex = offset;
+		offset += live[i]->vertexCount;
+	}
+	if (offset > 0)
+	{
+		state->BindBuffer(GL_COPY_READ_BUFFER, scratch);
+		state->BindBuffer(GL_COPY_WRITE_BUFFER, p.vertexBuffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, offset * sizeof(Vertex));
+	}
+	p.freeVertices.clear();
+	if (offset < p.vertexCapacity)
+	{
+		Range rest = { offset, p.vertexCapacity - offset };
+		p.freeVertices.push_back(rest);
+	}
+
+	// Indices
+	std::sort(live.begin(), live.end(), ByFirstIndex);
+	state->BindBuffer(GL_COPY_READ_BUFFER, p.indexBuffer);
+	state->BindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+	offset = 0;
+	for (size_t i = 0; i < live.size(); ++i)
+	{
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+			live[i]->firstIndex * sizeof(GLuint), offset * sizeof(GLuint), live[i]->indexCount * sizeof(GLuint));
+		live[i]->firstIndex = offset;
+		offset += live[i]->indexCount;
+	}
+	if (offset > 0)
+	{
+		state->BindBuffer(GL_COPY_READ_BUFFER, scratch);
+		state->BindBuffer(GL_COPY_WRITE_BUFFER, p.indexBuffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, offset * sizeof(GLuint));
+	}
+	p.freeIndices.clear();
+	if (offset < p.indexCapacity)
+	{
+		Range rest = { offset, p.indexCapacity - offset };
+		p.freeIndices.push_back(rest);
+	}
+
+	state->DeleteBuffer(scratch);
+}
+
+unsigned GeometryArena::GetNumPages(void) const
+{
+	return static_cast<unsigned>(pages.size());
+}
+
+unsigned GeometryArena::GetVertexArray(unsigned page) const
+{
+	return pages[page].vertexArray;
+}
+
+unsigned GeometryArena::GetVertexBuffer(unsigned page) const
+{
+	return pages[page].vertexBuffer;
+}
+
+unsigned GeometryArena::GetIndexBuffer(unsigned page) const
+{
+	return pages[page].indexBuffer;
+}
+
+void GeometryArena::PrintStats(void) const
+{
+	printf("%-6s %8s %12s %12s %8s %12s %12s %8s\n", "page", "meshes",
+		"vertices", "largest free", "ranges", "indices", "largest free", "ranges");
+	for (size_t i = 0; i < pages.size(); ++i)
+	{
+		const Page& p = pages[i];
+		printf("%-6u %8u %5u/%-6u %12u %8u %5u/%-6u %12u %8u\n", static_cast<unsigned>(i),
+			static_cast<unsigned>(p.allocations.size()),
+			p.vertexCapacity - TotalFree(p.freeVertices), p.vertexCapacity,
+			LargestRange(p.freeVertices), static_cast<unsigned>(p.freeVertices.size()),
+			p.indexCapacity - TotalFree(p.freeIndices), p.indexCapacity,
+			LargestRange(p.freeIndices), static_cast<unsigned>(p.freeIndices.size()));
+	}
+}
+
+// First fit
+bool GeometryArena::TakeRange(std::vector<Range>& freeList, unsigned count, unsigned& offset)
+{
+	for (size_t i = 0; i < freeList.size(); ++i)
+	{
+		if (freeList[i].count < count)
+			continue;
+
+		offset = freeList[i].offset;
+		freeList[i].offset += count;
+		freeList[i].count -= count;
+		if (freeList[i].count == 0)
+			freeList.erase(freeList.begin() + i);
+		return true;
+	}
+	return false;
+}
+
+void GeometryArena::ReturnRange(std::vector<Range>& freeList, unsigned offset, unsigned count)
+{
+	size_t i = 0;
+	while (i < freeList.size() && freeList[i].offset < offset)
+		++i;
+
+	Range range = { offset, count };
+	freeList.insert(freeList.begin() + i, range);
+
+	// Merge with the following range, then with the preceding one
+	if (i + 1 < freeList.size() && freeList[i].offset + freeList[i].count == freeList[i + 1].offset)
+	{
+		freeList[i].count += freeList[i + 1].count;
+		freeList.erase(freeList.begin() + i + 1);
+	}
+	if (i > 0 && freeList[i - 1].offset + freeList[i - 1].count == freeList[i].offset)
+	{
+		freeList[i - 1].count += freeList[i].count;
+		freeList.erase(freeList.begin() + i);
+	}
+}
+
+unsigned GeometryArena::LargestRange(const std::vector<Range>& freeList)
+{
+	unsigned largest = 0;
+	for (size_t i = 0; i < freeList.size(); ++i)
+		largest = std::max(largest, freeList[i].count);
+	return largest;
+}
+
+unsigned GeometryArena::TotalFree(const std::vector<Range>& freeList)
+{
+	unsigned total = 0;
+	for (size_t i = 0; i < freeList.size(); ++i)
+		total += freeList[i].count;
+	return total;
+}
@@ -0,0 +1,95 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <vector>
+#include "Vertex.h"
+
+/******************************************************************************/
+/*!
+		Class GeometryArena:
+\brief	Sub-allocates the vertex and index ranges of every mesh out of a few
+		large pages, each one VBO + IBO + VAO, so meshes on the same page draw
+		without rebinding buffers (glDrawElementsBaseVertex with offsets)
+*/
+/******************************************************************************/
+class GeometryArena
+{
+public:
+	static const unsigned NO_PAGE = 0xFFFFFFFF;
+
+	// Default page size; a bigger mesh gets a page of its own size
+	static const unsigned PAGE_VERTICES = 1 << 18;
+	static const unsigned PAGE_INDICES = 1 << 20;
+
+	struct Allocation
+	{
+		unsigned page;
+		unsigned baseVertex;	// First vertex in the page's vertex buffer
+		unsigned vertexCount;
+		unsigned firstIndex;	// First index in the page's index buffer
+		unsigned indexCount;
+
+		Allocation() : page(NO_PAGE), baseVertex(0), vertexCount(0), firstIndex(0), indexCount(0) {}
+	};
+
+	static GeometryArena* GetInstance(void);
+	static void DestroyInstance(void);
+
+	// Copy the data into a page; the arena keeps the pointer to patch offsets on compaction
+	bool Allocate(const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices, Allocation* allocation);
+	// Same, from memory the caller does not own as vectors, e.g. a mapped file
+	bool Allocate(const Vertex* vertices, unsigned vertexCount, const unsigned* indices, unsigned indexCount, Allocation* allocation);
+	void Free(Allocation* allocation);
+
+	// Move the live ranges of every page to the front so free space is contiguous again
+	void Compact(void);
+
+	unsigned GetNumPages(void) const;
+	unsigned GetVertexArray(unsigned page) const;
+	unsigned GetVertexBuffer(unsigned page) const;
+	unsigned GetIndexBuffer(unsigned page) const;
+
+	void PrintStats(void) const;
+
+private:
+	GeometryArena(void);
+	~GeometryArena(void);
+
+	static GeometryArena* m_instance;
+
+	// Free range of a page in vertices or indices
+	struct Range
+	{
+		unsigned offset;
+		unsigned count;
+	};
+
+	struct Page
+	{
+		unsigned vertexArray;
+		unsigned vertexBuffer;
+		unsigned indexBuffer;
+		unsigned vertexCapacity;
+		unsigned indexCapacity;
+
+		// Sorted by offset with neighbours merged
+		std::vector<Range> freeVertices;
+		std::vector<Range> freeIndices;
+
+		std::vector<Allocation*> allocations;
+	};
+
+	std::vector<Page> pages;
+
+	void CreatePage(unsigned vertexCapacity, unsigned indexCapacity);
+	void DeletePage(Page& page);
+	void CompactPage(unsigned page);
+	bool AllocateInPage(unsigned page, unsigned vertexCount, unsigned indexCount, Allocation* allocation);
+
+	static bool TakeRange(std::vector<Range>& freeList, unsigned count, unsigned& offset);
+	static void ReturnRange(std::vector<Range>& freeList, unsigned offset, unsigned count);
+	static unsigned LargestRange(const std::vector<Range>& freeList);
+	static unsigned TotalFree(const std::vector<Range>& freeList);
+};
+
+#endif
@@ -0,0 +1,244 @@
+#include "IndirectRenderer.h"
+#include <GL\glew.h>
+#include "GLStateCache.h"
+#include "UniformBlocks.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "shader.hpp"
+#include "GeometryArena.h"
+
+// Attribute location of the draw ID in Shader//Indirect.vertexshader
+static const GLuint DRAW_ID_ATTRIBUTE = 4;
+
+IndirectRenderer::IndirectRenderer()
+	: m_programID(0)
+	, drawIDBuffer(0)
+	, commandBuffer(0)
+	, drawDataBuffer(0)
+	, materialBuffer(0)
+	, capacity(0)
+	, numDraws(0)
+	, numMultiDraws(0)
+{
+}
+
+IndirectRenderer::~IndirectRenderer()
+{
+}
+
+bool IndirectRenderer::IsSupported(void)
+{
+	bool multiDraw = GLEW_VERSION_4_3 ||
+		(GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance && GLEW_ARB_shader_storage_buffer_object);
+	if (!multiDraw)
+		return false;
+
+	// GL 4.3 only guarantees storage blocks in fragment and compute shaders
+	GLint vertexBlocks = 0;
+	glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &vertexBlocks);
+	return vertexBlocks >= 1;
+}
+
+bool IndirectRenderer::Init(void)
+{
+	if (!IsSupported())
+	{
+		printf("Multi-draw indirect path needs GL 4.3 (or ARB_multi_draw_indirect with shader storage buffers)\n");
+		return false;
+	}
+
+	m_programID = LoadShaders("Shader//Indirect.vertexshader", "Shader//Indirect.fragmentshader");
+	if (m_programID == 0)
+		return false;
+
+	GLStateCache::GetInstance()->UseProgram(m_programID);
+	glUniform1i(glGetUniformLocation(m_programID, "colorTexture"), 0);
+	UniformBlocks::GetInstance()->BindProgram(m_programID);
+
+	glGenBuffers(1, &drawIDBuffer);
+	glGenBuffers(1, &commandBuffer);
+	glGenBuffers(1, &drawDataBuffer);
+	glGenBuffers(1, &materialBuffer);
+	Reserve(1024);
+	return true;
+}
+
+void IndirectRenderer::Exit(void)
+{
+	GLStateCache* state = GLStateCache::GetInstance();
+	if (m_programID == 0)
+		return;
+
+	// Detach the draw ID stream so no page VAO is left pointing at a deleted buffer
+	GeometryArena* arena = GeometryArena::GetInstance();
+	for (unsigned page = 0; page < arena->GetNumPages(); ++page)
+	{
+		state->BindVertexArray(arena->GetVertexArray(page));
+		glDisableVertexAttribArray(DRAW_ID_ATTRIBUTE);
+	}
+	state->BindVertexArray(0);
+
+	state->DeleteBuffer(drawIDBuffer);
+	state->DeleteBuffer(commandBuffer);
+	state->DeleteBuffer(drawDataBuffer);
+	state->DeleteBuffer(materialBuffer);
+	state->DeleteProgram(m_programID);
+	m_programID = 0;
+	capacity = 0;
+}
+
+void IndirectRenderer::Reserve(unsigned count)
+{
+	if (count <= capacity)
+		return;
+
+	while (capacity < count)
+		capacity = capacity ? capacity * 2 : 1024;
+
+	std::vector<unsigned> ids(capacity);
+	for (unsigned i = 0; i < capacity; ++i)
+		ids[i] = i;
+	GLStateCache::GetInstance()->BindBuffer(GL_ARRAY_BUFFER, drawIDBuffer);
+	glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(unsigned), &ids[0], GL_STATIC_DRAW);
+}
+
+void IndirectRenderer::Begin(const glm::mat4& view, const glm::mat4& projection)
+{
+	this->view = view;
+	this->projection = projection;
+	draws.clear();
+	drawData.clear();
+	materials.clear();
+}
+
+void IndirectRenderer::Submit(Mesh* mesh, const glm::mat4& model, bool enableLight)
+{
+	if (mesh->indexSize == 0)
+		return;
+
+	// Scenes usually submit runs of the same material, so only compare with the last one
+	MaterialData material;
+	material.kAmbient = mesh->material.kAmbient;
+	material.kDiffuse = mesh->material.kDiffuse;
+	material.kSpecular = mesh->material.kSpecular;
+	material.kShininess = mesh->material.kShininess;
+	material.padding0 = material.padding1 = 0.f;
+	if (materials.empty() || memcmp(&materials.back(), &material, sizeof(MaterialData)) != 0)
+		materials.push_back(material);
+
+	// MVP and normal matrix are filled in for all draws at once in End
+	DrawData data;
+	data.MV = view * model;
+	data.materialIndex = static_cast<unsigned>(materials.size() - 1);
+	data.lightEnabled = enableLight ? 1 : 0;
+	data.colorTextureEnabled = mesh->textureID > 0 ? 1 : 0;
+	data.padding = 0;
+
+	Draw draw;
+	draw.page = mesh->allocation.page;
+	draw.mode = mesh->mode;
+	draw.textureID = mesh->textureID;
+	draw.key = (static_cast<unsigned long long>(draw.page) << 40) |
+		(static_cast<unsigned long long>(draw.mode) << 32) | draw.textureID;
+	draw.data = static_cast<unsigned>(drawData.size());
+	draw.firstIndex = mesh->allocation.firstIndex;
+	draw.indexCount = mesh->indexSize;
+	draw.baseVertex = mesh->allocation.baseVertex;
+
+	draws.push_back(draw);
+	drawData.push_back(data);
+}
+
+void IndirectRenderer::End(void)
+{
+	GLStateCache* state = GLStateCache::GetInstance();
+	numDraws = static_cast<unsigned>(draws.size());
+	numMultiDraws = 0;
+	if (draws.empty())
+		return;
+
+	// Stable so draws inside a bucket keep the order the scene submitted them in
+	std::stable_sort(draws.begin(), draws.end());
+
+	// Draw i reads sortedDrawData[i]; baseInstance carries i into the shader via the draw ID attribute
+	sortedDrawData.resize(numDraws);
+	commands.resize(numDraws);
+	for (unsigned i = 0; i < numDraws; ++i)
+	{
+		const Draw& draw = draws[i];
+		sortedDrawData[i] = drawData[draw.data];
+		DrawCommand& command = commands[i];
+		command.count = draw.indexCount;
+		command.instanceCount = 1;
+		command.firstIndex = draw.firstIndex;
+		command.baseVertex = static_cast<int>(draw.baseVertex);
+		command.baseInstance = i;
+	}
+
+	transforms.Begin(projection);
+	for (unsigned i = 0; i < numDraws; ++i)
+		transforms.Add(sortedDrawData[i].MV);
+	transforms.Compute();
+	for (unsigned i = 0; i < numDraws; ++i)
+	{
+		DrawData& data = sortedDrawData[i];
+		data.MVP = transforms.GetMVP(i);
+		data.MV_inverse_transpose = data.lightEnabled ? transforms.GetNormalMatrix(i) : glm::mat4(1.f);
+	}
+
+	Reserve(numDraws);
+
+	// Orphan and refill every frame; the driver renames the storage so there is no stall
+	state->BindBuffer(GL_SHADER_STORAGE_BUFFER, drawDataBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, numDraws * sizeof(DrawData), &sortedDrawData[0], GL_STREAM_DRAW);
+	state->BindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, drawDataBuffer);
+	state->BindBuffer(GL_SHADER_STORAGE_BUFFER, materialBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, materials.size() * sizeof(MaterialData), &materials[0], GL_STREAM_DRAW);
+	state->BindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, materialBuffer);
+	state->BindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, numDraws * sizeof(DrawCommand), &commands[0], GL_STREAM_DRAW);
+
+	state->UseProgram(m_programID);
+	state->ActiveTexture(GL_TEXTURE0);
+
+	GeometryArena* arena = GeometryArena::GetInstance();
+	unsigned begin = 0;
+	while (begin < numDraws)
+	{
+		unsigned end = begin + 1;
+		while (end < numDraws && draws[end].key == draws[begin].key)
+			++end;
+		const Draw& bucket = draws[begin];
+
+		// The page VAO gets the instanced draw ID stream at a location the other shaders do not read
+		state->BindVertexArray(arena->GetVertexArray(bucket.page));
+		state->BindBuffer(GL_ARRAY_BUFFER, drawIDBuffer);
+		glEnableVertexAttribArray(DRAW_ID_ATTRIBUTE);
+		glVertexAttribIPointer(DRAW_ID_ATTRIBUTE, 1, GL_UNSIGNED_INT, sizeof(unsigned), 0);
+		glVertexAttribDivisor(DRAW_ID_ATTRIBUTE, 1);
+
+		state->BindTexture(GL_TEXTURE_2D, bucket.textureID);
+
+		// Restart state is shared with direct draws, which leave it enabled
+		glMultiDrawElementsIndirect(Mesh::BeginDraw(bucket.mode), GL_UNSIGNED_INT, (void*)(begin * sizeof(DrawCommand)), end - begin, 0);
+
+		++numMultiDraws;
+		begin = end;
+	}
+
+	state->BindTexture(GL_TEXTURE_2D, 0);
+	state->BindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+unsigned IndirectRenderer::GetNumDraws(void) const
+{
+	return numDraws;
+}
+
+unsigned IndirectRenderer::GetNumMultiDraws(void) const
+{
+	return numMultiDraws;
+}
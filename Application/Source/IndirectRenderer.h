@@ -0,0 +1,105 @@
+#ifndef INDIRECT_RENDERER_H
+#define INDIRECT_RENDERER_H
+
+#include <vector>
+#include <glm\glm.hpp>
+#include "Mesh.h"
+#include "BatchTransform.h"
+
+/******************************************************************************/
+/*!
+		Class IndirectRenderer:
+\brief	GL 4.3 submission path. Draws are collected for a frame, sorted into
+		buckets of arena page / draw mode / texture, and each bucket is issued
+		with one glMultiDrawElementsIndirect. Matrices and materials live in
+		shader storage buffers indexed by a per-draw ID; lights come from the
+		FrameData block of UniformBlocks like every other lit program.
+*/
+/******************************************************************************/
+class IndirectRenderer
+{
+public:
+	IndirectRenderer();
+	~IndirectRenderer();
+
+	// Whether the current context has multi-draw indirect and vertex shader storage buffers
+	static bool IsSupported(void);
+
+	bool Init(void);
+	void Exit(void);
+
+	void Begin(const glm::mat4& view, const glm::mat4& projection);
+	void Submit(Mesh* mesh, const glm::mat4& model, bool enableLight);
+	void End(void);
+
+	unsigned GetNumDraws(void) const;
+	unsigned GetNumMultiDraws(void) const;
+
+private:
+	// std430 layouts, mirrored in Shader//Indirect.vertexshader
+	struct DrawData
+	{
+		glm::mat4 MVP;
+		glm::mat4 MV;
+		glm::mat4 MV_inverse_transpose;
+		unsigned materialIndex;
+		unsigned lightEnabled;
+		unsigned colorTextureEnabled;
+		unsigned padding;
+	};
+
+	struct MaterialData
+	{
+		glm::vec3 kAmbient;
+		float padding0;
+		glm::vec3 kDiffuse;
+		float padding1;
+		glm::vec3 kSpecular;
+		float kShininess;
+	};
+
+	// Layout fixed by GL for GL_DRAW_INDIRECT_BUFFER
+	struct DrawCommand
+	{
+		unsigned count;
+		unsigned instanceCount;
+		unsigned firstIndex;
+		int baseVertex;
+		unsigned baseInstance;
+	};
+
+	struct Draw
+	{
+		unsigned long long key;		// page, draw mode, texture; draws with equal keys share a multi-draw
+		unsigned data;				// index into drawData
+		unsigned page;
+		Mesh::DRAW_MODE mode;
+		unsigned textureID;
+		unsigned firstIndex;
+		unsigned indexCount;
+		unsigned baseVertex;
+
+		bool operator<(const Draw& that) const { return key < that.key; }
+	};
+
+	void Reserve(unsigned numDraws);
+
+	unsigned m_programID;
+
+	unsigned drawIDBuffer;		// 0, 1, 2, ... read as an instanced attribute offset by baseInstance
+	unsigned commandBuffer;
+	unsigned drawDataBuffer;
+	unsigned materialBuffer;
+	unsigned capacity;
+
+	glm::mat4 view, projection;
+	std::vector<Draw> draws;
+	std::vector<DrawData> drawData, sortedDrawData;
+	std::vector<MaterialData> materials;
+	std::vector<DrawCommand> commands;
+	BatchTransform transforms;
+
+	unsigned numDraws, numMultiDraws;
+};
+
+#endif
@@ -13,6 +13,8 @@ struct Light
 		LIGHT_POINT = 0,
 		LIGHT_DIRECTIONAL,
 		LIGHT_SPOT,
+
+		NUM_LIGHT_TYPES,
 	};
 	LIGHT_TYPE type;
 
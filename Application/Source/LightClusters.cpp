@@ -0,0 +1,306 @@
+#include "LightClusters.h"
+#include "ThreadPool.h"
+
+#include <math.h>
+#include <float.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+
+namespace
+{
+	// A light is cut off once it is this dim, so it can stay out of the clusters beyond
+	const float LIGHT_CUTOFF = 1.f / 256.f;
+
+	// Lights per task when converting and bounding them
+	const unsigned LIGHT_CHUNK = 256;
+
+	float SquaredDistanceToBox(const glm::vec3& p, const glm::vec3& boxMin, const glm::vec3& boxMax)
+	{
+		glm::vec3 d = glm::max(boxMin - p, glm::vec3(0.f)) + glm::max(p - boxMax, glm::vec3(0.f));
+		return glm::dot(d, d);
+	}
+}
+
+LightClusters::LightClusters(void)
+	: grid(1, 1, 1)
+	, depthScaleBias(0.f)
+	, boxProjection(0.f)
+	, maxPerCluster(0)
+	, buildTime(0.0)
+{
+}
+
+LightClusters::~LightClusters(void)
+{
+}
+
+float LightClusters::GetRange(const Light& light)
+{
+	float brightness = light.power * std::max(light.color.r, std::max(light.color.g, light.color.b));
+	float target = brightness / LIGHT_CUTOFF;
+	if (!(target > 1.f))
+		return 0.f;
+
+	// Attenuation is 1 / max(1, kC + kL d + kQ d^2); solve for where it reaches 1 / target
+	if (light.kQ > 0.f)
+	{
+		float discriminant = light.kL * light.kL + 4.f * light.kQ * (target - light.kC);
+		return discriminant > 0.f ? std::max((sqrtf(discriminant) - light.kL) / (2.f * light.kQ), 0.f) : 0.f;
+	}
+	if (light.kL > 0.f)
+		return std::max((target - light.kC) / light.kL, 0.f);
+	return light.kC < target ? FLT_MAX : 0.f;
+}
+
+void LightClusters::Clear(void)
+{
+	grid = glm::ivec3(1);
+	depthScaleBias = glm::vec2(0.f);
+	lightTexels.clear();
+	cells.assign(2, 0);
+	indices.clear();
+	maxPerCluster = 0;
+}
+
+bool LightClusters::IsEmpty(void) const
+{
+	return lightTexels.empty();
+}
+
+int LightClusters::GetNumLights(void) const
+{
+	return static_cast<int>(lightTexels.size() / TEXELS_PER_LIGHT);
+}
+
+unsigned LightClusters::GetMaxPerCluster(void) const
+{
+	return maxPerCluster;
+}
+
+double LightClusters::GetBuildTime(void) const
+{
+	return buildTime;
+}
+
+void LightClusters::BuildClusterBoxes(const glm::mat4& projection)
+{
+	boxProjection = projection;
+	clusterBoxes.resize(NUM_CLUSTERS * 2);
+	for (int z = 0; z < CLUSTERS_Z; ++z)
+	{
+		float depths[2] = { expf((z - depthScaleBias.y) / depthScaleBias.x), expf((z + 1 - depthScaleBias.y) / depthScaleBias.x) };
+		for (int y = 0; y < CLUSTERS_Y; ++y)
+		{
+			for (int x = 0; x < CLUSTERS_X; ++x)
+			{
+				// Camera space x = (ndc + P20) * depth / P00 at the tile's edges and the slice's ends
+				float ndcX[2] = { -1.f + 2.f * x / CLUSTERS_X, -1.f + 2.f * (x + 1) / CLUSTERS_X };
+				float ndcY[2] = { -1.f + 2.f * y / CLUSTERS_Y, -1.f + 2.f * (y + 1) / CLUSTERS_Y };
+				glm::vec3 boxMin(FLT_MAX, FLT_MAX, -depths[1]), boxMax(-FLT_MAX, -FLT_MAX, -depths[0]);
+				for (int d = 0; d < 2; ++d)
+				{
+					for (int e = 0; e < 2; ++e)
+					{
+						float cornerX = (ndcX[e] + projection[2][0]) * depths[d] / projection[0][0];
+						float cornerY = (ndcY[e] + projection[2][1]) * depths[d] / projection[1][1];
+						boxMin.x = std::min(boxMin.x, cornerX);
+						boxMax.x = std::max(boxMax.x, cornerX);
+						boxMin.y = std::min(boxMin.y, cornerY);
+						boxMax.y = std::max(boxMax.y, cornerY);
+					}
+				}
+				int cluster = (z * CLUSTERS_Y + y) * CLUSTERS_X + x;
+				clusterBoxes[cluster * 2] = boxMin;
+				clusterBoxes[cluster * 2 + 1] = boxMax;
+			}
+		}
+	}
+}
+
+/******************************************************************************/
+/*!
+\brief
+Bin lights into clusters. Every light is converted to camera space and
+bounded by the tiles and slices its range sphere overlaps, in parallel
+over chunks of lights; then every depth slice, in parallel, tests the
+lights overlapping it against its clusters' boxes and lists them by
+cluster. The slices' lists are joined afterwards.
+
+\param view - view matrix
+\param projection - projection matrix, whose near and far planes bound the slices
+\param lights - lights to bin, in world space
+\param numLights - number of lights
+*/
+/******************************************************************************/
+void LightClusters::Build(const glm::mat4& view, const glm::mat4& projection, const Light* lights, int numLights)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	numLights = std::max(numLights, 0);
+
+	// glm::perspective and glm::frustum put -1 in the w row; the planes follow from the depth terms
+	float zNear = 0.f, zFar = 0.f;
+	bool perspective = projection[2][3] == -1.f && projection[3][3] == 0.f;
+	if (perspective)
+	{
+		zNear = projection[3][2] / (projection[2][2] - 1.f);
+		zFar = projection[3][2] / (projection[2][2] + 1.f);
+		// An infinite far plane still needs a last slice
+		if (!(zFar > zNear) || zFar > zNear * 1e6f)
+			zFar = zNear * 1e6f;
+		perspective = zNear > 0.f;
+	}
+	if (perspective)
+	{
+		grid = glm::ivec3(CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z);
+		depthScaleBias.x = CLUSTERS_Z / logf(zFar / zNear);
+		depthScaleBias.y = -logf(zNear) * depthScaleBias.x;
+		if (projection != boxProjection || clusterBoxes.empty())
+			BuildClusterBoxes(projection);
+	}
+	else
+	{
+		grid = glm::ivec3(1);
+		depthScaleBias = glm::vec2(0.f);
+	}
+
+	lightTexels.resize(static_cast<size_t>(numLights) * TEXELS_PER_LIGHT);
+	bounds.resize(numLights);
+	ThreadPool* pool = ThreadPool::GetInstance();
+	unsigned numChunks = (static_cast<unsigned>(numLights) + LIGHT_CHUNK - 1) / LIGHT_CHUNK;
+	pool->Run(numChunks, [&](unsigned index, unsigned /*thread*/)
+	{
+		int last = std::min(numLights, static_cast<int>((index + 1) * LIGHT_CHUNK));
+		for (int i = index * LIGHT_CHUNK; i < last; ++i)
+		{
+			const Light& light = lights[i];
+			bool directional = light.type == Light::LIGHT_DIRECTIONAL;
+
+			// Same conversion as UniformBlocks::SetFrame does for the light array
+			glm::vec3 position = glm::vec3(view * glm::vec4(light.position, directional ? 0.f : 1.f));
+			glm::vec4* texels = &lightTexels[i * TEXELS_PER_LIGHT];
+			texels[0] = glm::vec4(position, static_cast<float>(light.type));
+			texels[1] = glm::vec4(light.color, light.power);
+			texels[2] = glm::vec4(glm::vec3(view * glm::vec4(light.spotDirection, 0.f)), cosf(glm::radians(light.cosCutoff)));
+			texels[3] = glm::vec4(light.kC, light.kL, light.kQ, cosf(glm::radians(light.cosInner)));
+
+			LightBounds& b = bounds[i];
+			float range = directional ? FLT_MAX : GetRange(light);
+			b.everywhere = range == FLT_MAX || !perspective;
+			b.center = position;
+			b.radiusSquared = range * range;
+			b.minX = b.minY = b.minZ = 0;
+			b.maxX = grid.x - 1;
+			b.maxY = grid.y - 1;
+			b.maxZ = grid.z - 1;
+			if (b.everywhere)
+			{
+				if (range <= 0.f)
+					b.maxZ = -1;
+				continue;
+			}
+
+			float nearDepth = std::max(-position.z - range, zNear);
+			float farDepth = std::min(-position.z + range, zFar);
+			if (!(range > 0.f) || nearDepth > farDepth)
+			{
+				b.maxZ = -1;
+				continue;
+			}
+
+			// The corners of the sphere's box span its projection, with depth clamped into the frustum
+			glm::vec2 ndcMin(FLT_MAX), ndcMax(-FLT_MAX);
+			float depths[2] = { nearDepth, farDepth };
+			for (int d = 0; d < 2; ++d)
+			{
+				for (int e = 0; e < 2; ++e)
+				{
+					float side = e ? range : -range;
+					glm::vec2 ndc((position.x + side) * projection[0][0] / depths[d] - projection[2][0],
+						(position.y + side) * projection[1][1] / depths[d] - projection[2][1]);
+					ndcMin = glm::min(ndcMin, ndc);
+					ndcMax = glm::max(ndcMax, ndc);
+				}
+			}
+			if (ndcMax.x < -1.f || ndcMin.x > 1.f || ndcMax.y < -1.f || ndcMin.y > 1.f)
+			{
+				b.maxZ = -1;
+				continue;
+			}
+			b.minX = std::max(static_cast<int>(floorf((ndcMin.x + 1.f) * 0.5f * grid.x)), 0);
+			b.maxX = std::min(static_cast<int>(floorf((ndcMax.x + 1.f) * 0.5f * grid.x)), grid.x - 1);
+			b.minY = std::max(static_cast<int>(floorf((ndcMin.y + 1.f) * 0.5f * grid.y)), 0);
+			b.maxY = std::min(static_cast<int>(floorf((ndcMax.y + 1.f) * 0.5f * grid.y)), grid.y - 1);
+			b.minZ = std::max(static_cast<int>(floorf(logf(nearDepth) * depthScaleBias.x + depthScaleBias.y)), 0);
+			b.maxZ = std::min(static_cast<int>(floorf(logf(farDepth) * depthScaleBias.x + depthScaleBias.y)), grid.z - 1);
+		}
+	});
+
+	// Each slice counts its clusters' lights, then lists them; cells hold offsets within the slice until joined
+	int cellsPerSlice = grid.x * grid.y;
+	cells.assign(static_cast<size_t>(cellsPerSlice) * grid.z * 2, 0);
+	sliceIndices.resize(grid.z);
+	pool->Run(grid.z, [&](unsigned z, unsigned /*thread*/)
+	{
+		unsigned* sliceCells = &cells[z * cellsPerSlice * 2];
+		std::vector<unsigned>& list = sliceIndices[z];
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			if (pass == 1)
+			{
+				unsigned offset = 0;
+				for (int c = 0; c < cellsPerSlice; ++c)
+				{
+					sliceCells[c * 2] = offset;
+					offset += sliceCells[c * 2 + 1];
+					sliceCells[c * 2 + 1] = 0;
+				}
+				list.resize(offset);
+			}
+			for (int i = 0; i < numLights; ++i)
+			{
+				const LightBounds& b = bounds[i];
+				if (static_cast<int>(z) < b.minZ || static_cast<int>(z) > b.maxZ)
+					continue;
+				for (int y = b.minY; y <= b.maxY; ++y)
+				{
+					for (int x = b.minX; x <= b.maxX; ++x)
+					{
+						int cell = y * grid.x + x;
+						if (!b.everywhere)
+						{
+							int cluster = static_cast<int>(z) * cellsPerSlice + cell;
+							if (SquaredDistanceToBox(b.center, clusterBoxes[cluster * 2], clusterBoxes[cluster * 2 + 1]) > b.radiusSquared)
+								continue;
+						}
+						unsigned& count = sliceCells[cell * 2 + 1];
+						if (pass == 1)
+							list[sliceCells[cell * 2] + count] = static_cast<unsigned>(i);
+						++count;
+					}
+				}
+			}
+		}
+	});
+
+	size_t numIndices = 0;
+	maxPerCluster = 0;
+	for (int z = 0; z < grid.z; ++z)
+	{
+		unsigned* sliceCells = &cells[z * cellsPerSlice * 2];
+		for (int c = 0; c < cellsPerSlice; ++c)
+		{
+			sliceCells[c * 2] += static_cast<unsigned>(numIndices);
+			maxPerCluster = std::max(maxPerCluster, sliceCells[c * 2 + 1]);
+		}
+		numIndices += sliceIndices[z].size();
+	}
+	indices.resize(numIndices);
+	for (int z = 0; z < grid.z; ++z)
+	{
+		if (!sliceIndices[z].empty())
+			memcpy(&indices[cells[z * cellsPerSlice * 2]], &sliceIndices[z][0], sliceIndices[z].size() * sizeof(unsigned));
+	}
+
+	buildTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
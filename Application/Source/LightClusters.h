@@ -0,0 +1,75 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <vector>
+#include <glm\glm.hpp>
+#include "Light.h"
+
+/******************************************************************************/
+/*!
+		Class LightClusters:
+\brief	Bins lights into a grid of clusters over the view frustum: tiles
+		across the screen and slices in depth, spaced exponentially from
+		the near plane to the far plane. A light goes in every cluster its
+		range sphere touches, its range being where it has faded to 1/256
+		of its brightness. Directional lights and lights that never fade
+		go in every cluster.
+
+		Build only fills the arrays below, on the ThreadPool, so a scene
+		can run it while recording; UniformBlocks::SetClusters uploads the
+		result to the texture buffers the lit shaders read.
+*/
+/******************************************************************************/
+class LightClusters
+{
+public:
+	static const int CLUSTERS_X = 16;
+	static const int CLUSTERS_Y = 9;
+	static const int CLUSTERS_Z = 24;
+	static const int NUM_CLUSTERS = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+	static const int TEXELS_PER_LIGHT = 4;		// RGBA32F texels, laid out as the shaders read them
+
+	LightClusters(void);
+	~LightClusters(void);
+
+	// Bin the lights for this camera. Without a perspective projection
+	// every light goes in one cluster covering the whole view
+	void Build(const glm::mat4& view, const glm::mat4& projection, const Light* lights, int numLights);
+	void Clear(void);
+
+	// Distance at which a light has faded out; FLT_MAX if it never does
+	static float GetRange(const Light& light);
+
+	bool IsEmpty(void) const;
+	int GetNumLights(void) const;
+	unsigned GetMaxPerCluster(void) const;
+	double GetBuildTime(void) const;		// ms, of the last Build
+
+	// Uploaded by UniformBlocks::SetClusters
+	glm::ivec3 grid;						// clusters along x, y and z
+	glm::vec2 depthScaleBias;				// slice = log(depth) * x + y
+	std::vector<glm::vec4> lightTexels;		// TEXELS_PER_LIGHT per light, in camera space
+	std::vector<unsigned> cells;			// first index and count per cluster, x fastest
+	std::vector<unsigned> indices;			// light numbers, per cluster in light order
+
+private:
+	// Tiles and slices a light's sphere overlaps, inclusive; an empty range when it is out of view
+	struct LightBounds
+	{
+		int minX, maxX, minY, maxY, minZ, maxZ;
+		glm::vec3 center;
+		float radiusSquared;
+		bool everywhere;
+	};
+
+	void BuildClusterBoxes(const glm::mat4& projection);
+
+	glm::mat4 boxProjection;				// the projection clusterBoxes were made for
+	std::vector<glm::vec3> clusterBoxes;	// camera space min and max corner per cluster
+	std::vector<LightBounds> bounds;
+	std::vector<std::vector<unsigned> > sliceIndices;	// light numbers of each depth slice, by cluster
+	unsigned maxPerCluster;
+	double buildTime;
+};
+
+#endif
@@ -0,0 +1,191 @@
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+#include "LoadAnimation.h"
+
+namespace
+{
+	const char ANIMATION_MAGIC[4] = { 'A', 'N', 'I', 'M' };
+	const unsigned ANIMATION_VERSION = 1;
+
+	// A channel that moves less than this over the whole clip is stored as a constant
+	const float CONSTANT_RANGE = 1e-5f;
+
+	enum TRACK_TYPE
+	{
+		TRACK_CONSTANT,
+		TRACK_QUANTIZED,
+	};
+
+	template<typename T>
+	void Write(std::ofstream& stream, const T& value)
+	{
+		stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template<typename T>
+	bool Read(std::ifstream& stream, T& value)
+	{
+		stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+		return stream.good();
+	}
+}
+
+bool LoadAnimation(
+	const char* file_path,
+	std::vector<AnimationClip>& out_clips
+)
+{
+	std::ifstream fileStream(file_path, std::ios::binary);
+	if (!fileStream.is_open())
+	{
+		std::cout << "Impossible to open " << file_path << ". Are you in the right directory ?\n";
+		return false;
+	}
+
+	char magic[4];
+	unsigned version, numClips;
+	fileStream.read(magic, 4);
+	if (!fileStream.good() || !std::equal(magic, magic + 4, ANIMATION_MAGIC) ||
+		!Read(fileStream, version) || version != ANIMATION_VERSION || !Read(fileStream, numClips))
+	{
+		std::cout << file_path << " is not an animation file\n";
+		return false;
+	}
+
+	std::vector<AnimationClip> clips(numClips);
+	std::vector<unsigned short> steps;
+	for (unsigned i = 0; i < numClips; ++i)
+	{
+		unsigned nameLength, numJoints, numKeys;
+		unsigned char loop;
+		float frameRate, loopStart;
+		if (!Read(fileStream, nameLength) || nameLength > 256)
+		{
+			std::cout << file_path << " is corrupt\n";
+			return false;
+		}
+		std::string name(nameLength, ' ');
+		fileStream.read(&name[0], nameLength);
+		if (!Read(fileStream, numJoints) || !Read(fileStream, numKeys) || !Read(fileStream, frameRate) ||
+			!Read(fileStream, loop) || !Read(fileStream, loopStart) ||
+			numJoints > 4096 || numKeys == 0 || numKeys > (1u << 20) || !(frameRate > 0.f))
+		{
+			std::cout << file_path << " is corrupt\n";
+			return false;
+		}
+
+		AnimationClip& clip = clips[i];
+		clip.Create(name, numJoints, numKeys, frameRate, loop != 0, loopStart);
+		unsigned stride = clip.GetStride();
+		unsigned keySize = AnimationPose::NUM_CHANNELS * stride;
+		float* keys = clip.GetKeyData(0);
+		steps.resize(numKeys);
+
+		for (unsigned j = 0; j < numJoints; ++j)
+		{
+			for (unsigned c = 0; c < AnimationPose::NUM_CHANNELS; ++c)
+			{
+				float* track = keys + c * stride + j;
+				unsigned char type;
+				float low, high;
+				if (!Read(fileStream, type) || !Read(fileStream, low))
+				{
+					std::cout << file_path << " is corrupt\n";
+					return false;
+				}
+				if (type == TRACK_CONSTANT)
+				{
+					for (unsigned k = 0; k < numKeys; ++k)
+						track[k * keySize] = low;
+					continue;
+				}
+
+				if (type != TRACK_QUANTIZED || !Read(fileStream, high))
+				{
+					std::cout << file_path << " is corrupt\n";
+					return false;
+				}
+				fileStream.read(reinterpret_cast<char*>(&steps[0]), numKeys * sizeof(unsigned short));
+				if (!fileStream.good())
+				{
+					std::cout << file_path << " is corrupt\n";
+					return false;
+				}
+				float scale = (high - low) / 65535.f;
+				for (unsigned k = 0; k < numKeys; ++k)
+					track[k * keySize] = low + steps[k] * scale;
+			}
+		}
+	}
+
+	out_clips.swap(clips);
+	return true;
+}
+
+bool SaveAnimation(
+	const char* file_path,
+	const std::vector<AnimationClip>& clips
+)
+{
+	std::ofstream fileStream(file_path, std::ios::binary);
+	if (!fileStream.is_open())
+	{
+		std::cout << "Impossible to write " << file_path << ". Are you in the right directory ?\n";
+		return false;
+	}
+
+	fileStream.write(ANIMATION_MAGIC, 4);
+	Write(fileStream, ANIMATION_VERSION);
+	Write(fileStream, static_cast<unsigned>(clips.size()));
+
+	std::vector<unsigned short> steps;
+	for (const AnimationClip& clip : clips)
+	{
+		Write(fileStream, static_cast<unsigned>(clip.GetName().size()));
+		fileStream.write(clip.GetName().data(), clip.GetName().size());
+		Write(fileStream, clip.GetNumJoints());
+		Write(fileStream, clip.GetNumKeys());
+		Write(fileStream, clip.GetFrameRate());
+		Write(fileStream, static_cast<unsigned char>(clip.IsLooping() ? 1 : 0));
+		Write(fileStream, clip.GetLoopStart());
+
+		unsigned numKeys = clip.GetNumKeys();
+		unsigned stride = clip.GetStride();
+		unsigned keySize = AnimationPose::NUM_CHANNELS * stride;
+		const float* keys = clip.GetKeyData(0);
+		steps.resize(numKeys);
+
+		for (unsigned j = 0; j < clip.GetNumJoints(); ++j)
+		{
+			for (unsigned c = 0; c < AnimationPose::NUM_CHANNELS; ++c)
+			{
+				const float* track = keys + c * stride + j;
+				float low = track[0], high = track[0];
+				for (unsigned k = 1; k < numKeys; ++k)
+				{
+					low = std::min(low, track[k * keySize]);
+					high = std::max(high, track[k * keySize]);
+				}
+
+				if (high - low < CONSTANT_RANGE)
+				{
+					Write(fileStream, static_cast<unsigned char>(TRACK_CONSTANT));
+					Write(fileStream, (low + high) * 0.5f);
+					continue;
+				}
+
+				// Round to the nearest step, so the error is at most half a step
+				float scale = 65535.f / (high - low);
+				for (unsigned k = 0; k < numKeys; ++k)
+					steps[k] = static_cast<unsigned short>(std::min((track[k * keySize] - low) * scale + 0.5f, 65535.f));
+				Write(fileStream, static_cast<unsigned char>(TRACK_QUANTIZED));
+				Write(fileStream, low);
+				Write(fileStream, high);
+				fileStream.write(reinterpret_cast<const char*>(&steps[0]), numKeys * sizeof(unsigned short));
+			}
+		}
+	}
+	return fileStream.good();
+}
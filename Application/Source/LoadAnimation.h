@@ -0,0 +1,19 @@
+#ifndef LOAD_ANIMATION_H
+#define LOAD_ANIMATION_H
+
+#include <vector>
+#include "AnimationClip.h"
+
+// Compact binary clips: each joint channel that changes is stored as 16-bit
+// steps between its minimum and maximum, and a channel that never changes as one float
+bool LoadAnimation(
+	const char* file_path,
+	std::vector<AnimationClip>& out_clips
+);
+
+bool SaveAnimation(
+	const char* file_path,
+	const std::vector<AnimationClip>& clips
+);
+
+#endif
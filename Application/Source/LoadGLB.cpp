@@ -0,0 +1,1233 @@
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+#include <algorithm>
+#include <glm\gtc\quaternion.hpp>
+
+#include "LoadGLB.h"
+#include "MappedFile.h"
+#include "SceneGraph.h"
+#include "UniformBlocks.h"
+
+namespace
+{
+	const unsigned GLB_MAGIC = 0x46546C67;		// "glTF"
+	const unsigned GLB_VERSION = 2;
+	const unsigned CHUNK_JSON = 0x4E4F534A;		// "JSON"
+	const unsigned CHUNK_BIN = 0x004E4942;		// "BIN\0"
+
+	// glTF component types, the same values as the GL enums
+	const unsigned COMPONENT_BYTE = 5120;
+	const unsigned COMPONENT_UNSIGNED_BYTE = 5121;
+	const unsigned COMPONENT_SHORT = 5122;
+	const unsigned COMPONENT_UNSIGNED_SHORT = 5123;
+	const unsigned COMPONENT_UNSIGNED_INT = 5125;
+	const unsigned COMPONENT_FLOAT = 5126;
+
+	// glTF primitive modes, the same values as the GL enums
+	const int MODE_LINES = 1;
+	const int MODE_TRIANGLES = 4;
+	const int MODE_TRIANGLE_STRIP = 5;
+
+	// Deeper JSON than this is refused rather than overflowing the stack
+	const unsigned MAX_JSON_DEPTH = 64;
+
+	/******************************************************************************/
+	/*!
+			Struct JsonValue:
+	\brief	Parsed JSON document. An object keeps its member names in keys
+			and the values, in the same order, in elements.
+	*/
+	/******************************************************************************/
+	struct JsonValue
+	{
+		enum TYPE
+		{
+			JSON_NULL,
+			JSON_BOOL,
+			JSON_NUMBER,
+			JSON_STRING,
+			JSON_ARRAY,
+			JSON_OBJECT,
+		};
+
+		TYPE type;
+		double number;		// a bool is 0 or 1
+		std::string string;
+		std::vector<JsonValue> elements;
+		std::vector<std::string> keys;
+
+		JsonValue() : type(JSON_NULL), number(0.0) {}
+
+		const JsonValue* Find(const char* key) const
+		{
+			if (type != JSON_OBJECT)
+				return NULL;
+			for (size_t i = 0; i < keys.size(); ++i)
+			{
+				if (keys[i] == key)
+					return &elements[i];
+			}
+			return NULL;
+		}
+
+		size_t Size(void) const
+		{
+			return type == JSON_ARRAY ? elements.size() : 0;
+		}
+	};
+
+	class JsonParser
+	{
+	public:
+		JsonParser(const char* begin, const char* end) : p(begin), end(end), depth(0) {}
+
+		// The chunk is padded with spaces, so anything after the document is ignored
+		bool Parse(JsonValue& out)
+		{
+			return ParseValue(out);
+		}
+
+	private:
+		const char* p;
+		const char* end;
+		unsigned depth;
+
+		void SkipSpace(void)
+		{
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+				++p;
+		}
+
+		bool Literal(const char* word)
+		{
+			size_t length = strlen(word);
+			if (static_cast<size_t>(end - p) < length || strncmp(p, word, length) != 0)
+				return false;
+			p += length;
+			return true;
+		}
+
+		bool ParseValue(JsonValue& out)
+		{
+			SkipSpace();
+			if (p >= end)
+				return false;
+
+			if (*p == '{' || *p == '[')
+			{
+				if (++depth > MAX_JSON_DEPTH)
+					return false;
+				bool parsed = *p == '{' ? ParseObject(out) : ParseArray(out);
+				--depth;
+				return parsed;
+			}
+			if (*p == '"')
+			{
+				out.type = JsonValue::JSON_STRING;
+				return ParseString(out.string);
+			}
+			if (*p == 't' || *p == 'f')
+			{
+				out.type = JsonValue::JSON_BOOL;
+				out.number = *p == 't' ? 1.0 : 0.0;
+				return Literal(*p == 't' ? "true" : "false");
+			}
+			if (*p == 'n')
+			{
+				out.type = JsonValue::JSON_NULL;
+				return Literal("null");
+			}
+			return ParseNumber(out);
+		}
+
+		bool ParseObject(JsonValue& out)
+		{
+			out.type = JsonValue::JSON_OBJECT;
+			++p;
+			SkipSpace();
+			if (p < end && *p == '}')
+			{
+				++p;
+				return true;
+			}
+			for (;;)
+			{
+				SkipSpace();
+				out.keys.push_back(std::string());
+				if (p >= end || *p != '"' || !ParseString(out.keys.back()))
+					return false;
+				SkipSpace();
+				if (p >= end || *p != ':')
+					return false;
+				++p;
+				out.elements.push_back(JsonValue());
+				if (!ParseValue(out.elements.back()))
+					return false;
+				SkipSpace();
+				if (p >= end)
+					return false;
+				if (*p == '}')
+				{
+					++p;
+					return true;
+				}
+				if (*p != ',')
+					return false;
+				++p;
+			}
+		}
+
+		bool ParseArray(JsonValue& out)
+		{
+			out.type = JsonValue::JSON_ARRAY;
+			++p;
+			SkipSpace();
+			if (p < end && *p == ']')
+			{
+				++p;
+				return true;
+			}
+			for (;;)
+			{
+				out.elements.push_back(JsonValue());
+				if (!ParseValue(out.elements.back()))
+					return false;
+				SkipSpace();
+				if (p >= end)
+					return false;
+				if (*p == ']')
+				{
+					++p;
+					return true;
+				}
+				if (*p != ',')
+					return false;
+				++p;
+			}
+		}
+
+		bool ParseHex(unsigned& out)
+		{
+			if (end - p < 4)
+				return false;
+			out = 0;
+			for (int i = 0; i < 4; ++i, ++p)
+			{
+				char c = *p;
+				unsigned digit;
+				if (c >= '0' && c <= '9')
+					digit = c - '0';
+				else if (c >= 'a' && c <= 'f')
+					digit = c - 'a' + 10;
+				else if (c >= 'A' && c <= 'F')
+					digit = c - 'A' + 10;
+				else
+					return false;
+				out = out * 16 + digit;
+			}
+			return true;
+		}
+
+		void AppendUTF8(std::string& out, unsigned code)
+		{
+			if (code < 0x80)
+				out += static_cast<char>(code);
+			else if (code < 0x800)
+			{
+				out += static_cast<char>(0xC0 | (code >> 6));
+				out += static_cast<char>(0x80 | (code & 0x3F));
+			}
+			else if (code < 0x10000)
+			{
+				out += static_cast<char>(0xE0 | (code >> 12));
+				out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+				out += static_cast<char>(0x80 | (code & 0x3F));
+			}
+			else
+			{
+				out += static_cast<char>(0xF0 | (code >> 18));
+				out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+				out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+				out += static_cast<char>(0x80 | (code & 0x3F));
+			}
+		}
+
+		bool ParseString(std::string& out)
+		{
+			++p;
+			while (p < end && *p != '"')
+			{
+				if (*p != '\\')
+				{
+					out += *p++;
+					continue;
+				}
+				if (++p >= end)
+					return false;
+				char c = *p++;
+				switch (c)
+				{
+				case '"': out += '"'; break;
+				case '\\': out += '\\'; break;
+				case '/': out += '/'; break;
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'n': out += '\n'; break;
+				case 'r': out += '\r'; break;
+				case 't': out += '\t'; break;
+				case 'u':
+				{
+					unsigned code;
+					if (!ParseHex(code))
+						return false;
+					// A character outside the basic plane comes as a surrogate pair
+					unsigned low;
+					if (code >= 0xD800 && code < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u')
+					{
+						p += 2;
+						if (!ParseHex(low) || low < 0xDC00 || low >= 0xE000)
+							return false;
+						code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+					}
+					AppendUTF8(out, code);
+					break;
+				}
+				default:
+					return false;
+				}
+			}
+			if (p >= end)
+				return false;
+			++p;
+			return true;
+		}
+
+		bool ParseNumber(JsonValue& out)
+		{
+			// Copied out because the chunk is not null terminated
+			char text[64];
+			size_t length = 0;
+			while (p < end && length + 1 < sizeof(text) && ((*p != '\0' && strchr("+-.eE", *p) != NULL) || (*p >= '0' && *p <= '9')))
+				text[length++] = *p++;
+			text[length] = '\0';
+
+			char* parsed;
+			out.type = JsonValue::JSON_NUMBER;
+			out.number = strtod(text, &parsed);
+			return length > 0 && parsed == text + length;
+		}
+	};
+
+	// Indices, counts and offsets; anything that is not a whole number in int range is the fallback
+	int ToInt(const JsonValue* value, int fallback)
+	{
+		if (value == NULL || value->type != JsonValue::JSON_NUMBER || !(value->number >= INT_MIN && value->number <= INT_MAX))
+			return fallback;
+		int number = static_cast<int>(value->number);
+		return number == value->number ? number : fallback;
+	}
+
+	int GetInt(const JsonValue& object, const char* key, int fallback)
+	{
+		return ToInt(object.Find(key), fallback);
+	}
+
+	double GetNumber(const JsonValue& object, const char* key, double fallback)
+	{
+		const JsonValue* value = object.Find(key);
+		return value && value->type == JsonValue::JSON_NUMBER ? value->number : fallback;
+	}
+
+	std::string GetString(const JsonValue& object, const char* key)
+	{
+		const JsonValue* value = object.Find(key);
+		return value && value->type == JsonValue::JSON_STRING ? value->string : std::string();
+	}
+
+	// The array under key, or an empty one
+	const JsonValue& GetArray(const JsonValue& object, const char* key)
+	{
+		static const JsonValue empty;
+		const JsonValue* value = object.Find(key);
+		return value && value->type == JsonValue::JSON_ARRAY ? *value : empty;
+	}
+
+	// Up to count numbers of an array into out, leaving the rest of out as it was
+	void GetFloats(const JsonValue& object, const char* key, float* out, unsigned count)
+	{
+		const JsonValue& array = GetArray(object, key);
+		for (unsigned i = 0; i < count && i < array.Size(); ++i)
+			out[i] = static_cast<float>(array.elements[i].number);
+	}
+
+	struct BufferView
+	{
+		size_t offset;		// from the start of the BIN chunk
+		size_t length;
+		unsigned stride;	// 0 if the elements are tightly packed
+	};
+
+	struct Accessor
+	{
+		int bufferView;		// -1 for all zeros, before any sparse values
+		size_t offset;		// from the start of the view
+		unsigned componentType;
+		bool normalized;
+		unsigned count;
+		unsigned numComponents;
+		const JsonValue* sparse;
+	};
+
+	// The parts of the file accessors read from
+	struct GLBFile
+	{
+		const unsigned char* bin;
+		size_t binSize;
+		std::vector<BufferView> views;
+		std::vector<Accessor> accessors;
+	};
+
+	unsigned ComponentSize(unsigned componentType)
+	{
+		switch (componentType)
+		{
+		case COMPONENT_BYTE:
+		case COMPONENT_UNSIGNED_BYTE:
+			return 1;
+		case COMPONENT_SHORT:
+		case COMPONENT_UNSIGNED_SHORT:
+			return 2;
+		case COMPONENT_UNSIGNED_INT:
+		case COMPONENT_FLOAT:
+			return 4;
+		}
+		return 0;
+	}
+
+	// Matrices other than MAT4 are padded per column for small components, and no attribute uses them
+	unsigned NumComponents(const std::string& type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		if (type == "MAT4") return 16;
+		return 0;
+	}
+
+	unsigned ElementSize(const Accessor& accessor)
+	{
+		return ComponentSize(accessor.componentType) * accessor.numComponents;
+	}
+
+	unsigned ElementStride(const GLBFile& file, const Accessor& accessor)
+	{
+		unsigned stride = accessor.bufferView >= 0 ? file.views[accessor.bufferView].stride : 0;
+		return stride ? stride : ElementSize(accessor);
+	}
+
+	// Checks that every element of the accessor lies inside its view
+	bool ParseAccessor(const JsonValue& json, const GLBFile& file, Accessor& out)
+	{
+		out.bufferView = GetInt(json, "bufferView", -1);
+		int offset = GetInt(json, "byteOffset", 0);
+		out.componentType = static_cast<unsigned>(GetInt(json, "componentType", 0));
+		const JsonValue* normalized = json.Find("normalized");
+		out.normalized = normalized && normalized->number != 0.0;
+		int count = GetInt(json, "count", 0);
+		out.numComponents = NumComponents(GetString(json, "type"));
+		out.sparse = json.Find("sparse");
+
+		if (ComponentSize(out.componentType) == 0 || out.numComponents == 0 || count <= 0 || offset < 0)
+			return false;
+		out.offset = static_cast<size_t>(offset);
+		out.count = static_cast<unsigned>(count);
+		if (out.bufferView < 0)
+			return out.bufferView == -1;
+		if (out.bufferView >= static_cast<int>(file.views.size()))
+			return false;
+
+		const BufferView& view = file.views[out.bufferView];
+		size_t last = static_cast<size_t>(out.count - 1) * ElementStride(file, out);
+		return out.offset <= view.length && last <= view.length - out.offset && ElementSize(out) <= view.length - out.offset - last;
+	}
+
+	double ReadComponent(const unsigned char* data, unsigned componentType, bool normalized)
+	{
+		switch (componentType)
+		{
+		case COMPONENT_BYTE:
+		{
+			signed char value = static_cast<signed char>(data[0]);
+			return normalized ? std::max(value / 127.0, -1.0) : value;
+		}
+		case COMPONENT_UNSIGNED_BYTE:
+			return normalized ? data[0] / 255.0 : data[0];
+		case COMPONENT_SHORT:
+		{
+			short value;
+			memcpy(&value, data, sizeof(value));
+			return normalized ? std::max(value / 32767.0, -1.0) : value;
+		}
+		case COMPONENT_UNSIGNED_SHORT:
+		{
+			unsigned short value;
+			memcpy(&value, data, sizeof(value));
+			return normalized ? value / 65535.0 : value;
+		}
+		case COMPONENT_UNSIGNED_INT:
+		{
+			unsigned value;
+			memcpy(&value, data, sizeof(value));
+			return value;
+		}
+		case COMPONENT_FLOAT:
+		{
+			float value;
+			memcpy(&value, data, sizeof(value));
+			return value;
+		}
+		}
+		return 0.0;
+	}
+
+	// Replaces the elements the accessor's sparse part lists; values are tightly packed
+	bool ApplySparse(const GLBFile& file, const Accessor& accessor, unsigned components, std::vector<double>& out)
+	{
+		const JsonValue& sparse = *accessor.sparse;
+		const JsonValue* indices = sparse.Find("indices");
+		const JsonValue* values = sparse.Find("values");
+		int count = GetInt(sparse, "count", 0);
+		if (indices == NULL || values == NULL || count <= 0 || static_cast<unsigned>(count) > accessor.count)
+			return false;
+
+		int indexView = GetInt(*indices, "bufferView", -1);
+		int valueView = GetInt(*values, "bufferView", -1);
+		unsigned indexType = static_cast<unsigned>(GetInt(*indices, "componentType", 0));
+		int indexOffset = GetInt(*indices, "byteOffset", 0);
+		int valueOffset = GetInt(*values, "byteOffset", 0);
+		unsigned indexSize = ComponentSize(indexType);
+		unsigned valueSize = ElementSize(accessor);
+		if (indexView < 0 || indexView >= static_cast<int>(file.views.size()) || valueView < 0 || valueView >= static_cast<int>(file.views.size()) ||
+			indexOffset < 0 || valueOffset < 0)
+			return false;
+		size_t indexLength = file.views[indexView].length, valueLength = file.views[valueView].length;
+		if (indexSize == 0 || indexType == COMPONENT_FLOAT || indexType == COMPONENT_BYTE || indexType == COMPONENT_SHORT ||
+			static_cast<size_t>(indexOffset) > indexLength || static_cast<size_t>(count) > (indexLength - indexOffset) / indexSize ||
+			static_cast<size_t>(valueOffset) > valueLength || static_cast<size_t>(count) > (valueLength - valueOffset) / valueSize)
+			return false;
+
+		const unsigned char* indexData = file.bin + file.views[indexView].offset + indexOffset;
+		const unsigned char* valueData = file.bin + file.views[valueView].offset + valueOffset;
+		unsigned componentSize = ComponentSize(accessor.componentType);
+		unsigned numRead = std::min(components, accessor.numComponents);
+		for (int i = 0; i < count; ++i)
+		{
+			unsigned element = static_cast<unsigned>(ReadComponent(indexData + i * indexSize, indexType, false));
+			if (element >= accessor.count)
+				return false;
+			for (unsigned c = 0; c < numRead; ++c)
+				out[element * components + c] = ReadComponent(valueData + i * valueSize + c * componentSize, accessor.componentType, accessor.normalized);
+		}
+		return true;
+	}
+
+	// Every element as components numbers, converted from any component type; missing components are 0
+	bool ReadAccessor(const GLBFile& file, int index, unsigned components, std::vector<double>& out)
+	{
+		if (index < 0 || index >= static_cast<int>(file.accessors.size()))
+			return false;
+		const Accessor& accessor = file.accessors[index];
+		out.assign(static_cast<size_t>(accessor.count) * components, 0.0);
+
+		if (accessor.bufferView >= 0)
+		{
+			const unsigned char* data = file.bin + file.views[accessor.bufferView].offset + accessor.offset;
+			unsigned stride = ElementStride(file, accessor);
+			unsigned componentSize = ComponentSize(accessor.componentType);
+			unsigned numRead = std::min(components, accessor.numComponents);
+			for (unsigned i = 0; i < accessor.count; ++i)
+			{
+				for (unsigned c = 0; c < numRead; ++c)
+					out[i * components + c] = ReadComponent(data + static_cast<size_t>(i) * stride + c * componentSize, accessor.componentType, accessor.normalized);
+			}
+		}
+		return accessor.sparse == NULL || ApplySparse(file, accessor, components, out);
+	}
+
+	// One vertex attribute of a layout the importer can upload without converting
+	struct LayoutAttribute
+	{
+		const char* name;
+		unsigned numComponents;
+		unsigned componentType;
+		size_t offset;
+	};
+
+	const LayoutAttribute VERTEX_LAYOUT[] =
+	{
+		{ "POSITION", 3, COMPONENT_FLOAT, offsetof(Vertex, pos) },
+		{ "COLOR_0", 3, COMPONENT_FLOAT, offsetof(Vertex, color) },
+		{ "NORMAL", 3, COMPONENT_FLOAT, offsetof(Vertex, normal) },
+		{ "TEXCOORD_0", 2, COMPONENT_FLOAT, offsetof(Vertex, texCoord) },
+	};
+
+	const LayoutAttribute SKINNED_VERTEX_LAYOUT[] =
+	{
+		{ "POSITION", 3, COMPONENT_FLOAT, offsetof(SkinnedVertex, pos) },
+		{ "COLOR_0", 3, COMPONENT_FLOAT, offsetof(SkinnedVertex, color) },
+		{ "NORMAL", 3, COMPONENT_FLOAT, offsetof(SkinnedVertex, normal) },
+		{ "TEXCOORD_0", 2, COMPONENT_FLOAT, offsetof(SkinnedVertex, texCoord) },
+		{ "JOINTS_0", 4, COMPONENT_UNSIGNED_BYTE, offsetof(SkinnedVertex, joints) },
+		{ "WEIGHTS_0", 4, COMPONENT_FLOAT, offsetof(SkinnedVertex, weights) },
+	};
+
+	/******************************************************************************/
+	/*!
+	\brief
+	Find the first vertex when the primitive's attributes interleave in one
+	view exactly as the vertex struct does
+
+	\param file - the loaded file
+	\param attributes - the primitive's attributes object
+	\param layout - attributes of the vertex struct
+	\param numAttributes - entries of layout
+	\param vertexSize - size of the vertex struct, which must be the view's stride
+	\param out_count - receives the number of vertices
+
+	\return the first vertex in the mapped file, or NULL if it must be converted
+	*/
+	/******************************************************************************/
+	const unsigned char* MatchLayout(const GLBFile& file, const JsonValue& attributes, const LayoutAttribute* layout, unsigned numAttributes, unsigned vertexSize, unsigned& out_count)
+	{
+		int view = -1;
+		size_t base = 0;
+		for (unsigned i = 0; i < numAttributes; ++i)
+		{
+			int index = GetInt(attributes, layout[i].name, -1);
+			if (index < 0 || index >= static_cast<int>(file.accessors.size()))
+				return NULL;
+			const Accessor& accessor = file.accessors[index];
+			if (accessor.bufferView < 0 || accessor.sparse || accessor.normalized || accessor.componentType != layout[i].componentType ||
+				accessor.numComponents != layout[i].numComponents || accessor.offset < layout[i].offset)
+				return NULL;
+			if (i == 0)
+			{
+				view = accessor.bufferView;
+				base = accessor.offset - layout[i].offset;
+				out_count = accessor.count;
+			}
+			else if (accessor.bufferView != view || accessor.offset - layout[i].offset != base || accessor.count != out_count)
+				return NULL;
+		}
+
+		// The whole last vertex is read, padding included, so it has to lie in the chunk too
+		const BufferView& bufferView = file.views[view];
+		if (bufferView.stride != vertexSize || bufferView.offset + base + static_cast<size_t>(out_count) * vertexSize > file.binSize)
+			return NULL;
+		const unsigned char* data = file.bin + bufferView.offset + base;
+		return reinterpret_cast<uintptr_t>(data) % sizeof(float) == 0 ? data : NULL;
+	}
+
+	// 32-bit indices that can go to GL as they are, or NULL
+	const unsigned* MatchIndices(const GLBFile& file, int index)
+	{
+		if (index < 0 || index >= static_cast<int>(file.accessors.size()))
+			return NULL;
+		const Accessor& accessor = file.accessors[index];
+		if (accessor.bufferView < 0 || accessor.sparse || accessor.componentType != COMPONENT_UNSIGNED_INT || accessor.numComponents != 1 ||
+			ElementStride(file, accessor) != sizeof(unsigned))
+			return NULL;
+		const unsigned char* data = file.bin + file.views[accessor.bufferView].offset + accessor.offset;
+		return reinterpret_cast<uintptr_t>(data) % sizeof(unsigned) == 0 ? reinterpret_cast<const unsigned*>(data) : NULL;
+	}
+
+	bool ReadIndices(const GLBFile& file, int index, unsigned numVertices, std::vector<unsigned>& out)
+	{
+		if (index < 0)
+		{
+			out.resize(numVertices);
+			for (unsigned i = 0; i < numVertices; ++i)
+				out[i] = i;
+			return true;
+		}
+
+		std::vector<double> values;
+		if (!ReadAccessor(file, index, 1, values))
+			return false;
+		out.resize(values.size());
+		for (size_t i = 0; i < values.size(); ++i)
+			out[i] = static_cast<unsigned>(values[i]);
+		return true;
+	}
+
+	bool IndicesInRange(const unsigned* indices, unsigned indexCount, unsigned numVertices)
+	{
+		for (unsigned i = 0; i < indexCount; ++i)
+		{
+			if (indices[i] >= numVertices)
+				return false;
+		}
+		return true;
+	}
+
+	// Area weighted vertex normals, for triangle lists that come without any
+	void ComputeNormals(const std::vector<unsigned>& indices, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& out_normals)
+	{
+		out_normals.assign(positions.size(), glm::vec3(0.f));
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			const glm::vec3& a = positions[indices[i]];
+			glm::vec3 face = glm::cross(positions[indices[i + 1]] - a, positions[indices[i + 2]] - a);
+			out_normals[indices[i]] += face;
+			out_normals[indices[i + 1]] += face;
+			out_normals[indices[i + 2]] += face;
+		}
+		for (size_t i = 0; i < out_normals.size(); ++i)
+		{
+			float length = glm::length(out_normals[i]);
+			out_normals[i] = length > 0.f ? out_normals[i] / length : glm::vec3(0.f, 1.f, 0.f);
+		}
+	}
+
+	/******************************************************************************/
+	/*!
+	\brief
+	Read the attributes every vertex struct shares, converting from whatever
+	the file stores; a missing colour is white and missing normals are
+	computed for triangle lists
+
+	\return false if the primitive has no usable positions
+	*/
+	/******************************************************************************/
+	bool ReadVertices(const GLBFile& file, const JsonValue& attributes, int indicesAccessor, int mode,
+		std::vector<glm::vec3>& out_positions, std::vector<glm::vec3>& out_colors, std::vector<glm::vec3>& out_normals, std::vector<glm::vec2>& out_texCoords, std::vector<unsigned>& out_indices)
+	{
+		std::vector<double> values;
+		if (!ReadAccessor(file, GetInt(attributes, "POSITION", -1), 3, values))
+			return false;
+		size_t numVertices = values.size() / 3;
+		out_positions.resize(numVertices);
+		for (size_t i = 0; i < numVertices; ++i)
+			out_positions[i] = glm::vec3(values[i * 3], values[i * 3 + 1], values[i * 3 + 2]);
+
+		if (!ReadIndices(file, indicesAccessor, static_cast<unsigned>(numVertices), out_indices) ||
+			out_indices.empty() || !IndicesInRange(&out_indices[0], static_cast<unsigned>(out_indices.size()), static_cast<unsigned>(numVertices)))
+			return false;
+
+		out_colors.assign(numVertices, glm::vec3(1.f));
+		if (ReadAccessor(file, GetInt(attributes, "COLOR_0", -1), 3, values) && values.size() == numVertices * 3)
+		{
+			for (size_t i = 0; i < numVertices; ++i)
+				out_colors[i] = glm::vec3(values[i * 3], values[i * 3 + 1], values[i * 3 + 2]);
+		}
+
+		if (ReadAccessor(file, GetInt(attributes, "NORMAL", -1), 3, values) && values.size() == numVertices * 3)
+		{
+			out_normals.resize(numVertices);
+			for (size_t i = 0; i < numVertices; ++i)
+				out_normals[i] = glm::vec3(values[i * 3], values[i * 3 + 1], values[i * 3 + 2]);
+		}
+		else if (mode == MODE_TRIANGLES)
+			ComputeNormals(out_indices, out_positions, out_normals);
+		else
+			out_normals.assign(numVertices, glm::vec3(0.f, 1.f, 0.f));
+
+		out_texCoords.assign(numVertices, glm::vec2(0.f));
+		if (ReadAccessor(file, GetInt(attributes, "TEXCOORD_0", -1), 2, values) && values.size() == numVertices * 2)
+		{
+			for (size_t i = 0; i < numVertices; ++i)
+				out_texCoords[i] = glm::vec2(values[i * 2], values[i * 2 + 1]);
+		}
+		return true;
+	}
+
+	// Returns NULL and says why if the primitive cannot be imported
+	Mesh* ImportRigid(const GLBFile& file, const std::string& name, const JsonValue& primitive, bool& out_zeroCopy)
+	{
+		const JsonValue* attributes = primitive.Find("attributes");
+		int mode = GetInt(primitive, "mode", MODE_TRIANGLES);
+		int indicesAccessor = GetInt(primitive, "indices", -1);
+		if (mode != MODE_TRIANGLES && mode != MODE_TRIANGLE_STRIP && mode != MODE_LINES)
+		{
+			std::cout << name << ": primitive mode " << mode << " is not supported\n";
+			return NULL;
+		}
+
+		Mesh* mesh = new Mesh(name);
+		mesh->mode = mode == MODE_TRIANGLE_STRIP ? Mesh::DRAW_TRIANGLE_STRIP : mode == MODE_LINES ? Mesh::DRAW_LINES : Mesh::DRAW_TRIANGLES;
+
+		unsigned vertexCount;
+		const unsigned char* vertices = MatchLayout(file, *attributes, VERTEX_LAYOUT, sizeof(VERTEX_LAYOUT) / sizeof(VERTEX_LAYOUT[0]), sizeof(Vertex), vertexCount);
+		const unsigned* indices = MatchIndices(file, indicesAccessor);
+		if (vertices && indices && IndicesInRange(indices, file.accessors[indicesAccessor].count, vertexCount))
+		{
+			mesh->Upload(reinterpret_cast<const Vertex*>(vertices), vertexCount, indices, file.accessors[indicesAccessor].count);
+			out_zeroCopy = true;
+			return mesh;
+		}
+
+		std::vector<glm::vec3> positions, colors, normals;
+		std::vector<glm::vec2> texCoords;
+		std::vector<unsigned> index_buffer_data;
+		if (!ReadVertices(file, *attributes, indicesAccessor, mode, positions, colors, normals, texCoords, index_buffer_data))
+		{
+			std::cout << name << ": primitive has invalid positions or indices\n";
+			delete mesh;
+			return NULL;
+		}
+
+		std::vector<Vertex> vertex_buffer_data(positions.size());
+		for (size_t i = 0; i < positions.size(); ++i)
+		{
+			vertex_buffer_data[i].pos = positions[i];
+			vertex_buffer_data[i].color = colors[i];
+			vertex_buffer_data[i].normal = normals[i];
+			vertex_buffer_data[i].texCoord = texCoords[i];
+		}
+		mesh->Upload(vertex_buffer_data, index_buffer_data);
+		out_zeroCopy = false;
+		return mesh;
+	}
+
+	SkinnedMesh* ImportSkinned(const GLBFile& file, const std::string& name, const JsonValue& primitive, bool& out_zeroCopy)
+	{
+		const JsonValue* attributes = primitive.Find("attributes");
+		int mode = GetInt(primitive, "mode", MODE_TRIANGLES);
+		int indicesAccessor = GetInt(primitive, "indices", -1);
+		if (mode != MODE_TRIANGLES)
+		{
+			std::cout << name << ": skinned primitives must be triangle lists\n";
+			return NULL;
+		}
+
+		SkinnedMesh* mesh = new SkinnedMesh(name);
+
+		unsigned vertexCount;
+		const unsigned char* vertices = MatchLayout(file, *attributes, SKINNED_VERTEX_LAYOUT, sizeof(SKINNED_VERTEX_LAYOUT) / sizeof(SKINNED_VERTEX_LAYOUT[0]), sizeof(SkinnedVertex), vertexCount);
+		const unsigned* indices = MatchIndices(file, indicesAccessor);
+		if (vertices && indices && IndicesInRange(indices, file.accessors[indicesAccessor].count, vertexCount))
+		{
+			// Bytes match the layout, but any joint past the palette would be read out of bounds
+			const SkinnedVertex* skinned = reinterpret_cast<const SkinnedVertex*>(vertices);
+			for (unsigned i = 0; i < vertexCount; ++i)
+			{
+				for (int j = 0; j < 4; ++j)
+				{
+					if (skinned[i].joints[j] >= UniformBlocks::MAX_SKIN_JOINTS)
+					{
+						std::cout << name << ": joint " << static_cast<unsigned>(skinned[i].joints[j]) << " is beyond the skin palette\n";
+						delete mesh;
+						return NULL;
+					}
+				}
+			}
+			// Upload keeps its own copy to renormalize the weights, so this is still a conversion
+			mesh->Upload(skinned, vertexCount, indices, file.accessors[indicesAccessor].count);
+			out_zeroCopy = false;
+			return mesh;
+		}
+
+		std::vector<glm::vec3> positions, colors, normals;
+		std::vector<glm::vec2> texCoords;
+		std::vector<unsigned> index_buffer_data;
+		std::vector<double> joints, weights;
+		if (!ReadVertices(file, *attributes, indicesAccessor, mode, positions, colors, normals, texCoords, index_buffer_data) ||
+			!ReadAccessor(file, GetInt(*attributes, "JOINTS_0", -1), 4, joints) || joints.size() != positions.size() * 4 ||
+			!ReadAccessor(file, GetInt(*attributes, "WEIGHTS_0", -1), 4, weights) || weights.size() != positions.size() * 4)
+		{
+			std::cout << name << ": skinned primitive has invalid attributes or indices\n";
+			delete mesh;
+			return NULL;
+		}
+
+		std::vector<SkinnedVertex> vertex_buffer_data(positions.size());
+		for (size_t i = 0; i < positions.size(); ++i)
+		{
+			SkinnedVertex& vertex = vertex_buffer_data[i];
+			vertex.pos = positions[i];
+			vertex.color = colors[i];
+			vertex.normal = normals[i];
+			vertex.texCoord = texCoords[i];
+			for (int j = 0; j < 4; ++j)
+			{
+				// The palette never holds more joints than fit a byte
+				if (joints[i * 4 + j] >= UniformBlocks::MAX_SKIN_JOINTS)
+				{
+					std::cout << name << ": joint " << joints[i * 4 + j] << " is beyond the skin palette\n";
+					delete mesh;
+					return NULL;
+				}
+				vertex.joints[j] = static_cast<unsigned char>(joints[i * 4 + j]);
+			}
+			vertex.weights = glm::vec4(weights[i * 4], weights[i * 4 + 1], weights[i * 4 + 2], weights[i * 4 + 3]);
+		}
+		mesh->Upload(vertex_buffer_data, index_buffer_data);
+		out_zeroCopy = false;
+		return mesh;
+	}
+
+	/******************************************************************************/
+	/*!
+	\brief
+	Metallic-roughness material to the Phong terms of the shading shaders:
+	base colour is the diffuse, specular goes from 4% grey to the base colour
+	as the surface turns metal, and roughness sets the highlight size
+	*/
+	/******************************************************************************/
+	Material ImportMaterial(const JsonValue& json)
+	{
+		float baseColor[4] = { 1.f, 1.f, 1.f, 1.f };
+		float emissive[3] = { 0.f, 0.f, 0.f };
+		float metallic = 1.f, roughness = 1.f;
+		const JsonValue* pbr = json.Find("pbrMetallicRoughness");
+		if (pbr)
+		{
+			GetFloats(*pbr, "baseColorFactor", baseColor, 4);
+			metallic = static_cast<float>(GetNumber(*pbr, "metallicFactor", 1.0));
+			roughness = static_cast<float>(GetNumber(*pbr, "roughnessFactor", 1.0));
+		}
+		GetFloats(json, "emissiveFactor", emissive, 3);
+
+		glm::vec3 base(baseColor[0], baseColor[1], baseColor[2]);
+		Material material;
+		material.kAmbient = base * 0.1f + glm::vec3(emissive[0], emissive[1], emissive[2]);
+		material.kDiffuse = base;
+		material.kSpecular = glm::mix(glm::vec3(0.04f), base, glm::clamp(metallic, 0.f, 1.f));
+		// Blinn-Phong exponent of about the same lobe as GGX with alpha = roughness^2
+		float alpha = std::max(roughness * roughness, 0.05f);
+		material.kShininess = std::min(2.f / (alpha * alpha) - 2.f, 256.f);
+		material.kShininess = std::max(material.kShininess, 1.f);
+		return material;
+	}
+
+	glm::mat4 ImportTransform(const JsonValue& json)
+	{
+		if (GetArray(json, "matrix").Size() == 16)
+		{
+			// Column major, as glm stores it
+			float matrix[16];
+			GetFloats(json, "matrix", matrix, 16);
+			return glm::make_mat4(matrix);
+		}
+
+		float translation[3] = { 0.f, 0.f, 0.f };
+		float rotation[4] = { 0.f, 0.f, 0.f, 1.f };	// x, y, z, w
+		float scale[3] = { 1.f, 1.f, 1.f };
+		GetFloats(json, "translation", translation, 3);
+		GetFloats(json, "rotation", rotation, 4);
+		GetFloats(json, "scale", scale, 3);
+
+		glm::mat4 local = glm::translate(glm::mat4(1.f), glm::vec3(translation[0], translation[1], translation[2]));
+		local *= glm::mat4_cast(glm::normalize(glm::quat(rotation[3], rotation[0], rotation[1], rotation[2])));
+		return glm::scale(local, glm::vec3(scale[0], scale[1], scale[2]));
+	}
+
+	unsigned ReadUint(const unsigned char* data)
+	{
+		unsigned value;
+		memcpy(&value, data, sizeof(value));
+		return value;
+	}
+}
+
+GLBModel::GLBModel()
+	: numZeroCopy(0)
+	, numConverted(0)
+{
+}
+
+GLBModel::~GLBModel()
+{
+	Clear();
+}
+
+void GLBModel::Clear(void)
+{
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		for (size_t j = 0; j < meshes[i].primitives.size(); ++j)
+		{
+			delete meshes[i].primitives[j].mesh;
+			delete meshes[i].primitives[j].skinnedMesh;
+		}
+	}
+	nodes.clear();
+	roots.clear();
+	meshes.clear();
+	materials.clear();
+	skins.clear();
+	numZeroCopy = numConverted = 0;
+}
+
+void GLBModel::AddToSceneGraph(SceneGraph& graph, std::vector<unsigned>& out_graphNodes) const
+{
+	out_graphNodes.assign(nodes.size(), static_cast<unsigned>(SceneGraph::NO_PARENT));
+	for (size_t i = 0; i < roots.size(); ++i)
+		AddNode(graph, roots[i], out_graphNodes);
+}
+
+void GLBModel::AddNode(SceneGraph& graph, int node, std::vector<unsigned>& out_graphNodes) const
+{
+	const GLBNode& n = nodes[node];
+	out_graphNodes[node] = graph.BeginNode(n.local);
+	if (n.mesh >= 0)
+	{
+		// Every rigid primitive is a child at the node's transform
+		const std::vector<GLBPrimitive>& primitives = meshes[n.mesh].primitives;
+		for (size_t i = 0; i < primitives.size(); ++i)
+		{
+			if (primitives[i].mesh)
+				graph.AddNode(glm::mat4(1.f), primitives[i].mesh, primitives[i].mesh->material);
+		}
+	}
+	for (size_t i = 0; i < n.children.size(); ++i)
+		AddNode(graph, n.children[i], out_graphNodes);
+	graph.EndNode();
+}
+
+/******************************************************************************/
+/*!
+\brief
+Import a binary glTF 2.0 file, mapping it rather than reading it
+
+\param file_path - the .glb file
+\param out_model - receives the model; left empty if the file is refused
+
+\return true if the file was imported
+*/
+/******************************************************************************/
+bool LoadGLB(
+	const char* file_path,
+	GLBModel& out_model
+)
+{
+	out_model.Clear();
+
+	MappedFile mapped;
+	if (!mapped.Open(file_path))
+	{
+		std::cout << "Impossible to open " << file_path << ". Are you in the right directory ?\n";
+		return false;
+	}
+
+	// 12 byte header, then chunks of length, type and data padded to 4 bytes: JSON, then an optional BIN
+	const unsigned char* data = mapped.GetData();
+	size_t size = mapped.GetSize();
+	if (size < 20 || ReadUint(data) != GLB_MAGIC || ReadUint(data + 4) != GLB_VERSION || ReadUint(data + 8) > size ||
+		ReadUint(data + 16) != CHUNK_JSON || ReadUint(data + 12) > size - 20)
+	{
+		std::cout << file_path << " is not a binary glTF 2.0 file\n";
+		return false;
+	}
+	size = ReadUint(data + 8);
+	size_t jsonSize = ReadUint(data + 12);
+	const char* json = reinterpret_cast<const char*>(data + 20);
+
+	GLBFile file;
+	file.bin = NULL;
+	file.binSize = 0;
+	size_t binChunk = 20 + ((jsonSize + 3) & ~static_cast<size_t>(3));
+	if (binChunk + 8 <= size && ReadUint(data + binChunk + 4) == CHUNK_BIN && ReadUint(data + binChunk) <= size - binChunk - 8)
+	{
+		file.bin = data + binChunk + 8;
+		file.binSize = ReadUint(data + binChunk);
+	}
+
+	JsonValue root;
+	JsonParser parser(json, json + jsonSize);
+	if (!parser.Parse(root) || root.type != JsonValue::JSON_OBJECT)
+	{
+		std::cout << file_path << " has invalid JSON\n";
+		return false;
+	}
+
+	const JsonValue& buffers = GetArray(root, "buffers");
+	for (size_t i = 0; i < buffers.Size(); ++i)
+	{
+		if (i > 0 || buffers.elements[i].Find("uri") || file.bin == NULL)
+		{
+			std::cout << file_path << ": only the buffer in the BIN chunk is supported\n";
+			return false;
+		}
+	}
+
+	const JsonValue& views = GetArray(root, "bufferViews");
+	file.views.resize(views.Size());
+	for (size_t i = 0; i < views.Size(); ++i)
+	{
+		const JsonValue& view = views.elements[i];
+		BufferView& out = file.views[i];
+		int offset = GetInt(view, "byteOffset", 0);
+		int length = GetInt(view, "byteLength", -1);
+		int stride = GetInt(view, "byteStride", 0);
+		out.offset = static_cast<size_t>(std::max(offset, 0));
+		out.length = static_cast<size_t>(std::max(length, 0));
+		out.stride = static_cast<unsigned>(std::max(stride, 0));
+		if (GetInt(view, "buffer", -1) != 0 || offset < 0 || length < 0 || stride < 0 || stride > 252 || out.offset > file.binSize || out.length > file.binSize - out.offset)
+		{
+			std::cout << file_path << ": buffer view " << i << " is outside the buffer\n";
+			return false;
+		}
+	}
+
+	const JsonValue& accessors = GetArray(root, "accessors");
+	file.accessors.resize(accessors.Size());
+	for (size_t i = 0; i < accessors.Size(); ++i)
+	{
+		if (!ParseAccessor(accessors.elements[i], file, file.accessors[i]))
+		{
+			std::cout << file_path << ": accessor " << i << " is invalid\n";
+			return false;
+		}
+	}
+
+	GLBModel& model = out_model;
+	const JsonValue& materials = GetArray(root, "materials");
+	for (size_t i = 0; i < materials.Size(); ++i)
+		model.materials.push_back(ImportMaterial(materials.elements[i]));
+
+	// glTF's default material: white, fully metal and fully rough
+	Material defaultMaterial = ImportMaterial(JsonValue());
+
+	const JsonValue& meshes = GetArray(root, "meshes");
+	model.meshes.resize(meshes.Size());
+	for (size_t i = 0; i < meshes.Size(); ++i)
+	{
+		GLBMesh& mesh = model.meshes[i];
+		mesh.name = GetString(meshes.elements[i], "name");
+		const JsonValue& primitives = GetArray(meshes.elements[i], "primitives");
+		for (size_t j = 0; j < primitives.Size(); ++j)
+		{
+			const JsonValue& primitive = primitives.elements[j];
+			const JsonValue* attributes = primitive.Find("attributes");
+			if (attributes == NULL || attributes->type != JsonValue::JSON_OBJECT)
+				continue;
+
+			GLBPrimitive out;
+			out.mesh = NULL;
+			out.skinnedMesh = NULL;
+			out.material = GetInt(primitive, "material", -1);
+			if (out.material >= static_cast<int>(model.materials.size()))
+				out.material = -1;
+
+			bool zeroCopy = false;
+			if (attributes->Find("JOINTS_0") && attributes->Find("WEIGHTS_0"))
+				out.skinnedMesh = ImportSkinned(file, mesh.name, primitive, zeroCopy);
+			else
+				out.mesh = ImportRigid(file, mesh.name, primitive, zeroCopy);
+			if (out.mesh == NULL && out.skinnedMesh == NULL)
+				continue;
+
+			const Material& material = out.material >= 0 ? model.materials[out.material] : defaultMaterial;
+			if (out.mesh)
+				out.mesh->material = material;
+			else
+				out.skinnedMesh->material = material;
+			if (zeroCopy)
+				++model.numZeroCopy;
+			else
+				++model.numConverted;
+			mesh.primitives.push_back(out);
+		}
+	}
+
+	const JsonValue& skins = GetArray(root, "skins");
+	const JsonValue& nodes = GetArray(root, "nodes");
+	model.skins.resize(skins.Size());
+	for (size_t i = 0; i < skins.Size(); ++i)
+	{
+		const JsonValue& skin = skins.elements[i];
+		GLBSkin& out = model.skins[i];
+		out.name = GetString(skin, "name");
+		const JsonValue& joints = GetArray(skin, "joints");
+		for (size_t j = 0; j < joints.Size(); ++j)
+		{
+			int joint = ToInt(&joints.elements[j], -1);
+			if (joint < 0 || joint >= static_cast<int>(nodes.Size()))
+			{
+				std::cout << file_path << ": skin " << i << " has an invalid joint\n";
+				model.Clear();
+				return false;
+			}
+			out.joints.push_back(joint);
+		}
+		if (out.joints.size() > UniformBlocks::MAX_SKIN_JOINTS)
+			std::cout << file_path << ": skin " << i << " has more joints than the skin palette holds\n";
+
+		// Without inverse bind matrices every joint is bound at the identity
+		out.inverseBindMatrices.assign(out.joints.size(), glm::mat4(1.f));
+		std::vector<double> values;
+		int inverseBind = GetInt(skin, "inverseBindMatrices", -1);
+		if (inverseBind >= 0 && ReadAccessor(file, inverseBind, 16, values) && values.size() >= out.joints.size() * 16)
+		{
+			for (size_t j = 0; j < out.joints.size(); ++j)
+			{
+				float matrix[16];
+				for (int k = 0; k < 16; ++k)
+					matrix[k] = static_cast<float>(values[j * 16 + k]);
+				out.inverseBindMatrices[j] = glm::make_mat4(matrix);
+			}
+		}
+	}
+
+	model.nodes.resize(nodes.Size());
+	for (size_t i = 0; i < nodes.Size(); ++i)
+	{
+		const JsonValue& node = nodes.elements[i];
+		GLBNode& out = model.nodes[i];
+		out.name = GetString(node, "name");
+		out.parent = -1;
+		out.local = ImportTransform(node);
+		out.mesh = GetInt(node, "mesh", -1);
+		out.skin = GetInt(node, "skin", -1);
+		if (out.mesh >= static_cast<int>(model.meshes.size()))
+			out.mesh = -1;
+		if (out.skin >= static_cast<int>(model.skins.size()))
+			out.skin = -1;
+	}
+
+	// A node with two parents would also be the only way to form a cycle
+	for (size_t i = 0; i < nodes.Size(); ++i)
+	{
+		const JsonValue& children = GetArray(nodes.elements[i], "children");
+		for (size_t j = 0; j < children.Size(); ++j)
+		{
+			int child = ToInt(&children.elements[j], -1);
+			if (child < 0 || child >= static_cast<int>(nodes.Size()) || model.nodes[child].parent >= 0 || child == static_cast<int>(i))
+			{
+				std::cout << file_path << ": node " << i << " is not part of a tree\n";
+				model.Clear();
+				return false;
+			}
+			model.nodes[child].parent = static_cast<int>(i);
+			model.nodes[i].children.push_back(child);
+		}
+	}
+
+	const JsonValue& scenes = GetArray(root, "scenes");
+	int scene = GetInt(root, "scene", 0);
+	if (scene >= 0 && scene < static_cast<int>(scenes.Size()))
+	{
+		const JsonValue& sceneNodes = GetArray(scenes.elements[scene], "nodes");
+		for (size_t i = 0; i < sceneNodes.Size(); ++i)
+		{
+			int node = ToInt(&sceneNodes.elements[i], -1);
+			if (node >= 0 && node < static_cast<int>(nodes.Size()) && model.nodes[node].parent < 0)
+				model.roots.push_back(node);
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < model.nodes.size(); ++i)
+		{
+			if (model.nodes[i].parent < 0)
+				model.roots.push_back(static_cast<int>(i));
+		}
+	}
+	return true;
+}
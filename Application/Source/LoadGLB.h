@@ -0,0 +1,89 @@
+#ifndef LOAD_GLB_H
+#define LOAD_GLB_H
+
+#include <string>
+#include <vector>
+#include "Mesh.h"
+#include "SkinnedMesh.h"
+#include "Material.h"
+
+class SceneGraph;
+
+// One draw of a glTF mesh; exactly one of mesh and skinnedMesh is set
+struct GLBPrimitive
+{
+	Mesh* mesh;
+	SkinnedMesh* skinnedMesh;
+	int material;	// into GLBModel::materials, or -1 for the default material
+};
+
+struct GLBMesh
+{
+	std::string name;
+	std::vector<GLBPrimitive> primitives;
+};
+
+struct GLBNode
+{
+	std::string name;
+	int parent;		// -1 for a root
+	std::vector<int> children;
+	glm::mat4 local;
+	int mesh;		// -1 if the node draws nothing
+	int skin;		// -1 unless the mesh follows a skin
+};
+
+struct GLBSkin
+{
+	std::string name;
+	std::vector<int> joints;	// node of every palette entry
+	std::vector<glm::mat4> inverseBindMatrices;
+};
+
+/******************************************************************************/
+/*!
+		Class GLBModel:
+\brief	Everything LoadGLB imports from a binary glTF 2.0 file: the node
+		hierarchy of the default scene, meshes uploaded to GL, materials and
+		skins. The model owns its meshes.
+*/
+/******************************************************************************/
+class GLBModel
+{
+public:
+	GLBModel();
+	~GLBModel();
+
+	void Clear(void);
+
+	// Adds the scene's nodes as SceneGraph nodes, drawing every rigid primitive.
+	// out_graphNodes[i] is the graph node of nodes[i], for joints and skinned draws.
+	void AddToSceneGraph(SceneGraph& graph, std::vector<unsigned>& out_graphNodes) const;
+
+	std::vector<GLBNode> nodes;
+	std::vector<int> roots;
+	std::vector<GLBMesh> meshes;
+	std::vector<Material> materials;
+	std::vector<GLBSkin> skins;
+
+	// Primitives whose vertices went from the file to GL as they were, and ones that had to be converted
+	unsigned numZeroCopy;
+	unsigned numConverted;
+
+private:
+	GLBModel(const GLBModel&);
+	GLBModel& operator=(const GLBModel&);
+
+	void AddNode(SceneGraph& graph, int node, std::vector<unsigned>& out_graphNodes) const;
+};
+
+// Binary glTF with its buffer in the file's BIN chunk; external and data URI
+// buffers, textures and morph targets are not read. A primitive whose
+// accessors already lay out Vertex or SkinnedVertex, with 32-bit indices,
+// goes from the mapped file to GL without a copy; others are converted.
+bool LoadGLB(
+	const char* file_path,
+	GLBModel& out_model
+);
+
+#endif
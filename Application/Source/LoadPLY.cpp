@@ -0,0 +1,492 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string.h>
+#include <algorithm>
+
+#include "LoadPLY.h"
+#include "MappedFile.h"
+
+namespace
+{
+	enum PLY_TYPE
+	{
+		PLY_INT8,
+		PLY_UINT8,
+		PLY_INT16,
+		PLY_UINT16,
+		PLY_INT32,
+		PLY_UINT32,
+		PLY_FLOAT32,
+		PLY_FLOAT64,
+		NUM_PLY_TYPES,
+	};
+
+	const unsigned PLY_TYPE_SIZE[NUM_PLY_TYPES] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+	// The original names and the sized ones later exporters write
+	const char* PLY_TYPE_NAMES[NUM_PLY_TYPES][2] =
+	{
+		{ "char", "int8" }, { "uchar", "uint8" }, { "short", "int16" }, { "ushort", "uint16" },
+		{ "int", "int32" }, { "uint", "uint32" }, { "float", "float32" }, { "double", "float64" },
+	};
+
+	// A file whose header runs longer than this is not taken for PLY
+	const size_t MAX_HEADER_SIZE = 1 << 16;
+
+	enum VERTEX_FIELD
+	{
+		FIELD_X,
+		FIELD_Y,
+		FIELD_Z,
+		FIELD_NX,
+		FIELD_NY,
+		FIELD_NZ,
+		FIELD_RED,
+		FIELD_GREEN,
+		FIELD_BLUE,
+		FIELD_S,
+		FIELD_T,
+		NUM_FIELDS,
+	};
+
+	const char* FIELD_NAMES[NUM_FIELDS][3] =
+	{
+		{ "x", "x", "x" }, { "y", "y", "y" }, { "z", "z", "z" },
+		{ "nx", "nx", "nx" }, { "ny", "ny", "ny" }, { "nz", "nz", "nz" },
+		{ "red", "r", "diffuse_red" }, { "green", "g", "diffuse_green" }, { "blue", "b", "diffuse_blue" },
+		{ "s", "u", "texture_u" }, { "t", "v", "texture_v" },
+	};
+
+	// White, unlit by any normal, at the texture origin
+	const float FIELD_DEFAULTS[NUM_FIELDS] = { 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 1.f, 1.f, 1.f, 0.f, 0.f };
+
+	struct Property
+	{
+		std::string name;
+		PLY_TYPE type;			// of the items, for a list
+		bool list;
+		PLY_TYPE countType;
+	};
+
+	struct Element
+	{
+		std::string name;
+		size_t count;
+		std::vector<Property> properties;
+	};
+
+	// Reads one value of a type in the file's byte order
+	typedef double (*ReadFunction)(const unsigned char* data);
+
+	// Where one vertex property is in the record and what it becomes
+	struct FieldDecoder
+	{
+		unsigned offset;
+		ReadFunction read;
+		VERTEX_FIELD field;
+		float scale;
+	};
+
+	bool ParseType(const std::string& name, PLY_TYPE& out_type)
+	{
+		for (int i = 0; i < NUM_PLY_TYPES; ++i)
+		{
+			if (name == PLY_TYPE_NAMES[i][0] || name == PLY_TYPE_NAMES[i][1])
+			{
+				out_type = static_cast<PLY_TYPE>(i);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template<typename T, bool SWAP>
+	double Read(const unsigned char* data)
+	{
+		unsigned char bytes[sizeof(T)];
+		for (unsigned i = 0; i < sizeof(T); ++i)
+			bytes[i] = data[SWAP ? sizeof(T) - 1 - i : i];
+		T value;
+		memcpy(&value, bytes, sizeof(T));
+		return value;
+	}
+
+	// Chosen once per property, so decoding a record does not switch on the type or byte order
+	ReadFunction GetReader(PLY_TYPE type, bool swap)
+	{
+		static const ReadFunction readers[2][NUM_PLY_TYPES] =
+		{
+			{
+				Read<signed char, false>, Read<unsigned char, false>, Read<short, false>, Read<unsigned short, false>,
+				Read<int, false>, Read<unsigned, false>, Read<float, false>, Read<double, false>,
+			},
+			{
+				Read<signed char, true>, Read<unsigned char, true>, Read<short, true>, Read<unsigned short, true>,
+				Read<int, true>, Read<unsigned, true>, Read<float, true>, Read<double, true>,
+			},
+		};
+		return readers[swap ? 1 : 0][type];
+	}
+
+	// Bytes in every record, or 0 if a list makes records vary
+	size_t RecordSize(const Element& element)
+	{
+		size_t size = 0;
+		for (size_t i = 0; i < element.properties.size(); ++i)
+		{
+			if (element.properties[i].list)
+				return 0;
+			size += PLY_TYPE_SIZE[element.properties[i].type];
+		}
+		return size;
+	}
+
+	/******************************************************************************/
+	/*!
+	\brief
+	Read the text header up to end_header
+
+	\param data - start of the file
+	\param size - size of the file
+	\param out_bigEndian - receives the byte order of the body
+	\param out_elements - receives the elements in file order
+	\param out_body - receives the offset of the binary body
+
+	\return false with a message if the file is not binary PLY
+	*/
+	/******************************************************************************/
+	bool ParseHeader(const char* file_path, const unsigned char* data, size_t size, bool& out_bigEndian, std::vector<Element>& out_elements, size_t& out_body)
+	{
+		const char* text = reinterpret_cast<const char*>(data);
+		size_t limit = std::min(size, MAX_HEADER_SIZE);
+		size_t lineStart = 0;
+		bool formatRead = false;
+		for (size_t i = 0; i < limit; ++i)
+		{
+			if (text[i] != '\n')
+				continue;
+
+			std::istringstream line(std::string(text + lineStart, text + i));
+			std::string keyword;
+			line >> keyword;
+			if (lineStart == 0 && keyword != "ply")
+				break;
+			lineStart = i + 1;
+
+			if (keyword == "format")
+			{
+				std::string format;
+				line >> format;
+				if (format == "ascii")
+				{
+					std::cout << file_path << " is ASCII PLY; only binary PLY is supported\n";
+					return false;
+				}
+				if (format != "binary_little_endian" && format != "binary_big_endian")
+					break;
+				out_bigEndian = format == "binary_big_endian";
+				formatRead = true;
+			}
+			else if (keyword == "element")
+			{
+				Element element;
+				long long count = -1;
+				line >> element.name >> count;
+				if (line.fail() || count < 0)
+					break;
+				element.count = static_cast<size_t>(count);
+				out_elements.push_back(element);
+			}
+			else if (keyword == "property")
+			{
+				if (out_elements.empty())
+					break;
+				Property property;
+				std::string type;
+				line >> type;
+				property.list = type == "list";
+				property.countType = PLY_UINT8;
+				if (property.list)
+				{
+					std::string countType;
+					line >> countType >> type;
+					if (!ParseType(countType, property.countType) || property.countType == PLY_FLOAT32 || property.countType == PLY_FLOAT64)
+						break;
+				}
+				line >> property.name;
+				if (line.fail() || !ParseType(type, property.type))
+					break;
+				out_elements.back().properties.push_back(property);
+			}
+			else if (keyword == "end_header")
+			{
+				if (!formatRead)
+					break;
+				out_body = lineStart;
+				return true;
+			}
+		}
+
+		std::cout << file_path << " is not a binary PLY file\n";
+		return false;
+	}
+
+	bool ReadVertices(const Element& element, const unsigned char* data, bool swap, std::vector<Vertex>& out_vertices, bool& out_hasNormals)
+	{
+		// The layout is worked out once, so each record is only a few loads at fixed offsets
+		std::vector<FieldDecoder> decoders;
+		bool found[NUM_FIELDS] = {};
+		unsigned offset = 0;
+		for (size_t i = 0; i < element.properties.size(); ++i)
+		{
+			const Property& property = element.properties[i];
+			for (int f = 0; f < NUM_FIELDS; ++f)
+			{
+				if (found[f] || (property.name != FIELD_NAMES[f][0] && property.name != FIELD_NAMES[f][1] && property.name != FIELD_NAMES[f][2]))
+					continue;
+				FieldDecoder decoder;
+				decoder.offset = offset;
+				decoder.read = GetReader(property.type, swap);
+				decoder.field = static_cast<VERTEX_FIELD>(f);
+				decoder.scale = 1.f;
+				// Integer colours are in steps of the type's range
+				if (f >= FIELD_RED && f <= FIELD_BLUE && property.type == PLY_UINT8)
+					decoder.scale = 1.f / 255.f;
+				else if (f >= FIELD_RED && f <= FIELD_BLUE && property.type == PLY_UINT16)
+					decoder.scale = 1.f / 65535.f;
+				decoders.push_back(decoder);
+				found[f] = true;
+				break;
+			}
+			offset += PLY_TYPE_SIZE[property.type];
+		}
+		if (!found[FIELD_X] || !found[FIELD_Y] || !found[FIELD_Z])
+			return false;
+		out_hasNormals = found[FIELD_NX] && found[FIELD_NY] && found[FIELD_NZ];
+
+		size_t stride = offset;
+		out_vertices.resize(element.count);
+		for (size_t i = 0; i < element.count; ++i)
+		{
+			const unsigned char* record = data + i * stride;
+			float fields[NUM_FIELDS];
+			memcpy(fields, FIELD_DEFAULTS, sizeof(fields));
+			for (size_t d = 0; d < decoders.size(); ++d)
+				fields[decoders[d].field] = static_cast<float>(decoders[d].read(record + decoders[d].offset)) * decoders[d].scale;
+
+			Vertex& vertex = out_vertices[i];
+			vertex.pos = glm::vec3(fields[FIELD_X], fields[FIELD_Y], fields[FIELD_Z]);
+			vertex.normal = glm::vec3(fields[FIELD_NX], fields[FIELD_NY], fields[FIELD_NZ]);
+			vertex.color = glm::vec3(fields[FIELD_RED], fields[FIELD_GREEN], fields[FIELD_BLUE]);
+			vertex.texCoord = glm::vec2(fields[FIELD_S], fields[FIELD_T]);
+		}
+		return true;
+	}
+
+	/******************************************************************************/
+	/*!
+	\brief
+	Walk the records of an element with lists, triangulating the face lists
+	as fans when indexList names one of its properties
+
+	\param element - the element
+	\param data - in: its first record; out: the byte after its last one
+	\param end - end of the file
+	\param swap - whether the body's byte order is the other one
+	\param indexList - property holding vertex indices, or -1 to only skip
+	\param numVertices - faces naming any other vertex are dropped
+	\param out_indices - triangles are appended here
+	\param out_dropped - counts the dropped faces
+
+	\return false if the records run past the end of the file
+	*/
+	/******************************************************************************/
+	bool ReadRecords(const Element& element, const unsigned char*& data, const unsigned char* end, bool swap, int indexList, size_t numVertices,
+		std::vector<unsigned>& out_indices, size_t& out_dropped)
+	{
+		std::vector<ReadFunction> readCount(element.properties.size()), readItem(element.properties.size());
+		for (size_t k = 0; k < element.properties.size(); ++k)
+		{
+			readCount[k] = GetReader(element.properties[k].countType, swap);
+			readItem[k] = GetReader(element.properties[k].type, swap);
+		}
+
+		std::vector<unsigned> polygon;
+		const unsigned char* p = data;
+		for (size_t r = 0; r < element.count; ++r)
+		{
+			for (size_t k = 0; k < element.properties.size(); ++k)
+			{
+				const Property& property = element.properties[k];
+				if (!property.list)
+				{
+					if (static_cast<size_t>(end - p) < PLY_TYPE_SIZE[property.type])
+						return false;
+					p += PLY_TYPE_SIZE[property.type];
+					continue;
+				}
+
+				if (static_cast<size_t>(end - p) < PLY_TYPE_SIZE[property.countType])
+					return false;
+				double count = readCount[k](p);
+				p += PLY_TYPE_SIZE[property.countType];
+				unsigned itemSize = PLY_TYPE_SIZE[property.type];
+				if (count < 0.0 || count > static_cast<double>(end - p) / itemSize)
+					return false;
+				size_t numItems = static_cast<size_t>(count);
+
+				if (static_cast<int>(k) == indexList)
+				{
+					bool valid = numItems >= 3;
+					polygon.resize(numItems);
+					for (size_t i = 0; i < numItems && valid; ++i)
+					{
+						double index = readItem[k](p + i * itemSize);
+						valid = index >= 0.0 && index < static_cast<double>(numVertices);
+						polygon[i] = static_cast<unsigned>(index);
+					}
+					if (valid)
+					{
+						for (size_t i = 2; i < numItems; ++i)
+						{
+							out_indices.push_back(polygon[0]);
+							out_indices.push_back(polygon[i - 1]);
+							out_indices.push_back(polygon[i]);
+						}
+					}
+					else
+						++out_dropped;
+				}
+				p += numItems * itemSize;
+			}
+		}
+		data = p;
+		return true;
+	}
+
+	// Area weighted, so large faces dominate the slivers scans are full of
+	void ComputeNormals(const std::vector<unsigned>& indices, std::vector<Vertex>& vertices)
+	{
+		for (size_t i = 0; i < vertices.size(); ++i)
+			vertices[i].normal = glm::vec3(0.f);
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			Vertex& a = vertices[indices[i]];
+			Vertex& b = vertices[indices[i + 1]];
+			Vertex& c = vertices[indices[i + 2]];
+			glm::vec3 face = glm::cross(b.pos - a.pos, c.pos - a.pos);
+			a.normal += face;
+			b.normal += face;
+			c.normal += face;
+		}
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			float length = glm::length(vertices[i].normal);
+			vertices[i].normal = length > 0.f ? vertices[i].normal / length : glm::vec3(0.f, 1.f, 0.f);
+		}
+	}
+}
+
+bool LoadPLY(
+	const char* file_path,
+	std::vector<Vertex>& out_vertices,
+	std::vector<unsigned>& out_indices
+)
+{
+	MappedFile file;
+	if (!file.Open(file_path))
+	{
+		std::cout << "Impossible to open " << file_path << ". Are you in the right directory ?\n";
+		return false;
+	}
+
+	const unsigned char* data = file.GetData();
+	const unsigned char* end = data + file.GetSize();
+	bool bigEndian = false;
+	std::vector<Element> elements;
+	size_t body = 0;
+	if (!ParseHeader(file_path, data, file.GetSize(), bigEndian, elements, body))
+		return false;
+
+	unsigned short one = 1;
+	bool hostBigEndian = *reinterpret_cast<unsigned char*>(&one) == 0;
+	bool swap = bigEndian != hostBigEndian;
+
+	std::vector<Vertex> vertices;
+	std::vector<unsigned> indices;
+	bool hasVertices = false, hasNormals = false;
+	size_t numDropped = 0;
+	const unsigned char* p = data + body;
+	for (size_t e = 0; e < elements.size(); ++e)
+	{
+		const Element& element = elements[e];
+		size_t recordSize = RecordSize(element);
+		if (element.name == "vertex" && !hasVertices)
+		{
+			if (recordSize == 0 || element.count > static_cast<size_t>(end - p) / recordSize ||
+				!ReadVertices(element, p, swap, vertices, hasNormals))
+			{
+				std::cout << file_path << ": vertex records need fixed size x, y and z properties within the file\n";
+				return false;
+			}
+			p += element.count * recordSize;
+			hasVertices = true;
+			continue;
+		}
+
+		if (recordSize > 0)
+		{
+			// Nothing to read from an element of fixed records but its size
+			if (element.count > static_cast<size_t>(end - p) / recordSize)
+			{
+				std::cout << file_path << " is truncated\n";
+				return false;
+			}
+			p += element.count * recordSize;
+			continue;
+		}
+
+		int indexList = -1;
+		if (element.name == "face")
+		{
+			for (size_t k = 0; k < element.properties.size() && indexList < 0; ++k)
+			{
+				const Property& property = element.properties[k];
+				if (property.list && (property.name == "vertex_indices" || property.name == "vertex_index") &&
+					property.type != PLY_FLOAT32 && property.type != PLY_FLOAT64)
+					indexList = static_cast<int>(k);
+			}
+			// Every face is at least a triangle of one byte count and three indices
+			size_t minFace = 1 + 3 * PLY_TYPE_SIZE[PLY_UINT8];
+			indices.reserve(std::min(element.count, static_cast<size_t>(end - p) / minFace) * 3);
+		}
+		if (!ReadRecords(element, p, end, swap, indexList, hasVertices ? vertices.size() : 0, indices, numDropped))
+		{
+			std::cout << file_path << " is truncated\n";
+			return false;
+		}
+	}
+
+	if (!hasVertices)
+	{
+		std::cout << file_path << " has no vertex element\n";
+		return false;
+	}
+	if (numDropped > 0)
+		std::cout << file_path << ": dropped " << numDropped << " faces with fewer than 3 or invalid vertices\n";
+
+	if (!hasNormals)
+	{
+		if (indices.empty())
+		{
+			for (size_t i = 0; i < vertices.size(); ++i)
+				vertices[i].normal = glm::vec3(0.f, 1.f, 0.f);
+		}
+		else
+			ComputeNormals(indices, vertices);
+	}
+
+	out_vertices.swap(vertices);
+	out_indices.swap(indices);
+	return true;
+}
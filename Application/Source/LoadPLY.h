@@ -0,0 +1,18 @@
+#ifndef LOAD_PLY_H
+#define LOAD_PLY_H
+
+#include <vector>
+#include "Vertex.h"
+
+// Binary PLY, little or big endian, read through a mapping of the file.
+// Vertices take x/y/z, nx/ny/nz, red/green/blue and s/t (or u/v) where
+// present; polygons are triangulated as fans. Missing normals are computed
+// from the faces. A file without faces is a point cloud and out_indices
+// is left empty.
+bool LoadPLY(
+	const char* file_path,
+	std::vector<Vertex>& out_vertices,
+	std::vector<unsigned>& out_indices
+);
+
+#endif
@@ -0,0 +1,367 @@
+#include <iostream>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <algorithm>
+
+#include "LoadSTL.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+namespace
+{
+	const size_t STL_HEADER_SIZE = 80;
+	const size_t STL_RECORD_SIZE = 50;		// normal, three corners, attribute byte count
+
+	// Corners or faces per task of the parallel passes
+	const unsigned WELD_CHUNK = 1 << 14;
+
+	const unsigned NO_VERTEX = 0xFFFFFFFF;
+
+	// Grid cell width over the weld distance; at least 2, and wider means fewer cells to search per corner
+	const float CELL_SIZE_IN_EPSILON = 8.f;
+
+	/******************************************************************************/
+	/*!
+			Struct WeldGrid:
+	\brief	Uniform grid hashed into buckets. Cells are at least twice the
+			weld distance across, so the neighbourhood of a corner overlaps
+			at most two of them per axis. Corners are counted into their
+			buckets in order, so each bucket lists its corners ascending.
+	*/
+	/******************************************************************************/
+	struct WeldGrid
+	{
+		glm::vec3 origin;
+		float inverseCellSize;
+		unsigned mask;
+		std::vector<unsigned> bucketStart;		// one more than the buckets; the last is the end
+		std::vector<unsigned> corners;
+		std::vector<glm::vec3> positions;		// of corners, for scanning a bucket without gathering
+
+		long long Cell(float value, float origin) const
+		{
+			double cell = floor((static_cast<double>(value) - origin) * inverseCellSize);
+			return static_cast<long long>(std::max(std::min(cell, 4e18), -4e18));
+		}
+
+		// Different cells can share a bucket; the search compares distances anyway
+		unsigned Bucket(long long x, long long y, long long z) const
+		{
+			unsigned long long key = static_cast<unsigned long long>(x) * 0x9E3779B97F4A7C15ull;
+			key ^= static_cast<unsigned long long>(y) * 0xC2B2AE3D27D4EB4Full;
+			key ^= static_cast<unsigned long long>(z) * 0x165667B19E3779F9ull;
+			return static_cast<unsigned>(key ^ (key >> 32)) & mask;
+		}
+	};
+
+	bool IsFinite(const glm::vec3& p)
+	{
+		return fabsf(p.x) <= FLT_MAX && fabsf(p.y) <= FLT_MAX && fabsf(p.z) <= FLT_MAX;
+	}
+}
+
+bool LoadSTL(
+	const char* file_path,
+	std::vector<glm::vec3>& out_corners
+)
+{
+	MappedFile file;
+	if (!file.Open(file_path))
+	{
+		std::cout << "Impossible to open " << file_path << ". Are you in the right directory ?\n";
+		return false;
+	}
+
+	const unsigned char* data = file.GetData();
+	size_t size = file.GetSize();
+	unsigned numTriangles = 0;
+	if (size >= STL_HEADER_SIZE + 4)
+		memcpy(&numTriangles, data + STL_HEADER_SIZE, sizeof(numTriangles));
+
+	// Binary files may also start with "solid", so the size decides
+	if (size < STL_HEADER_SIZE + 4 || numTriangles > (size - STL_HEADER_SIZE - 4) / STL_RECORD_SIZE)
+	{
+		if (size >= 5 && memcmp(data, "solid", 5) == 0)
+			std::cout << file_path << " is ASCII STL; only binary STL is supported\n";
+		else
+			std::cout << file_path << " is not a binary STL file\n";
+		return false;
+	}
+
+	// The stored normal is skipped: exporters often leave it zero, and the corners decide it anyway
+	std::vector<glm::vec3> corners(static_cast<size_t>(numTriangles) * 3);
+	const unsigned char* record = data + STL_HEADER_SIZE + 4;
+	for (unsigned t = 0; t < numTriangles; ++t, record += STL_RECORD_SIZE)
+		memcpy(&corners[t * 3], record + sizeof(glm::vec3), 3 * sizeof(glm::vec3));
+
+	out_corners.swap(corners);
+	return true;
+}
+
+/******************************************************************************/
+/*!
+\brief
+Weld corners closer than epsilon. Every corner's grid bucket is found in
+parallel and the corners counted into their buckets; then every corner,
+again in parallel, looks for the lowest numbered corner within epsilon in
+the buckets of the cells its neighbourhood overlaps. Chains of such links
+are followed in order afterwards.
+
+\param corners - positions to weld
+\param epsilon - largest distance welded; 0 welds exact copies only
+\param out_remap - receives the welded vertex of every corner
+\param out_positions - receives the position of every welded vertex
+
+\return number of welded vertices
+*/
+/******************************************************************************/
+unsigned WeldVertices(
+	const std::vector<glm::vec3>& corners,
+	float epsilon,
+	std::vector<unsigned>& out_remap,
+	std::vector<glm::vec3>& out_positions
+)
+{
+	unsigned count = static_cast<unsigned>(corners.size());
+	out_remap.resize(count);
+	out_positions.clear();
+	if (count == 0)
+		return 0;
+
+	glm::vec3 minimum(FLT_MAX), maximum(-FLT_MAX);
+	for (unsigned i = 0; i < count; ++i)
+	{
+		if (!IsFinite(corners[i]))
+			continue;
+		minimum = glm::min(minimum, corners[i]);
+		maximum = glm::max(maximum, corners[i]);
+	}
+	if (minimum.x > maximum.x)
+		minimum = maximum = glm::vec3(0.f);
+
+	// An exact weld still needs cells, so they get a size a million times smaller than the model
+	epsilon = std::max(epsilon, 0.f);
+	glm::vec3 extent = maximum - minimum;
+	float cellSize = std::max(std::max(CELL_SIZE_IN_EPSILON * epsilon, std::max(extent.x, std::max(extent.y, extent.z)) * 1e-6f), FLT_MIN);
+
+	WeldGrid grid;
+	grid.origin = minimum;
+	grid.inverseCellSize = 1.f / cellSize;
+	unsigned numBuckets = 16;
+	while (numBuckets < count && numBuckets < 0x80000000u)
+		numBuckets *= 2;
+	grid.mask = numBuckets - 1;
+
+	ThreadPool* pool = ThreadPool::GetInstance();
+	unsigned numChunks = (count + WELD_CHUNK - 1) / WELD_CHUNK;
+	std::vector<unsigned> buckets(count);
+	pool->Run(numChunks, [&](unsigned index, unsigned /*thread*/)
+	{
+		unsigned last = std::min(count, (index + 1) * WELD_CHUNK);
+		for (unsigned i = index * WELD_CHUNK; i < last; ++i)
+		{
+			// A corner that is not finite is never welded, so it goes in no bucket
+			const glm::vec3& p = corners[i];
+			buckets[i] = IsFinite(p) ? grid.Bucket(grid.Cell(p.x, grid.origin.x), grid.Cell(p.y, grid.origin.y), grid.Cell(p.z, grid.origin.z)) : NO_VERTEX;
+		}
+	});
+
+	grid.bucketStart.assign(numBuckets + 1, 0);
+	for (unsigned i = 0; i < count; ++i)
+	{
+		if (buckets[i] != NO_VERTEX)
+			++grid.bucketStart[buckets[i] + 1];
+	}
+	for (unsigned b = 0; b < numBuckets; ++b)
+		grid.bucketStart[b + 1] += grid.bucketStart[b];
+	grid.corners.resize(grid.bucketStart[numBuckets]);
+	grid.positions.resize(grid.bucketStart[numBuckets]);
+	std::vector<unsigned> fill(grid.bucketStart.begin(), grid.bucketStart.end() - 1);
+	for (unsigned i = 0; i < count; ++i)
+	{
+		if (buckets[i] == NO_VERTEX)
+			continue;
+		unsigned slot = fill[buckets[i]]++;
+		grid.corners[slot] = i;
+		grid.positions[slot] = corners[i];
+	}
+
+	std::vector<unsigned> representative(count);
+	float epsilonSquared = epsilon * epsilon;
+	pool->Run(numChunks, [&](unsigned index, unsigned /*thread*/)
+	{
+		unsigned last = std::min(count, (index + 1) * WELD_CHUNK);
+		for (unsigned i = index * WELD_CHUNK; i < last; ++i)
+		{
+			const glm::vec3& p = corners[i];
+			unsigned best = i;
+			if (buckets[i] != NO_VERTEX)
+			{
+				long long low[3], high[3];
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					low[axis] = grid.Cell(p[axis] - epsilon, grid.origin[axis]);
+					high[axis] = grid.Cell(p[axis] + epsilon, grid.origin[axis]);
+				}
+				for (long long x = low[0]; x <= high[0]; ++x)
+				{
+					for (long long y = low[1]; y <= high[1]; ++y)
+					{
+						for (long long z = low[2]; z <= high[2]; ++z)
+						{
+							// A bucket is in corner order, so the first corner close enough is its lowest
+							unsigned b = grid.Bucket(x, y, z);
+							for (unsigned e = grid.bucketStart[b]; e < grid.bucketStart[b + 1] && grid.corners[e] < best; ++e)
+							{
+								glm::vec3 d = grid.positions[e] - p;
+								if (glm::dot(d, d) <= epsilonSquared)
+								{
+									best = grid.corners[e];
+									break;
+								}
+							}
+						}
+					}
+				}
+			}
+			representative[i] = best;
+		}
+	});
+
+	// A corner only ever links to a lower one, so one pass in order reaches the end of every chain
+	for (unsigned i = 0; i < count; ++i)
+	{
+		if (representative[i] == i)
+		{
+			out_remap[i] = static_cast<unsigned>(out_positions.size());
+			out_positions.push_back(corners[i]);
+		}
+		else
+		{
+			representative[i] = representative[representative[i]];
+			out_remap[i] = out_remap[representative[i]];
+		}
+	}
+	return static_cast<unsigned>(out_positions.size());
+}
+
+/******************************************************************************/
+/*!
+\brief
+Build indexed triangles with crease angle normals from welded corners
+
+\param positions - welded vertex positions
+\param remap - welded vertex of every corner, three per triangle
+\param creaseAngle - faces meeting at a smaller angle, in degrees, share normals
+\param out_vertices - receives the vertices, split where normals differ
+\param out_indices - receives the triangle list
+
+\return number of degenerate triangles dropped
+*/
+/******************************************************************************/
+unsigned BuildCreasedMesh(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<unsigned>& remap,
+	float creaseAngle,
+	std::vector<Vertex>& out_vertices,
+	std::vector<unsigned>& out_indices
+)
+{
+	unsigned numTriangles = static_cast<unsigned>(remap.size() / 3);
+	unsigned numVertices = static_cast<unsigned>(positions.size());
+
+	// Area weighted face normals; a triangle without area has no direction to give
+	std::vector<unsigned> faces;
+	std::vector<glm::vec3> faceNormals(numTriangles), faceDirections(numTriangles);
+	for (unsigned t = 0; t < numTriangles; ++t)
+	{
+		unsigned a = remap[t * 3], b = remap[t * 3 + 1], c = remap[t * 3 + 2];
+		if (a == b || b == c || c == a || a >= numVertices || b >= numVertices || c >= numVertices)
+			continue;
+		glm::vec3 normal = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+		float length = glm::length(normal);
+		if (!(length > 0.f))
+			continue;
+		faceNormals[t] = normal;
+		faceDirections[t] = normal / length;
+		faces.push_back(t);
+	}
+
+	// Faces around every vertex, as offsets into one array
+	std::vector<unsigned> vertexFaceStart(numVertices + 1, 0), vertexFaces(faces.size() * 3);
+	for (size_t f = 0; f < faces.size(); ++f)
+	{
+		for (int k = 0; k < 3; ++k)
+			++vertexFaceStart[remap[faces[f] * 3 + k] + 1];
+	}
+	for (unsigned v = 0; v < numVertices; ++v)
+		vertexFaceStart[v + 1] += vertexFaceStart[v];
+	std::vector<unsigned> fill(vertexFaceStart.begin(), vertexFaceStart.end() - 1);
+	for (size_t f = 0; f < faces.size(); ++f)
+	{
+		for (int k = 0; k < 3; ++k)
+			vertexFaces[fill[remap[faces[f] * 3 + k]]++] = faces[f];
+	}
+
+	// Every corner sums the same faces in the same order, so corners that agree get bitwise equal normals
+	bool smooth = creaseAngle >= 180.f;
+	float cosCrease = cosf(glm::radians(std::max(creaseAngle, 0.f))) - 1e-6f;
+	std::vector<glm::vec3> cornerNormals(faces.size() * 3);
+	unsigned numChunks = static_cast<unsigned>((faces.size() + WELD_CHUNK - 1) / WELD_CHUNK);
+	ThreadPool::GetInstance()->Run(numChunks, [&](unsigned index, unsigned /*thread*/)
+	{
+		size_t last = std::min(faces.size(), static_cast<size_t>(index + 1) * WELD_CHUNK);
+		for (size_t f = static_cast<size_t>(index) * WELD_CHUNK; f < last; ++f)
+		{
+			unsigned t = faces[f];
+			for (int k = 0; k < 3; ++k)
+			{
+				unsigned v = remap[t * 3 + k];
+				glm::vec3 normal(0.f);
+				for (unsigned i = vertexFaceStart[v]; i < vertexFaceStart[v + 1]; ++i)
+				{
+					unsigned other = vertexFaces[i];
+					if (smooth || glm::dot(faceDirections[t], faceDirections[other]) >= cosCrease)
+						normal += faceNormals[other];
+				}
+				float length = glm::length(normal);
+				cornerNormals[f * 3 + k] = length > 0.f ? normal / length : faceDirections[t];
+			}
+		}
+	});
+
+	// One vertex per distinct normal at each welded vertex, chained from the welded vertex
+	std::vector<Vertex> vertices;
+	std::vector<unsigned> indices(faces.size() * 3);
+	std::vector<unsigned> first(numVertices, NO_VERTEX), next;
+	vertices.reserve(numVertices);
+	for (size_t f = 0; f < faces.size(); ++f)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			unsigned v = remap[faces[f] * 3 + k];
+			const glm::vec3& normal = cornerNormals[f * 3 + k];
+			unsigned out = first[v];
+			while (out != NO_VERTEX && vertices[out].normal != normal)
+				out = next[out];
+			if (out == NO_VERTEX)
+			{
+				out = static_cast<unsigned>(vertices.size());
+				Vertex vertex;
+				vertex.pos = positions[v];
+				vertex.color = glm::vec3(1.f);
+				vertex.normal = normal;
+				vertex.texCoord = glm::vec2(0.f);
+				vertices.push_back(vertex);
+				next.push_back(first[v]);
+				first[v] = out;
+			}
+			indices[f * 3 + k] = out;
+		}
+	}
+
+	out_vertices.swap(vertices);
+	out_indices.swap(indices);
+	return numTriangles - static_cast<unsigned>(faces.size());
+}
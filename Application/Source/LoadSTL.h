@@ -0,0 +1,38 @@
+#ifndef LOAD_STL_H
+#define LOAD_STL_H
+
+#include <vector>
+#include <glm\glm.hpp>
+#include "Vertex.h"
+
+// Binary STL: three corners per triangle, none of them shared
+bool LoadSTL(
+	const char* file_path,
+	std::vector<glm::vec3>& out_corners
+);
+
+// Merges corners closer than epsilon, found through a hashed uniform grid
+// and searched in parallel over chunks of corners. Each corner goes to the
+// lowest numbered corner near it, so the result does not depend on threads.
+// out_remap[c] is the welded vertex of corner c; returns the vertex count.
+unsigned WeldVertices(
+	const std::vector<glm::vec3>& corners,
+	float epsilon,
+	std::vector<unsigned>& out_remap,
+	std::vector<glm::vec3>& out_positions
+);
+
+// Indexed triangles over welded vertices. A corner's normal is averaged
+// over the faces around its vertex that meet its own face at less than
+// creaseAngle degrees, so 0 gives flat shading and 180 smooth; a vertex
+// is split once per distinct normal. Triangles welded into a line or a
+// point are dropped. Returns the number dropped.
+unsigned BuildCreasedMesh(
+	const std::vector<glm::vec3>& positions,
+	const std::vector<unsigned>& remap,
+	float creaseAngle,
+	std::vector<Vertex>& out_vertices,
+	std::vector<unsigned>& out_indices
+);
+
+#endif
@@ -2,6 +2,7 @@
 #include <iostream>
 #include <fstream>
 #include <GL\glew.h>
+#include "GLStateCache.h"
 
 #include "LoadTGA.h"
 
@@ -43,7 +44,7 @@ GLuint LoadTGA(const char *file_path)				// load TGA file to memory
 
 	glGenTextures(1, &texture);
 	glGenerateMipmap(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, texture);
+	GLStateCache::GetInstance()->BindTexture(GL_TEXTURE_2D, texture);
 	if(bytesPerPixel == 3)
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_BGR, GL_UNSIGNED_BYTE, data);
 	else //bytesPerPixel == 4
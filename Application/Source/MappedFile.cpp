@@ -0,0 +1,125 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile()
+	: data(NULL)
+	, size(0)
+#ifdef _WIN32
+	, file(INVALID_HANDLE_VALUE)
+	, mapping(NULL)
+#else
+	, file(-1)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+/******************************************************************************/
+/*!
+\brief
+Map the whole file for reading, closing any file mapped before
+
+\param file_path - file to map
+
+\return true if the file is mapped; an empty file cannot be
+*/
+/******************************************************************************/
+bool MappedFile::Open(const char* file_path)
+{
+	Close();
+
+#ifdef _WIN32
+	file = CreateFileA(file_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0 || static_cast<unsigned long long>(fileSize.QuadPart) > static_cast<size_t>(-1))
+	{
+		Close();
+		return false;
+	}
+
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		Close();
+		return false;
+	}
+
+	data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (data == NULL)
+	{
+		Close();
+		return false;
+	}
+	size = static_cast<size_t>(fileSize.QuadPart);
+#else
+	file = open(file_path, O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat status;
+	if (fstat(file, &status) != 0 || status.st_size <= 0)
+	{
+		Close();
+		return false;
+	}
+
+	void* view = mmap(NULL, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	if (view == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+	data = static_cast<const unsigned char*>(view);
+	size = static_cast<size_t>(status.st_size);
+#endif
+	return true;
+}
+
+void MappedFile::Close(void)
+{
+#ifdef _WIN32
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+	mapping = NULL;
+	file = INVALID_HANDLE_VALUE;
+#else
+	if (data)
+		munmap(const_cast<unsigned char*>(data), size);
+	if (file >= 0)
+		close(file);
+	file = -1;
+#endif
+	data = NULL;
+	size = 0;
+}
+
+const unsigned char* MappedFile::GetData(void) const
+{
+	return data;
+}
+
+size_t MappedFile::GetSize(void) const
+{
+	return size;
+}
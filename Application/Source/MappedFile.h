@@ -0,0 +1,41 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stddef.h>
+
+/******************************************************************************/
+/*!
+		Class MappedFile:
+\brief	Read-only view of a whole file through the virtual memory system.
+		The OS pages the file in as it is touched, so a loader can hand
+		parts of it straight to GL without reading them into a buffer of
+		its own first. The view stays valid until Close or destruction.
+*/
+/******************************************************************************/
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const char* file_path);
+	void Close(void);
+
+	const unsigned char* GetData(void) const;
+	size_t GetSize(void) const;
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	const unsigned char* data;
+	size_t size;
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#else
+	int file;
+#endif
+};
+
+#endif
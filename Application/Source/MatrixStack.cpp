@@ -1,86 +1,199 @@
 #include "MatrixStack.h"
+#include "SSE.h"
 
-MatrixStack::MatrixStack() 
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+
+#ifdef HAS_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace
 {
-	glm::mat4 mat(1.f);
-	ms.push(mat);
+	// One column of the top matrix; every kernel below is written in terms of these
+#ifdef HAS_SSE
+	typedef __m128 Column;
+	inline Column Load(const glm::mat4& m, int c) { return _mm_load_ps(&m[c][0]); }
+	inline void Store(glm::mat4& m, int c, Column v) { _mm_store_ps(&m[c][0], v); }
+	inline Column Mul(Column v, float s) { return _mm_mul_ps(v, _mm_set1_ps(s)); }
+	inline Column Add(Column a, Column b) { return _mm_add_ps(a, b); }
+	inline Column Sub(Column a, Column b) { return _mm_sub_ps(a, b); }
+#else
+	typedef glm::vec4 Column;
+	inline Column Load(const glm::mat4& m, int c) { return m[c]; }
+	inline void Store(glm::mat4& m, int c, Column v) { m[c] = v; }
+	inline Column Mul(Column v, float s) { return v * s; }
+	inline Column Add(Column a, Column b) { return a + b; }
+	inline Column Sub(Column a, Column b) { return a - b; }
+#endif
+
+	// Rotation in the plane of columns i and j, i.e. about the remaining axis
+	void RotatePlane(glm::mat4& m, int i, int j, float c, float s)
+	{
+		Column ci = Load(m, i);
+		Column cj = Load(m, j);
+		Store(m, i, Add(Mul(ci, c), Mul(cj, s)));
+		Store(m, j, Sub(Mul(cj, c), Mul(ci, s)));
+	}
 }
 
-MatrixStack::~MatrixStack() 
+MatrixStack::MatrixStack()
+	: top(0)
 {
+	Base()[0] = glm::mat4(1.f);
+}
 
+MatrixStack::MatrixStack(const MatrixStack& other)
+	: top(0)
+{
+	*this = other;
+}
+
+MatrixStack::~MatrixStack()
+{
+
+}
+
+MatrixStack& MatrixStack::operator=(const MatrixStack& other)
+{
+	// The aligned arrays may start at different offsets, so copy matrices rather than bytes
+	top = other.top;
+	for (unsigned i = 0; i <= top; ++i)
+		Base()[i] = other.Base()[i];
+	return *this;
+}
+
+glm::mat4* MatrixStack::Base()
+{
+	return reinterpret_cast<glm::mat4*>((reinterpret_cast<uintptr_t>(storage) + 63) & ~static_cast<uintptr_t>(63));
+}
+
+const glm::mat4* MatrixStack::Base() const
+{
+	return reinterpret_cast<const glm::mat4*>((reinterpret_cast<uintptr_t>(storage) + 63) & ~static_cast<uintptr_t>(63));
 }
 
-const glm::mat4& MatrixStack::Top() const 
+const glm::mat4& MatrixStack::Top() const
 {
-	return ms.top();
+	return Base()[top];
 }
 
-void MatrixStack::PopMatrix() 
+void MatrixStack::PopMatrix()
 {
-	ms.pop();
+	if (top == 0)
+	{
+		printf("MatrixStack: PopMatrix without a matching PushMatrix\n");
+		return;
+	}
+	--top;
 }
 
-void MatrixStack::PushMatrix() 
+void MatrixStack::PushMatrix()
 {
-	ms.push(ms.top());
+	if (top + 1 >= MAX_DEPTH)
+	{
+		printf("MatrixStack: PushMatrix deeper than %u\n", MAX_DEPTH);
+		return;
+	}
+
+	glm::mat4* base = Base();
+	const glm::mat4& src = base[top];
+	glm::mat4& dst = base[top + 1];
+	Store(dst, 0, Load(src, 0));
+	Store(dst, 1, Load(src, 1));
+	Store(dst, 2, Load(src, 2));
+	Store(dst, 3, Load(src, 3));
+	++top;
 }
 
-void MatrixStack::Clear() 
+void MatrixStack::Clear()
 {
-	while (ms.size() > 1)
-		ms.pop();
+	top = 0;
 }
 
-void MatrixStack::LoadIdentity() 
+void MatrixStack::LoadIdentity()
 {
-	glm::mat4 mat(1.f);
-	ms.top() = mat;
+	Base()[top] = glm::mat4(1.f);
 }
 
-void MatrixStack::LoadMatrix(const glm::mat4& matrix) 
+void MatrixStack::LoadMatrix(const glm::mat4& matrix)
 {
-	ms.top() = matrix;
+	Base()[top] = matrix;
 }
 
-void MatrixStack::MultMatrix(const glm::mat4& matrix) 
+void MatrixStack::MultMatrix(const glm::mat4& matrix)
 {
-	ms.top() = ms.top() * matrix;
+	glm::mat4& m = Base()[top];
+	m = m * matrix;
 }
 
 void MatrixStack::Rotate(float degrees, float axisX, float axisY, float axisZ) {
-	glm::mat4 mat = glm::rotate(
-		glm::mat4(1.f), 
-		glm::radians(degrees),
-		glm::vec3(axisX, axisY, axisZ) // the axis to rotate along
-	);
-	ms.top() = ms.top() * mat;
+	glm::mat4& m = Base()[top];
+	float radians = glm::radians(degrees);
+	float c = cosf(radians);
+	float s = sinf(radians);
+
+	// Rotations about a coordinate axis only mix two columns; the sign of the axis flips the angle
+	if (axisY == 0.f && axisZ == 0.f && axisX != 0.f)
+	{
+		RotatePlane(m, 1, 2, c, axisX > 0.f ? s : -s);
+		return;
+	}
+	if (axisX == 0.f && axisZ == 0.f && axisY != 0.f)
+	{
+		RotatePlane(m, 2, 0, c, axisY > 0.f ? s : -s);
+		return;
+	}
+	if (axisX == 0.f && axisY == 0.f && axisZ != 0.f)
+	{
+		RotatePlane(m, 0, 1, c, axisZ > 0.f ? s : -s);
+		return;
+	}
+
+	// Arbitrary axis: the 3x3 of glm::rotate applied to the first three columns; translation is unchanged
+	glm::vec3 axis = glm::normalize(glm::vec3(axisX, axisY, axisZ));
+	glm::vec3 temp = (1.f - c) * axis;
+	float r[3][3] =
+	{
+		{ c + temp.x * axis.x, temp.x * axis.y + s * axis.z, temp.x * axis.z - s * axis.y },
+		{ temp.y * axis.x - s * axis.z, c + temp.y * axis.y, temp.y * axis.z + s * axis.x },
+		{ temp.z * axis.x + s * axis.y, temp.z * axis.y - s * axis.x, c + temp.z * axis.z },
+	};
+	Column c0 = Load(m, 0);
+	Column c1 = Load(m, 1);
+	Column c2 = Load(m, 2);
+	for (int j = 0; j < 3; ++j)
+		Store(m, j, Add(Add(Mul(c0, r[j][0]), Mul(c1, r[j][1])), Mul(c2, r[j][2])));
 }
 
 void MatrixStack::Scale(float scaleX, float scaleY, float scaleZ) {
-	glm::mat4 mat = glm::scale(
-		glm::mat4(1.f),
-		glm::vec3(scaleX, scaleY, scaleZ)
-	);
-	ms.top() = ms.top() * mat;
+	glm::mat4& m = Base()[top];
+	Store(m, 0, Mul(Load(m, 0), scaleX));
+	Store(m, 1, Mul(Load(m, 1), scaleY));
+	Store(m, 2, Mul(Load(m, 2), scaleZ));
 }
 
-void MatrixStack::Translate(float translateX, float translateY, float translateZ) 
+void MatrixStack::Translate(float translateX, float translateY, float translateZ)
 {
-	glm::mat4 mat = glm::translate( glm::mat4(1.f), glm::vec3(translateX, translateY, translateZ ) );
-	ms.top() = ms.top() * mat;
+	// Only the last column changes: it gains x, y and z times the first three
+	glm::mat4& m = Base()[top];
+	Column t = Add(Add(Mul(Load(m, 0), translateX), Mul(Load(m, 1), translateY)), Add(Mul(Load(m, 2), translateZ), Load(m, 3)));
+	Store(m, 3, t);
 }
 
-void MatrixStack::Frustum(double left, double right, double bottom, double top, double near, double far) 
+void MatrixStack::Frustum(double left, double right, double bottom, double top, double near, double far)
 {
 	glm::mat4 mat = glm::frustum(left, right, bottom, top, near, far);
-	ms.top() = ms.top() * mat;
+	glm::mat4& m = Base()[this->top];
+	m = m * mat;
 }
 
 void MatrixStack::LookAt(double eyeX, double eyeY, double eyeZ, double centerX, double centerY, double centerZ, double upX, double upY, double upZ)
 {
 	glm::mat4 mat = glm::lookAt( glm::vec3(eyeX, eyeY, eyeZ), glm::vec3(centerX, centerY, centerZ), glm::vec3(upX, upY, upZ) );
-	ms.top() = ms.top() * mat;
+	glm::mat4& m = Base()[top];
+	m = m * mat;
 }
 
 
@@ -6,15 +6,30 @@
 #include <glm\gtc\matrix_transform.hpp>
 #include <glm\gtc\type_ptr.hpp>
 
-#include <stack>
-
-
+/******************************************************************************/
+/*!
+		Class MatrixStack:
+\brief	Fixed-capacity stack of matrices stored inline in a cache-line
+		aligned array, so pushes and pops never touch the heap. Translate,
+		Scale and Rotate only update the columns they change instead of
+		building a 4x4 and doing a full product, and PushMatrix copies the
+		top with aligned SSE moves.
+
+		Deeper than MAX_DEPTH is a programming error; it is reported and
+		the push is ignored rather than writing past the array.
+*/
+/******************************************************************************/
 class MatrixStack
 {
 public:
+	static const unsigned MAX_DEPTH = 32;
+
 	MatrixStack();
+	MatrixStack(const MatrixStack& other);
 	~MatrixStack();
 
+	MatrixStack& operator=(const MatrixStack& other);
+
 	const glm::mat4& Top() const;
 
 	void PopMatrix();
@@ -40,10 +55,13 @@ public:
 	void LookAt(double eyeX, double eyeY, double eyeZ, double centerX, double centerY, double centerZ, double upX, double upY, double upZ);
 
 private:
-	std::stack<glm::mat4> ms;
+	// The object itself may sit anywhere the heap puts it, so the array is aligned inside the storage
+	glm::mat4* Base();
+	const glm::mat4* Base() const;
+
+	unsigned char storage[MAX_DEPTH * sizeof(glm::mat4) + 63];
+	unsigned top;	// index of the top matrix
 };
 
 
 #endif
-
-
@@ -1,12 +1,16 @@
 
 #include "Mesh.h"
 #include "GL\glew.h"
+#include "GLStateCache.h"
 #include "Vertex.h"
+#include "Stripifier.h"
+
+#include <algorithm>
 
 /******************************************************************************/
 /*!
 \brief
-Default constructor - generate VBO/IBO here
+Default constructor - the vertex and index data are placed by Upload
 
 \param meshName - name of mesh
 */
@@ -14,70 +18,144 @@ Default constructor - generate VBO/IBO here
 Mesh::Mesh(const std::string &meshName)
 	: name(meshName)
 	, mode(DRAW_TRIANGLES)
+	, vertexArray(0)
+	, indexSize(0)
+	, boundsCenter(0.f)
+	, boundsRadius(0.f)
 	, textureID(0)
 {
-	glGenBuffers(1, &vertexBuffer);
-	glGenBuffers(1, &indexBuffer);
 }
 
 /******************************************************************************/
 /*!
 \brief
-Destructor - delete VBO/IBO here
+Destructor - return the arena range here
 */
 /******************************************************************************/
 Mesh::~Mesh()
 {
-	glDeleteBuffers(1, &vertexBuffer);
-	glDeleteBuffers(1, &indexBuffer);
+	GeometryArena::GetInstance()->Free(&allocation);
 
 	if (textureID > 0)
 	{
-		glDeleteTextures(1, &textureID);
+		GLStateCache::GetInstance()->DeleteTexture(textureID);
 	}	
 }
 
 /******************************************************************************/
 /*!
 \brief
-OpenGL render code
+Copy the vertex and index data into the shared GeometryArena
+
+\param vertices - vertex data
+\param indices - indices relative to the first vertex of this mesh
 */
 /******************************************************************************/
-void Mesh::Render()
+void Mesh::Upload(const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices)
 {
-	glEnableVertexAttribArray(0); // 1st attribute buffer : positions
-	glEnableVertexAttribArray(1); // 2nd attribute buffer : colors
-	glEnableVertexAttribArray(2); // 3rd attribute : normals
-								// 4th attribute : texture coordinate
-	if (textureID > 0)
+	Upload(vertices.empty() ? NULL : &vertices[0], static_cast<unsigned>(vertices.size()),
+		indices.empty() ? NULL : &indices[0], static_cast<unsigned>(indices.size()));
+}
+
+/******************************************************************************/
+/*!
+\brief
+Copy the vertex and index data into the shared GeometryArena straight from
+memory the mesh does not own, such as a mapped model file
+
+\param vertices - vertex data
+\param vertexCount - number of vertices
+\param indices - indices relative to the first vertex of this mesh
+\param indexCount - number of indices
+*/
+/******************************************************************************/
+void Mesh::Upload(const Vertex* vertices, unsigned vertexCount, const unsigned* indices, unsigned indexCount)
+{
+	// Sphere around the box centre; not the tightest, but cheap and good enough for culling
+	glm::vec3 minimum(0.f), maximum(0.f);
+	for (unsigned i = 0; i < vertexCount; ++i)
 	{
-		glEnableVertexAttribArray(3);
+		minimum = i == 0 ? vertices[i].pos : glm::min(minimum, vertices[i].pos);
+		maximum = i == 0 ? vertices[i].pos : glm::max(maximum, vertices[i].pos);
 	}
+	boundsCenter = (minimum + maximum) * 0.5f;
+	boundsRadius = 0.f;
+	for (unsigned i = 0; i < vertexCount; ++i)
+		boundsRadius = std::max(boundsRadius, glm::length(vertices[i].pos - boundsCenter));
 
-	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)sizeof(glm::vec3));
-	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-		(void*)(sizeof(glm::vec3) + sizeof(glm::vec3)));
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
-	if (textureID > 0)
-		glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-			(void*)(sizeof(glm::vec3) + sizeof(glm::vec3) + sizeof(glm::vec3)));
+	GeometryArena* arena = GeometryArena::GetInstance();
+	arena->Free(&allocation);
+	if (arena->Allocate(vertices, vertexCount, indices, indexCount, &allocation))
+	{
+		vertexArray = arena->GetVertexArray(allocation.page);
+		indexSize = allocation.indexCount;
+	}
+	else
+	{
+		vertexArray = 0;
+		indexSize = 0;
+	}
+}
+
+/******************************************************************************/
+/*!
+\brief
+OpenGL render code
+*/
+/******************************************************************************/
+void Mesh::Render()
+{
+	if (indexSize == 0)
+		return;
 
-	
+	GLStateCache* state = GLStateCache::GetInstance();
 
-	if (mode == DRAW_TRIANGLE_STRIP)
-		glDrawElements(GL_TRIANGLE_STRIP, indexSize, GL_UNSIGNED_INT, 0);
-	else if (mode == DRAW_LINES)
-		glDrawElements(GL_LINES, indexSize, GL_UNSIGNED_INT, 0);
-	else
-		glDrawElements(GL_TRIANGLES, indexSize, GL_UNSIGNED_INT, 0);
+	// Meshes on the same arena page share this VAO, so the state cache drops repeated binds
+	state->BindVertexArray(vertexArray);
 
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
-	glDisableVertexAttribArray(2);
-	if (textureID > 0)
+	void* firstIndex = (void*)(allocation.firstIndex * sizeof(GLuint));
+	GLint baseVertex = static_cast<GLint>(allocation.baseVertex);
+
+	glDrawElementsBaseVertex(BeginDraw(mode), indexSize, GL_UNSIGNED_INT, firstIndex, baseVertex);
+}
+
+/******************************************************************************/
+/*!
+\brief
+GL primitive a mesh of the given mode is drawn with; turns primitive restart
+on for restart strips, and leaves it on
+
+\param mode - draw mode of the mesh
+
+\return GL primitive mode to pass to the draw call
+*/
+/******************************************************************************/
+unsigned Mesh::BeginDraw(DRAW_MODE mode)
+{
+	switch (mode)
+	{
+	case DRAW_TRIANGLE_STRIP:
+		return GL_TRIANGLE_STRIP;
+	case DRAW_TRIANGLE_STRIP_RESTART:
 	{
-		glDisableVertexAttribArray(3);
+		// Fixed index restart is GL 4.3 / ES3 compatibility; GL 3.1 has an explicit index.
+		// Restart is checked before baseVertex is added, so arena offsets do not affect it.
+		// It is left enabled: no other mesh uses index 0xFFFFFFFF, and consecutive strip meshes skip the toggle.
+		GLStateCache* state = GLStateCache::GetInstance();
+		if (GLEW_ARB_ES3_compatibility)
+			state->Enable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+		else
+		{
+			state->Enable(GL_PRIMITIVE_RESTART);
+			state->PrimitiveRestartIndex(STRIP_RESTART_INDEX);
+		}
+		return GL_TRIANGLE_STRIP;
 	}
-}
\ No newline at end of file
+	case DRAW_LINES:
+		return GL_LINES;
+	case DRAW_POINTS:
+		return GL_POINTS;
+	default:
+		return GL_TRIANGLES;
+	}
+}
@@ -2,11 +2,13 @@
 #define MESH_H
 
 #include <string>
+#include <vector>
 #include "Material.h"
+#include "GeometryArena.h"
 /******************************************************************************/
 /*!
 		Class Mesh:
-\brief	To store VBO (vertex & color buffer) and IBO (index buffer)
+\brief	To store the mesh's range of vertex and index data in the GeometryArena
 */
 /******************************************************************************/
 class Mesh
@@ -18,18 +20,26 @@ public:
 	{
 		DRAW_TRIANGLES, //default mode
 		DRAW_TRIANGLE_STRIP,
+		DRAW_TRIANGLE_STRIP_RESTART, //strips separated by STRIP_RESTART_INDEX
 		DRAW_LINES,
+		DRAW_POINTS,
 		DRAW_MODE_LAST,
 	};
 	Mesh(const std::string &meshName);
 	~Mesh();
+	void Upload(const std::vector<Vertex>& vertices, const std::vector<unsigned>& indices);
+	void Upload(const Vertex* vertices, unsigned vertexCount, const unsigned* indices, unsigned indexCount);
 	void Render();
+	// GL primitive to draw mode with; enables primitive restart when mode needs it
+	static unsigned BeginDraw(DRAW_MODE mode);
 
 	const std::string name;
 	DRAW_MODE mode;
-	unsigned vertexBuffer;
-	unsigned indexBuffer;
+	unsigned vertexArray;	// VAO of the arena page holding the mesh
 	unsigned indexSize;
+	GeometryArena::Allocation allocation;
+	glm::vec3 boundsCenter;	// Bounding sphere in model space, set by Upload
+	float boundsRadius;
 
 	Material material;
 	unsigned textureID;
@@ -1,6 +1,10 @@
 #include "MeshBuilder.h"
+#include "Stripifier.h"
 #include <GL\glew.h>
 #include <vector>
+#include <algorithm>
+#include <float.h>
+#include <math.h>
 #include <glm\gtc\constants.hpp>
 
 
@@ -61,13 +65,7 @@ Mesh* MeshBuilder::GenerateAxes(const std::string &meshName, float lengthX, floa
 	index_buffer_data.push_back(5);
 
 	Mesh *mesh = new Mesh(meshName);
-
-	glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer);
-	glBufferData(GL_ARRAY_BUFFER, vertex_buffer_data.size() * sizeof(Vertex), &vertex_buffer_data[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_buffer_data.size() * sizeof(GLuint), &index_buffer_data[0], GL_STATIC_DRAW);
-
-	mesh->indexSize = index_buffer_data.size();
+	mesh->Upload(vertex_buffer_data, index_buffer_data);
 	mesh->mode = Mesh::DRAW_LINES;
 
 	return mesh;
@@ -108,13 +106,7 @@ Mesh* MeshBuilder::GenerateQuad(const std::string &meshName, glm::vec3 color, fl
 
 	// Create the new mesh
 	Mesh* mesh = new Mesh(meshName);
-
-	glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer);
-	glBufferData(GL_ARRAY_BUFFER, vertex_buffer_data.size() * sizeof(Vertex), &vertex_buffer_data[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_buffer_data.size() * sizeof(GLuint), &index_buffer_data[0], GL_STATIC_DRAW);
-
-	mesh->indexSize = index_buffer_data.size();
+	mesh->Upload(vertex_buffer_data, index_buffer_data);
 	mesh->mode = Mesh::DRAW_TRIANGLE_STRIP;
 
 	return mesh;
@@ -188,19 +180,14 @@ Mesh* MeshBuilder::GenerateCylinder(const std::string& meshName, glm::vec3 color
 		index_buffer_data.push_back(numSlice + 1 + i);
 	}
 
+	// The faces above are a triangle list; merge them into restarted strips
+	std::vector<GLuint> strip_buffer_data;
+	Stripify(index_buffer_data, strip_buffer_data);
+
 	// Create the new mesh
 	Mesh* mesh = new Mesh(meshName);
-
-	glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer);
-	glBufferData(GL_ARRAY_BUFFER, vertex_buffer_data.size() * sizeof(Vertex),
-		&vertex_buffer_data[0], GL_STATIC_DRAW);
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_buffer_data.size() * sizeof(GLuint),
-		&index_buffer_data[0], GL_STATIC_DRAW);
-
-	mesh->indexSize = index_buffer_data.size();
-	mesh->mode = Mesh::DRAW_TRIANGLE_STRIP;
+	mesh->Upload(vertex_buffer_data, strip_buffer_data);
+	mesh->mode = Mesh::DRAW_TRIANGLE_STRIP_RESTART;
 
 	return mesh;
 
@@ -236,26 +223,20 @@ Mesh* MeshBuilder::GenerateSphere(const std::string& meshName, glm::vec3 color,
 
 	for (unsigned stack = 0; stack < numStack; ++stack)
 	{
+		// One strip per stack, restarted instead of wrapping into the next stack
+		if (stack > 0)
+			index_buffer_data.push_back(STRIP_RESTART_INDEX);
 		for (unsigned slice = 0; slice < numSlice + 1; ++slice)
 		{
-			index_buffer_data.push_back((numStack + 1) * stack + slice);
-			index_buffer_data.push_back((numStack + 1) * (stack + 1) + slice);
+			index_buffer_data.push_back((numSlice + 1) * stack + slice);
+			index_buffer_data.push_back((numSlice + 1) * (stack + 1) + slice);
 		}
 	}
 
 	// Create the new mesh
 	Mesh* mesh = new Mesh(meshName);
-
-	glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer);
-	glBufferData(GL_ARRAY_BUFFER, vertex_buffer_data.size() * sizeof(Vertex),
-		&vertex_buffer_data[0], GL_STATIC_DRAW);
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_buffer_data.size() * sizeof(GLuint),
-		&index_buffer_data[0], GL_STATIC_DRAW);
-
-	mesh->indexSize = index_buffer_data.size();
-	mesh->mode = Mesh::DRAW_TRIANGLE_STRIP;
+	mesh->Upload(vertex_buffer_data, index_buffer_data);
+	mesh->mode = Mesh::DRAW_TRIANGLE_STRIP_RESTART;
 
 	return mesh;
 }
@@ -286,24 +267,20 @@ Mesh* MeshBuilder::GenerateTorus(const std::string& meshName, glm::vec3 color, f
 
 	for (unsigned stack = 0; stack < numStack; stack ++)
 	{
+		// One strip per stack, restarted instead of wrapping into the next stack
+		if (stack > 0)
+			index_buffer_data.push_back(STRIP_RESTART_INDEX);
 		for (unsigned slice = 0; slice < numSlice + 1; slice++)
 		{
-			index_buffer_data.push_back((numStack + 1) * stack + slice);
-			index_buffer_data.push_back((numStack + 1) * (stack + 1) + slice);
+			index_buffer_data.push_back((numSlice + 1) * stack + slice);
+			index_buffer_data.push_back((numSlice + 1) * (stack + 1) + slice);
 		}
 	}
 
 	//Create the new mesh
 	Mesh* mesh = new Mesh(meshName);
-
-	glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer);
-	glBufferData(GL_ARRAY_BUFFER, vertex_buffer_data.size() * sizeof(Vertex), &vertex_buffer_data[0], GL_STATIC_DRAW);
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_buffer_data.size() * sizeof(GLuint), &index_buffer_data[0], GL_STATIC_DRAW);
-
-	mesh->indexSize = index_buffer_data.size();
-	mesh->mode = Mesh::DRAW_TRIANGLE_STRIP;
+	mesh->Upload(vertex_buffer_data, index_buffer_data);
+	mesh->mode = Mesh::DRAW_TRIANGLE_STRIP_RESTART;
 
 	return mesh;
 }
@@ -369,26 +346,21 @@ Mesh* MeshBuilder::GenerateCube(const std::string& meshName, glm::vec3 color, fl
 		index_buffer_data.push_back(numSlice + 1 + i);
 	}
 
+	// The faces above are a triangle list; merge them into restarted strips
+	std::vector<GLuint> strip_buffer_data;
+	Stripify(index_buffer_data, strip_buffer_data);
+
 	// Create the new mesh
 	Mesh* mesh = new Mesh(meshName);
-
-	glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer);
-	glBufferData(GL_ARRAY_BUFFER, vertex_buffer_data.size() * sizeof(Vertex),
-		&vertex_buffer_data[0], GL_STATIC_DRAW);
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_buffer_data.size() * sizeof(GLuint),
-		&index_buffer_data[0], GL_STATIC_DRAW);
-
-	mesh->indexSize = index_buffer_data.size();
-	mesh->mode = Mesh::DRAW_TRIANGLE_STRIP;
+	mesh->Upload(vertex_buffer_data, strip_buffer_data);
+	mesh->mode = Mesh::DRAW_TRIANGLE_STRIP_RESTART;
 
 	return mesh;
 
 
 }
 
-Mesh* MeshBuilder::GenerateOBJ(const std::string& meshName, const std::string& file_path)
+Mesh* MeshBuilder::GenerateOBJ(const std::string& meshName, const std::string& file_path, bool stripify)
 {
 	// Read vertices, texcoords & normals from OBJ
 	std::vector<glm::vec3> vertices;
@@ -403,13 +375,185 @@ Mesh* MeshBuilder::GenerateOBJ(const std::string& meshName, const std::string& f
 	std::vector<GLuint> index_buffer_data;
 	IndexVBO(vertices, uvs, normals, index_buffer_data, vertex_buffer_data);
 
+	return GenerateIndexed(meshName, vertex_buffer_data, index_buffer_data, stripify);
+}
+
+Mesh* MeshBuilder::GeneratePLY(const std::string& meshName, const std::string& file_path, bool stripify)
+{
+	// Already indexed in the file, so there is nothing to weld
+	std::vector<Vertex> vertex_buffer_data;
+	std::vector<GLuint> index_buffer_data;
+	bool success = LoadPLY(file_path.c_str(), vertex_buffer_data, index_buffer_data);
+
+	if (!success || vertex_buffer_data.empty()) { return NULL; }
+
+	if (index_buffer_data.empty())
+	{
+		// A point cloud: every vertex once, in file order
+		index_buffer_data.resize(vertex_buffer_data.size());
+		for (size_t i = 0; i < index_buffer_data.size(); ++i)
+			index_buffer_data[i] = static_cast<GLuint>(i);
+
+		Mesh* mesh = new Mesh(meshName);
+		mesh->Upload(vertex_buffer_data, index_buffer_data);
+		mesh->mode = Mesh::DRAW_POINTS;
+		return mesh;
+	}
+
+	return GenerateIndexed(meshName, vertex_buffer_data, index_buffer_data, stripify);
+}
+
+Mesh* MeshBuilder::GenerateSTL(const std::string& meshName, const std::string& file_path, float creaseAngle, bool stripify)
+{
+	// Corners closer than this fraction of the bounding box diagonal are one vertex
+	const float weldTolerance = 1e-6f;
+
+	std::vector<glm::vec3> corners;
+	if (!LoadSTL(file_path.c_str(), corners) || corners.empty()) { return NULL; }
+
+	glm::vec3 minimum(FLT_MAX), maximum(-FLT_MAX);
+	for (size_t i = 0; i < corners.size(); ++i)
+	{
+		const glm::vec3& corner = corners[i];
+		if (!(fabsf(corner.x) <= FLT_MAX && fabsf(corner.y) <= FLT_MAX && fabsf(corner.z) <= FLT_MAX)) { continue; }
+		minimum = glm::min(minimum, corner);
+		maximum = glm::max(maximum, corner);
+	}
+	float epsilon = minimum.x <= maximum.x ? glm::length(maximum - minimum) * weldTolerance : 0.f;
+
+	std::vector<unsigned> remap;
+	std::vector<glm::vec3> positions;
+	WeldVertices(corners, epsilon, remap, positions);
+
+	std::vector<Vertex> vertex_buffer_data;
+	std::vector<GLuint> index_buffer_data;
+	BuildCreasedMesh(positions, remap, creaseAngle, vertex_buffer_data, index_buffer_data);
+
+	if (index_buffer_data.empty()) { return NULL; }
+
+	return GenerateIndexed(meshName, vertex_buffer_data, index_buffer_data, stripify);
+}
+
+// The shared tail of the file importers: a triangle list, optionally merged into restarted strips
+Mesh* MeshBuilder::GenerateIndexed(const std::string& meshName, const std::vector<Vertex>& vertex_buffer_data, std::vector<GLuint>& index_buffer_data, bool stripify)
+{
+	Mesh::DRAW_MODE mode = Mesh::DRAW_TRIANGLES;
+	if (stripify)
+	{
+		std::vector<GLuint> strip_buffer_data;
+		Stripify(index_buffer_data, strip_buffer_data);
+		index_buffer_data.swap(strip_buffer_data);
+		mode = Mesh::DRAW_TRIANGLE_STRIP_RESTART;
+	}
+
 	Mesh* mesh = new Mesh(meshName);
-	glBindBuffer(GL_ARRAY_BUFFER, mesh->vertexBuffer);
-	glBufferData(GL_ARRAY_BUFFER, vertex_buffer_data.size() * sizeof(Vertex), &vertex_buffer_data[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_buffer_data.size() * sizeof(GLuint), &index_buffer_data[0], GL_STATIC_DRAW);
-	mesh->indexSize = index_buffer_data.size();
-	mesh->mode = Mesh::DRAW_TRIANGLES;
+	mesh->Upload(vertex_buffer_data, index_buffer_data);
+	mesh->mode = mode;
+
+	return mesh;
+}
+
+/******************************************************************************/
+/*!
+\brief
+Generate the vertices of a capped tube skinned to a chain of joints up the y axis.
+Joint j sits at height * j / numJoints; a vertex follows the two joints around it,
+blended by how far it is between the middles of their segments.
+
+\param meshName - name of mesh
+\param color - vertex color
+\param radius - radius of the tube
+\param height - length of the tube, from y = 0 up
+\param numJoints - joints in the chain, at most UniformBlocks::MAX_SKIN_JOINTS
+\param numSlice - vertices around each ring
+\param numStack - rings along the length, more bend more smoothly
+
+\return Pointer to skinned mesh with its bind pose set
+*/
+/******************************************************************************/
+SkinnedMesh* MeshBuilder::GenerateSkinnedCylinder(const std::string& meshName, glm::vec3 color, float radius, float height, int numJoints, int numSlice, int numStack)
+{
+	SkinnedVertex v;
+	std::vector<SkinnedVertex> vertex_buffer_data;
+	std::vector<GLuint> index_buffer_data;
+
+	v.color = color;
+	v.texCoord = glm::vec2(0.f, 0.f);
+
+	float segment = height / numJoints;
+	float anglePerSlice = glm::two_pi<float>() / numSlice;
+
+	std::vector<glm::mat4> bindPose(numJoints);
+	for (int j = 0; j < numJoints; ++j)
+		bindPose[j] = glm::translate(glm::mat4(1.f), glm::vec3(0.f, segment * j, 0.f));
+
+	// Side rings, bottom to top
+	for (int k = 0; k <= numStack; ++k)
+	{
+		float y = height * k / numStack;
+		float u = std::min(std::max(y / segment - 0.5f, 0.f), numJoints - 1.f);
+		int j0 = std::min(static_cast<int>(u), numJoints - 1);
+		int j1 = std::min(j0 + 1, numJoints - 1);
+		v.joints[0] = static_cast<unsigned char>(j0);
+		v.joints[1] = static_cast<unsigned char>(j1);
+		v.joints[2] = v.joints[3] = 0;
+		v.weights = glm::vec4(1.f - (u - j0), u - j0, 0.f, 0.f);
+
+		for (int i = 0; i < numSlice; ++i)
+		{
+			float theta = i * anglePerSlice;
+			v.pos = glm::vec3(radius * glm::cos(theta), y, radius * glm::sin(theta));
+			v.normal = glm::vec3(glm::cos(theta), 0.f, glm::sin(theta));
+			vertex_buffer_data.push_back(v);
+		}
+	}
+	for (int k = 0; k < numStack; ++k)
+	{
+		for (int i = 0; i < numSlice; ++i)
+		{
+			GLuint a = k * numSlice + i;
+			GLuint b = k * numSlice + (i + 1) % numSlice;
+			GLuint c = a + numSlice;
+			GLuint d = b + numSlice;
+			index_buffer_data.push_back(a);
+			index_buffer_data.push_back(c);
+			index_buffer_data.push_back(b);
+			index_buffer_data.push_back(b);
+			index_buffer_data.push_back(c);
+			index_buffer_data.push_back(d);
+		}
+	}
+
+	// Caps get their own ring copies for the flat normals, and follow the end joints only
+	for (int cap = 0; cap < 2; ++cap)
+	{
+		float y = cap == 0 ? 0.f : height;
+		v.joints[0] = static_cast<unsigned char>(cap == 0 ? 0 : numJoints - 1);
+		v.joints[1] = v.joints[2] = v.joints[3] = 0;
+		v.weights = glm::vec4(1.f, 0.f, 0.f, 0.f);
+		v.normal = glm::vec3(0.f, cap == 0 ? -1.f : 1.f, 0.f);
+
+		GLuint centre = static_cast<GLuint>(vertex_buffer_data.size());
+		v.pos = glm::vec3(0.f, y, 0.f);
+		vertex_buffer_data.push_back(v);
+		for (int i = 0; i < numSlice; ++i)
+		{
+			float theta = i * anglePerSlice;
+			v.pos = glm::vec3(radius * glm::cos(theta), y, radius * glm::sin(theta));
+			vertex_buffer_data.push_back(v);
+		}
+		for (int i = 0; i < numSlice; ++i)
+		{
+			GLuint a = centre + 1 + i;
+			GLuint b = centre + 1 + (i + 1) % numSlice;
+			index_buffer_data.push_back(centre);
+			index_buffer_data.push_back(cap == 0 ? a : b);
+			index_buffer_data.push_back(cap == 0 ? b : a);
+		}
+	}
 
+	SkinnedMesh* mesh = new SkinnedMesh(meshName);
+	mesh->Upload(vertex_buffer_data, index_buffer_data);
+	mesh->SetBindPose(bindPose);
 	return mesh;
 }
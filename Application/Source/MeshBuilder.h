@@ -2,8 +2,11 @@
 #define MESH_BUILDER_H
 
 #include "Mesh.h"
+#include "SkinnedMesh.h"
 #include "Vertex.h"
 #include "LoadOBJ.h"
+#include "LoadPLY.h"
+#include "LoadSTL.h"
 
 /******************************************************************************/
 /*!
@@ -27,8 +30,17 @@ public:
 	//4.
 	static Mesh* GenerateCube(const std::string& meshName, glm::vec3 color, float topRadius = 1, float btmRadius = 1, int height = 1, int numSlice = 360);
 
-	static Mesh* GenerateOBJ(const std::string& meshName, const std::string& file_path);
+	static Mesh* GenerateOBJ(const std::string& meshName, const std::string& file_path, bool stripify = false);
+	// Binary PLY; a file without faces becomes a DRAW_POINTS cloud
+	static Mesh* GeneratePLY(const std::string& meshName, const std::string& file_path, bool stripify = false);
+	// Binary STL, welded within a millionth of its size; creaseAngle in degrees splits hard edges
+	static Mesh* GenerateSTL(const std::string& meshName, const std::string& file_path, float creaseAngle = 30.f, bool stripify = false);
 
+	// Capped tube up the y axis over a chain of numJoints joints spaced evenly from its base, for bending in one draw
+	static SkinnedMesh* GenerateSkinnedCylinder(const std::string& meshName, glm::vec3 color, float radius = 1.f, float height = 1.f, int numJoints = 4, int numSlice = 36, int numStack = 16);
+
+private:
+	static Mesh* GenerateIndexed(const std::string& meshName, const std::vector<Vertex>& vertex_buffer_data, std::vector<unsigned>& index_buffer_data, bool stripify);
 
 };
 
@@ -0,0 +1,310 @@
+#include "RenderQueue.h"
+#include <GL\glew.h>
+#include "GLStateCache.h"
+#include "UniformBlocks.h"
+#include "ShaderCache.h"
+#include "CommandList.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+namespace
+{
+	double Milliseconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// Bit pattern of a non-negative float, which orders the same way as the float
+	unsigned DepthBits(float depth)
+	{
+		if (!(depth > 0.f))
+			return 0;
+		unsigned bits;
+		memcpy(&bits, &depth, sizeof(bits));
+		return bits;
+	}
+}
+
+RenderQueue::RenderQueue()
+	: numItems(0)
+	, sortTime(0.0)
+	, submitTime(0.0)
+	, numProgramChanges(0)
+	, numTextureChanges(0)
+	, numMaterialChanges(0)
+	, firstTransparent(0)
+{
+}
+
+RenderQueue::~RenderQueue()
+{
+}
+
+void RenderQueue::Begin(const glm::mat4& view, const glm::mat4& projection)
+{
+	this->view = view;
+	this->projection = projection;
+	items.clear();
+	entries.clear();
+	firstTransparent = 0;
+}
+
+void RenderQueue::Submit(Mesh* mesh, const glm::mat4& model, unsigned programID, bool enableLight, bool transparent)
+{
+	Submit(mesh, mesh->material, model, programID, enableLight, transparent);
+}
+
+void RenderQueue::Submit(Mesh* mesh, const Material& material, const glm::mat4& model, unsigned programID, bool enableLight, bool transparent)
+{
+	Item item;
+	item.mesh = mesh;
+	item.modelView = view * model;
+	item.material = material;
+	item.textureID = mesh->textureID;
+	item.programID = programID;
+	item.lightEnabled = enableLight;
+	item.transparent = transparent;
+
+	// Camera looks down -z, so the distance in front of it is -z of the object's origin
+	SortEntry entry;
+	entry.key = MakeKey(item, mesh, -item.modelView[3].z);
+	entry.item = static_cast<unsigned>(items.size());
+
+	items.push_back(item);
+	entries.push_back(entry);
+}
+
+void RenderQueue::Append(const CommandList& list)
+{
+	unsigned base = static_cast<unsigned>(items.size());
+	items.insert(items.end(), list.items.begin(), list.items.end());
+	for (size_t i = 0; i < list.keys.size(); ++i)
+	{
+		SortEntry entry;
+		entry.key = list.keys[i];
+		entry.item = base + static_cast<unsigned>(i);
+		entries.push_back(entry);
+	}
+}
+
+unsigned long long RenderQueue::MakeKey(const Item& item, const Mesh* mesh, float depth)
+{
+	unsigned long long program = item.programID & 0xFF;
+	unsigned long long texture = item.textureID & 0xFFF;
+	unsigned long long bits = DepthBits(depth);
+
+	if (item.transparent)
+	{
+		unsigned long long farToNear = 0x7FFFFFFF - bits;
+		return (1ULL << 63) | (farToNear << 32) | (program << 24) | (texture << 12);
+	}
+
+	unsigned long long page = mesh->allocation.page & 0xFF;
+	unsigned long long light = item.lightEnabled ? 1 : 0;
+	unsigned long long nearToFar = bits >> 7;	// Top 24 bits of a positive float
+	return (program << 55) | (texture << 43) | (page << 35) | (light << 34) | nearToFar;
+}
+
+void RenderQueue::RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch)
+{
+	const unsigned DIGITS = 8;
+	size_t count = entries.size();
+	scratch.resize(count);
+
+	// All eight histograms in one pass over the keys
+	unsigned histogram[DIGITS][256];
+	memset(histogram, 0, sizeof(histogram));
+	for (size_t i = 0; i < count; ++i)
+	{
+		unsigned long long key = entries[i].key;
+		for (unsigned d = 0; d < DIGITS; ++d)
+			++histogram[d][(key >> (d * 8)) & 0xFF];
+	}
+
+	SortEntry* src = &entries[0];
+	SortEntry* dst = &scratch[0];
+	for (unsigned d = 0; d < DIGITS; ++d)
+	{
+		// Skip digits every key agrees on, e.g. the unused middle bits
+		unsigned first = static_cast<unsigned>((src[0].key >> (d * 8)) & 0xFF);
+		if (histogram[d][first] == count)
+			continue;
+
+		unsigned offset[256];
+		unsigned sum = 0;
+		for (unsigned b = 0; b < 256; ++b)
+		{
+			offset[b] = sum;
+			sum += histogram[d][b];
+		}
+		for (size_t i = 0; i < count; ++i)
+			dst[offset[(src[i].key >> (d * 8)) & 0xFF]++] = src[i];
+		SortEntry* swap = src;
+		src = dst;
+		dst = swap;
+	}
+
+	if (src != &entries[0])
+		entries.swap(scratch);
+}
+
+const RenderQueue::ProgramUniforms& RenderQueue::GetUniforms(unsigned programID)
+{
+	for (size_t i = 0; i < programs.size(); ++i)
+	{
+		if (programs[i].programID == programID)
+			return programs[i];
+	}
+
+	// Missing uniforms come back as -1, and glUniform ignores location -1
+	ProgramUniforms u;
+	u.programID = programID;
+	u.colorTexture = glGetUniformLocation(programID, "colorTexture");
+	programs.push_back(u);
+	return programs.back();
+}
+
+void RenderQueue::Flush(void)
+{
+	FlushOpaque(0);
+	FlushTransparent();
+}
+
+void RenderQueue::FlushOpaque(unsigned programID)
+{
+	numItems = static_cast<unsigned>(items.size());
+	numProgramChanges = numTextureChanges = numMaterialChanges = 0;
+	sortTime = submitTime = 0.0;
+	firstTransparent = 0;
+	if (items.empty())
+		return;
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	RadixSort(entries, scratch);
+	sortTime = Milliseconds(start);
+
+	// Transparent keys have the top bit set, so they all sort after the opaque ones
+	firstTransparent = entries.size();
+	while (firstTransparent > 0 && (entries[firstTransparent - 1].key >> 63) != 0)
+		--firstTransparent;
+
+	start = std::chrono::high_resolution_clock::now();
+	transforms.Begin(projection);
+	for (size_t i = 0; i < entries.size(); ++i)
+		transforms.Add(items[entries[i].item].modelView);
+	transforms.Compute();
+	submitTime = Milliseconds(start);
+
+	Draw(0, firstTransparent, programID);
+}
+
+void RenderQueue::FlushTransparent(void)
+{
+	Draw(firstTransparent, entries.size(), 0);
+	firstTransparent = entries.size();
+}
+
+void RenderQueue::Draw(size_t first, size_t last, unsigned programID)
+{
+	if (first >= last)
+		return;
+
+	GLStateCache* state = GLStateCache::GetInstance();
+	UniformBlocks* blocks = UniformBlocks::GetInstance();
+	ShaderCache* shaders = ShaderCache::GetInstance();
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+	state->ActiveTexture(GL_TEXTURE0);
+
+	const ProgramUniforms* u = nullptr;
+	const Material* lastMaterial = nullptr;
+	unsigned lastTexture = 0;
+	bool blending = false;
+	for (size_t i = first; i < last; ++i)
+	{
+		const Item& item = items[entries[i].item];
+		// A program still compiling in the background draws with its fallback
+		unsigned itemProgramID = shaders->Resolve(programID != 0 ? programID : item.programID);
+
+		if (u == nullptr || u->programID != itemProgramID)
+		{
+			state->UseProgram(itemProgramID);
+			u = &GetUniforms(itemProgramID);
+			glUniform1i(u->colorTexture, 0);
+			++numProgramChanges;
+		}
+
+		if (item.transparent && !blending)
+		{
+			state->Enable(GL_BLEND);
+			state->BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			state->DepthMask(false);
+			blending = true;
+		}
+
+		// One buffer update carries the matrices, material and toggles of the draw
+		blocks->SetObject(transforms.GetMVP(static_cast<unsigned>(i)), item.modelView, transforms.GetNormalMatrix(static_cast<unsigned>(i)),
+			item.material, item.lightEnabled, item.textureID > 0);
+		if (item.lightEnabled && (lastMaterial == nullptr || memcmp(lastMaterial, &item.material, sizeof(Material)) != 0))
+		{
+			lastMaterial = &item.material;
+			++numMaterialChanges;
+		}
+
+		if (item.textureID > 0 && item.textureID != lastTexture)
+		{
+			state->BindTexture(GL_TEXTURE_2D, item.textureID);
+			lastTexture = item.textureID;
+			++numTextureChanges;
+		}
+
+		item.mesh->Render();
+	}
+
+	if (lastTexture > 0)
+		state->BindTexture(GL_TEXTURE_2D, 0);
+	if (blending)
+	{
+		state->DepthMask(true);
+		state->Disable(GL_BLEND);
+	}
+	submitTime += Milliseconds(start);
+}
+
+unsigned RenderQueue::GetNumItems(void) const
+{
+	return numItems;
+}
+
+double RenderQueue::GetSortTime(void) const
+{
+	return sortTime;
+}
+
+double RenderQueue::GetSubmitTime(void) const
+{
+	return submitTime;
+}
+
+unsigned RenderQueue::GetNumProgramChanges(void) const
+{
+	return numProgramChanges;
+}
+
+unsigned RenderQueue::GetNumTextureChanges(void) const
+{
+	return numTextureChanges;
+}
+
+unsigned RenderQueue::GetNumMaterialChanges(void) const
+{
+	return numMaterialChanges;
+}
+
+void RenderQueue::PrintStats(void) const
+{
+	printf("render queue: %u items, sort %.3f ms, submit %.3f ms, %u program / %u texture / %u material changes\n",
+		numItems, sortTime, submitTime, numProgramChanges, numTextureChanges, numMaterialChanges);
+}
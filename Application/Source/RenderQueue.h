@@ -0,0 +1,110 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <vector>
+#include <glm\glm.hpp>
+#include "Mesh.h"
+#include "Material.h"
+#include "BatchTransform.h"
+
+class CommandList;
+
+/******************************************************************************/
+/*!
+		Class RenderQueue:
+\brief	Collects a frame's draws instead of issuing them inline, radix sorts
+		them on a 64-bit key and executes them with redundant program and
+		texture binds skipped. The MVP and normal matrices of all items are
+		computed in one BatchTransform pass before the draws are issued.
+		Matrices, material and toggles reach the shaders through the
+		ObjectData block of UniformBlocks, so programs must have been
+		registered with UniformBlocks::BindProgram.
+
+		Opaque key:      0 | program:8 | texture:12 | page:8 | light:1 | 0:10 | depth:24
+		Transparent key: 1 | far-to-near depth:31 | program:8 | texture:12 | 0:12
+
+		Opaque items group by state and go front to back inside a state;
+		transparent items all come after and go back to front. Program and
+		texture names are masked into their fields, so a collision only costs
+		grouping, never correctness.
+
+		Flush draws both. A deferred renderer instead calls FlushOpaque with
+		its G-buffer program, lights the result, then calls FlushTransparent
+		to blend the transparent items over it as usual.
+*/
+/******************************************************************************/
+class RenderQueue
+{
+public:
+	RenderQueue();
+	~RenderQueue();
+
+	void Begin(const glm::mat4& view, const glm::mat4& projection);
+
+	// The mesh's material and texture are copied now, so scenes may change them for the next submit
+	void Submit(Mesh* mesh, const glm::mat4& model, unsigned programID, bool enableLight, bool transparent = false);
+	// Draws with the given material instead of the mesh's, e.g. one mesh shared by differently coloured nodes
+	void Submit(Mesh* mesh, const Material& material, const glm::mat4& model, unsigned programID, bool enableLight, bool transparent = false);
+	// Take over the draws a worker recorded; keys were already made by the worker
+	void Append(const CommandList& list);
+
+	void Flush(void);
+	// Sort and draw the opaque items only, all with programID instead of their own when it is not 0
+	void FlushOpaque(unsigned programID);
+	// Draw the transparent items left by FlushOpaque; the stats add up over both
+	void FlushTransparent(void);
+
+	unsigned GetNumItems(void) const;
+	double GetSortTime(void) const;		// milliseconds spent sorting in the last Flush
+	double GetSubmitTime(void) const;	// milliseconds spent issuing GL calls in the last Flush
+	unsigned GetNumProgramChanges(void) const;
+	unsigned GetNumTextureChanges(void) const;
+	unsigned GetNumMaterialChanges(void) const;
+	void PrintStats(void) const;
+
+	struct Item
+	{
+		Mesh* mesh;
+		glm::mat4 modelView;
+		Material material;
+		unsigned textureID;
+		unsigned programID;
+		bool lightEnabled;
+		bool transparent;
+	};
+
+	static unsigned long long MakeKey(const Item& item, const Mesh* mesh, float depth);
+
+private:
+
+	struct SortEntry
+	{
+		unsigned long long key;
+		unsigned item;
+	};
+
+	// The sampler is the only plain uniform left, everything else is in the uniform blocks
+	struct ProgramUniforms
+	{
+		unsigned programID;
+		int colorTexture;
+	};
+
+	const ProgramUniforms& GetUniforms(unsigned programID);
+	// Issue the sorted entries [first, last), with programID overriding theirs when it is not 0
+	void Draw(size_t first, size_t last, unsigned programID);
+	static void RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
+
+	glm::mat4 view, projection;
+	std::vector<Item> items;
+	std::vector<SortEntry> entries, scratch;
+	std::vector<ProgramUniforms> programs;
+	BatchTransform transforms;	// MVP and normal matrix of every item, in sorted order
+
+	unsigned numItems;
+	double sortTime, submitTime;
+	unsigned numProgramChanges, numTextureChanges, numMaterialChanges;
+	size_t firstTransparent;	// sorted entry where the transparent items start
+};
+
+#endif
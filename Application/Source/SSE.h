@@ -0,0 +1,11 @@
+#ifndef SSE_H
+#define SSE_H
+
+// Defined when the target has SSE2, which every x64 build does. The SIMD
+// paths of MatrixStack, BatchTransform and AnimationPose are built on it,
+// with scalar code in its place otherwise
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define HAS_SSE
+#endif
+
+#endif
@@ -1,16 +1,28 @@
 #ifndef SCENE_H
 #define SCENE_H
 
+struct FrameSnapshot;
+class EntityStore;
+
 class Scene
 {
 public:
 	Scene() {}
-	~Scene() {}
+	virtual ~Scene() {}
 
 	virtual void Init() = 0;
 	virtual void Update(double dt) = 0;
 	virtual void Render() = 0;
 	virtual void Exit() = 0;
+
+	// Scenes whose Update makes no GL calls can instead record each frame
+	// into a snapshot that FramePipeline draws on its render thread
+	virtual bool SupportsRecord() const { return false; }
+	virtual void Record(FrameSnapshot& /*frame*/) {}
+
+	// Scenes keeping their objects in an EntityStore expose it, so the
+	// application can report on it without knowing the scene
+	virtual EntityStore* GetEntities() { return nullptr; }
 };
 
 #endif
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "Scene1.h"
 #include "GL\glew.h"
+#include "GLStateCache.h"
 
 // GLM Headers
 #include <glm\glm.hpp>
@@ -28,22 +29,18 @@ void Scene1::Init()
 	glClearColor(0.0f, 0.0f, 0.4f, 0.0f);
 
 	//Enable depth buffer and depth testing
-	glEnable(GL_DEPTH_TEST);
+	GLStateCache::GetInstance()->Enable(GL_DEPTH_TEST);
 
 	//Enable back face culling
-	glEnable(GL_CULL_FACE);
+	GLStateCache::GetInstance()->Enable(GL_CULL_FACE);
 
 	//Default to fill mode
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-	// Generate a default VAO for now
-	glGenVertexArrays(1, &m_vertexArrayID);
-	glBindVertexArray(m_vertexArrayID);
+	GLStateCache::GetInstance()->PolygonMode(GL_FILL);
 
 	// Load the shader programs
 	m_programID = LoadShaders("Shader//TransformVertexShader.vertexshader",
 								"Shader//SimpleFragmentShader.fragmentshader");
-	glUseProgram(m_programID);
+	GLStateCache::GetInstance()->UseProgram(m_programID);
 
 	// Get a handle for our "MVP" uniform
 	m_parameters[U_MVP] = glGetUniformLocation(m_programID, "MVP");
@@ -107,8 +104,7 @@ void Scene1::Exit()
 			delete meshList[i];
 		}
 	}
-	glDeleteVertexArrays(1, &m_vertexArrayID);
-	glDeleteProgram(m_programID);
+	GLStateCache::GetInstance()->DeleteProgram(m_programID);
 }
 
 void Scene1::HandleKeyPress() 
@@ -116,22 +112,22 @@ void Scene1::HandleKeyPress()
 	if (Application::IsKeyPressed(0x31))
 	{
 		// Key press to enable culling
-		glEnable(GL_CULL_FACE);
+		GLStateCache::GetInstance()->Enable(GL_CULL_FACE);
 	}
 	if (Application::IsKeyPressed(0x32))
 	{
 		// Key press to disable culling
-		glDisable(GL_CULL_FACE);
+		GLStateCache::GetInstance()->Disable(GL_CULL_FACE);
 	}
 	if (Application::IsKeyPressed(0x33))
 	{
 		// Key press to enable fill mode for the polygon
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); //default fill mode
+		GLStateCache::GetInstance()->PolygonMode(GL_FILL); //default fill mode
 	}
 	if (Application::IsKeyPressed(0x34))
 	{
 		// Key press to enable wireframe mode for the polygon
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); //wireframe mode
+		GLStateCache::GetInstance()->PolygonMode(GL_LINE); //wireframe mode
 	}
 	if (KeyboardController::GetInstance()->IsKeyPressed('P'))
 	{
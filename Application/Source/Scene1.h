@@ -31,7 +31,6 @@ public:
 private:
 	void HandleKeyPress();
 
-	unsigned m_vertexArrayID;
 	Mesh* meshList[NUM_GEOMETRY];
 
 	unsigned m_programID;
@@ -1,5 +1,6 @@
 #include "Scene2.h"
 #include "GL\glew.h"
+#include "GLStateCache.h"
 
 // GLM Headers
 #include <glm\glm.hpp>
@@ -33,22 +34,18 @@ void Scene2::Init()
 	glClearColor(0.0f, 0.0f, 0.4f, 0.0f);
 
 	//Enable depth buffer and depth testing
-	glEnable(GL_DEPTH_TEST);
+	GLStateCache::GetInstance()->Enable(GL_DEPTH_TEST);
 
 	//Enable back face culling
-	glEnable(GL_CULL_FACE);
+	GLStateCache::GetInstance()->Enable(GL_CULL_FACE);
 
 	//Default to fill mode
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-	// Generate a default VAO for now
-	glGenVertexArrays(1, &m_vertexArrayID);
-	glBindVertexArray(m_vertexArrayID);
+	GLStateCache::GetInstance()->PolygonMode(GL_FILL);
 
 	// Load the shader programs
 	m_programID = LoadShaders("Shader//TransformVertexShader.vertexshader",
 								"Shader//SimpleFragmentShader.fragmentshader");
-	glUseProgram(m_programID);
+	GLStateCache::GetInstance()->UseProgram(m_programID);
 
 	// Get a handle for our "MVP" uniform
 	m_parameters[U_MVP] = glGetUniformLocation(m_programID, "MVP");
@@ -67,7 +64,7 @@ void Scene2::Init()
 
 	meshList[GEO_SPHERE] = MeshBuilder::GenerateSphere("Sphere", glm::vec3(1.f, 1.f, 1.f), 1.f, 12, 12);
 
-	meshList[GEO_TORUS] = MeshBuilder::GenerateTorus("Torus", glm::vec3(.9f, .5f, .7f), 0.5f, 1.f, 12, 12);
+	torusLOD.InitTorus("Torus", glm::vec3(.9f, .5f, .7f), 0.5f, 1.f);
 
 }
 
@@ -111,7 +108,9 @@ void Scene2::Render()
 
 	//meshList[GEO_SPHERE]->Render();
 
-	meshList[GEO_TORUS]->Render();
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	torusLOD.Select(view * model, projection, static_cast<float>(viewport[3]))->Render();
 
 
 }
@@ -126,8 +125,8 @@ void Scene2::Exit()
 			delete meshList[i];
 		}
 	}
-	glDeleteVertexArrays(1, &m_vertexArrayID);
-	glDeleteProgram(m_programID);
+	torusLOD.Exit();
+	GLStateCache::GetInstance()->DeleteProgram(m_programID);
 }
 
 void Scene2::HandleKeyPress() 
@@ -135,22 +134,22 @@ void Scene2::HandleKeyPress()
 	if (Application::IsKeyPressed(0x31))
 	{
 		// Key press to enable culling
-		glEnable(GL_CULL_FACE);
+		GLStateCache::GetInstance()->Enable(GL_CULL_FACE);
 	}
 	if (Application::IsKeyPressed(0x32))
 	{
 		// Key press to disable culling
-		glDisable(GL_CULL_FACE);
+		GLStateCache::GetInstance()->Disable(GL_CULL_FACE);
 	}
 	if (Application::IsKeyPressed(0x33))
 	{
 		// Key press to enable fill mode for the polygon
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); //default fill mode
+		GLStateCache::GetInstance()->PolygonMode(GL_FILL); //default fill mode
 	}
 	if (Application::IsKeyPressed(0x34))
 	{
 		// Key press to enable wireframe mode for the polygon
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); //wireframe mode
+		GLStateCache::GetInstance()->PolygonMode(GL_LINE); //wireframe mode
 	}
 	if (KeyboardController::GetInstance()->IsKeyPressed('P'))
 	{
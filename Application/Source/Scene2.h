@@ -4,6 +4,7 @@
 #include "Scene.h"
 #include "Mesh.h"
 #include "AltAzCamera.h"
+#include "TessellationCache.h"
 
 class Scene2 : public Scene
 {
@@ -37,9 +38,11 @@ private:
 
 	void HandleKeyPress();
 
-	unsigned m_vertexArrayID;
 	Mesh* meshList[NUM_GEOMETRY];
 
+	// The torus picks its tessellation from its size on screen
+	TessellationCache torusLOD;
+
 	unsigned m_programID;
 	unsigned m_parameters[U_TOTAL];
 
@@ -0,0 +1,222 @@
+#include "SceneCrowd.h"
+#include "GL\glew.h"
+#include "GLStateCache.h"
+#include "UniformBlocks.h"
+
+// GLM Headers
+#include <glm\glm.hpp>
+#include <glm\gtc\matrix_transform.hpp>
+
+#include <math.h>
+#include <algorithm>
+
+#include "shader.hpp"
+#include "MeshBuilder.h"
+#include "KeyboardController.h"
+
+namespace
+{
+	// Cheap repeatable noise in [0, 1) so the crowd looks the same every run
+	float Noise(unsigned i, unsigned salt)
+	{
+		unsigned h = i * 2654435761u ^ salt * 40503u;
+		h ^= h >> 15;
+		h *= 2246822519u;
+		h ^= h >> 13;
+		return static_cast<float>(h & 0xFFFFFF) / 16777216.f;
+	}
+}
+
+SceneCrowd::SceneCrowd(unsigned numObjects, unsigned numPointLights)
+	: numObjects(numObjects)
+	, numPointLights(numPointLights)
+	, lightTime(0.f)
+{
+}
+
+SceneCrowd::~SceneCrowd()
+{
+}
+
+void SceneCrowd::Init()
+{
+	// Set background color to dark blue
+	clearColor = glm::vec4(0.0f, 0.0f, 0.4f, 0.0f);
+	glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+
+	//Enable depth buffer and depth testing
+	GLStateCache::GetInstance()->Enable(GL_DEPTH_TEST);
+
+	//Enable back face culling
+	cullFace = true;
+	GLStateCache::GetInstance()->Enable(GL_CULL_FACE);
+
+	//Default to fill mode
+	wireframe = false;
+	GLStateCache::GetInstance()->PolygonMode(GL_FILL);
+
+	//Default to forward shading
+	deferred = false;
+
+	// Load the shader programs
+	m_programID = LoadShaders("Shader//Shading.vertexshader",
+		"Shader//Shading.fragmentshader");
+	GLStateCache::GetInstance()->UseProgram(m_programID);
+
+	// Matrices, material and lights come from the shared uniform blocks
+	UniformBlocks::GetInstance()->BindProgram(m_programID);
+	// Enough object slots for the whole crowd in view, made now while this thread owns the context
+	UniformBlocks::GetInstance()->ReserveObjects(numObjects);
+
+	// Initialise camera properties
+	camera.Init(45.f, 45.f, 60.f);
+	projection = glm::perspective(45.0f, 4.0f / 3.0f, 0.1f, 1000.0f);
+
+	meshList[GEO_SPHERE] = MeshBuilder::GenerateSphere("Sphere", glm::vec3(1.f, 1.f, 1.f), 0.5f, 12, 6);
+	meshList[GEO_CUBE] = MeshBuilder::GenerateCube("Cube", glm::vec3(1.f, 1.f, 1.f), 1, 1, 1, 4);
+	meshList[GEO_TORUS] = MeshBuilder::GenerateTorus("Torus", glm::vec3(1.f, 1.f, 1.f), 0.2f, 0.5f, 8, 8);
+	meshList[GEO_CYLINDER] = MeshBuilder::GenerateCylinder("Cylinder", glm::vec3(1.f, 1.f, 1.f), 0.5f, 0.5f, 1, 12);
+
+	unsigned handles[NUM_GEOMETRY];
+	entities.Clear();
+	entities.Reserve(numObjects);
+	for (int i = 0; i < NUM_GEOMETRY; ++i)
+		handles[i] = entities.AddMesh(meshList[i]);
+
+	// A square grid on the ground, centred on the origin
+	unsigned side = static_cast<unsigned>(ceil(sqrt(static_cast<double>(numObjects))));
+	float spacing = 2.5f;
+	for (unsigned i = 0; i < numObjects; ++i)
+	{
+		Material material;
+		material.kAmbient = glm::vec3(Noise(i, 1), Noise(i, 2), Noise(i, 3)) * 0.6f;
+		material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
+		material.kSpecular = glm::vec3(0.5f, 0.5f, 0.5f);
+		material.kShininess = 1.f + Noise(i, 4) * 4.f;
+
+		glm::vec3 position((static_cast<float>(i % side) - side * 0.5f) * spacing, 0.f,
+			(static_cast<float>(i / side) - side * 0.5f) * spacing);
+		float size = 0.5f + Noise(i, 5);
+		EntityStore::Entity entity = entities.Create(handles[i % NUM_GEOMETRY], material, position, glm::vec3(size));
+
+		entities.SetRotation(entity, glm::vec3(Noise(i, 6) - 0.5f, 1.f, Noise(i, 7) - 0.5f), Noise(i, 8) * 360.f);
+		entities.SetSpin(entity, 30.f + Noise(i, 9) * 120.f);
+		entities.SetBob(entity, 0.5f * Noise(i, 10), 0.2f + Noise(i, 11) * 0.5f, Noise(i, 12) * 6.2831853f);
+	}
+
+	light[0].position = glm::vec3(0, 20, 0);
+	light[0].color = glm::vec3(1, 1, 1);
+	light[0].type = Light::LIGHT_DIRECTIONAL;
+	light[0].power = numPointLights > 0 ? 0.2f : 1.f;
+
+	// Scattered over the middle of the field, where the camera looks; each fades out within about 11 units
+	float lightArea = std::min(side * spacing * 0.5f, 60.f);
+	pointLights.assign(numPointLights, Light());
+	lightOrbits.resize(numPointLights);
+	for (unsigned i = 0; i < numPointLights; ++i)
+	{
+		Light& point = pointLights[i];
+		point.type = Light::LIGHT_POINT;
+		point.color = glm::normalize(glm::vec3(Noise(i, 21), Noise(i, 22), Noise(i, 23)) + glm::vec3(0.1f));
+		point.power = 1.f;
+		point.kC = 1.f;
+		point.kL = 0.f;
+		point.kQ = 2.f;
+
+		LightOrbit& orbit = lightOrbits[i];
+		orbit.center = glm::vec3((Noise(i, 24) * 2.f - 1.f) * lightArea, 1.f + Noise(i, 25) * 2.f, (Noise(i, 26) * 2.f - 1.f) * lightArea);
+		orbit.radius = 1.f + Noise(i, 27) * 4.f;
+		orbit.speed = (Noise(i, 28) - 0.5f) * 2.f;
+		orbit.phase = Noise(i, 29) * 6.2831853f;
+	}
+	lightTime = 0.f;
+}
+
+void SceneCrowd::Update(double dt)
+{
+	HandleKeyPress();
+	camera.Update(dt);
+
+	entities.Update(static_cast<float>(dt));
+
+	lightTime += static_cast<float>(dt);
+	for (unsigned i = 0; i < numPointLights; ++i)
+	{
+		const LightOrbit& orbit = lightOrbits[i];
+		float angle = orbit.phase + orbit.speed * lightTime;
+		pointLights[i].position = orbit.center + glm::vec3(cosf(angle), 0.f, sinf(angle)) * orbit.radius;
+	}
+}
+
+void SceneCrowd::Render()
+{
+	Record(serialFrame);
+	serialFrame.Replay(renderQueue);
+}
+
+void SceneCrowd::Record(FrameSnapshot& frame)
+{
+	frame.view = glm::lookAt(camera.position, camera.target, camera.up);
+	frame.projection = projection;
+	frame.lights.assign(light, light + NUM_LIGHTS);
+	frame.clearColor = clearColor;
+	frame.cullFace = cullFace;
+	frame.wireframe = wireframe;
+	frame.deferred = deferred;
+
+	if (numPointLights > 0)
+		frame.clusters.Build(frame.view, frame.projection, &pointLights[0], static_cast<int>(numPointLights));
+	else
+		frame.clusters.Clear();
+
+	frame.commands.Begin(frame.view, frame.projection);
+	entities.Record(frame.workerCommands, frame.view, frame.projection, m_programID, true);
+}
+
+void SceneCrowd::Exit()
+{
+	entities.Clear();
+	// Cleanup VBO here
+	for (int i = 0; i < NUM_GEOMETRY; ++i)
+	{
+		if (meshList[i])
+		{
+			delete meshList[i];
+		}
+	}
+	GLStateCache::GetInstance()->DeleteProgram(m_programID);
+}
+
+void SceneCrowd::HandleKeyPress()
+{
+	if (KeyboardController::GetInstance()->IsKeyPressed(0x31))
+	{
+		// Key press to enable culling
+		cullFace = true;
+	}
+	if (KeyboardController::GetInstance()->IsKeyPressed(0x32))
+	{
+		// Key press to disable culling
+		cullFace = false;
+	}
+	if (KeyboardController::GetInstance()->IsKeyPressed(0x33))
+	{
+		// Key press to enable fill mode for the polygon
+		wireframe = false; //default fill mode
+	}
+	if (KeyboardController::GetInstance()->IsKeyPressed(0x34))
+	{
+		// Key press to enable wireframe mode for the polygon
+		wireframe = true; //wireframe mode
+	}
+	if (KeyboardController::GetInstance()->IsKeyPressed(0x35))
+	{
+		// Key press to light every fragment as it is drawn
+		deferred = false;
+	}
+	if (KeyboardController::GetInstance()->IsKeyPressed(0x36))
+	{
+		// Key press to draw into the G-buffer first and light only the visible pixels
+		deferred = true;
+	}
+}
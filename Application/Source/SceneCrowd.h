@@ -0,0 +1,88 @@
+#ifndef SCENE_CROWD_H
+#define SCENE_CROWD_H
+
+#include "Scene.h"
+#include "Mesh.h"
+#include "AltAzCamera.h"
+#include "Light.h"
+#include "RenderQueue.h"
+#include "FrameSnapshot.h"
+#include "EntityStore.h"
+
+/******************************************************************************/
+/*!
+		Class SceneCrowd:
+\brief	A large field of spinning, bobbing shapes kept in an EntityStore
+		instead of scene members. Update runs the entity systems on the
+		ThreadPool and Record has every pool thread cull and record its
+		chunks into its own CommandList. Optionally hundreds of coloured
+		point lights circle over the field, binned into LightClusters.
+		Keys 5 and 6 switch between forward and deferred shading.
+*/
+/******************************************************************************/
+class SceneCrowd : public Scene
+{
+public:
+	enum GEOMETRY_TYPE
+	{
+		GEO_SPHERE,
+		GEO_CUBE,
+		GEO_TORUS,
+		GEO_CYLINDER,
+
+		NUM_GEOMETRY,
+	};
+
+	SceneCrowd(unsigned numObjects, unsigned numPointLights = 0);
+	~SceneCrowd();
+
+	virtual void Init();
+	virtual void Update(double dt);
+	virtual void Render();
+	virtual void Exit();
+
+	virtual bool SupportsRecord() const { return true; }
+	virtual void Record(FrameSnapshot& frame);
+
+	virtual EntityStore* GetEntities() { return &entities; }
+
+private:
+	void HandleKeyPress();
+
+	Mesh* meshList[NUM_GEOMETRY];
+	unsigned m_programID;
+
+	AltAzCamera camera;
+	glm::mat4 projection;
+
+	unsigned numObjects;
+	EntityStore entities;
+
+	// Render state, kept here so Update stays free of GL calls
+	glm::vec4 clearColor;
+	bool cullFace;
+	bool wireframe;
+	bool deferred;
+
+	// Serial mode records into this and replays it straight away
+	FrameSnapshot serialFrame;
+	RenderQueue renderQueue;
+
+	static const int NUM_LIGHTS = 1;
+	Light light[NUM_LIGHTS];
+
+	// Each point light circles its own centre at its own height and speed
+	struct LightOrbit
+	{
+		glm::vec3 center;
+		float radius;
+		float speed;		// radians per second
+		float phase;
+	};
+	std::vector<Light> pointLights;
+	std::vector<LightOrbit> lightOrbits;
+	unsigned numPointLights;
+	float lightTime;
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "SceneGalaxy.h"
 #include "GL\glew.h"
+#include "GLStateCache.h"
 
 // GLM Headers
 #include <glm\glm.hpp>
@@ -42,22 +43,18 @@ void SceneGalaxy::Init()
 	glClearColor(0.0f, 0.0f, 0.4f, 0.0f);
 
 	//Enable depth buffer and depth testing
-	glEnable(GL_DEPTH_TEST);
+	GLStateCache::GetInstance()->Enable(GL_DEPTH_TEST);
 
 	//Enable back face culling
-	glEnable(GL_CULL_FACE);
+	GLStateCache::GetInstance()->Enable(GL_CULL_FACE);
 
 	//Default to fill mode
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-	// Generate a default VAO for now
-	glGenVertexArrays(1, &m_vertexArrayID);
-	glBindVertexArray(m_vertexArrayID);
+	GLStateCache::GetInstance()->PolygonMode(GL_FILL);
 
 	// Load the shader programs
 	m_programID = LoadShaders("Shader//TransformVertexShader.vertexshader",
 								"Shader//SimpleFragmentShader.fragmentshader");
-	glUseProgram(m_programID);
+	GLStateCache::GetInstance()->UseProgram(m_programID);
 
 	// Get a handle for our "MVP" uniform
 	m_parameters[U_MVP] = glGetUniformLocation(m_programID, "MVP");
@@ -80,14 +77,14 @@ void SceneGalaxy::Init()
 
 	meshList[GEO_SPHERE] = MeshBuilder::GenerateSphere("Sphere", glm::vec3(1.f, 1.f, 1.f), 1.f, 12, 12);
 
-	meshList[GEO_TORUS] = MeshBuilder::GenerateTorus("Torus", glm::vec3(.9f, .5f, .7f), 0.5f, 1.f, 12, 12);
+	//meshList[GEO_TORUS] = MeshBuilder::GenerateTorus("Torus", glm::vec3(.9f, .5f, .7f), 0.5f, 1.f, 12, 12);
 
 	//Week 03
-	meshList[GEO_SPHERE_ORANGE] = MeshBuilder::GenerateSphere("Sun", glm::vec3(0.9f, 0.3f, 0.f), 2.f, 12, 12);
+	sunLOD.InitSphere("Sun", glm::vec3(0.9f, 0.3f, 0.f), 2.f);
 
-	meshList[GEO_SPHERE_BLUE] = MeshBuilder::GenerateSphere("Earth", glm::vec3(0.4f, 0.2f, 0.8f), 1.f, 12, 12);
+	earthLOD.InitSphere("Earth", glm::vec3(0.4f, 0.2f, 0.8f), 1.f);
 
-	meshList[GEO_SPHERE_GREY] = MeshBuilder::GenerateSphere("Moon", glm::vec3(0.5f, 0.5f, 0.5f), 1.f, 12, 12);
+	moonLOD.InitSphere("Moon", glm::vec3(0.5f, 0.5f, 0.5f), 1.f);
 
 
 }
@@ -168,6 +165,11 @@ void SceneGalaxy::Render()
 	// Load identity matrix into the model stack
 	modelStack.LoadIdentity();
 
+	// Viewport height is needed to measure the planets in pixels
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	float viewportHeight = static_cast<float>(viewport[3]);
+
 	{
 		// Render Sun
 		modelStack.PushMatrix();
@@ -188,19 +190,19 @@ void SceneGalaxy::Render()
 
 				MVP = projectionStack.Top() * viewStack.Top() * modelStack.Top();
 				glUniformMatrix4fv(m_parameters[U_MVP], 1, GL_FALSE, glm::value_ptr(MVP));
-				meshList[GEO_SPHERE_GREY]->Render();
+				moonLOD.Select(viewStack.Top() * modelStack.Top(), projectionStack.Top(), viewportHeight)->Render();
 				modelStack.PopMatrix();
 			}
 
 			MVP = projectionStack.Top() * viewStack.Top() * modelStack.Top();
 			glUniformMatrix4fv(m_parameters[U_MVP], 1, GL_FALSE, glm::value_ptr(MVP));
-			meshList[GEO_SPHERE_BLUE]->Render();
+			earthLOD.Select(viewStack.Top() * modelStack.Top(), projectionStack.Top(), viewportHeight)->Render();
 			modelStack.PopMatrix();
 		}
 
 		MVP = projectionStack.Top() * viewStack.Top() * modelStack.Top();
 		glUniformMatrix4fv(m_parameters[U_MVP], 1, GL_FALSE, glm::value_ptr(MVP));
-		meshList[GEO_SPHERE_ORANGE]->Render();
+		sunLOD.Select(viewStack.Top() * modelStack.Top(), projectionStack.Top(), viewportHeight)->Render();
 		modelStack.PopMatrix();
 	}
 }
@@ -215,8 +217,10 @@ void SceneGalaxy::Exit()
 			delete meshList[i];
 		}
 	}
-	glDeleteVertexArrays(1, &m_vertexArrayID);
-	glDeleteProgram(m_programID);
+	sunLOD.Exit();
+	earthLOD.Exit();
+	moonLOD.Exit();
+	GLStateCache::GetInstance()->DeleteProgram(m_programID);
 }
 
 void SceneGalaxy::HandleKeyPress() 
@@ -224,22 +228,22 @@ void SceneGalaxy::HandleKeyPress()
 	if (Application::IsKeyPressed(0x31))
 	{
 		// Key press to enable culling
-		glEnable(GL_CULL_FACE);
+		GLStateCache::GetInstance()->Enable(GL_CULL_FACE);
 	}
 	if (Application::IsKeyPressed(0x32))
 	{
 		// Key press to disable culling
-		glDisable(GL_CULL_FACE);
+		GLStateCache::GetInstance()->Disable(GL_CULL_FACE);
 	}
 	if (Application::IsKeyPressed(0x33))
 	{
 		// Key press to enable fill mode for the polygon
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); //default fill mode
+		GLStateCache::GetInstance()->PolygonMode(GL_FILL); //default fill mode
 	}
 	if (Application::IsKeyPressed(0x34))
 	{
 		// Key press to enable wireframe mode for the polygon
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); //wireframe mode
+		GLStateCache::GetInstance()->PolygonMode(GL_LINE); //wireframe mode
 	}
 	if (KeyboardController::GetInstance()->IsKeyPressed('P'))
 	{
@@ -5,6 +5,7 @@
 #include "Mesh.h"
 #include "AltAzCamera.h"
 #include "MatrixStack.h"
+#include "TessellationCache.h"
 
 class SceneGalaxy : public Scene
 {
@@ -17,10 +18,6 @@ public:
 		GEO_SPHERE,
 		GEO_TORUS,
 
-		GEO_SPHERE_ORANGE,
-		GEO_SPHERE_BLUE,
-		GEO_SPHERE_GREY,
-
 		NUM_GEOMETRY,
 	};
 
@@ -54,9 +51,11 @@ private:
 
 	void HandleKeyPress();
 
-	unsigned m_vertexArrayID;
 	Mesh* meshList[NUM_GEOMETRY];
 
+	// Planets pick their tessellation from their size on screen
+	TessellationCache sunLOD, earthLOD, moonLOD;
+
 	unsigned m_programID;
 	unsigned m_parameters[U_TOTAL];
 
@@ -0,0 +1,139 @@
+#include "SceneGraph.h"
+#include "RenderQueue.h"
+
+#include <stdio.h>
+
+SceneGraph::SceneGraph()
+	: anyDirty(false)
+	, numUpdated(0)
+{
+}
+
+SceneGraph::~SceneGraph()
+{
+}
+
+void SceneGraph::Clear(void)
+{
+	nodes.clear();
+	draws.clear();
+	open.clear();
+	anyDirty = false;
+	numUpdated = 0;
+}
+
+unsigned SceneGraph::BeginNode(const glm::mat4& local)
+{
+	Node node;
+	node.local = local;
+	node.world = local;
+	node.parent = open.empty() ? NO_PARENT : open.back();
+	node.end = 0;
+	node.dirty = true;
+	anyDirty = true;
+
+	unsigned index = static_cast<unsigned>(nodes.size());
+	nodes.push_back(node);
+	open.push_back(index);
+	return index;
+}
+
+unsigned SceneGraph::BeginNode(const glm::mat4& local, Mesh* mesh, const Material& material, bool enableLight)
+{
+	unsigned index = BeginNode(local);
+	Draw draw;
+	draw.node = index;
+	draw.mesh = mesh;
+	draw.material = material;
+	draw.enableLight = enableLight;
+	draws.push_back(draw);
+	return index;
+}
+
+void SceneGraph::EndNode(void)
+{
+	if (open.empty())
+	{
+		printf("SceneGraph: EndNode without a matching BeginNode\n");
+		return;
+	}
+	nodes[open.back()].end = static_cast<unsigned>(nodes.size());
+	open.pop_back();
+}
+
+unsigned SceneGraph::AddNode(const glm::mat4& local, Mesh* mesh, const Material& material, bool enableLight)
+{
+	unsigned index = BeginNode(local, mesh, material, enableLight);
+	EndNode();
+	return index;
+}
+
+void SceneGraph::SetLocal(unsigned node, const glm::mat4& local)
+{
+	// Animated joints are set every frame, but most frames most of them hold still
+	if (nodes[node].local == local)
+		return;
+	nodes[node].local = local;
+	nodes[node].dirty = true;
+	anyDirty = true;
+}
+
+const glm::mat4& SceneGraph::GetLocal(unsigned node) const
+{
+	return nodes[node].local;
+}
+
+const glm::mat4& SceneGraph::GetWorld(unsigned node) const
+{
+	return nodes[node].world;
+}
+
+void SceneGraph::Update(void)
+{
+	numUpdated = 0;
+	if (!anyDirty)
+		return;
+
+	unsigned count = static_cast<unsigned>(nodes.size());
+	unsigned i = 0;
+	while (i < count)
+	{
+		if (!nodes[i].dirty)
+		{
+			++i;
+			continue;
+		}
+
+		// Parents precede children, so one forward pass over the subtree is enough.
+		// A node still open has no end yet; its subtree runs to the end of the array
+		unsigned end = nodes[i].end > i ? nodes[i].end : count;
+		for (unsigned j = i; j < end; ++j)
+		{
+			Node& node = nodes[j];
+			node.world = node.parent == NO_PARENT ? node.local : nodes[node.parent].world * node.local;
+			node.dirty = false;
+		}
+		numUpdated += end - i;
+		i = end;
+	}
+	anyDirty = false;
+}
+
+void SceneGraph::Submit(RenderQueue& queue, unsigned programID) const
+{
+	for (size_t i = 0; i < draws.size(); ++i)
+	{
+		const Draw& draw = draws[i];
+		queue.Submit(draw.mesh, draw.material, nodes[draw.node].world, programID, draw.enableLight);
+	}
+}
+
+unsigned SceneGraph::GetNumNodes(void) const
+{
+	return static_cast<unsigned>(nodes.size());
+}
+
+unsigned SceneGraph::GetNumUpdated(void) const
+{
+	return numUpdated;
+}
@@ -0,0 +1,80 @@
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include <vector>
+#include <glm\glm.hpp>
+#include "Mesh.h"
+#include "Material.h"
+
+class RenderQueue;
+
+/******************************************************************************/
+/*!
+		Class SceneGraph:
+\brief	Retained hierarchy of transforms, built once and then only touched
+		where something moves. Nodes live in one flat array in depth-first
+		order, so a node's subtree is the contiguous range after it and
+		every parent comes before its children. Update walks the array once
+		and recomputes world matrices only for subtrees under a node whose
+		local transform changed.
+
+		Transforms and draws are kept apart: the update loop only reads the
+		transform array, and Submit only reads the much shorter draw list.
+*/
+/******************************************************************************/
+class SceneGraph
+{
+public:
+	static const unsigned NO_PARENT = 0xFFFFFFFF;
+
+	SceneGraph();
+	~SceneGraph();
+
+	void Clear(void);
+
+	// Opens a child of the innermost open node, or a new root; close it with EndNode
+	unsigned BeginNode(const glm::mat4& local);
+	// Same, drawing mesh with material at the node's world transform
+	unsigned BeginNode(const glm::mat4& local, Mesh* mesh, const Material& material, bool enableLight = true);
+	void EndNode(void);
+	// A node without children
+	unsigned AddNode(const glm::mat4& local, Mesh* mesh, const Material& material, bool enableLight = true);
+
+	// Marks the node's subtree for the next Update, unless the transform did not change
+	void SetLocal(unsigned node, const glm::mat4& local);
+	const glm::mat4& GetLocal(unsigned node) const;
+	const glm::mat4& GetWorld(unsigned node) const;
+
+	void Update(void);
+	// Queue every node that has a mesh
+	void Submit(RenderQueue& queue, unsigned programID) const;
+
+	unsigned GetNumNodes(void) const;
+	unsigned GetNumUpdated(void) const;	// world matrices recomputed by the last Update
+
+private:
+	struct Node
+	{
+		glm::mat4 local;
+		glm::mat4 world;
+		unsigned parent;
+		unsigned end;		// one past the last node of the subtree
+		bool dirty;
+	};
+
+	struct Draw
+	{
+		unsigned node;
+		Mesh* mesh;
+		Material material;
+		bool enableLight;
+	};
+
+	std::vector<Node> nodes;
+	std::vector<Draw> draws;
+	std::vector<unsigned> open;		// nodes begun but not ended yet
+	bool anyDirty;
+	unsigned numUpdated;
+};
+
+#endif
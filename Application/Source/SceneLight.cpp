@@ -1,5 +1,7 @@
 #include "SceneLight.h"
 #include "GL\glew.h"
+#include "GLStateCache.h"
+#include "UniformBlocks.h"
 
 // GLM Headers
 #include <glm\glm.hpp>
@@ -15,9 +17,49 @@
 #include "shader.hpp"
 #include "Application.h"
 #include "MeshBuilder.h"
+#include "LoadAnimation.h"
 
 
 #include <iostream>
+#include <algorithm>
+#include <math.h>
+
+namespace
+{
+	const char* ANIMATION_FILE = "Animation//robot.anim";
+	// Seconds to cross-fade from one clip into the next
+	const float FADE_TIME = 0.3f;
+
+	const int ANTENNA_JOINTS = 6;
+	const float ANTENNA_LENGTH = 1.5f;
+
+	// Rises at rate from zero and holds at limit
+	float Ramp(float t, float rate, float limit)
+	{
+		float value = rate * t;
+		return rate >= 0.f ? std::min(value, limit) : std::max(value, limit);
+	}
+
+	// Rises from zero to high, then swings between high and low for good
+	float Bounce(float t, float low, float high, float upSpeed, float downSpeed)
+	{
+		float rise = high / upSpeed;
+		if (t < rise)
+			return upSpeed * t;
+		float down = (high - low) / downSpeed;
+		float u = fmodf(t - rise, down + (high - low) / upSpeed);
+		return u < down ? high - downSpeed * u : low + upSpeed * (u - down);
+	}
+
+	// Zero, then up to peak and back at speed starting at start
+	float Pulse(float t, float start, float peak, float speed)
+	{
+		float u = t - start;
+		if (u <= 0.f || u >= 2.f * peak / speed)
+			return 0.f;
+		return peak - fabsf(speed * u - peak);
+	}
+}
 
 SceneLight::SceneLight()
 {
@@ -50,29 +92,6 @@ void SceneLight::setDefaultValue()
 	handRoteAmt = 0;
 	bodyRotAmt = 0;
 	bodyTransAmt = 0;
-	punchCounter = 0;
-
-	//Speeds
-	rightHandRotateSpeed = 35;
-	rightForearmRotSpeed = 40;
-	headRotateSpeed = 20;
-	legRotSpeed = 60;
-	lefthandRotSpeed = 30;
-	bodyMovementSpeed_idle = 0.5f;
-	bodyMovementSpeed_ss = 0.5f;
-	legMovementSpeed_ss = 26;
-	handRoteSpeed = 26;
-	bodyRotSpeed = 150;
-	bodyTransSped = 5;
-	bodyRotSpeed_ca = 20;
-	rightHandTranslateSpeed = 40;
-	leftHandTranslateSpeed = 40;
-
-	//Conditions
-	finishAnim_SS = true;
-	rightHandAnim = true;
-	leftHandAnim = false;
-	kickAnim = false;
 }
 
 void SceneLight::Init()
@@ -84,47 +103,29 @@ void SceneLight::Init()
 	glClearColor(0.0f, 0.0f, 0.4f, 0.0f);
 
 	//Enable depth buffer and depth testing
-	glEnable(GL_DEPTH_TEST);
+	GLStateCache::GetInstance()->Enable(GL_DEPTH_TEST);
 
 	// Enable back face culling
-	glEnable(GL_CULL_FACE);
+	GLStateCache::GetInstance()->Enable(GL_CULL_FACE);
 
 	//Default to fill mode
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-	// Generate a default VAO for now
-	glGenVertexArrays(1, &m_vertexArrayID);
-	glBindVertexArray(m_vertexArrayID);
+	GLStateCache::GetInstance()->PolygonMode(GL_FILL);
 
 	m_programID = LoadShaders("Shader//Shading.vertexshader",
 		"Shader//Shading.fragmentshader");
-	glUseProgram(m_programID);
-
-	// Get a handle for our "MVP" uniform
-	{
-	m_parameters[U_MVP] = glGetUniformLocation(m_programID, "MVP");
-	m_parameters[U_MODELVIEW] = glGetUniformLocation(m_programID, "MV");
-	m_parameters[U_MODELVIEW_INVERSE_TRANSPOSE] = glGetUniformLocation(m_programID, "MV_inverse_transpose");
-	m_parameters[U_MATERIAL_AMBIENT] = glGetUniformLocation(m_programID, "material.kAmbient");
-	m_parameters[U_MATERIAL_DIFFUSE] = glGetUniformLocation(m_programID, "material.kDiffuse");
-	m_parameters[U_MATERIAL_SPECULAR] = glGetUniformLocation(m_programID, "material.kSpecular");
-	m_parameters[U_MATERIAL_SHININESS] = glGetUniformLocation(m_programID, "material.kShininess");
-	m_parameters[U_LIGHT0_POSITION] = glGetUniformLocation(m_programID, "lights[0].position_cameraspace");
-	m_parameters[U_LIGHT0_COLOR] = glGetUniformLocation(m_programID, "lights[0].color");
-	m_parameters[U_LIGHT0_POWER] = glGetUniformLocation(m_programID, "lights[0].power");
-	m_parameters[U_LIGHT0_KC] = glGetUniformLocation(m_programID, "lights[0].kC");
-	m_parameters[U_LIGHT0_KL] = glGetUniformLocation(m_programID, "lights[0].kL");
-	m_parameters[U_LIGHT0_KQ] = glGetUniformLocation(m_programID, "lights[0].kQ");
-	m_parameters[U_LIGHTENABLED] = glGetUniformLocation(m_programID, "lightEnabled");
-	}
+	GLStateCache::GetInstance()->UseProgram(m_programID);
+
+	// Matrices, material and light come from the shared uniform blocks
+	UniformBlocks::GetInstance()->BindProgram(m_programID);
+
+	// Same lighting, with the vertices blended by a joint palette
+	m_skinProgramID = LoadShaders("Shader//Skinning.vertexshader",
+		"Shader//Shading.fragmentshader");
+	UniformBlocks::GetInstance()->BindProgram(m_skinProgramID);
 
 	// Load identity matrix into the model stack
 	modelStack.LoadIdentity();
 
-	// Calculate the light position in camera space
-	glm::vec3 lightPosition_cameraspace = viewStack.Top() * glm::vec4(light[0].position, 1);
-	glUniform3fv(m_parameters[U_LIGHT0_POSITION], 1, glm::value_ptr(lightPosition_cameraspace));
-
 	// Init VBO here
 	for (int i = 0; i < NUM_GEOMETRY; ++i)
 	{
@@ -149,6 +150,16 @@ void SceneLight::Init()
 	//5.
 	meshList[GEO_CUBE] = MeshBuilder::GenerateCube("Legs",glm::vec3(1, 1, 1), 1, 1, 2, 4);
 
+	antenna = MeshBuilder::GenerateSkinnedCylinder("Antenna", glm::vec3(1, 1, 1), 0.08f, ANTENNA_LENGTH, ANTENNA_JOINTS, 12, 24);
+	antenna->material.kAmbient = glm::vec3(0.3f, 0.3f, 0.35f);
+	antenna->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
+	antenna->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
+	antenna->material.kShininess = 5.0f;
+	antennaTime = 0.f;
+	antennaPose.resize(ANTENNA_JOINTS);
+	antennaPalette.resize(ANTENNA_JOINTS);
+	AnimateAntenna(0.f);
+
 	// Init default data on start
 	{
 	currAnim = ANIM_DEFAULT;
@@ -161,56 +172,20 @@ void SceneLight::Init()
 	light[0].kC = 1.f;
 	light[0].kL = 0.01f;
 	light[0].kQ = 0.001f;
+	light[0].type = Light::LIGHT_POINT;
 
-	glUniform3fv(m_parameters[U_LIGHT0_COLOR], 1, glm::value_ptr(light[0].color));
-	glUniform1f(m_parameters[U_LIGHT0_POWER], light[0].power);
-	glUniform1f(m_parameters[U_LIGHT0_KC], light[0].kC);
-	glUniform1f(m_parameters[U_LIGHT0_KL], light[0].kL);
-	glUniform1f(m_parameters[U_LIGHT0_KQ], light[0].kQ);
+	setDefaultValue();
+	}
 
-	//Common
-	jointSize = 0.35f;
-	eyeSize = 0.3f;
-	upperBodySize = 1.25f;
-	
-	//Values
-	headRotateAmt = 0;
-	rightHandTranslateAmt = 0;
-	//rightForearmRotAmt = 0;
-	lefthandTranslateAmt = 0;
-	leftlegRotateAmt = 0;
-	rightlegRoteAmt = 0;
-	legRoteAmt = 0;
-	bodyMovementAmt_idle = 0;
-	bodyMovementAmt_ss = 0;
-	legMovementAmt_ss = 0;
-	handRoteAmt = 0;
-	bodyRotAmt = 0;
-	bodyTransAmt = 0;
-	punchCounter = 0;
-
-	//Speeds
-	rightHandRotateSpeed = 35;
-	rightForearmRotSpeed = 40;
-	headRotateSpeed = 20;
-	legRotSpeed = 60;
-	lefthandRotSpeed = 30;
-	bodyMovementSpeed_idle = 0.5f;
-	bodyMovementSpeed_ss = 0.5f;
-	legMovementSpeed_ss = 26;
-	handRoteSpeed = 26;
-	bodyRotSpeed = 150;
-	bodyTransSped = 5;
-	bodyRotSpeed_ca = 20;
-	rightHandTranslateSpeed = 40;
-	leftHandTranslateSpeed = 40;
-
-	//Conditions
-	finishAnim_SS = true;
-	rightHandAnim = true;
-	leftHandAnim = false;
-	kickAnim = false;
+	BuildRobot();
+
+	// Authored once and then loaded; delete the file to re-key the clips after changing the robot
+	if (!LoadAnimation(ANIMATION_FILE, clips) || clips.size() != NUM_ANIM || clips[0].GetNumJoints() != NUM_JOINTS)
+	{
+		AuthorClips();
+		SaveAnimation(ANIMATION_FILE, clips);
 	}
+	player.Play(&clips[ANIM_DEFAULT]);
 }
 
 void SceneLight::Update(double dt)
@@ -219,282 +194,6 @@ void SceneLight::Update(double dt)
 	HandleKeyPress();
 	camera.Update(dt);
 
-	//Do animation here
-	switch (currAnim) 
-	{
-		//Press 'Z'
-	case ANIM_IDLE:
-		//Idle anim
-		lefthandTranslateAmt += static_cast<float>(dt) * lefthandRotSpeed;
-		if (lefthandTranslateAmt >= 30 || lefthandTranslateAmt <= -30)
-		{	
-			lefthandRotSpeed *= -1;
-		}
-		bodyMovementAmt_idle += static_cast<float>(dt) * bodyMovementSpeed_idle;
-		if (bodyMovementAmt_idle >= 0.25f || bodyMovementAmt_idle <= -0)
-		{
-			bodyMovementSpeed_idle *= -1;
-		}
-
-		break;
-		//Press 'X'
-	case ANIM_WAVING:
-		//Waving anim
-		//Head tilt to left
-	
-		headRotateAmt += static_cast<float>(dt) * headRotateSpeed;
-
-		if (headRotateAmt >= 20)
-		{
-			headRotateSpeed = 0;
-		}
-		else
-		{
-			headRotateSpeed = 50;
-		}
-		
-		//Waving
-		rightHandTranslateAmt += static_cast<float>(dt) * rightHandRotateSpeed;
-		
-		if (rightHandTranslateAmt >= 40 || rightHandTranslateAmt <= 0)
-		{
-			rightHandRotateSpeed = -rightHandRotateSpeed;
-
-		}
-
-		rightForearmRotAmt += static_cast<float>(dt) * rightForearmRotSpeed;
-
-		if (rightHandTranslateAmt >= 40 || rightHandTranslateAmt <= 0)
-		{
-			rightForearmRotSpeed = -rightForearmRotSpeed;
-		}
-
-		//Put down the left hand
-		lefthandTranslateAmt -= static_cast<float>(dt) * lefthandRotSpeed;
-
-		if (lefthandTranslateAmt >= 45)
-		{
-			lefthandRotSpeed = 0;
-		}
-		else
-		{
-			lefthandRotSpeed = -20;
-		}
-		break;
-		//Press 'C'
-	case ANIM_SWIMMING:
-		
-		//Head Swing
-		if (headRotateAmt >= 30 || headRotateAmt <= -30)
-		{
-			headRotateSpeed = -headRotateSpeed;
-		}
-		headRotateAmt += static_cast<float>(dt) * headRotateSpeed;
-
-		//Hand movement
-		rightHandTranslateAmt += static_cast<float>(dt) * rightHandRotateSpeed;
-		if (rightHandTranslateAmt >= 55 || rightHandTranslateAmt <= -55)
-		{
-			rightHandRotateSpeed = -rightHandRotateSpeed;
-			if (rightHandTranslateAmt >= 55)
-			{
-				rightHandRotateSpeed *= 3;
-			}
-			else if (rightHandTranslateAmt <= -55)
-			{
-				rightHandRotateSpeed /= 3;
-			}
-		}
-		legRoteAmt += static_cast<float>(dt) * legRotSpeed;
-		if (legRoteAmt >= 50 || legRoteAmt <= -50)
-		{
-			legRotSpeed = -legRotSpeed;
-		}
-
-		//Leg movement
-
-		break;
-		//Press 'V'
-	case ANIM_SUMMERSAULT:
-		//Start animation while player not perform the summersault
-
-		finishAnim_SS = false;
-		if (!finishAnim_SS)
-		{
-			headRotateAmt += static_cast<float>(dt) * headRotateSpeed;
-			bodyMovementAmt_ss += static_cast<float>(dt) * -bodyMovementSpeed_ss;
-			legMovementAmt_ss += static_cast<float>(dt) * legMovementSpeed_ss;
-			handRoteAmt += static_cast<float>(dt) * handRoteSpeed;
-			
-			
-			if (headRotateAmt >= 30)
-			{
-				headRotateSpeed *= 0;
-			}
-
-			if (bodyMovementAmt_ss <= -1)
-			{
-				
-				bodyMovementSpeed_ss *= 0;
-
-				bodyTransAmt += static_cast<float>(dt) * bodyTransSped;
-				bodyRotAmt += static_cast<float>(dt) * bodyRotSpeed;
-				if (bodyRotAmt >= 360)
-				{
-					bodyRotSpeed *= 0;
-					bodyTransSped *= 0;
-					finishAnim_SS = true;
-				}
-				
-			}
-
-			if (legMovementAmt_ss >= 55)
-			{
-				legMovementSpeed_ss *= 0;
-			}
-
-			if (handRoteAmt >= 50)
-			{
-				handRoteSpeed *= 0;
-			}
-			
-		}
-		//Start animation to reverse to the orignal pose;
-
-		if(finishAnim_SS)
-		{
-			std::cout << "Reverse Anim" << '\n';
-			
-			//headRotateAmt -= static_cast<float>(dt) * 20;
-			//legMovementAmt_ss -= static_cast<float>(dt) * 26;
-			//handRoteAmt -= static_cast<float>(dt) * 26;
-
-			if (headRotateAmt >= 0)
-			{
-				headRotateAmt -= static_cast<float>(dt) * 20;
-			}
-			else
-			{
-				headRotateAmt -= static_cast<float>(dt) * 0;
-			}
-
-			if (legMovementAmt_ss >= 0)
-			{
-				legMovementAmt_ss -= static_cast<float>(dt) * 26;
-			}
-			else
-			{
-				legMovementAmt_ss -= static_cast<float>(dt) * 0;
-			}
-
-			if (handRoteAmt >= 0)
-			{
-				handRoteAmt -= static_cast<float>(dt) * 26;
-			}
-			else
-			{
-				handRoteAmt -= static_cast<float>(dt) * 0;
-			}
-
-		}
-		break;
-		//Press 'B'
-	case ANIM_COMBO_ATTACK:
-
-		bodyRotAmt += static_cast<float>(dt) * bodyRotSpeed_ca;
-		if (bodyRotAmt >= 20)
-		{
-			bodyRotSpeed_ca *= 0;
-		}
-		//Punch
-		handRoteAmt += static_cast<float>(dt) * handRoteSpeed;
-		if (handRoteAmt >= 40)
-		{
-			handRoteAmt = 40;
-			//leftHandAnim = true;
-			if (leftHandAnim)
-			{
-				//rightHandTranslateAmt = 0;
-				lefthandTranslateAmt += static_cast<float>(dt) * (leftHandTranslateSpeed * 4);
-				if (lefthandTranslateAmt >= 20 || lefthandTranslateAmt <= 0)
-				{
-					leftHandTranslateSpeed = -leftHandTranslateSpeed;
-
-					if (lefthandTranslateAmt <= 0)
-					{
-						punchCounter++;
-						rightHandAnim = true;
-						leftHandAnim = false;
-					}
-				}
-			}
-			if (rightHandAnim)
-			{
-				//lefthandTranslateAmt = 0;
-				rightHandTranslateAmt += static_cast<float>(dt) * (rightHandTranslateSpeed * 4);
-				if (rightHandTranslateAmt >= 20 || rightHandTranslateAmt <= 0)
-				{
-					rightHandTranslateSpeed = -rightHandTranslateSpeed;
-					if (rightHandTranslateAmt <= 0)
-					{
-						punchCounter++;
-						leftHandAnim = true;
-						rightHandAnim = false;
-					}
-				}
-			}
-		}
-		//Check the lap of punch
-		if (punchCounter >= 10)
-		{
-			leftHandAnim = false;
-			rightHandAnim = false;
-			kickAnim = true;
-		}
-
-		legRoteAmt += static_cast<float>(dt) * legRotSpeed;
-		if (legRoteAmt >= 20)
-		{
-			legRoteAmt = 20;
-		}
-		//Rasie the leg
-		if (kickAnim)
-		{
-			legMovementAmt_ss += static_cast<float>(dt) * (legMovementSpeed_ss * 2 );
-			if (legMovementAmt_ss >= 30 || legMovementAmt_ss <= 0)
-			{
-				//legMovementAmt_ss = 30;
-				if (legMovementAmt_ss <= 0)
-				{
-					legMovementSpeed_ss = 0;
-				}
-				legMovementSpeed_ss = -legMovementSpeed_ss;	
-			}
-
-			bodyTransAmt += static_cast<float>(dt) * (bodyTransSped * 3.1f);
-			if (bodyTransAmt >= 10 || bodyTransAmt <= 0)
-			{
-				bodyTransSped = -bodyTransSped;
-				if (bodyTransAmt <= 0)
-				{
-					bodyTransSped = 0;
-				}
-			}
-			kickAnim = false;
-		}	
-
-		//End
-
-		break;
-	case ANIM_DEFAULT:
-		setDefaultValue();
-		
-		break;
-	default:
-		
-		break;
-	}
-
 	// Controller for movement of light source
 	{
 	if (KeyboardController::GetInstance()->IsKeyDown('I'))
@@ -510,6 +209,17 @@ void SceneLight::Update(double dt)
 	if (KeyboardController::GetInstance()->IsKeyDown('P'))
 		light[0].position.y += static_cast<float>(dt) * 5.f;
 	}
+
+	// Sample the playing clip, cross-faded with the last one for a moment after a switch
+	player.Update(static_cast<float>(dt));
+	player.Sample(pose);
+
+	// Only joints that moved this frame get their subtrees recomputed
+	for (int j = 0; j < NUM_JOINTS; ++j)
+		robot.SetLocal(joints[j], pose.GetMatrix(j));
+	robot.Update();
+
+	AnimateAntenna(static_cast<float>(dt));
 }
 
 void SceneLight::Render()
@@ -525,9 +235,11 @@ void SceneLight::Render()
 		// Load identity matrix into the model stack
 		modelStack.LoadIdentity();
 
-		// Calculate the light position in camera space
-		glm::vec3 lightPosition_cameraspace = viewStack.Top() * glm::vec4(light[0].position, 0);
-		glUniform3fv(m_parameters[U_LIGHT0_POSITION], 1, glm::value_ptr(lightPosition_cameraspace));
+		// Draws are queued by RenderMesh and issued sorted at the end of the frame
+		renderQueue.Begin(viewStack.Top(), projectionStack.Top());
+
+		// Camera and light are uploaded once for the whole frame
+		UniformBlocks::GetInstance()->SetFrame(viewStack.Top(), projectionStack.Top(), light, 1);
 
 		modelStack.PushMatrix();
 		// Render objects
@@ -548,681 +260,602 @@ void SceneLight::Render()
 		modelStack.PopMatrix();
 	}
 
-	//Whole upper body
+	robot.Submit(renderQueue, m_programID);
+
+	renderQueue.Flush();
+
+	RenderAntenna();
+}
+
+void SceneLight::AnimateAntenna(float dt)
+{
+	// A wave running up the chain, each joint bending a little after the one below it
+	antennaTime += dt;
+	float segment = ANTENNA_LENGTH / ANTENNA_JOINTS;
+	glm::mat4 pose(1.f);
+	for (int j = 0; j < ANTENNA_JOINTS; ++j)
 	{
-		//Render of pelvis
-		modelStack.PushMatrix();
+		if (j > 0)
+			pose = glm::translate(pose, glm::vec3(0.f, segment, 0.f));
+		pose = glm::rotate(pose, glm::radians(12.f * sinf(2.f * antennaTime - j * 0.6f)), glm::vec3(0.f, 0.f, 1.f));
+		pose = glm::rotate(pose, glm::radians(6.f * cosf(1.3f * antennaTime - j * 0.6f)), glm::vec3(1.f, 0.f, 0.f));
+		antennaPose[j] = pose;
+	}
+	antenna->ComputePalette(&antennaPose[0], &antennaPalette[0]);
+}
 
-		//Rotation of the whole boday
-		if (currAnim == ANIM_SWIMMING)
-		{
-			modelStack.Rotate(100, 1, 0, 0);
-			
-		}
-		else if (currAnim == ANIM_IDLE)
-		{
-			modelStack.Translate(0, bodyMovementAmt_idle, 0);
-		}
-		else if (currAnim == ANIM_SUMMERSAULT)
+void SceneLight::RenderAntenna()
+{
+	// Sits on top of the head and follows it
+	glm::mat4 model = glm::translate(robot.GetWorld(joints[JOINT_NECK]), glm::vec3(0.f, 3.4f, 0.f));
+	glm::mat4 modelView = viewStack.Top() * model;
+
+	GLStateCache::GetInstance()->UseProgram(m_skinProgramID);
+	UniformBlocks::GetInstance()->SetObject(projectionStack.Top() * modelView, modelView, antenna->material, enableLight, false);
+	UniformBlocks::GetInstance()->SetSkin(&antennaPalette[0], antenna->GetNumJoints());
+	antenna->Render();
+}
+
+void SceneLight::BuildRobot()
+{
+	Material eye, iris, head, chest, pelvis, body;
+	eye.kAmbient = glm::vec3(1, 0.9f, 0.4f);
+	eye.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
+	eye.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
+	eye.kShininess = 1.0f;
+	iris = eye;
+	iris.kAmbient = glm::vec3(0.7f, 0.4f, 0.f);
+	iris.kShininess = 3.0f;
+	head.kAmbient = glm::vec3(0.25f, 0.25f, 0.03f);
+	head.kDiffuse = glm::vec3(0.4f, 0.4f, 0.4f);
+	head.kSpecular = glm::vec3(0.6f, 0.6f, 0.6f);
+	head.kShininess = 1.0f;
+	chest = head;
+	chest.kAmbient = glm::vec3(0.75f, 0.25f, 0.03f);
+	chest.kShininess = 5.0f;
+	pelvis = eye;
+	body = eye;
+	body.kAmbient = glm::vec3(1, 0.2f, 0);
+
+	// Joints start at their rest pose; AnimateRobot moves them. Shapes are fixed relative to their joint
+	MatrixStack local;
+	robot.Clear();
+
+	//Whole upper body
+	joints[JOINT_PELVIS] = robot.BeginNode(glm::mat4(1.f));
+	{
+		//Render area of head
+		joints[JOINT_NECK] = robot.BeginNode(glm::mat4(1.f));
 		{
-			modelStack.Translate(0, bodyMovementAmt_ss, bodyTransAmt);
-			modelStack.Rotate(bodyRotAmt, 1, 0, 0);
+			//Eye ball left
+			local.LoadIdentity();
+			local.Translate(-1, 2.2f, 1.1f);
+			local.Scale(eyeSize, eyeSize, eyeSize);
+			local.Rotate(90, 1, 0, 0);
+			robot.AddNode(local.Top(), meshList[GEO_SPHERE], eye);
+
+			//Left eye
+			local.LoadIdentity();
+			local.Translate(-1, 2.2f, 1.15f);
+			local.Scale(eyeSize, eyeSize, eyeSize);
+			local.Rotate(90, 1, 0, 0);
+			local.Rotate(45, 0, 0, 1);
+			robot.AddNode(local.Top(), meshList[GEO_TORUS], iris);
+
+			//Eye ball right
+			local.LoadIdentity();
+			local.Translate(1, 2.2f, 1.1f);
+			local.Scale(eyeSize, eyeSize, eyeSize);
+			local.Rotate(90, 1, 0, 0);
+			robot.AddNode(local.Top(), meshList[GEO_SPHERE], eye);
+
+			//Right eye
+			local.LoadIdentity();
+			local.Translate(1, 2.2f, 1.15f);
+			local.Scale(eyeSize, eyeSize, eyeSize);
+			local.Rotate(90, 1, 0, 0);
+			local.Rotate(-45, 0, 0, 1);
+			robot.AddNode(local.Top(), meshList[GEO_TORUS], iris);
+
+			//Head
+			local.LoadIdentity();
+			local.Translate(0, 2, 0);
+			local.Scale(1.9f, 1.5f, 1.5f);
+			robot.AddNode(local.Top(), meshList[GEO_SPHERE], head);
+
+			//Neck
+			local.LoadIdentity();
+			local.Translate(0, 0.45f, 0);
+			local.Scale(0.35f, 0.35f, 0.35f);
+			robot.AddNode(local.Top(), meshList[GEO_SPHERE], body);
 		}
-		else if (currAnim == ANIM_COMBO_ATTACK)
+		robot.EndNode();
+
+		//Render of chest
+		local.LoadIdentity();
+		local.Translate(0, -0.9f, 0);
+		local.Scale(upperBodySize, 2.65f, upperBodySize);
+		robot.AddNode(local.Top(), meshList[GEO_TORUS_01], chest);
+
+		BuildArm(JOINT_LEFT_CLAVICLE, JOINT_LEFT_FOREARM, -1.f, body);
+		BuildArm(JOINT_RIGHT_CLAVICLE, JOINT_RIGHT_FOREARM, 1.f, body);
+		BuildLeg(JOINT_LEFT_HIP, JOINT_LEFT_KNEE, JOINT_LEFT_ANKLE, JOINT_LEFT_FOOT, body);
+		BuildLeg(JOINT_RIGHT_HIP, JOINT_RIGHT_KNEE, JOINT_RIGHT_ANKLE, JOINT_RIGHT_FOOT, body);
+
+		//Render of pelvis
+		local.LoadIdentity();
+		local.Translate(0, -1.8f, 0);
+		local.Scale(.4f, .4f, .4f);
+		robot.AddNode(local.Top(), meshList[GEO_SPHERE], pelvis);
+	}
+	robot.EndNode();
+
+	AnimateRobot();
+	robot.Update();
+}
+
+void SceneLight::BuildArm(JOINT clavicle, JOINT forearm, float side, const Material& material)
+{
+	MatrixStack local;
+
+	//Clavicle joint
+	joints[clavicle] = robot.BeginNode(glm::mat4(1.f));
+	{
+		//Forearm joint
+		joints[forearm] = robot.BeginNode(glm::mat4(1.f));
 		{
-			modelStack.Rotate(bodyRotAmt, 0, 1, 0);
-			modelStack.Rotate(bodyTransAmt * 3, 0, 0, 1);
-			
+			//Finger 01
+			local.LoadIdentity();
+			local.Translate(side * 1.5f, 0.25f, 0);
+			local.Scale(jointSize / 3, jointSize / 3, jointSize / 3);
+			robot.AddNode(local.Top(), meshList[GEO_SPHERE], material);
+
+			//Finger 02
+			local.LoadIdentity();
+			local.Translate(side * 1.65f, 0, 0);
+			local.Scale(jointSize / 3, jointSize / 3, jointSize / 3);
+			robot.AddNode(local.Top(), meshList[GEO_SPHERE], material);
+
+			//Finger 03
+			local.LoadIdentity();
+			local.Translate(side * 1.5f, -0.2f, 0);
+			local.Scale(jointSize / 3, jointSize / 3, jointSize / 3);
+			robot.AddNode(local.Top(), meshList[GEO_SPHERE], material);
+
+			//Hand joint
+			local.LoadIdentity();
+			local.Translate(side * 1.25f, 0, 0);
+			local.Scale(jointSize, jointSize, jointSize);
+			robot.AddNode(local.Top(), meshList[GEO_SPHERE], material);
+
+			//Forearm; the right one always sat a little further in
+			local.LoadIdentity();
+			local.Translate(side < 0.f ? -.2f : .15f, 0, 0);
+			local.Scale(0.5f, 0.25f, 0.25f);
+			local.Rotate(side * -90, 0, 0, 1);
+			robot.AddNode(local.Top(), meshList[GEO_CYLINDER], material);
+
+			//Elbow
+			local.LoadIdentity();
+			local.Scale(jointSize, jointSize, jointSize);
+			robot.AddNode(local.Top(), meshList[GEO_SPHERE], material);
 		}
-			
+		robot.EndNode();
+
+		//Shoulder; the left one always sat at -0.2, the right at 1.2
+		local.LoadIdentity();
+		local.Translate(side < 0.f ? -.2f : 1.2f, 0, 0);
+		local.Rotate(90, 0, 0, 1);
+		local.Scale(0.25f, 0.5f, 0.25f);
+		robot.AddNode(local.Top(), meshList[GEO_CYLINDER], material);
+
+		//Clavicle
+		local.LoadIdentity();
+		local.Scale(jointSize, jointSize, jointSize);
+		robot.AddNode(local.Top(), meshList[GEO_SPHERE], material);
+	}
+	robot.EndNode();
+}
+
+void SceneLight::BuildLeg(JOINT hip, JOINT knee, JOINT ankle, JOINT foot, const Material& material)
+{
+	MatrixStack local;
+
+	//Hip joint
+	joints[hip] = robot.BeginNode(glm::mat4(1.f));
+	{
+		//Thigh
+		local.LoadIdentity();
+		local.Translate(0, -1.25f, 0);
+		robot.BeginNode(local.Top());
 		{
-			//Render area of head
+			//Knee joint
+			joints[knee] = robot.BeginNode(glm::mat4(1.f));
 			{
-				//Render of neck
-				modelStack.PushMatrix();
-				if (currAnim == ANIM_WAVING)
+				//Calf
+				local.LoadIdentity();
+				local.Translate(0, -1.25f, 0);
+				robot.BeginNode(local.Top());
 				{
-					modelStack.Rotate(headRotateAmt, 0, 0, 1);
-				}
-				else if (currAnim == ANIM_SWIMMING)
-				{
-					modelStack.Rotate(-45, 1, 0, 0);
-					modelStack.Rotate(headRotateAmt, 0, 1, 0);
-				}
-				else if (currAnim == ANIM_SUMMERSAULT)
-				{
-					modelStack.Rotate(headRotateAmt, 1, 0, 0);
-				}
-				else if (currAnim == ANIM_COMBO_ATTACK)
-				{
-					modelStack.Rotate(-bodyRotAmt, 0, 1, 0);
-				}
-				
-				//Render of the head
-				{
-					modelStack.PushMatrix();
-					//Render the of two eye
+					//Ankle joint
+					joints[ankle] = robot.BeginNode(glm::mat4(1.f));
 					{
-						//Render the of left eye
-						modelStack.PushMatrix();
-
-						{
-							//Eye ball left
-							modelStack.PushMatrix();
-							modelStack.Translate(-1, 2.2f, 1.1f);
-							modelStack.Scale(eyeSize, eyeSize, eyeSize);
-							modelStack.Rotate(90, 1, 0, 0);
-							meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.9f, 0.4f);
-							meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-							meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-							meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-							RenderMesh(meshList[GEO_SPHERE], true);
-
-							modelStack.PopMatrix();
-						}
-						modelStack.Translate(-1, 2.2f, 1.15f);
-						modelStack.Scale(eyeSize, eyeSize, eyeSize);
-						modelStack.Rotate(90, 1, 0, 0);
-						modelStack.Rotate(45, 0, 0, 1);
-
-						meshList[GEO_TORUS]->material.kAmbient = glm::vec3(0.7f, 0.4f, 0.f);
-						meshList[GEO_TORUS]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-						meshList[GEO_TORUS]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-						meshList[GEO_TORUS]->material.kShininess = 3.0f;
-						RenderMesh(meshList[GEO_TORUS], true);
-						modelStack.PopMatrix();
-
-						//Render the of right eye
-						modelStack.PushMatrix();
-
-						{
-							//Eye ball right
-							modelStack.PushMatrix();
-							modelStack.Translate(1, 2.2f, 1.1f);
-							modelStack.Scale(eyeSize, eyeSize, eyeSize);
-							modelStack.Rotate(90, 1, 0, 0);
-							meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.9f, 0.4f);
-							meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-							meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-							meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-							RenderMesh(meshList[GEO_SPHERE], true);
-							modelStack.PopMatrix();
-						}
-						modelStack.Translate(1, 2.2f, 1.15f);
-						modelStack.Scale(eyeSize, eyeSize, eyeSize);
-						modelStack.Rotate(90, 1, 0, 0);
-						modelStack.Rotate(-45, 0, 0, 1);
-
-						meshList[GEO_TORUS]->material.kAmbient = glm::vec3(0.7f, 0.4f, 0.f);
-						meshList[GEO_TORUS]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-						meshList[GEO_TORUS]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-						meshList[GEO_TORUS]->material.kShininess = 3.0f;
-						RenderMesh(meshList[GEO_TORUS], true);
-						modelStack.PopMatrix();
-					}
+						//Foot, which bobs with the idle animation
+						joints[foot] = robot.AddNode(glm::mat4(1.f), meshList[GEO_CUBE], material);
 
-					modelStack.Translate(0, 2, 0);
-					modelStack.Scale(1.9f, 1.5f, 1.5f);
+						local.LoadIdentity();
+						local.Scale(jointSize, jointSize, jointSize);
+						robot.AddNode(local.Top(), meshList[GEO_SPHERE], material);
+					}
+					robot.EndNode();
 
-					meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(0.25f, 0.25f, 0.03f);
-					meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.4f, 0.4f, 0.4f);
-					meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.6f, 0.6f, 0.6f);
-					meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-					RenderMesh(meshList[GEO_SPHERE], true);
-					modelStack.PopMatrix();
+					local.LoadIdentity();
+					local.Scale(0.25f, 0.65f, 0.25f);
+					robot.AddNode(local.Top(), meshList[GEO_CYLINDER], material);
 				}
-				modelStack.Translate(0, 0.45f, 0);
-				modelStack.Scale(0.35f, 0.35f, 0.35f);
-
-				meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-				meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-				meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-				meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-				RenderMesh(meshList[GEO_SPHERE], true);
-				modelStack.PopMatrix();
-			}
-
-			//Render area of upper body
-			{
-				//Render of chest
-
-				modelStack.PushMatrix();
-				modelStack.Translate(0, -0.9f, 0);
-				modelStack.Scale(upperBodySize, 2.65f, upperBodySize);
-				meshList[GEO_TORUS_01]->material.kAmbient = glm::vec3(0.75f, 0.25f, 0.03f);
-				meshList[GEO_TORUS_01]->material.kDiffuse = glm::vec3(0.4f, 0.4f, 0.4f);
-				meshList[GEO_TORUS_01]->material.kSpecular = glm::vec3(0.6f, 0.6f, 0.6f);
-				meshList[GEO_TORUS_01]->material.kShininess = 5.0f;
-				RenderMesh(meshList[GEO_TORUS_01], true);
-				modelStack.PopMatrix();
+				robot.EndNode();
 
+				local.LoadIdentity();
+				local.Scale(jointSize, jointSize, jointSize);
+				robot.AddNode(local.Top(), meshList[GEO_SPHERE], material);
 			}
+			robot.EndNode();
 
-			//Render of left arm
-			{
-				//Left clavicle Joints
-				modelStack.PushMatrix();
-				modelStack.Translate(-1, 0, 0);
-				if (currAnim == ANIM_SWIMMING)
-				{
-					modelStack.Rotate(-rightHandTranslateAmt, 0, 0, 1);
-				}
-				else if (currAnim == ANIM_WAVING)
-				{
-					modelStack.Rotate(lefthandTranslateAmt, 0, 0, 1);
-				}
-				else if (currAnim == ANIM_IDLE)
-				{
-					modelStack.Rotate(45, 0, 0, 1);
-					modelStack.Rotate(-lefthandTranslateAmt, 0, 1, 0);
-				}
-				else if (currAnim == ANIM_SUMMERSAULT)
-				{
-					modelStack.Rotate(handRoteAmt, 0, 0, 1);
-					modelStack.Rotate(handRoteAmt, 0, 1, 0);
-				}
-				else if (currAnim == ANIM_COMBO_ATTACK)
-				{
-					modelStack.Rotate(bodyRotAmt * 2, 0, 0, 1);
-					modelStack.Rotate(lefthandTranslateAmt * 5, 0, 1, 0);
-				}
-
+			local.LoadIdentity();
+			local.Scale(0.25f, 0.65f, 0.25f);
+			robot.AddNode(local.Top(), meshList[GEO_CYLINDER], material);
+		}
+		robot.EndNode();
 
-				{
-					//Left shoulder
-					modelStack.PushMatrix();
+		local.LoadIdentity();
+		local.Scale(jointSize, jointSize, jointSize);
+		robot.AddNode(local.Top(), meshList[GEO_SPHERE], material);
+	}
+	robot.EndNode();
+}
 
-					{
-						//Left forearm joint
-						modelStack.PushMatrix();
-						modelStack.Translate(-1.3f, 0, 0);
-						if (currAnim == ANIM_COMBO_ATTACK)
-						{
-
-							modelStack.Rotate(handRoteAmt * 3.5f, 0, 1, 0);
-							modelStack.Rotate(-lefthandTranslateAmt * 7, 0, 1, 0);
-						}
-
-						{
-							//Left forearm
-							modelStack.PushMatrix();
-
-							{
-								//Left hand joint
-								modelStack.PushMatrix();
-								{
-									//Finger 01
-									modelStack.PushMatrix();
-									modelStack.Translate(-1.5f, 0.25f, 0);
-									modelStack.Scale(jointSize / 3, jointSize / 3, jointSize / 3);
-									meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-									meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-									meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-									meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-									RenderMesh(meshList[GEO_SPHERE], true);
-									modelStack.PopMatrix();
-
-									//Finger 02
-									modelStack.PushMatrix();
-									modelStack.Translate(-1.65f, 0, 0);
-									modelStack.Scale(jointSize / 3, jointSize / 3, jointSize / 3);
-									meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-									meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-									meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-									meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-									RenderMesh(meshList[GEO_SPHERE], true);
-									modelStack.PopMatrix();
-
-									//Finger 03
-									modelStack.PushMatrix();
-									modelStack.Translate(-1.5f, -0.2f, 0);
-									modelStack.Scale(jointSize / 3, jointSize / 3, jointSize / 3);
-									meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-									meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-									meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-									meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-									RenderMesh(meshList[GEO_SPHERE], true);
-									modelStack.PopMatrix();
-
-								}
-								modelStack.Translate(-1.25f, 0, 0);
-								modelStack.Scale(jointSize, jointSize, jointSize);
-								meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-								meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-								meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-								meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-								RenderMesh(meshList[GEO_SPHERE], true);
-								modelStack.PopMatrix();
-							}
-
-							modelStack.Translate(-.2f, 0, 0);
-							modelStack.Scale(0.5f, 0.25f, 0.25f);
-							modelStack.Rotate(90, 0, 0, 1);
-							meshList[GEO_CYLINDER]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-							meshList[GEO_CYLINDER]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-							meshList[GEO_CYLINDER]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-							meshList[GEO_CYLINDER]->material.kShininess = 1.0f;
-							RenderMesh(meshList[GEO_CYLINDER], true);
-							modelStack.PopMatrix();
-						}
-
-						modelStack.Scale(jointSize, jointSize, jointSize);
-
-						meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-						meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-						meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-						meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-						RenderMesh(meshList[GEO_SPHERE], true);
-						modelStack.PopMatrix();
-					}
+void SceneLight::AnimateRobot()
+{
+	MatrixStack local;
 
-					modelStack.Translate(-.2f, 0, 0);
-					modelStack.Rotate(90, 0, 0, 1);
-					modelStack.Scale(0.25f, 0.5f, 0.25f);
+	//Rotation of the whole boday
+	local.LoadIdentity();
+	if (currAnim == ANIM_SWIMMING)
+	{
+		local.Rotate(100, 1, 0, 0);
+	}
+	else if (currAnim == ANIM_IDLE)
+	{
+		local.Translate(0, bodyMovementAmt_idle, 0);
+	}
+	else if (currAnim == ANIM_SUMMERSAULT)
+	{
+		local.Translate(0, bodyMovementAmt_ss, bodyTransAmt);
+		local.Rotate(bodyRotAmt, 1, 0, 0);
+	}
+	else if (currAnim == ANIM_COMBO_ATTACK)
+	{
+		local.Rotate(bodyRotAmt, 0, 1, 0);
+		local.Rotate(bodyTransAmt * 3, 0, 0, 1);
+	}
+	robot.SetLocal(joints[JOINT_PELVIS], local.Top());
 
-					meshList[GEO_CYLINDER]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-					meshList[GEO_CYLINDER]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-					meshList[GEO_CYLINDER]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-					meshList[GEO_CYLINDER]->material.kShininess = 1.0f;
-					RenderMesh(meshList[GEO_CYLINDER], true);
-					modelStack.PopMatrix();
-				}
+	//Neck
+	local.LoadIdentity();
+	if (currAnim == ANIM_WAVING)
+	{
+		local.Rotate(headRotateAmt, 0, 0, 1);
+	}
+	else if (currAnim == ANIM_SWIMMING)
+	{
+		local.Rotate(-45, 1, 0, 0);
+		local.Rotate(headRotateAmt, 0, 1, 0);
+	}
+	else if (currAnim == ANIM_SUMMERSAULT)
+	{
+		local.Rotate(headRotateAmt, 1, 0, 0);
+	}
+	else if (currAnim == ANIM_COMBO_ATTACK)
+	{
+		local.Rotate(-bodyRotAmt, 0, 1, 0);
+	}
+	robot.SetLocal(joints[JOINT_NECK], local.Top());
 
-				modelStack.Scale(jointSize, jointSize, jointSize);
+	//Left clavicle
+	local.LoadIdentity();
+	local.Translate(-1, 0, 0);
+	if (currAnim == ANIM_SWIMMING)
+	{
+		local.Rotate(-rightHandTranslateAmt, 0, 0, 1);
+	}
+	else if (currAnim == ANIM_WAVING)
+	{
+		local.Rotate(lefthandTranslateAmt, 0, 0, 1);
+	}
+	else if (currAnim == ANIM_IDLE)
+	{
+		local.Rotate(45, 0, 0, 1);
+		local.Rotate(-lefthandTranslateAmt, 0, 1, 0);
+	}
+	else if (currAnim == ANIM_SUMMERSAULT)
+	{
+		local.Rotate(handRoteAmt, 0, 0, 1);
+		local.Rotate(handRoteAmt, 0, 1, 0);
+	}
+	else if (currAnim == ANIM_COMBO_ATTACK)
+	{
+		local.Rotate(bodyRotAmt * 2, 0, 0, 1);
+		local.Rotate(lefthandTranslateAmt * 5, 0, 1, 0);
+	}
+	robot.SetLocal(joints[JOINT_LEFT_CLAVICLE], local.Top());
 
-				meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-				meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-				meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-				meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-				RenderMesh(meshList[GEO_SPHERE], true);
-				modelStack.PopMatrix();
-			}
+	//Left forearm
+	local.LoadIdentity();
+	local.Translate(-1.3f, 0, 0);
+	if (currAnim == ANIM_COMBO_ATTACK)
+	{
+		local.Rotate(handRoteAmt * 3.5f, 0, 1, 0);
+		local.Rotate(-lefthandTranslateAmt * 7, 0, 1, 0);
+	}
+	robot.SetLocal(joints[JOINT_LEFT_FOREARM], local.Top());
 
-			//Render of right arm
-			{
-				//Right clavicle joints ( 1 )
-				modelStack.PushMatrix();
-				modelStack.Translate(1, 0, 0);
-				if (currAnim == ANIM_SWIMMING)
-				{
-					modelStack.Rotate(rightHandTranslateAmt, 0, 0, 1);
-				}
-				else if (currAnim == ANIM_WAVING)
-				{
-					modelStack.Rotate(rightHandTranslateAmt, 0, 0, 1);
-				}
-				else if (currAnim == ANIM_IDLE)
-				{
-					modelStack.Rotate(-45, 0, 0, 1);
-					modelStack.Rotate(lefthandTranslateAmt, 0, 1, 0);
-				}
-				else if (currAnim == ANIM_SUMMERSAULT)
-				{
-					modelStack.Rotate(-handRoteAmt, 0, 0, 1);
-					modelStack.Rotate(-handRoteAmt, 0, 1, 0);
-				}
-				else if (currAnim == ANIM_COMBO_ATTACK)
-				{
-					modelStack.Rotate(-bodyRotAmt * 2, 0, 0, 1);
-					modelStack.Rotate(-rightHandTranslateAmt * 5, 0, 1, 0);
-				}
+	//Right clavicle
+	local.LoadIdentity();
+	local.Translate(1, 0, 0);
+	if (currAnim == ANIM_SWIMMING)
+	{
+		local.Rotate(rightHandTranslateAmt, 0, 0, 1);
+	}
+	else if (currAnim == ANIM_WAVING)
+	{
+		local.Rotate(rightHandTranslateAmt, 0, 0, 1);
+	}
+	else if (currAnim == ANIM_IDLE)
+	{
+		local.Rotate(-45, 0, 0, 1);
+		local.Rotate(lefthandTranslateAmt, 0, 1, 0);
+	}
+	else if (currAnim == ANIM_SUMMERSAULT)
+	{
+		local.Rotate(-handRoteAmt, 0, 0, 1);
+		local.Rotate(-handRoteAmt, 0, 1, 0);
+	}
+	else if (currAnim == ANIM_COMBO_ATTACK)
+	{
+		local.Rotate(-bodyRotAmt * 2, 0, 0, 1);
+		local.Rotate(-rightHandTranslateAmt * 5, 0, 1, 0);
+	}
+	robot.SetLocal(joints[JOINT_RIGHT_CLAVICLE], local.Top());
 
-				{
-					//Right shoulder
-					modelStack.PushMatrix();
+	//Right forearm
+	local.LoadIdentity();
+	local.Translate(1.3f, 0, 0);
+	if (currAnim == ANIM_WAVING)
+	{
+		local.Rotate(rightForearmRotAmt, 0, 0, 1);
+	}
+	if (currAnim == ANIM_COMBO_ATTACK)
+	{
+		local.Rotate(-handRoteAmt * 3.5f, 0, 1, 0);
+		local.Rotate(rightHandTranslateAmt * 7, 0, 1, 0);
+	}
+	robot.SetLocal(joints[JOINT_RIGHT_FOREARM], local.Top());
 
-					{
-						//Right forearm joint ( 2 )
-						modelStack.PushMatrix();
-
-						modelStack.Translate(1.3f, 0, 0);
-						if (currAnim == ANIM_WAVING)
-						{
-							modelStack.Rotate(rightForearmRotAmt, 0, 0, 1);
-						}
-
-						if (currAnim == ANIM_COMBO_ATTACK)
-						{
-
-							modelStack.Rotate(-handRoteAmt * 3.5f, 0, 1, 0);
-							modelStack.Rotate(rightHandTranslateAmt * 7, 0, 1, 0);
-						}
-
-						{
-							//Right forearm
-							modelStack.PushMatrix();
-
-							{
-								//Right hand joint ( 3 )
-								modelStack.PushMatrix();
-
-								{
-									//Finger 01
-									modelStack.PushMatrix();
-									modelStack.Translate(1.5f, 0.25f, 0);
-									modelStack.Scale(jointSize/3, jointSize/3, jointSize/3);
-									meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-									meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-									meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-									meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-									RenderMesh(meshList[GEO_SPHERE], true);
-									modelStack.PopMatrix();
-
-									//Finger 02
-									modelStack.PushMatrix();
-									modelStack.Translate(1.65f, 0, 0);
-									modelStack.Scale(jointSize / 3, jointSize / 3, jointSize / 3);
-									meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-									meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-									meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-									meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-									RenderMesh(meshList[GEO_SPHERE], true);
-									modelStack.PopMatrix();
-
-									//Finger 03
-									modelStack.PushMatrix();
-									modelStack.Translate(1.5f, -0.2f, 0);
-									modelStack.Scale(jointSize / 3, jointSize / 3, jointSize / 3);
-									meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-									meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-									meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-									meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-									RenderMesh(meshList[GEO_SPHERE], true);
-									modelStack.PopMatrix();
-
-								}
-
-								modelStack.Translate(1.25f, 0, 0);
-								modelStack.Scale(jointSize, jointSize, jointSize);
-								meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-								meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-								meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-								meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-								RenderMesh(meshList[GEO_SPHERE], true);
-								modelStack.PopMatrix();
-							}
-
-							modelStack.Translate(.15f, 0, 0);
-							modelStack.Scale(0.5f, 0.25f, 0.25f);
-							modelStack.Rotate(-90, 0, 0, 1);
-
-							meshList[GEO_CYLINDER]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-							meshList[GEO_CYLINDER]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-							meshList[GEO_CYLINDER]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-							meshList[GEO_CYLINDER]->material.kShininess = 1.0f;
-							RenderMesh(meshList[GEO_CYLINDER], true);
-							modelStack.PopMatrix();
-						}
-
-						modelStack.Scale(jointSize, jointSize, jointSize);
-
-						meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-						meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-						meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-						meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-						RenderMesh(meshList[GEO_SPHERE], true);
-						modelStack.PopMatrix();
-					}
+	//Left hip
+	local.LoadIdentity();
+	local.Translate(-1, -2, 0);
+	if (currAnim == ANIM_IDLE)
+	{
+		local.Translate(0, -bodyMovementAmt_idle * 0.5f, 0);
+	}
+	else if (currAnim == ANIM_SUMMERSAULT)
+	{
+		local.Rotate(-legMovementAmt_ss, 1, 0, 0);
+	}
+	else if (currAnim == ANIM_SWIMMING)
+	{
+		local.Rotate(legRoteAmt, 1, 0, 0);
+	}
+	else if (currAnim == ANIM_COMBO_ATTACK)
+	{
+		local.Rotate(-legRoteAmt, 1, 0, 1);
+		local.Rotate(-bodyTransAmt * 3, 0, 0, 1);
+	}
+	robot.SetLocal(joints[JOINT_LEFT_HIP], local.Top());
 
-					modelStack.Translate(1.2f, 0, 0);
-					modelStack.Rotate(90, 0, 0, 1);
-					modelStack.Scale(0.25f, 0.5f, 0.25f);
+	//Left knee
+	local.LoadIdentity();
+	local.Translate(0, -0.15f, 0);
+	if (currAnim == ANIM_SUMMERSAULT)
+	{
+		local.Rotate(legMovementAmt_ss * 2, 1, 0, 0);
+	}
+	else if (currAnim == ANIM_COMBO_ATTACK)
+	{
+		local.Rotate(legRoteAmt, 1, 0, 1);
+	}
+	robot.SetLocal(joints[JOINT_LEFT_KNEE], local.Top());
 
-					meshList[GEO_CYLINDER]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-					meshList[GEO_CYLINDER]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-					meshList[GEO_CYLINDER]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-					meshList[GEO_CYLINDER]->material.kShininess = 1.0f;
-					RenderMesh(meshList[GEO_CYLINDER], true);
-					modelStack.PopMatrix();
-				}
+	//Right hip
+	local.LoadIdentity();
+	local.Translate(1.f, -2, 0);
+	if (currAnim == ANIM_IDLE)
+	{
+		local.Translate(0, -bodyMovementAmt_idle * 0.5f, 0);
+	}
+	else if (currAnim == ANIM_SUMMERSAULT)
+	{
+		local.Rotate(-legMovementAmt_ss, 1, 0, 0);
+	}
+	else if (currAnim == ANIM_SWIMMING)
+	{
+		local.Rotate(-legRoteAmt, 1, 0, 0);
+	}
+	else if (currAnim == ANIM_COMBO_ATTACK)
+	{
+		local.Rotate(legRoteAmt, 1, 0, 1);
+		local.Rotate(-legMovementAmt_ss * 5, 1, 0, 0);
+	}
+	robot.SetLocal(joints[JOINT_RIGHT_HIP], local.Top());
 
-				modelStack.Scale(jointSize, jointSize, jointSize);
-				meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-				meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-				meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-				meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-				RenderMesh(meshList[GEO_SPHERE], true);
-				modelStack.PopMatrix();
-			}
-				
-			//Render of left leg
-			{
-				//Left hip Joints (1)
-				modelStack.PushMatrix();
-				modelStack.Translate(-1, -2, 0);
-				if (currAnim == ANIM_IDLE)
-				{
-					modelStack.Translate(0, -bodyMovementAmt_idle * 0.5f, 0);
-				}
-				else if (currAnim == ANIM_SUMMERSAULT)
-				{
-					modelStack.Rotate(-legMovementAmt_ss, 1, 0, 0);
-				}
-				else if (currAnim == ANIM_SWIMMING)
-				{
-					modelStack.Rotate(legRoteAmt, 1, 0, 0);
-				}
-				else if (currAnim == ANIM_COMBO_ATTACK)
-				{
-					modelStack.Rotate(-legRoteAmt, 1, 0, 1);
-					modelStack.Rotate(-bodyTransAmt * 3, 0, 0, 1);
-					
-				}
-				{
-					//Left thigh
-					modelStack.PushMatrix();
-					modelStack.Translate(0, -1.25f, 0);
-					{
-						//Left Knee (2)
-						modelStack.PushMatrix();
-						modelStack.Translate(0, -0.15f, 0);
-						if (currAnim == ANIM_SUMMERSAULT)
-						{
-							modelStack.Rotate(legMovementAmt_ss * 2, 1, 0, 0);
-						}
-						else if (currAnim == ANIM_COMBO_ATTACK)
-						{
-							modelStack.Rotate(legRoteAmt, 1, 0, 1);
-						}
-						{
-							//Left calf
-							modelStack.PushMatrix();
-							modelStack.Translate(0, -1.25f, 0);
-
-							{
-								//Left ankle (3)
-								modelStack.PushMatrix();
-								modelStack.Translate(0, -0.25f, 0);
-								if (currAnim == ANIM_SUMMERSAULT)
-								{
-									modelStack.Rotate(-legMovementAmt_ss / 1.5f, 1, 0, 0);
-								}
-								{
-									//Left Legs
-									modelStack.PushMatrix();
-									modelStack.Translate(0, -0.45f, 0.1f);
-									modelStack.Translate(0, bodyMovementAmt_idle, 0);
-									modelStack.Scale(0.55f, 0.15f, 0.55f);
-									modelStack.Rotate(35, 0, 1, 0);
-									meshList[GEO_CUBE]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-									meshList[GEO_CUBE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-									meshList[GEO_CUBE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-									meshList[GEO_CUBE]->material.kShininess = 1.0f;
-									RenderMesh(meshList[GEO_CUBE], true);
-									modelStack.PopMatrix();
-								}
-								
-								modelStack.Scale(jointSize, jointSize, jointSize);
-								meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-								meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-								meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-								meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-								RenderMesh(meshList[GEO_SPHERE], true);
-								modelStack.PopMatrix();
-							}
-							
-							modelStack.Scale(0.25f, 0.65f, 0.25f);
-							meshList[GEO_CYLINDER]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-							meshList[GEO_CYLINDER]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-							meshList[GEO_CYLINDER]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-							meshList[GEO_CYLINDER]->material.kShininess = 1.0f;
-							RenderMesh(meshList[GEO_CYLINDER], true);
-							modelStack.PopMatrix();
-						}
-						
-						modelStack.Scale(jointSize, jointSize, jointSize);
-						meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-						meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-						meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-						meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-						RenderMesh(meshList[GEO_SPHERE], true);
-						modelStack.PopMatrix();
+	//Right knee
+	local.LoadIdentity();
+	local.Translate(0, -0.15f, 0);
+	if (currAnim == ANIM_SUMMERSAULT)
+	{
+		local.Rotate(legMovementAmt_ss * 2, 1, 0, 0);
+	}
+	else if (currAnim == ANIM_COMBO_ATTACK)
+	{
+		local.Rotate(legMovementAmt_ss * 5, 1, 0, 0);
+	}
+	robot.SetLocal(joints[JOINT_RIGHT_KNEE], local.Top());
 
-					}
-					
-					modelStack.Scale(0.25f, 0.65f, 0.25f);
-					meshList[GEO_CYLINDER]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-					meshList[GEO_CYLINDER]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-					meshList[GEO_CYLINDER]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-					meshList[GEO_CYLINDER]->material.kShininess = 1.0f;
-					RenderMesh(meshList[GEO_CYLINDER], true);
-					modelStack.PopMatrix();
-				}
-				
-				modelStack.Scale(jointSize, jointSize, jointSize);
-				meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-				meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-				meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-				meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-				RenderMesh(meshList[GEO_SPHERE], true);
-				modelStack.PopMatrix();
-			}
+	//Both ankles
+	local.LoadIdentity();
+	local.Translate(0, -0.25f, 0);
+	if (currAnim == ANIM_SUMMERSAULT)
+	{
+		local.Rotate(-legMovementAmt_ss / 1.5f, 1, 0, 0);
+	}
+	robot.SetLocal(joints[JOINT_LEFT_ANKLE], local.Top());
+	robot.SetLocal(joints[JOINT_RIGHT_ANKLE], local.Top());
+
+	//Feet
+	local.LoadIdentity();
+	local.Translate(0, -0.45f, 0.1f);
+	local.Translate(0, bodyMovementAmt_idle, 0);
+	local.Scale(0.55f, 0.15f, 0.55f);
+	local.PushMatrix();
+	local.Rotate(35, 0, 1, 0);
+	robot.SetLocal(joints[JOINT_LEFT_FOOT], local.Top());
+	local.PopMatrix();
+	local.Rotate(-35, 0, 1, 0);
+	robot.SetLocal(joints[JOINT_RIGHT_FOOT], local.Top());
+}
 
-			//Render of right leg
-			{
-				//Right leg Joints
-				modelStack.PushMatrix();
-				modelStack.Translate(1.f, -2, 0);	
-				if (currAnim == ANIM_IDLE)
-				{
-					modelStack.Translate(0, -bodyMovementAmt_idle * 0.5f, 0);
-				}
-				else if (currAnim == ANIM_SUMMERSAULT)
-				{
-					modelStack.Rotate(-legMovementAmt_ss, 1, 0, 0);
-				}
-				else if (currAnim == ANIM_SWIMMING)
-				{
-					modelStack.Rotate(-legRoteAmt, 1, 0, 0);
-				}
-				else if (currAnim == ANIM_COMBO_ATTACK)
-				{
-					modelStack.Rotate(legRoteAmt, 1, 0, 1);
-					modelStack.Rotate(-legMovementAmt_ss * 5, 1, 0, 0);
-				}
+void SceneLight::PoseAt(ANIMATION anim, float t)
+{
+	// Closed forms of what the old per-frame increments and bounce checks produced
+	setDefaultValue();
+	switch (anim)
+	{
+	case ANIM_IDLE:
+		lefthandTranslateAmt = Bounce(t, -30, 30, 30, 30);
+		bodyMovementAmt_idle = Bounce(t, 0, 0.25f, 0.5f, 0.5f);
+		break;
+	case ANIM_WAVING:
+		//Head tilt to left, wave, put down the left hand
+		headRotateAmt = Ramp(t, 50, 20);
+		rightHandTranslateAmt = Bounce(t, 0, 40, 35, 35);
+		rightForearmRotAmt = rightHandTranslateAmt * 40 / 35;
+		lefthandTranslateAmt = Ramp(t, 20, 45);
+		break;
+	case ANIM_SWIMMING:
+		// Strokes are timed so head, hands and legs all come round together every 6 seconds
+		headRotateAmt = Bounce(t, -30, 30, 20, 20);
+		rightHandTranslateAmt = Bounce(t, -55, 55, 55, 110);
+		legRoteAmt = Bounce(t, -50, 50, 200.f / 3, 200.f / 3);
+		break;
+	case ANIM_SUMMERSAULT:
+	{
+		// Crouch for 2 seconds, flip for 2.4, then straighten up
+		float flip = std::min(std::max(t - 2.f, 0.f), 2.4f);
+		float after = std::max(t - 4.4f, 0.f);
+		headRotateAmt = std::max(Ramp(t, 20, 30) - 20 * after, 0.f);
+		bodyMovementAmt_ss = Ramp(t, -0.5f, -1);
+		bodyTransAmt = flip * 5;
+		bodyRotAmt = flip * 150;
+		legMovementAmt_ss = std::max(Ramp(t, 26, 55) - 26 * after, 0.f);
+		handRoteAmt = std::max(Ramp(t, 26, 50) - 26 * after, 0.f);
+		break;
+	}
+	case ANIM_COMBO_ATTACK:
+	{
+		// Ten punches, right hand first, once the guard is up, then a kick
+		float punchStart = 40.f / 26;
+		bodyRotAmt = Ramp(t, 20, 20);
+		handRoteAmt = Ramp(t, 26, 40);
+		for (int i = 0; i < 10; ++i)
+		{
+			float punch = Pulse(t, punchStart + i * 0.25f, 20, 160);
+			if (i % 2 == 0)
+				rightHandTranslateAmt += punch;
+			else
+				lefthandTranslateAmt += punch;
+		}
+		legRoteAmt = Ramp(t, 60, 20);
+		float kickStart = punchStart + 10 * 0.25f;
+		legMovementAmt_ss = Pulse(t, kickStart, 30, 52);
+		bodyTransAmt = Pulse(t, kickStart, 10, 15.5f);
+		break;
+	}
+	default:
+		break;
+	}
+}
 
-				{
-					//Right thigh
-					modelStack.PushMatrix();
-					modelStack.Translate(0, -1.25f, 0);
-					{
-						//Right Knee
-						modelStack.PushMatrix();
-						modelStack.Translate(0, -0.15f, 0);
-						if (currAnim == ANIM_SUMMERSAULT)
-						{
-							modelStack.Rotate(legMovementAmt_ss * 2, 1, 0, 0);
-						}
-						else if (currAnim == ANIM_COMBO_ATTACK)
-						{
-							modelStack.Rotate(legMovementAmt_ss * 5, 1, 0, 0);
-						}
-				
-						{
-							//Right calf
-							modelStack.PushMatrix();
-							modelStack.Translate(0, -1.25f, 0);
-							{
-								//Right ankle
-								modelStack.PushMatrix();
-								modelStack.Translate(0, -0.25f, 0);
-								if (currAnim == ANIM_SUMMERSAULT)
-								{
-									modelStack.Rotate(-legMovementAmt_ss/1.5f, 1, 0, 0);
-								}
-								{
-									//Right Legs
-									modelStack.PushMatrix();
-									modelStack.Translate(0, -0.45f, 0.1f);
-									modelStack.Translate(0, bodyMovementAmt_idle, 0);
-									modelStack.Scale(0.55f, 0.15f, 0.55f);
-									modelStack.Rotate(-35, 0, 1, 0);
-									meshList[GEO_CUBE]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-									meshList[GEO_CUBE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-									meshList[GEO_CUBE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-									meshList[GEO_CUBE]->material.kShininess = 1.0f;
-									RenderMesh(meshList[GEO_CUBE], true);
-									modelStack.PopMatrix();
-								}
-								
-								modelStack.Scale(jointSize, jointSize, jointSize);
-								meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-								meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-								meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-								meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-								RenderMesh(meshList[GEO_SPHERE], true);
-								modelStack.PopMatrix();
-							}
-							
-							modelStack.Scale(0.25f, 0.65f, 0.25f);
-							meshList[GEO_CYLINDER]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-							meshList[GEO_CYLINDER]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-							meshList[GEO_CYLINDER]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-							meshList[GEO_CYLINDER]->material.kShininess = 1.0f;
-							RenderMesh(meshList[GEO_CYLINDER], true);
-							modelStack.PopMatrix();
-						}
-						
-						modelStack.Scale(jointSize, jointSize, jointSize);
-						meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-						meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-						meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-						meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-						RenderMesh(meshList[GEO_SPHERE], true);
-						modelStack.PopMatrix();
-					}
-					
-					modelStack.Scale(0.25f, 0.65f, 0.25f);
-					meshList[GEO_CYLINDER]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-					meshList[GEO_CYLINDER]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-					meshList[GEO_CYLINDER]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-					meshList[GEO_CYLINDER]->material.kShininess = 1.0f;
-					RenderMesh(meshList[GEO_CYLINDER], true);
-					modelStack.PopMatrix();
-				}
-				
-				modelStack.Scale(jointSize, jointSize, jointSize);
-				meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.2f, 0);
-				meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-				meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-				meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-				RenderMesh(meshList[GEO_SPHERE], true);
-				modelStack.PopMatrix();
+void SceneLight::CapturePose(AnimationPose& out)
+{
+	out.Resize(NUM_JOINTS);
+	for (int j = 0; j < NUM_JOINTS; ++j)
+	{
+		// Every joint is translate * rotate * scale, so the column lengths are the scale
+		const glm::mat4& local = robot.GetLocal(joints[j]);
+		glm::vec3 scale(glm::length(glm::vec3(local[0])), glm::length(glm::vec3(local[1])), glm::length(glm::vec3(local[2])));
+		glm::mat3 rotation(glm::vec3(local[0]) / scale.x, glm::vec3(local[1]) / scale.y, glm::vec3(local[2]) / scale.z);
+		out.SetJoint(j, glm::vec3(local[3]), glm::normalize(glm::quat_cast(rotation)), scale);
+	}
+}
 
-			}
+void SceneLight::AuthorClips()
+{
+	struct ClipInfo
+	{
+		const char* name;
+		float duration;
+		bool loop;
+		float loopStart;
+		// Keys per second; adjusted slightly so the last key lands on the duration
+		float keyRate;
+	};
+	const ClipInfo info[NUM_ANIM] =
+	{
+		{ "default", 0.f, false, 0.f, 30.f },
+		{ "idle", 4.f, true, 0.f, 30.f },
+		// The wave loops once the left hand is down
+		{ "waving", 160.f / 35, true, 80.f / 35, 30.f },
+		{ "swimming", 6.f, true, 0.f, 30.f },
+		{ "summersault", 6.6f, false, 0.f, 30.f },
+		// Punches turn the forearms over a thousand degrees a second
+		{ "combo attack", 5.4f, false, 0.f, 120.f },
+	};
+
+	std::cout << "Keying robot animation clips\n";
+	ANIMATION playing = currAnim;
+	AnimationPose key;
+	clips.assign(NUM_ANIM, AnimationClip());
+	for (int anim = 0; anim < NUM_ANIM; ++anim)
+	{
+		unsigned numKeys = static_cast<unsigned>(ceil(info[anim].duration * info[anim].keyRate)) + 1;
+		float frameRate = numKeys > 1 ? (numKeys - 1) / info[anim].duration : info[anim].keyRate;
+		clips[anim].Create(info[anim].name, NUM_JOINTS, numKeys, frameRate, info[anim].loop, info[anim].loopStart);
 
+		currAnim = static_cast<ANIMATION>(anim);
+		for (unsigned k = 0; k < numKeys; ++k)
+		{
+			PoseAt(currAnim, k / frameRate);
+			AnimateRobot();
+			CapturePose(key);
+			clips[anim].SetKey(k, key);
 		}
-
-		modelStack.Translate(0, -1.8f, 0);
-		modelStack.Scale(.4f, .4f, .4f);
-		meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(1, 0.9f, 0.4f);
-		meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-		meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-		meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-		RenderMesh(meshList[GEO_SPHERE], true);
-
-		modelStack.PopMatrix();
 	}
+
+	// Back to the rest pose
+	currAnim = playing;
+	setDefaultValue();
+	AnimateRobot();
+	robot.Update();
 }
 
 void SceneLight::Exit()
@@ -1235,8 +868,9 @@ void SceneLight::Exit()
 			delete meshList[i];
 		}
 	}
-	glDeleteVertexArrays(1, &m_vertexArrayID);
-	glDeleteProgram(m_programID);
+	delete antenna;
+	GLStateCache::GetInstance()->DeleteProgram(m_programID);
+	GLStateCache::GetInstance()->DeleteProgram(m_skinProgramID);
 }
 
 void SceneLight::HandleKeyPress() 
@@ -1244,22 +878,22 @@ void SceneLight::HandleKeyPress()
 	if (Application::IsKeyPressed(0x31))
 	{
 		// Key press to enable culling
-		glEnable(GL_CULL_FACE);
+		GLStateCache::GetInstance()->Enable(GL_CULL_FACE);
 	}
 	if (Application::IsKeyPressed(0x32))
 	{
 		// Key press to disable culling
-		glDisable(GL_CULL_FACE);
+		GLStateCache::GetInstance()->Disable(GL_CULL_FACE);
 	}
 	if (Application::IsKeyPressed(0x33))
 	{
 		// Key press to enable fill mode for the polygon
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); //default fill mode
+		GLStateCache::GetInstance()->PolygonMode(GL_FILL); //default fill mode
 	}
 	if (Application::IsKeyPressed(0x34))
 	{
 		// Key press to enable wireframe mode for the polygon
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); //wireframe mode
+		GLStateCache::GetInstance()->PolygonMode(GL_LINE); //wireframe mode
 	}
 	if (KeyboardController::GetInstance()->IsKeyPressed('P'))
 	{
@@ -1284,67 +918,44 @@ void SceneLight::HandleKeyPress()
 	//Start idle animation
 	if (KeyboardController::GetInstance()->IsKeyPressed('Z'))
 	{
-		setDefaultValue();
 		currAnim = ANIM_IDLE;
+		player.Play(&clips[currAnim], FADE_TIME);
 		std::cout <<"IDLING" << '\n';
 	}
 	if (KeyboardController::GetInstance()->IsKeyPressed('X'))
 	{
-		setDefaultValue();
 		currAnim = ANIM_WAVING;
+		player.Play(&clips[currAnim], FADE_TIME);
 		std::cout << "Waving !" << '\n';
 	}
 	if (KeyboardController::GetInstance()->IsKeyPressed('C'))
 	{
-		setDefaultValue();
 		currAnim = ANIM_SWIMMING;
+		player.Play(&clips[currAnim], FADE_TIME);
 		std::cout << "Swimming !" << '\n';
 	}
 	if (KeyboardController::GetInstance()->IsKeyPressed('V'))
 	{
-		setDefaultValue();
 		currAnim = ANIM_SUMMERSAULT;
+		player.Play(&clips[currAnim], FADE_TIME);
 		std::cout << "Summersaulting !" << '\n';
 	}
 	if (KeyboardController::GetInstance()->IsKeyPressed('B'))
 	{
-		setDefaultValue();
 		currAnim = ANIM_COMBO_ATTACK;
+		player.Play(&clips[currAnim], FADE_TIME);
 		std::cout << "Combo attacking !" << '\n';
 	}
 	if (KeyboardController::GetInstance()->IsKeyPressed('R'))
 	{
 		currAnim = ANIM_DEFAULT;
+		player.Play(&clips[currAnim], FADE_TIME);
 		std::cout << "Default Pos !" << '\n';
 	}
 }
 
 void SceneLight::RenderMesh(Mesh* mesh, bool enableLight)
 {
-	glm::mat4 MVP, modelView, modelView_inverse_transpose;
-
-	MVP = projectionStack.Top() * viewStack.Top() * modelStack.Top();
-	glUniformMatrix4fv(m_parameters[U_MVP], 1, GL_FALSE, glm::value_ptr(MVP));
-	modelView = viewStack.Top() * modelStack.Top();
-	glUniformMatrix4fv(m_parameters[U_MODELVIEW], 1, GL_FALSE, glm::value_ptr(modelView));
-
-	if (enableLight)
-	{
-		glUniform1i(m_parameters[U_LIGHTENABLED], 1);
-		modelView_inverse_transpose = glm::inverseTranspose(modelView);
-		glUniformMatrix4fv(m_parameters[U_MODELVIEW_INVERSE_TRANSPOSE], 1, GL_FALSE,
-			glm::value_ptr(modelView_inverse_transpose));
-
-		//load material
-		glUniform3fv(m_parameters[U_MATERIAL_AMBIENT], 1, glm::value_ptr(mesh->material.kAmbient));
-		glUniform3fv(m_parameters[U_MATERIAL_DIFFUSE], 1, glm::value_ptr(mesh->material.kDiffuse));
-		glUniform3fv(m_parameters[U_MATERIAL_SPECULAR], 1, glm::value_ptr(mesh->material.kSpecular));
-		glUniform1f(m_parameters[U_MATERIAL_SHININESS], mesh->material.kShininess);
-	}
-	else
-	{
-		glUniform1i(m_parameters[U_LIGHTENABLED], 0);
-	}
-	mesh->Render();
+	renderQueue.Submit(mesh, modelStack.Top(), m_programID, enableLight);
 }
 
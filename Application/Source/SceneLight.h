@@ -7,6 +7,11 @@
 #include "MatrixStack.h"
 #include "SceneLight.h"
 #include "Light.h"
+#include "RenderQueue.h"
+#include "SceneGraph.h"
+#include "AnimationClip.h"
+#include "AnimationPlayer.h"
+#include "SkinnedMesh.h"
 
 class SceneLight : public Scene
 {
@@ -25,25 +30,6 @@ public:
 		NUM_GEOMETRY,
 	};
 
-	enum UNIFORM_TYPE
-	{
-		U_MVP = 0,
-		U_MODELVIEW,
-		U_MODELVIEW_INVERSE_TRANSPOSE,
-		U_MATERIAL_AMBIENT,
-		U_MATERIAL_DIFFUSE,
-		U_MATERIAL_SPECULAR,
-		U_MATERIAL_SHININESS,
-		U_LIGHT0_POSITION,
-		U_LIGHT0_COLOR,
-		U_LIGHT0_POWER,
-		U_LIGHT0_KC,
-		U_LIGHT0_KL,
-		U_LIGHT0_KQ,
-		U_LIGHTENABLED,
-		U_TOTAL,
-	};
-
 	enum ANIMATION
 	{
 		ANIM_DEFAULT,
@@ -56,6 +42,27 @@ public:
 		NUM_ANIM
 	};
 
+	// Robot nodes whose local transform is animated
+	enum JOINT
+	{
+		JOINT_PELVIS,
+		JOINT_NECK,
+		JOINT_LEFT_CLAVICLE,
+		JOINT_LEFT_FOREARM,
+		JOINT_RIGHT_CLAVICLE,
+		JOINT_RIGHT_FOREARM,
+		JOINT_LEFT_HIP,
+		JOINT_LEFT_KNEE,
+		JOINT_LEFT_ANKLE,
+		JOINT_LEFT_FOOT,
+		JOINT_RIGHT_HIP,
+		JOINT_RIGHT_KNEE,
+		JOINT_RIGHT_ANKLE,
+		JOINT_RIGHT_FOOT,
+
+		NUM_JOINTS
+	};
+
 	SceneLight();
 	~SceneLight();
 
@@ -68,20 +75,42 @@ public:
 
 private:
 	void RenderMesh(Mesh* mesh, bool enableLight);
+
+	// Builds the robot hierarchy once; AnimateRobot only rewrites the joints
+	void BuildRobot();
+	void BuildArm(JOINT clavicle, JOINT forearm, float side, const Material& material);
+	void BuildLeg(JOINT hip, JOINT knee, JOINT ankle, JOINT foot, const Material& material);
+	void AnimateRobot();
+
+	// Keys the clips from the procedural poses AnimateRobot builds, for when no clip file is found
+	void AuthorClips();
+	void PoseAt(ANIMATION anim, float time);
+	void CapturePose(AnimationPose& out);
+
+	// Sways the antenna's joint chain; it is skinned, so the whole antenna is one draw
+	void AnimateAntenna(float dt);
+	void RenderAntenna();
 	
 	AltAzCamera camera;
 
 	void HandleKeyPress();
 
-	unsigned m_vertexArrayID;
 	Mesh* meshList[NUM_GEOMETRY];
 
 	unsigned m_programID;
-	unsigned m_parameters[U_TOTAL];
 
 	// other variables
 
 	MatrixStack modelStack, viewStack, projectionStack;
+	RenderQueue renderQueue;
+	SceneGraph robot;
+	unsigned joints[NUM_JOINTS];
+
+	unsigned m_skinProgramID;
+	SkinnedMesh* antenna;
+	float antennaTime;
+	std::vector<glm::mat4> antennaPose;		// model space transform of each antenna joint
+	std::vector<glm::mat4> antennaPalette;
 
 	int projType = 1; // fix to 0 for orthographic, 1 for projection
 	
@@ -93,12 +122,15 @@ private:
 	// Keep track of current animation
 
 	ANIMATION currAnim;
+	std::vector<AnimationClip> clips;
+	AnimationPlayer player;
+	AnimationPose pose;
+
 	//Common
 	float jointSize;
 
 	//Head regions
 	float headRotateAmt;
-	float headRotateSpeed;
 	float eyeSize;
 
 	//Chest
@@ -106,58 +138,25 @@ private:
 
 	//Left hand
 	float lefthandTranslateAmt;
-	float leftHandTranslateSpeed;
-
-	float lefthandRotSpeed;
 
 	//Right hand
 	float rightHandTranslateAmt;
-	float rightHandTranslateSpeed;
-
 	float rightForearmRotAmt;
 
-	float rightHandRotateSpeed;
-	float rightForearmRotSpeed;
-
 	//Left leg
 	float leftlegRotateAmt;
-	float leftlegRotSpeed;
 	//Right leg
 	float rightlegRoteAmt;
-	float rightlegRotespeed;
 
 	//Common use var
 	float legRoteAmt;
-	float legRotSpeed;
 
 	float bodyMovementAmt_idle;
-	float bodyMovementSpeed_idle;
-
 	float bodyMovementAmt_ss;
-	float bodyMovementSpeed_ss;
-
 	float legMovementAmt_ss;
-	float legMovementSpeed_ss;
-
 	float handRoteAmt;
-	float handRoteSpeed;
-
 	float bodyRotAmt;
-	float bodyRotSpeed;
-	float bodyRotSpeed_ca;
-
 	float bodyTransAmt;
-	float bodyTransSped;
-
-	bool finishAnim_SS;
-
-	bool rightHandAnim;
-	bool leftHandAnim;
-	bool kickAnim;
-
-	int punchCounter;
-
-
 };
 
 #endif
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "SceneLightSource.h"
 #include "GL\glew.h"
+#include "GLStateCache.h"
+#include "UniformBlocks.h"
 
 // GLM Headers
 #include <glm\glm.hpp>
@@ -82,67 +84,24 @@ void SceneLightSource::Init()
 	glClearColor(0.0f, 0.0f, 0.4f, 0.0f);
 
 	//Enable depth buffer and depth testing
-	glEnable(GL_DEPTH_TEST);
+	GLStateCache::GetInstance()->Enable(GL_DEPTH_TEST);
 
 	// Enable back face culling
-	glEnable(GL_CULL_FACE);
+	GLStateCache::GetInstance()->Enable(GL_CULL_FACE);
 
 	//Default to fill mode
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-	// Generate a default VAO for now
-	glGenVertexArrays(1, &m_vertexArrayID);
-	glBindVertexArray(m_vertexArrayID);
+	GLStateCache::GetInstance()->PolygonMode(GL_FILL);
 
 	m_programID = LoadShaders("Shader//Shading.vertexshader",
 		"Shader//LightSource.fragmentshader");
-	glUseProgram(m_programID);
-	
-
-
-	// Get a handle for our "MVP" uniform
-	{
-		
-	m_parameters[U_LIGHT1_TYPE] = glGetUniformLocation(m_programID, "lights[1].type");
-	m_parameters[U_MVP] = glGetUniformLocation(m_programID, "MVP");
-	m_parameters[U_MODELVIEW] = glGetUniformLocation(m_programID, "MV");
-	m_parameters[U_MODELVIEW_INVERSE_TRANSPOSE] = glGetUniformLocation(m_programID, "MV_inverse_transpose");
-	m_parameters[U_MATERIAL_AMBIENT] = glGetUniformLocation(m_programID, "material.kAmbient");
-	m_parameters[U_MATERIAL_DIFFUSE] = glGetUniformLocation(m_programID, "material.kDiffuse");
-	m_parameters[U_MATERIAL_SPECULAR] = glGetUniformLocation(m_programID, "material.kSpecular");
-	m_parameters[U_MATERIAL_SHININESS] = glGetUniformLocation(m_programID, "material.kShininess");
-
-	m_parameters[U_LIGHT0_TYPE] = glGetUniformLocation(m_programID, "light[0].type");
-	
-	m_parameters[U_LIGHT0_POSITION] = glGetUniformLocation(m_programID, "lights[0].position_cameraspace");
-	m_parameters[U_LIGHT0_COLOR] = glGetUniformLocation(m_programID, "lights[0].color");
-	m_parameters[U_LIGHT0_POWER] = glGetUniformLocation(m_programID, "lights[0].power");
-	m_parameters[U_LIGHT0_KC] = glGetUniformLocation(m_programID, "lights[0].kC");
-	m_parameters[U_LIGHT0_KL] = glGetUniformLocation(m_programID, "lights[0].kL");
-	m_parameters[U_LIGHT0_KQ] = glGetUniformLocation(m_programID, "lights[0].kQ");
-
-	m_parameters[U_LIGHT0_SPOTDIRECTION] = glGetUniformLocation(m_programID,
-		"lights[0].spotDirection");
-	m_parameters[U_LIGHT0_COSCUTOFF] = glGetUniformLocation(m_programID, "lights[0].cosCutoff");
-	m_parameters[U_LIGHT0_COSINNER] = glGetUniformLocation(m_programID, "lights[0].cosInner");
-	m_parameters[U_LIGHT0_EXPONENT] = glGetUniformLocation(m_programID, "lights[0].exponent");
-
-
-	m_parameters[U_LIGHTENABLED] = glGetUniformLocation(m_programID, "lightEnabled");
-	m_parameters[U_NUMLIGHTS] = glGetUniformLocation(m_programID, "numLights");
-
-	glUniform1i(m_parameters[U_NUMLIGHTS], NUM_LIGHTS);
+	GLStateCache::GetInstance()->UseProgram(m_programID);
 
-
-	}
+	// Matrices, material and lights come from the shared uniform blocks
+	UniformBlocks::GetInstance()->BindProgram(m_programID);
 
 	// Load identity matrix into the model stack
 	modelStack.LoadIdentity();
 
-	// Calculate the light position in camera space
-	glm::vec3 lightPosition_cameraspace = viewStack.Top() * glm::vec4(light[0].position, 1);
-	glUniform3fv(m_parameters[U_LIGHT0_POSITION], 1, glm::value_ptr(lightPosition_cameraspace));
-
 	// Init VBO here
 	for (int i = 0; i < NUM_GEOMETRY; ++i)
 	{
@@ -160,6 +119,7 @@ void SceneLightSource::Init()
 	meshList[GEO_SPHERE1] = MeshBuilder::GenerateSphere("1", glm::vec3(1.f, 1.f, 1.f), 1.f, 6, 6);
 	//1.
 	meshList[GEO_SPHERE] = MeshBuilder::GenerateSphere("Sphere", glm::vec3(1.f, 1.f, 1.f), 1.f, 6, 6);
+	lightMarkerLOD.InitSphere("LightMarker", glm::vec3(1.f, 1.f, 1.f), 1.f);
 	////2.
 	//meshList[GEO_TORUS] = MeshBuilder::GenerateTorus("Torus", glm::vec3(1, 1, 1), 0.5f, 1, 8, 8);
 	////3.
@@ -192,15 +152,6 @@ void SceneLightSource::Init()
 
 	light[0].spotDirection = glm::vec3(0.f, 1.f, 0.f);
 
-	glUniform3fv(m_parameters[U_LIGHT0_COLOR], 1, &light[0].color.r);
-	glUniform1f(m_parameters[U_LIGHT0_TYPE], light[0].type);
-	glUniform1f(m_parameters[U_LIGHT0_POWER], light[0].power);
-	glUniform1f(m_parameters[U_LIGHT0_KC], light[0].kC);
-	glUniform1f(m_parameters[U_LIGHT0_KL], light[0].kL);
-	glUniform1f(m_parameters[U_LIGHT0_KQ], light[0].kQ);
-
-	glUniform1f(m_parameters[U_LIGHT0_COSCUTOFF], cosf(glm::radians<float>(light[0].cosCutoff))); glUniform1f(m_parameters[U_LIGHT0_COSINNER], cosf(glm::radians<float>(light[0].cosInner))); glUniform1f(m_parameters[U_LIGHT0_EXPONENT], light[0].exponent);
-
 	light[1].position = glm::vec3(2, 2, 2);
 	light[1].color = glm::vec3(1, 0.1f, 0.1f);
 	light[1].type = Light::LIGHT_DIRECTIONAL;
@@ -213,16 +164,6 @@ void SceneLightSource::Init()
 	light[1].exponent = 3.f;
 	light[1].spotDirection = glm::vec3(1.f, 1.f, 0.f);
 
-	glUniform3fv(m_parameters[U_LIGHT1_TYPE], 1, &light[1].color.r);
-	glUniform1f(m_parameters[U_LIGHT0_TYPE], light[1].type);
-
-	glUniform1f(m_parameters[U_LIGHT0_POWER], light[1].power);
-	glUniform1f(m_parameters[U_LIGHT0_KC], light[1].kC);
-	glUniform1f(m_parameters[U_LIGHT0_KL], light[1].kL);
-	glUniform1f(m_parameters[U_LIGHT0_KQ], light[1].kQ);
-
-	glUniform1f(m_parameters[U_LIGHT0_COSCUTOFF], cosf(glm::radians<float>(light[1].cosCutoff))); glUniform1f(m_parameters[U_LIGHT0_COSINNER], cosf(glm::radians<float>(light[1].cosInner))); glUniform1f(m_parameters[U_LIGHT0_EXPONENT], light[1].exponent);
-
 	////Common
 	//jointSize = 0.35f;
 	//eyeSize = 0.3f;
@@ -580,52 +521,12 @@ void SceneLightSource::Render()
 
 		// Load identity matrix into the model stack
 		modelStack.LoadIdentity();
-		
-		if (light[0].type == Light::LIGHT_DIRECTIONAL)
-		{
-			glm::vec3 lightDir(light[0].position.x, light[0].position.y, light[0].position.z);
-			glm::vec3 lightDirection_cameraspace = viewStack.Top() * glm::vec4(lightDir, 0);
-			glUniform3fv(m_parameters[U_LIGHT0_POSITION], 1,
-				glm::value_ptr(lightDirection_cameraspace));
-		}
-		else if (light[0].type == Light::LIGHT_SPOT) {
-			glm::vec3 lightPosition_cameraspace = viewStack.Top() * glm::vec4(light[0].position, 1);
-			glUniform3fv(m_parameters[U_LIGHT0_POSITION], 1,
-				glm::value_ptr(lightPosition_cameraspace));
-			glm::vec3 spotDirection_cameraspace = viewStack.Top() *
-				glm::vec4(light[0].spotDirection, 0);
-			glUniform3fv(m_parameters[U_LIGHT0_SPOTDIRECTION], 1,
-				glm::value_ptr(spotDirection_cameraspace));
-		}
-		else
-		{
-			// Calculate the light position in camera space
-			glm::vec3 lightPosition_cameraspace = viewStack.Top() * glm::vec4(light[0].position, 0);
-			glUniform3fv(m_parameters[U_LIGHT0_POSITION], 1, glm::value_ptr(lightPosition_cameraspace));
-		}
 
-		if (light[1].type == Light::LIGHT_DIRECTIONAL)
-		{
-			glm::vec3 lightDir(light[1].position.x, light[1].position.y, light[1].position.z);
-			glm::vec3 lightDirection_cameraspace = viewStack.Top() * glm::vec4(lightDir, 0);
-			glUniform3fv(m_parameters[U_LIGHT0_POSITION], 1,
-				glm::value_ptr(lightDirection_cameraspace));
-		}
-		else if (light[1].type == Light::LIGHT_SPOT) {
-			glm::vec3 lightPosition_cameraspace = viewStack.Top() * glm::vec4(light[1].position, 1);
-			glUniform3fv(m_parameters[U_LIGHT0_POSITION], 1,
-				glm::value_ptr(lightPosition_cameraspace));
-			glm::vec3 spotDirection_cameraspace = viewStack.Top() *
-				glm::vec4(light[1].spotDirection, 0);
-			glUniform3fv(m_parameters[U_LIGHT0_SPOTDIRECTION], 1,
-				glm::value_ptr(spotDirection_cameraspace));
-		}
-		else
-		{
-			// Calculate the light position in camera space
-			glm::vec3 lightPosition_cameraspace = viewStack.Top() * glm::vec4(light[1].position, 0);
-			glUniform3fv(m_parameters[U_LIGHT0_POSITION], 1, glm::value_ptr(lightPosition_cameraspace));
-		}
+		// Draws are queued by RenderMesh and issued sorted at the end of the frame
+		renderQueue.Begin(viewStack.Top(), projectionStack.Top());
+
+		// Camera and lights are uploaded once for the whole frame, already in camera space
+		UniformBlocks::GetInstance()->SetFrame(viewStack.Top(), projectionStack.Top(), light, NUM_LIGHTS);
 
 		modelStack.PushMatrix();
 		// Render objects
@@ -635,24 +536,31 @@ void SceneLightSource::Render()
 	
 	// Render light
 	{
+		// Viewport height is needed to measure the markers in pixels
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		float viewportHeight = static_cast<float>(viewport[3]);
+
 		modelStack.PushMatrix();
 		modelStack.Translate(light[0].position.x, light[0].position.y + 4, light[0].position.z);
 		modelStack.Scale(0.1f, 0.1f, 0.1f);
-		meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(0.1f, 0.1f, 0.1f);
-		meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-		meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-		meshList[GEO_SPHERE]->material.kShininess = 1.0f;
-		RenderMesh(meshList[GEO_SPHERE], false);
+		Mesh* marker = lightMarkerLOD.Select(viewStack.Top() * modelStack.Top(), projectionStack.Top(), viewportHeight);
+		marker->material.kAmbient = glm::vec3(0.1f, 0.1f, 0.1f);
+		marker->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
+		marker->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
+		marker->material.kShininess = 1.0f;
+		RenderMesh(marker, false);
 		modelStack.PopMatrix();
 
 		modelStack.PushMatrix();
 		modelStack.Translate(light[1].position.x, light[1].position.y + 4, light[1].position.z);
 		modelStack.Scale(0.1f, 0.1f, 0.1f);
-		meshList[GEO_SPHERE]->material.kAmbient = glm::vec3(0.1f, 0.1f, 0.1f);
-		meshList[GEO_SPHERE]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-		meshList[GEO_SPHERE]->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
-		meshList[GEO_SPHERE]->material.kShininess = .0f;
-		RenderMesh(meshList[GEO_SPHERE], false);
+		marker = lightMarkerLOD.Select(viewStack.Top() * modelStack.Top(), projectionStack.Top(), viewportHeight);
+		marker->material.kAmbient = glm::vec3(0.1f, 0.1f, 0.1f);
+		marker->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
+		marker->material.kSpecular = glm::vec3(0.9f, 0.9f, 0.9f);
+		marker->material.kShininess = .0f;
+		RenderMesh(marker, false);
 		modelStack.PopMatrix();
 	}
 
@@ -1359,6 +1267,8 @@ void SceneLightSource::Render()
 	meshList[GEO_SPHERE1]->material.kShininess = 1.0f;
 	RenderMesh(meshList[GEO_SPHERE1], enableLight);
 	modelStack.PopMatrix();
+
+	renderQueue.Flush();
 }
 
 void SceneLightSource::Exit()
@@ -1371,8 +1281,8 @@ void SceneLightSource::Exit()
 			delete meshList[i];
 		}
 	}
-	glDeleteVertexArrays(1, &m_vertexArrayID);
-	glDeleteProgram(m_programID);
+	lightMarkerLOD.Exit();
+	GLStateCache::GetInstance()->DeleteProgram(m_programID);
 }
 
 void SceneLightSource::HandleKeyPress() 
@@ -1380,22 +1290,22 @@ void SceneLightSource::HandleKeyPress()
 	if (Application::IsKeyPressed(0x31))
 	{
 		// Key press to enable culling
-		glEnable(GL_CULL_FACE);
+		GLStateCache::GetInstance()->Enable(GL_CULL_FACE);
 	}
 	if (Application::IsKeyPressed(0x32))
 	{
 		// Key press to disable culling
-		glDisable(GL_CULL_FACE);
+		GLStateCache::GetInstance()->Disable(GL_CULL_FACE);
 	}
 	if (Application::IsKeyPressed(0x33))
 	{
 		// Key press to enable fill mode for the polygon
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); //default fill mode
+		GLStateCache::GetInstance()->PolygonMode(GL_FILL); //default fill mode
 	}
 	if (Application::IsKeyPressed(0x34))
 	{
 		// Key press to enable wireframe mode for the polygon
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); //wireframe mode
+		GLStateCache::GetInstance()->PolygonMode(GL_LINE); //wireframe mode
 	}
 	if (KeyboardController::GetInstance()->IsKeyPressed('P'))
 	{
@@ -1464,8 +1374,6 @@ void SceneLightSource::HandleKeyPress()
 			light[0].type = Light::LIGHT_POINT;
 		}
 
-		glUniform1i(m_parameters[U_LIGHT0_TYPE], light[0].type);
-
 		std::cout << "Current Light: " << light[0].type << '\n';
 	}
 
@@ -1473,30 +1381,6 @@ void SceneLightSource::HandleKeyPress()
 
 void SceneLightSource::RenderMesh(Mesh* mesh, bool enableLight)
 {
-	glm::mat4 MVP, modelView, modelView_inverse_transpose;
-
-	MVP = projectionStack.Top() * viewStack.Top() * modelStack.Top();
-	glUniformMatrix4fv(m_parameters[U_MVP], 1, GL_FALSE, glm::value_ptr(MVP));
-	modelView = viewStack.Top() * modelStack.Top();
-	glUniformMatrix4fv(m_parameters[U_MODELVIEW], 1, GL_FALSE, glm::value_ptr(modelView));
-
-	if (enableLight)
-	{
-		glUniform1i(m_parameters[U_LIGHTENABLED], 1);
-		modelView_inverse_transpose = glm::inverseTranspose(modelView);
-		glUniformMatrix4fv(m_parameters[U_MODELVIEW_INVERSE_TRANSPOSE], 1, GL_FALSE,
-			glm::value_ptr(modelView_inverse_transpose));
-
-		//load material
-		glUniform3fv(m_parameters[U_MATERIAL_AMBIENT], 1, glm::value_ptr(mesh->material.kAmbient));
-		glUniform3fv(m_parameters[U_MATERIAL_DIFFUSE], 1, glm::value_ptr(mesh->material.kDiffuse));
-		glUniform3fv(m_parameters[U_MATERIAL_SPECULAR], 1, glm::value_ptr(mesh->material.kSpecular));
-		glUniform1f(m_parameters[U_MATERIAL_SHININESS], mesh->material.kShininess);
-	}
-	else
-	{
-		glUniform1i(m_parameters[U_LIGHTENABLED], 0);
-	}
-	mesh->Render();
+	renderQueue.Submit(mesh, modelStack.Top(), m_programID, enableLight);
 }
 
@@ -5,8 +5,10 @@
 #include "Mesh.h"
 #include "AltAzCamera.h"
 #include "MatrixStack.h"
+#include "TessellationCache.h"
 #include "SceneLightSource.h"
 #include "Light.h"
+#include "RenderQueue.h"
 
 class SceneLightSource : public Scene
 {
@@ -26,38 +28,6 @@ public:
 		NUM_GEOMETRY,
 	};
 
-	enum UNIFORM_TYPE
-	{
-		U_MVP = 0,
-		U_MODELVIEW,
-		U_MODELVIEW_INVERSE_TRANSPOSE,
-		U_MATERIAL_AMBIENT,
-		U_MATERIAL_DIFFUSE,
-		U_MATERIAL_SPECULAR,
-		U_MATERIAL_SHININESS,
-
-		U_LIGHT0_TYPE,
-
-		U_LIGHT0_POSITION,
-		U_LIGHT0_COLOR,
-		U_LIGHT0_POWER,
-		U_LIGHT0_KC,
-		U_LIGHT0_KL,
-		U_LIGHT0_KQ,
-
-		U_LIGHT0_SPOTDIRECTION,
-		U_LIGHT0_COSCUTOFF,
-		U_LIGHT0_COSINNER,
-		U_LIGHT0_EXPONENT,
-
-		U_LIGHT1_TYPE,
-
-		U_NUMLIGHTS,
-
-		U_LIGHTENABLED,
-		U_TOTAL,
-	};
-
 	enum ANIMATION
 	{
 		ANIM_DEFAULT,
@@ -88,15 +58,17 @@ private:
 
 	void HandleKeyPress();
 
-	unsigned m_vertexArrayID;
 	Mesh* meshList[NUM_GEOMETRY];
 
+	// Light markers pick their tessellation from their size on screen
+	TessellationCache lightMarkerLOD;
+
 	unsigned m_programID;
-	unsigned m_parameters[U_TOTAL];
 
 	// other variables
 
 	MatrixStack modelStack, viewStack, projectionStack;
+	RenderQueue renderQueue;
 
 	int projType = 1; // fix to 0 for orthographic, 1 for projection
 	
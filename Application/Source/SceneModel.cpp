@@ -1,5 +1,8 @@
 #include "SceneModel.h"
 #include "GL\glew.h"
+#include "GLStateCache.h"
+#include "UniformBlocks.h"
+#include "ShaderCache.h"
 
 // GLM Headers
 #include <glm\glm.hpp>
@@ -27,51 +30,26 @@ SceneModel::~SceneModel()
 void SceneModel::Init()
 {
 	// Set background color to dark blue
-	glClearColor(0.0f, 0.0f, 0.4f, 0.0f);
+	clearColor = glm::vec4(0.0f, 0.0f, 0.4f, 0.0f);
+	glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
 
 	//Enable depth buffer and depth testing
-	glEnable(GL_DEPTH_TEST);
+	GLStateCache::GetInstance()->Enable(GL_DEPTH_TEST);
 
 	//Enable back face culling
-	glEnable(GL_CULL_FACE);
+	cullFace = true;
+	GLStateCache::GetInstance()->Enable(GL_CULL_FACE);
 
 	//Default to fill mode
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+	wireframe = false;
+	GLStateCache::GetInstance()->PolygonMode(GL_FILL);
 
-	// Generate a default VAO for now
-	glGenVertexArrays(1, &m_vertexArrayID);
-	glBindVertexArray(m_vertexArrayID);
-
-	// Load the shader programs
-	m_programID = LoadShaders("Shader//Texture.vertexshader",
+	// Load the shader programs; the cache registers them with the shared uniform blocks,
+	// where matrices, material and lights come from
+	m_programID = ShaderCache::GetInstance()->GetUberProgram("Shader//Texture.vertexshader",
 		"Shader//Texture.fragmentshader");
 
-	glUseProgram(m_programID);
-
-	// Get a handle for our "MVP" uniform
-	m_parameters[U_MVP] = glGetUniformLocation(m_programID, "MVP");
-	m_parameters[U_MODELVIEW] = glGetUniformLocation(m_programID, "MV");
-	m_parameters[U_MODELVIEW_INVERSE_TRANSPOSE] = glGetUniformLocation(m_programID, "MV_inverse_transpose");
-	m_parameters[U_MATERIAL_AMBIENT] = glGetUniformLocation(m_programID, "material.kAmbient");
-	m_parameters[U_MATERIAL_DIFFUSE] = glGetUniformLocation(m_programID, "material.kDiffuse");
-	m_parameters[U_MATERIAL_SPECULAR] = glGetUniformLocation(m_programID, "material.kSpecular");
-	m_parameters[U_MATERIAL_SHININESS] = glGetUniformLocation(m_programID, "material.kShininess");
-	m_parameters[U_LIGHT0_TYPE] = glGetUniformLocation(m_programID, "lights[0].type");
-	m_parameters[U_LIGHT0_POSITION] = glGetUniformLocation(m_programID, "lights[0].position_cameraspace");
-	m_parameters[U_LIGHT0_COLOR] = glGetUniformLocation(m_programID, "lights[0].color");
-	m_parameters[U_LIGHT0_POWER] = glGetUniformLocation(m_programID, "lights[0].power");
-	m_parameters[U_LIGHT0_KC] = glGetUniformLocation(m_programID, "lights[0].kC");
-	m_parameters[U_LIGHT0_KL] = glGetUniformLocation(m_programID, "lights[0].kL");
-	m_parameters[U_LIGHT0_KQ] = glGetUniformLocation(m_programID, "lights[0].kQ");
-	m_parameters[U_LIGHT0_SPOTDIRECTION] = glGetUniformLocation(m_programID, "lights[0].spotDirection");
-	m_parameters[U_LIGHT0_COSCUTOFF] = glGetUniformLocation(m_programID, "lights[0].cosCutoff");
-	m_parameters[U_LIGHT0_COSINNER] = glGetUniformLocation(m_programID, "lights[0].cosInner");
-	m_parameters[U_LIGHT0_EXPONENT] = glGetUniformLocation(m_programID, "lights[0].exponent");
-	m_parameters[U_LIGHTENABLED] = glGetUniformLocation(m_programID, "lightEnabled");
-	m_parameters[U_NUMLIGHTS] = glGetUniformLocation(m_programID, "numLights");
-
-	m_parameters[U_COLOR_TEXTURE_ENABLED] = glGetUniformLocation(m_programID, "colorTextureEnabled");
-	m_parameters[U_COLOR_TEXTURE] = glGetUniformLocation(m_programID, "colorTexture");
+	GLStateCache::GetInstance()->UseProgram(m_programID);
 
 	// Initialise camera properties
 	camera.Init(45.f, 45.f, 10.f);
@@ -101,6 +79,11 @@ void SceneModel::Init()
 	meshList[GEO_SKELETON] = MeshBuilder::GenerateOBJ("skelton", "Obj//gun.obj");
 	meshList[GEO_SKELETON]->textureID = LoadTGA("Image//AKMN_Golden_Inlay_albedo.tga");
 	//meshList[GEO_SKELETON]->textureID = LoadTGA("Image//AKMN_Golden_Inlay_normal.tga");
+	// Set once here; a pipelined frame may still be reading the mesh while the next one records
+	meshList[GEO_SKELETON]->material.kAmbient = glm::vec3(0.5f, 0.5f, 0.5f);
+	meshList[GEO_SKELETON]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
+	meshList[GEO_SKELETON]->material.kSpecular = glm::vec3(0.5f, 0.5f, 0.5f);
+	meshList[GEO_SKELETON]->material.kShininess = 1.0f;
 
 	//meshList[GEO_SPHERE_BLUE] = MeshBuilder::GenerateSphere("Earth", Color(0.4f, 0.2f, 0.8f), 1.f, 12, 12);
 	//meshList[GEO_SPHERE_GREY] = MeshBuilder::GenerateSphere("Moon", Color(0.5f, 0.5f, 0.5f), 1.f, 4, 4);
@@ -108,9 +91,6 @@ void SceneModel::Init()
 	glm::mat4 projection = glm::perspective(45.0f, 4.0f / 3.0f, 0.1f, 1000.0f);
 	projectionStack.LoadMatrix(projection);
 
-
-	glUniform1i(m_parameters[U_NUMLIGHTS], NUM_LIGHTS);
-
 	light[0].position = glm::vec3(0, 5, 0);
 	light[0].color = glm::vec3(1, 1, 1);
 	light[0].type = Light::LIGHT_POINT;
@@ -123,17 +103,33 @@ void SceneModel::Init()
 	light[0].exponent = 3.f;
 	light[0].spotDirection = glm::vec3(0.f, 1.f, 0.f);
 
-	glUniform3fv(m_parameters[U_LIGHT0_COLOR], 1, &light[0].color.r);
-	glUniform1i(m_parameters[U_LIGHT0_TYPE], light[0].type);
-	glUniform1f(m_parameters[U_LIGHT0_POWER], light[0].power);
-	glUniform1f(m_parameters[U_LIGHT0_KC], light[0].kC);
-	glUniform1f(m_parameters[U_LIGHT0_KL], light[0].kL);
-	glUniform1f(m_parameters[U_LIGHT0_KQ], light[0].kQ);
-	glUniform1f(m_parameters[U_LIGHT0_COSCUTOFF], cosf(glm::radians<float>(light[0].cosCutoff)));
-	glUniform1f(m_parameters[U_LIGHT0_COSINNER], cosf(glm::radians<float>(light[0].cosInner)));
-	glUniform1f(m_parameters[U_LIGHT0_EXPONENT], light[0].exponent);
-
 	enableLight = true;
+
+	// Every variant Record may pick, requested now since it may run away from the GL context.
+	// They compile in the background and draw with the uber program until they have linked.
+	// Unlit ones ignore the light, so the cache hands back the same two for every type
+	ShaderFeatures features;
+	for (int type = 0; type < Light::NUM_LIGHT_TYPES; ++type)
+	{
+		Light variant = light[0];
+		variant.type = static_cast<Light::LIGHT_TYPE>(type);
+		features.SetLights(&variant, NUM_LIGHTS);
+		for (int textured = 0; textured < 2; ++textured)
+		{
+			for (int lit = 0; lit < 2; ++lit)
+			{
+				features.colorTexture = textured != 0;
+				features.lighting = lit != 0;
+				m_programs[type][textured][lit] = ShaderCache::GetInstance()->RequestProgram("Shader//Texture.vertexshader",
+					"Shader//Texture.fragmentshader", features, m_programID);
+			}
+		}
+	}
+	useSpecialized = true;
+
+	indirectReady = false;
+	useIndirect = false;
+	recording = nullptr;
 }
 
 void SceneModel::Update(double dt)
@@ -159,9 +155,40 @@ void SceneModel::Update(double dt)
 
 void SceneModel::Render()
 {
-	// Clear color buffer every frame
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	if (useIndirect && !indirectReady)
+	{
+		// Lazily set up on first use, if the context supports it
+		indirectReady = indirect.Init();
+		useIndirect = indirectReady;
+	}
+
+	if (!useIndirect)
+	{
+		Record(serialFrame);
+		serialFrame.Replay(renderQueue);
+		return;
+	}
+
+	SetupFrame(serialFrame);
+	serialFrame.ApplyState();
+	indirect.Begin(serialFrame.view, serialFrame.projection);
+	RenderObjects();
+	indirect.End();
+	// Per-object draws expect their own program bound
+	GLStateCache::GetInstance()->UseProgram(m_programID);
+}
+
+void SceneModel::Record(FrameSnapshot& frame)
+{
+	SetupFrame(frame);
+	frame.commands.Begin(frame.view, frame.projection);
+	recording = &frame.commands;
+	RenderObjects();
+	recording = nullptr;
+}
 
+void SceneModel::SetupFrame(FrameSnapshot& frame)
+{
 	// Load view matrix stack and set it with camera position, target position and up direction
 	viewStack.LoadIdentity();
 	viewStack.LookAt(
@@ -170,28 +197,20 @@ void SceneModel::Render()
 		camera.up.x, camera.up.y, camera.up.z
 	);
 
+	frame.view = viewStack.Top();
+	frame.projection = projectionStack.Top();
+	// Camera and lights are uploaded once for the whole frame, already in camera space
+	frame.lights.assign(light, light + NUM_LIGHTS);
+	frame.clearColor = clearColor;
+	frame.cullFace = cullFace;
+	frame.wireframe = wireframe;
+}
+
+void SceneModel::RenderObjects()
+{
 	// Load identity matrix into the model stack
 	modelStack.LoadIdentity();
 
-	if (light[0].type == Light::LIGHT_DIRECTIONAL)
-	{
-		glm::vec3 lightDir(light[0].position.x, light[0].position.y, light[0].position.z);
-		glm::vec3 lightDirection_cameraspace = viewStack.Top() * glm::vec4(lightDir, 0);
-		glUniform3fv(m_parameters[U_LIGHT0_POSITION], 1, glm::value_ptr(lightDirection_cameraspace));
-	}
-	else if (light[0].type == Light::LIGHT_SPOT)
-	{
-		glm::vec3 lightPosition_cameraspace = viewStack.Top() * glm::vec4(light[0].position, 1);
-		glUniform3fv(m_parameters[U_LIGHT0_POSITION], 1, glm::value_ptr(lightPosition_cameraspace));
-		glm::vec3 spotDirection_cameraspace = viewStack.Top() * glm::vec4(light[0].spotDirection, 0);
-		glUniform3fv(m_parameters[U_LIGHT0_SPOTDIRECTION], 1, glm::value_ptr(spotDirection_cameraspace));
-	}
-	else {
-		// Calculate the light position in camera space
-		glm::vec3 lightPosition_cameraspace = viewStack.Top() * glm::vec4(light[0].position, 1);
-		glUniform3fv(m_parameters[U_LIGHT0_POSITION], 1, glm::value_ptr(lightPosition_cameraspace));
-	}
-
 	//Render of doorman
 	//modelStack.PushMatrix();
 	//meshList[GEO_MODEL_DOORMAN]->material.kAmbient = glm::vec3(0.5f, 0.5f, 0.5f);
@@ -243,59 +262,26 @@ void SceneModel::Render()
 	//modelStack.PopMatrix();
 
 	modelStack.PushMatrix();
-	meshList[GEO_SKELETON]->material.kAmbient = glm::vec3(0.5f, 0.5f, 0.5f);
-	meshList[GEO_SKELETON]->material.kDiffuse = glm::vec3(0.5f, 0.5f, 0.5f);
-	meshList[GEO_SKELETON]->material.kSpecular = glm::vec3(0.5f, 0.5f, 0.5f);
-	meshList[GEO_SKELETON]->material.kShininess = 1.0f;
 	RenderMesh(meshList[GEO_SKELETON], true);
 	modelStack.PopMatrix();
-
 }
 
 void SceneModel::RenderMesh(Mesh* mesh, bool enableLight)
 {
-	glm::mat4 MVP, modelView, modelView_inverse_transpose;
-
-	MVP = projectionStack.Top() * viewStack.Top() * modelStack.Top();
-	glUniformMatrix4fv(m_parameters[U_MVP], 1, GL_FALSE, glm::value_ptr(MVP));
-	modelView = viewStack.Top() * modelStack.Top();
-	glUniformMatrix4fv(m_parameters[U_MODELVIEW], 1, GL_FALSE, glm::value_ptr(modelView));
-	if (enableLight)
-	{
-		glUniform1i(m_parameters[U_LIGHTENABLED], 1);
-		modelView_inverse_transpose = glm::inverseTranspose(modelView);
-		glUniformMatrix4fv(m_parameters[U_MODELVIEW_INVERSE_TRANSPOSE], 1, GL_FALSE, glm::value_ptr(modelView_inverse_transpose));
-
-		//load material
-		glUniform3fv(m_parameters[U_MATERIAL_AMBIENT], 1, &mesh->material.kAmbient.r);
-		glUniform3fv(m_parameters[U_MATERIAL_DIFFUSE], 1, &mesh->material.kDiffuse.r);
-		glUniform3fv(m_parameters[U_MATERIAL_SPECULAR], 1, &mesh->material.kSpecular.r);
-		glUniform1f(m_parameters[U_MATERIAL_SHININESS], mesh->material.kShininess);
-	}
-	else
-	{
-		glUniform1i(m_parameters[U_LIGHTENABLED], 0);
-	}
-
-	if (mesh->textureID > 0)
-	{
-		glUniform1i(m_parameters[U_COLOR_TEXTURE_ENABLED], 1);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, mesh->textureID);
-		glUniform1i(m_parameters[U_COLOR_TEXTURE], 0);
-	}
-	else
+	if (!recording)
 	{
-		glUniform1i(m_parameters[U_COLOR_TEXTURE_ENABLED], 0);
+		indirect.Submit(mesh, modelStack.Top(), enableLight);
+		return;
 	}
 
-	mesh->Render();
-
-	if (mesh->textureID > 0)
-	{
-		glBindTexture(GL_TEXTURE_2D, 0);
-	}
+	recording->Submit(mesh, modelStack.Top(), GetProgram(mesh, enableLight), enableLight);
+}
 
+unsigned SceneModel::GetProgram(const Mesh* mesh, bool enableLight) const
+{
+	if (!useSpecialized)
+		return m_programID;
+	return m_programs[light[0].type][mesh->textureID > 0 ? 1 : 0][enableLight ? 1 : 0];
 }
 
 
@@ -309,8 +295,7 @@ void SceneModel::Exit()
 			delete meshList[i];
 		}
 	}
-	glDeleteVertexArrays(1, &m_vertexArrayID);
-	glDeleteProgram(m_programID);
+	indirect.Exit();
 }
 
 void SceneModel::HandleKeyPress()
@@ -318,28 +303,38 @@ void SceneModel::HandleKeyPress()
 	if (KeyboardController::GetInstance()->IsKeyPressed(0x31))
 	{
 		// Key press to enable culling
-		glEnable(GL_CULL_FACE);
+		cullFace = true;
 	}
 	if (KeyboardController::GetInstance()->IsKeyPressed(0x32))
 	{
 		// Key press to disable culling
-		glDisable(GL_CULL_FACE);
+		cullFace = false;
 	}
 	if (KeyboardController::GetInstance()->IsKeyPressed(0x33))
 	{
 		// Key press to enable fill mode for the polygon
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); //default fill mode
+		wireframe = false; //default fill mode
 	}
 	if (KeyboardController::GetInstance()->IsKeyPressed(0x34))
 	{
 		// Key press to enable wireframe mode for the polygon
-		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); //wireframe mode
+		wireframe = true; //wireframe mode
+	}
+	if (KeyboardController::GetInstance()->IsKeyPressed(0x35))
+	{
+		// Key press to toggle the multi-draw indirect path; Render sets it up on first use
+		useIndirect = !useIndirect;
+	}
+	if (KeyboardController::GetInstance()->IsKeyPressed(0x36))
+	{
+		// Key press to toggle between the specialized programs and the uber program
+		useSpecialized = !useSpecialized;
 	}
 
 	if (KeyboardController::GetInstance()->IsKeyPressed(VK_SPACE))
 	{
 		// Change to black background
-		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		clearColor = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
 	}
 
 	if (KeyboardController::GetInstance()->IsKeyPressed(GLFW_KEY_0))
@@ -351,7 +346,6 @@ void SceneModel::HandleKeyPress()
 			light[0].power = 1.f;
 		else
 			light[0].power = 0.1f;
-		glUniform1f(m_parameters[U_LIGHT0_POWER], light[0].power);
 	}
 
 	if (KeyboardController::GetInstance()->IsKeyPressed(GLFW_KEY_TAB))
@@ -365,8 +359,6 @@ void SceneModel::HandleKeyPress()
 		else {
 			light[0].type = Light::LIGHT_POINT;
 		}
-
-		glUniform1i(m_parameters[U_LIGHT0_TYPE], light[0].type);
 	}
 
 }
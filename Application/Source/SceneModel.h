@@ -6,6 +6,9 @@
 #include "AltAzCamera.h"
 #include "MatrixStack.h"
 #include "Light.h"
+#include "RenderQueue.h"
+#include "IndirectRenderer.h"
+#include "FrameSnapshot.h"
 
 class SceneModel : public Scene
 {
@@ -23,33 +26,6 @@ public:
 		NUM_GEOMETRY,
 	};
 
-	enum UNIFORM_TYPE
-	{
-		U_MVP = 0,
-		U_MODELVIEW,
-		U_MODELVIEW_INVERSE_TRANSPOSE,
-		U_MATERIAL_AMBIENT,
-		U_MATERIAL_DIFFUSE,
-		U_MATERIAL_SPECULAR,
-		U_MATERIAL_SHININESS,
-		U_LIGHT0_TYPE,
-		U_LIGHT0_POSITION,
-		U_LIGHT0_COLOR,
-		U_LIGHT0_POWER,
-		U_LIGHT0_KC,
-		U_LIGHT0_KL,
-		U_LIGHT0_KQ,
-		U_LIGHT0_SPOTDIRECTION,
-		U_LIGHT0_COSCUTOFF,
-		U_LIGHT0_COSINNER,
-		U_LIGHT0_EXPONENT,
-		U_NUMLIGHTS,
-		U_COLOR_TEXTURE_ENABLED,
-		U_COLOR_TEXTURE,
-		U_LIGHTENABLED,
-		U_TOTAL,
-	};
-
 	SceneModel();
 	~SceneModel();
 
@@ -58,24 +34,47 @@ public:
 	virtual void Render();
 	virtual void Exit();
 
+	virtual bool SupportsRecord() const { return true; }
+	virtual void Record(FrameSnapshot& frame);
+
 private:
 	void HandleKeyPress();
+	void SetupFrame(FrameSnapshot& frame);
+	void RenderObjects();
 	void RenderMesh(Mesh* mesh, bool enableLight);
+	// The program specialized for this draw and the current light, or the uber program
+	unsigned GetProgram(const Mesh* mesh, bool enableLight) const;
 
-	unsigned m_vertexArrayID;
 	Mesh* meshList[NUM_GEOMETRY];
 
-	unsigned m_programID;
-	unsigned m_parameters[U_TOTAL];
+	unsigned m_programID;	// uber program, owned by ShaderCache
+	// Specialized programs by light[0]'s type, textured and lit, all requested in Init
+	unsigned m_programs[Light::NUM_LIGHT_TYPES][2][2];
+	bool useSpecialized;	// key 6 switches between them and the uber program
 
 	AltAzCamera camera;
 	int projType = 1; // fix to 0 for orthographic, 1 for projection
 
 	MatrixStack modelStack, viewStack, projectionStack;
+	RenderQueue renderQueue;
+
+	// Render state, kept here so Update stays free of GL calls
+	glm::vec4 clearColor;
+	bool cullFace;
+	bool wireframe;
+
+	// Serial mode records into this and replays it straight away
+	FrameSnapshot serialFrame;
+	CommandList* recording;	// where RenderMesh goes, or the indirect renderer when null
 
 	static const int NUM_LIGHTS = 1;
 	Light light[NUM_LIGHTS];
 	bool enableLight;
+
+	// Key 5 switches between per-object draws and multi-draw indirect, in serial mode only
+	IndirectRenderer indirect;
+	bool indirectReady;
+	bool useIndirect;
 };
 
 #endif
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include "AltAzCamera.h"
 #include "MatrixStack.h"
 #include "Light.h"
+#include "RenderQueue.h"
 
 class SceneTexture : public Scene
 {
@@ -19,33 +20,6 @@ public:
 		NUM_GEOMETRY,
 	};
 
-	enum UNIFORM_TYPE
-	{
-		U_MVP = 0,
-		U_MODELVIEW,
-		U_MODELVIEW_INVERSE_TRANSPOSE,
-		U_MATERIAL_AMBIENT,
-		U_MATERIAL_DIFFUSE,
-		U_MATERIAL_SPECULAR,
-		U_MATERIAL_SHININESS,
-		U_LIGHT0_TYPE,
-		U_LIGHT0_POSITION,
-		U_LIGHT0_COLOR,
-		U_LIGHT0_POWER,
-		U_LIGHT0_KC,
-		U_LIGHT0_KL,
-		U_LIGHT0_KQ,
-		U_LIGHT0_SPOTDIRECTION,
-		U_LIGHT0_COSCUTOFF,
-		U_LIGHT0_COSINNER,
-		U_LIGHT0_EXPONENT,
-		U_NUMLIGHTS,
-		U_COLOR_TEXTURE_ENABLED,
-		U_COLOR_TEXTURE,
-		U_LIGHTENABLED,
-		U_TOTAL,
-	};
-
 	SceneTexture();
 	~SceneTexture();
 
@@ -58,16 +32,15 @@ private:
 	void HandleKeyPress();
 	void RenderMesh(Mesh* mesh, bool enableLight);
 
-	unsigned m_vertexArrayID;
 	Mesh* meshList[NUM_GEOMETRY];
 
 	unsigned m_programID;
-	unsigned m_parameters[U_TOTAL];
 
 	AltAzCamera camera;
 	int projType = 1; // fix to 0 for orthographic, 1 for projection
 
 	MatrixStack modelStack, viewStack, projectionStack;
+	RenderQueue renderQueue;
 
 	static const int NUM_LIGHTS = 1;
 	Light light[NUM_LIGHTS];
@@ -0,0 +1,234 @@
+#include "ShaderBatch.h"
+#include <GL\glew.h>
+#include <GLFW/glfw3.h>
+#include "shader.hpp"
+
+#include <stdio.h>
+
+// KHR/ARB_parallel_shader_compile, newer than the bundled GLEW
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace
+{
+	typedef void (APIENTRY* MaxShaderCompilerThreadsProc)(GLuint count);
+
+	bool EnableParallelCompile(void)
+	{
+		const char* extensions[2] = { "GL_KHR_parallel_shader_compile", "GL_ARB_parallel_shader_compile" };
+		const char* functions[2] = { "glMaxShaderCompilerThreadsKHR", "glMaxShaderCompilerThreadsARB" };
+		for (int i = 0; i < 2; ++i)
+		{
+			if (!glfwExtensionSupported(extensions[i]))
+				continue;
+			// The default thread count is up to the driver, and some pick none
+			MaxShaderCompilerThreadsProc maxThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(glfwGetProcAddress(functions[i]));
+			if (maxThreads)
+				maxThreads(0xFFFFFFFF);
+			return true;
+		}
+		return false;
+	}
+}
+
+ShaderBatch::ShaderBatch(void)
+	: numPending(0)
+	, numFailed(0)
+{
+}
+
+ShaderBatch::~ShaderBatch(void)
+{
+	Clear();
+}
+
+bool ShaderBatch::IsParallelSupported(void)
+{
+	static bool supported = EnableParallelCompile();
+	return supported;
+}
+
+unsigned ShaderBatch::Add(const char* vertexPath, const char* fragmentPath, const char* defines, unsigned fallbackProgramID)
+{
+	Program program;
+	if (!ReadShaderSources(vertexPath, fragmentPath, defines, program.vertexCode, program.fragmentCode))
+		return 0;
+	program.vertexPath = vertexPath;
+	program.fragmentPath = fragmentPath;
+	program.fallbackProgramID = fallbackProgramID;
+	program.vertexShaderID = 0;
+	program.fragmentShaderID = 0;
+	program.binaryPath = GetProgramBinaryPath(program.vertexCode, program.fragmentCode);
+
+	// Loading a binary is quick next to compiling, so it is not worth deferring
+	program.programID = LoadProgramBinary(program.binaryPath);
+	if (program.programID != 0)
+	{
+		program.vertexCode.clear();
+		program.fragmentCode.clear();
+		program.state = STATE_LINKED;
+	}
+	else
+	{
+		// Created now so its name can be handed out before it is compiled
+		program.programID = glCreateProgram();
+		program.state = STATE_QUEUED;
+		++numPending;
+	}
+	programs.push_back(program);
+	return program.programID;
+}
+
+void ShaderBatch::Submit(void)
+{
+	IsParallelSupported();
+
+	// Every compile goes in before any link, and nothing is asked back,
+	// so the driver can work on all of them at once
+	unsigned numSubmitted = 0;
+	for (size_t i = 0; i < programs.size(); ++i)
+	{
+		Program& program = programs[i];
+		if (program.state != STATE_QUEUED)
+			continue;
+		program.vertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+		program.fragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+		const char* vertexSource = program.vertexCode.c_str();
+		const char* fragmentSource = program.fragmentCode.c_str();
+		glShaderSource(program.vertexShaderID, 1, &vertexSource, NULL);
+		glShaderSource(program.fragmentShaderID, 1, &fragmentSource, NULL);
+		glCompileShader(program.vertexShaderID);
+		glCompileShader(program.fragmentShaderID);
+		++numSubmitted;
+	}
+	if (numSubmitted == 0)
+		return;
+
+	for (size_t i = 0; i < programs.size(); ++i)
+	{
+		Program& program = programs[i];
+		if (program.state != STATE_QUEUED)
+			continue;
+		glAttachShader(program.programID, program.vertexShaderID);
+		glAttachShader(program.programID, program.fragmentShaderID);
+		if (!program.binaryPath.empty())
+			glProgramParameteri(program.programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glLinkProgram(program.programID);
+		program.vertexCode.clear();
+		program.vertexCode.shrink_to_fit();
+		program.fragmentCode.clear();
+		program.fragmentCode.shrink_to_fit();
+		program.state = STATE_COMPILING;
+	}
+	printf("Compiling %u programs in the background (%s)\n", numSubmitted,
+		IsParallelSupported() ? "parallel shader compile" : "one program per poll");
+}
+
+unsigned ShaderBatch::Poll(std::vector<unsigned>* linked)
+{
+	Submit();
+	bool parallel = IsParallelSupported();
+	for (size_t i = 0; i < programs.size() && numPending > 0; ++i)
+	{
+		Program& program = programs[i];
+		if (program.state != STATE_COMPILING)
+			continue;
+		if (parallel)
+		{
+			GLint done = GL_FALSE;
+			glGetProgramiv(program.programID, GL_COMPLETION_STATUS_KHR, &done);
+			if (done == GL_FALSE)
+				continue;
+			Retire(program, linked);
+		}
+		else
+		{
+			Retire(program, linked);
+			break;
+		}
+	}
+	return numPending;
+}
+
+void ShaderBatch::Finish(std::vector<unsigned>* linked)
+{
+	Submit();
+	for (size_t i = 0; i < programs.size() && numPending > 0; ++i)
+	{
+		if (programs[i].state == STATE_COMPILING)
+			Retire(programs[i], linked);
+	}
+}
+
+void ShaderBatch::Retire(Program& program, std::vector<unsigned>* linked)
+{
+	bool success = FinishProgram(program.vertexShaderID, program.fragmentShaderID, program.programID, program.binaryPath);
+	program.vertexShaderID = 0;
+	program.fragmentShaderID = 0;
+	--numPending;
+	if (success)
+	{
+		program.state = STATE_LINKED;
+		if (linked)
+			linked->push_back(program.programID);
+	}
+	else
+	{
+		printf("Program from %s and %s failed; drawing with its fallback\n", program.vertexPath.c_str(), program.fragmentPath.c_str());
+		program.state = STATE_FAILED;
+		++numFailed;
+	}
+}
+
+const ShaderBatch::Program* ShaderBatch::Find(unsigned programID) const
+{
+	for (size_t i = 0; i < programs.size(); ++i)
+	{
+		if (programs[i].programID == programID)
+			return &programs[i];
+	}
+	return nullptr;
+}
+
+bool ShaderBatch::IsLinked(unsigned programID) const
+{
+	const Program* program = Find(programID);
+	return program != nullptr && program->state == STATE_LINKED;
+}
+
+bool ShaderBatch::IsPending(unsigned programID) const
+{
+	const Program* program = Find(programID);
+	return program != nullptr && (program->state == STATE_QUEUED || program->state == STATE_COMPILING);
+}
+
+unsigned ShaderBatch::Resolve(unsigned programID) const
+{
+	// Called for every program change while drawing, so the common case stays a compare
+	if (numPending == 0 && numFailed == 0)
+		return programID;
+	const Program* program = Find(programID);
+	if (program == nullptr || program->state == STATE_LINKED)
+		return programID;
+	return program->fallbackProgramID;
+}
+
+unsigned ShaderBatch::GetNumPending(void) const
+{
+	return numPending;
+}
+
+void ShaderBatch::Clear(void)
+{
+	for (size_t i = 0; i < programs.size(); ++i)
+	{
+		if (programs[i].vertexShaderID != 0)
+			glDeleteShader(programs[i].vertexShaderID);
+		if (programs[i].fragmentShaderID != 0)
+			glDeleteShader(programs[i].fragmentShaderID);
+	}
+	programs.clear();
+	numPending = 0;
+	numFailed = 0;
+}
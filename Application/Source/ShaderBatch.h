@@ -0,0 +1,85 @@
+#ifndef SHADER_BATCH_H
+#define SHADER_BATCH_H
+
+#include <vector>
+#include <string>
+
+/******************************************************************************/
+/*!
+		Class ShaderBatch:
+\brief	Compiles and links a set of programs without waiting for any of
+		them. Every program gets its name as soon as it is added, Submit
+		issues all the compiles and links together, and Poll retires the
+		ones the driver has finished, so a frame keeps drawing with a
+		fallback program meanwhile.
+
+		With GL_KHR_parallel_shader_compile (or the ARB one) the driver
+		compiles on its own threads and Poll never waits. Without it,
+		asking about a program waits for it, so Poll finishes at most one
+		program per call to keep each hitch to a single program.
+
+		Programs that load from the binary cache are ready once added. The
+		batch does not own the programs it hands out; all calls must come
+		from the thread that owns the GL context.
+*/
+/******************************************************************************/
+class ShaderBatch
+{
+public:
+	ShaderBatch(void);
+	~ShaderBatch(void);
+
+	// Whether the driver compiles in the background; asks it for as many threads as it likes the first time
+	static bool IsParallelSupported(void);
+
+	// Read the sources and queue the program; 0 when a file is missing. Draws resolve to fallbackProgramID until it has linked
+	unsigned Add(const char* vertexPath, const char* fragmentPath, const char* defines = nullptr, unsigned fallbackProgramID = 0);
+	// Start compiling and linking everything added since the last Submit
+	void Submit(void);
+	// Retire the programs the driver has finished, appending those that linked to linked; returns how many are left
+	unsigned Poll(std::vector<unsigned>* linked = nullptr);
+	// Wait for every program
+	void Finish(std::vector<unsigned>* linked = nullptr);
+
+	bool IsLinked(unsigned programID) const;
+	bool IsPending(unsigned programID) const;
+	// The program a draw asking for programID uses now: itself once linked, its fallback before or if it failed
+	unsigned Resolve(unsigned programID) const;
+	unsigned GetNumPending(void) const;
+
+	// Forget every program, deleting the shaders of those still compiling; the programs themselves stay
+	void Clear(void);
+
+private:
+	enum PROGRAM_STATE
+	{
+		STATE_QUEUED,
+		STATE_COMPILING,
+		STATE_LINKED,
+		STATE_FAILED,
+		NUM_STATES,
+	};
+
+	struct Program
+	{
+		unsigned programID;
+		unsigned fallbackProgramID;
+		unsigned vertexShaderID;
+		unsigned fragmentShaderID;
+		std::string vertexPath;
+		std::string fragmentPath;
+		std::string vertexCode;		// until Submit
+		std::string fragmentCode;
+		std::string binaryPath;
+		PROGRAM_STATE state;
+	};
+
+	const Program* Find(unsigned programID) const;
+	void Retire(Program& program, std::vector<unsigned>* linked);
+
+	std::vector<Program> programs;
+	unsigned numPending;		// queued or compiling
+	unsigned numFailed;
+};
+
+#endif
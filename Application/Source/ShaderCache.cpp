@@ -0,0 +1,203 @@
+#include "ShaderCache.h"
+#include <GL\glew.h>
+#include "GLStateCache.h"
+#include "shader.hpp"
+
+#include <stdio.h>
+#include <chrono>
+#include <algorithm>
+
+ShaderFeatures::ShaderFeatures()
+	: lighting(true)
+	, colorTexture(false)
+	, clusteredLights(false)
+	, numLights(0)
+{
+	for (int i = 0; i < UniformBlocks::MAX_LIGHTS; ++i)
+		lightTypes[i] = Light::LIGHT_POINT;
+}
+
+void ShaderFeatures::SetLights(const Light* lights, int numLights)
+{
+	this->numLights = std::min(std::max(numLights, 0), static_cast<int>(UniformBlocks::MAX_LIGHTS));
+	for (int i = 0; i < this->numLights; ++i)
+		lightTypes[i] = lights[i].type;
+}
+
+unsigned long long ShaderFeatures::GetKey(void) const
+{
+	// lighting:1 | texture:1 | clusters:1 | count:4 | 2 bits of type per light
+	unsigned long long key = (lighting ? 1ULL : 0ULL) | (colorTexture ? 2ULL : 0ULL);
+	if (!lighting)
+		return key;
+	key |= (clusteredLights ? 4ULL : 0ULL) | (static_cast<unsigned long long>(numLights) << 3);
+	for (int i = 0; i < numLights; ++i)
+		key |= static_cast<unsigned long long>(lightTypes[i] & 3) << (7 + i * 2);
+	return key;
+}
+
+std::string ShaderFeatures::GetDefines(void) const
+{
+	std::string defines = "#define SPECIALIZED 1\n";
+	defines += lighting ? "#define LIGHTING 1\n" : "#define LIGHTING 0\n";
+	defines += colorTexture ? "#define COLOR_TEXTURE 1\n" : "#define COLOR_TEXTURE 0\n";
+	defines += lighting && clusteredLights ? "#define CLUSTERED_LIGHTS 1\n" : "#define CLUSTERED_LIGHTS 0\n";
+	int count = lighting ? numLights : 0;
+	defines += "#define NUM_LIGHTS " + std::to_string(count) + "\n";
+	if (count > 0)
+	{
+		// An array constructor the shader can index with the loop counter
+		defines += "#define LIGHT_TYPES int[](";
+		for (int i = 0; i < count; ++i)
+			defines += (i > 0 ? ", " : "") + std::to_string(static_cast<int>(lightTypes[i]));
+		defines += ")\n";
+	}
+	return defines;
+}
+
+ShaderCache* ShaderCache::m_instance = nullptr;
+
+ShaderCache* ShaderCache::GetInstance(void)
+{
+	if (m_instance == nullptr)
+		m_instance = new ShaderCache();
+	return m_instance;
+}
+
+void ShaderCache::DestroyInstance(void)
+{
+	if (m_instance)
+	{
+		delete m_instance;
+		m_instance = nullptr;
+	}
+}
+
+ShaderCache::ShaderCache(void)
+	: numHits(0)
+	, buildTime(0.0)
+{
+}
+
+ShaderCache::~ShaderCache(void)
+{
+	Clear();
+}
+
+unsigned ShaderCache::GetProgram(const char* vertexPath, const char* fragmentPath, const ShaderFeatures& features)
+{
+	return GetProgram(vertexPath, fragmentPath, features.GetKey(), features.GetDefines(), 0, true);
+}
+
+unsigned ShaderCache::GetUberProgram(const char* vertexPath, const char* fragmentPath)
+{
+	return GetProgram(vertexPath, fragmentPath, UBER_KEY, std::string(), 0, true);
+}
+
+unsigned ShaderCache::RequestProgram(const char* vertexPath, const char* fragmentPath, const ShaderFeatures& features, unsigned fallbackProgramID)
+{
+	return GetProgram(vertexPath, fragmentPath, features.GetKey(), features.GetDefines(), fallbackProgramID, false);
+}
+
+unsigned ShaderCache::GetProgram(const char* vertexPath, const char* fragmentPath, unsigned long long key, const std::string& defines, unsigned fallbackProgramID, bool wait)
+{
+	// A scene asks for a handful of programs, so a linear search is plenty
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		const Entry& entry = entries[i];
+		if (entry.key == key && entry.vertexPath == vertexPath && entry.fragmentPath == fragmentPath)
+		{
+			++numHits;
+			if (wait && batch.IsPending(entry.programID))
+				Finish();
+			return entry.programID != 0 ? entry.programID : fallbackProgramID;
+		}
+	}
+
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	Entry entry;
+	entry.vertexPath = vertexPath;
+	entry.fragmentPath = fragmentPath;
+	entry.key = key;
+	if (wait)
+	{
+		entry.programID = LoadShaders(vertexPath, fragmentPath, defines.c_str());
+		if (entry.programID != 0)
+			UniformBlocks::GetInstance()->BindProgram(entry.programID);
+	}
+	else
+	{
+		entry.programID = batch.Add(vertexPath, fragmentPath, defines.c_str(), fallbackProgramID);
+		// From the binary cache, and so ready already
+		if (batch.IsLinked(entry.programID))
+			UniformBlocks::GetInstance()->BindProgram(entry.programID);
+	}
+	buildTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	entries.push_back(entry);
+	return entry.programID != 0 ? entry.programID : fallbackProgramID;
+}
+
+void ShaderCache::Poll(void)
+{
+	if (batch.GetNumPending() == 0)
+		return;
+	batch.Poll(&linked);
+	BindLinked();
+}
+
+void ShaderCache::Finish(void)
+{
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	batch.Finish(&linked);
+	BindLinked();
+	buildTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void ShaderCache::BindLinked(void)
+{
+	// Uniform block bindings need a linked program, so they wait until now
+	for (size_t i = 0; i < linked.size(); ++i)
+		UniformBlocks::GetInstance()->BindProgram(linked[i]);
+	linked.clear();
+}
+
+unsigned ShaderCache::Resolve(unsigned programID) const
+{
+	return batch.Resolve(programID);
+}
+
+unsigned ShaderCache::GetNumPending(void) const
+{
+	return batch.GetNumPending();
+}
+
+void ShaderCache::Clear(void)
+{
+	batch.Clear();
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		if (entries[i].programID != 0)
+			GLStateCache::GetInstance()->DeleteProgram(entries[i].programID);
+	}
+	entries.clear();
+}
+
+unsigned ShaderCache::GetNumPrograms(void) const
+{
+	return static_cast<unsigned>(entries.size());
+}
+
+double ShaderCache::GetBuildTime(void) const
+{
+	return buildTime;
+}
+
+void ShaderCache::PrintStats(void) const
+{
+	printf("shader cache: %u programs built in %.1f ms, %u still compiling, %u requests served from the cache\n",
+		static_cast<unsigned>(entries.size()), buildTime, batch.GetNumPending(), numHits);
+	const ProgramBinaryStats& binaries = GetProgramBinaryStats();
+	printf("program binaries: %u loaded in %.1f ms, %u compiled in %.1f ms, %u rejected\n",
+		binaries.loaded, binaries.loadTime, binaries.compiled, binaries.compileTime, binaries.rejected);
+}
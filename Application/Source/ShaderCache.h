@@ -0,0 +1,112 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include <vector>
+#include <string>
+#include "Light.h"
+#include "UniformBlocks.h"
+#include "ShaderBatch.h"
+
+/******************************************************************************/
+/*!
+		Struct ShaderFeatures:
+\brief	What a specialized program is built for. Each field becomes a
+		#define ahead of the shader source, so the compiler folds away the
+		branches the uber shader takes at run time on lightEnabled,
+		colorTextureEnabled, numLights and each light's type.
+
+		A program built for some lights only draws correctly while the
+		frame's FrameData lights have that count and those types.
+*/
+/******************************************************************************/
+struct ShaderFeatures
+{
+	bool lighting;
+	bool colorTexture;
+	bool clusteredLights;		// loop over the LightClusters texture buffers as well
+	int numLights;				// FrameData lights, up to UniformBlocks::MAX_LIGHTS
+	Light::LIGHT_TYPE lightTypes[UniformBlocks::MAX_LIGHTS];
+
+	ShaderFeatures();
+
+	// Count and types of these lights, as UniformBlocks::SetFrame would upload them
+	void SetLights(const Light* lights, int numLights);
+
+	// Features that make no difference are dropped first, e.g. the lights of an unlit program
+	unsigned long long GetKey(void) const;
+	std::string GetDefines(void) const;
+};
+
+/******************************************************************************/
+/*!
+		Class ShaderCache:
+\brief	Builds programs on demand from a pair of shader sources and a set
+		of ShaderFeatures, and hands back the same program whenever the
+		same sources and features are asked for again. Every program is
+		registered with UniformBlocks when it is built and owned by the
+		cache, so scenes must not delete them.
+
+		Building compiles GLSL, so requests must come from the thread that
+		owns the GL context; scenes that record on another thread ask for
+		all the programs they need in Init.
+
+		RequestProgram hands out a program that is still compiling in a
+		ShaderBatch. Draws that ask for it resolve to its fallback until
+		Poll, called once per frame on the GL thread, sees it linked.
+*/
+/******************************************************************************/
+class ShaderCache
+{
+public:
+	static ShaderCache* GetInstance(void);
+	static void DestroyInstance(void);
+
+	// Sources compiled with the features as #defines, for shaders that test SPECIALIZED
+	unsigned GetProgram(const char* vertexPath, const char* fragmentPath, const ShaderFeatures& features);
+	// Sources compiled as they are, every feature decided at run time
+	unsigned GetUberProgram(const char* vertexPath, const char* fragmentPath);
+
+	// GetProgram without the wait; the fallback should be an uber program already built
+	unsigned RequestProgram(const char* vertexPath, const char* fragmentPath, const ShaderFeatures& features, unsigned fallbackProgramID);
+	// Start compiling what was requested, then register whatever the driver has finished without waiting on the rest
+	void Poll(void);
+	// Wait for every requested program
+	void Finish(void);
+	// The program to draw with when programID is asked for
+	unsigned Resolve(unsigned programID) const;
+	unsigned GetNumPending(void) const;
+
+	// Delete every program; ids handed out before are no longer valid
+	void Clear(void);
+
+	unsigned GetNumPrograms(void) const;
+	double GetBuildTime(void) const;	// ms spent building programs so far
+	void PrintStats(void) const;
+
+private:
+	ShaderCache(void);
+	~ShaderCache(void);
+
+	static ShaderCache* m_instance;
+
+	static const unsigned long long UBER_KEY = ~0ULL;
+
+	struct Entry
+	{
+		std::string vertexPath;
+		std::string fragmentPath;
+		unsigned long long key;
+		unsigned programID;
+	};
+
+	unsigned GetProgram(const char* vertexPath, const char* fragmentPath, unsigned long long key, const std::string& defines, unsigned fallbackProgramID, bool wait);
+	void BindLinked(void);
+
+	std::vector<Entry> entries;
+	ShaderBatch batch;
+	std::vector<unsigned> linked;
+	unsigned numHits;
+	double buildTime;
+};
+
+#endif
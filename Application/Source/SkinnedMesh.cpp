@@ -0,0 +1,151 @@
+#include "SkinnedMesh.h"
+#include "GL\glew.h"
+#include "GLStateCache.h"
+
+#include <stddef.h>
+
+/******************************************************************************/
+/*!
+\brief
+Default constructor - the buffers are created by Upload
+
+\param meshName - name of mesh
+*/
+/******************************************************************************/
+SkinnedMesh::SkinnedMesh(const std::string &meshName)
+	: name(meshName)
+	, vertexArray(0)
+	, vertexBuffer(0)
+	, indexBuffer(0)
+	, indexSize(0)
+{
+}
+
+/******************************************************************************/
+/*!
+\brief
+Destructor - delete the buffers here
+*/
+/******************************************************************************/
+SkinnedMesh::~SkinnedMesh()
+{
+	GLStateCache* state = GLStateCache::GetInstance();
+	if (vertexArray)
+		state->DeleteVertexArray(vertexArray);
+	if (vertexBuffer)
+		state->DeleteBuffer(vertexBuffer);
+	if (indexBuffer)
+		state->DeleteBuffer(indexBuffer);
+}
+
+/******************************************************************************/
+/*!
+\brief
+Copy the vertex and index data into the mesh's own buffers
+
+\param vertices - vertex data with joints and weights
+\param indices - triangle list indices
+*/
+/******************************************************************************/
+void SkinnedMesh::Upload(const std::vector<SkinnedVertex>& vertices, const std::vector<unsigned>& indices)
+{
+	Upload(vertices.empty() ? NULL : &vertices[0], static_cast<unsigned>(vertices.size()),
+		indices.empty() ? NULL : &indices[0], static_cast<unsigned>(indices.size()));
+}
+
+void SkinnedMesh::Upload(const SkinnedVertex* vertices, unsigned vertexCount, const unsigned* indices, unsigned indexCount)
+{
+	this->vertices.assign(vertices, vertices + vertexCount);
+	for (size_t i = 0; i < this->vertices.size(); ++i)
+	{
+		glm::vec4& weights = this->vertices[i].weights;
+		float sum = weights.x + weights.y + weights.z + weights.w;
+		weights = sum > 0.f ? weights / sum : glm::vec4(1.f, 0.f, 0.f, 0.f);
+	}
+
+	GLStateCache* state = GLStateCache::GetInstance();
+	if (vertexArray == 0)
+	{
+		glGenVertexArrays(1, &vertexArray);
+		glGenBuffers(1, &vertexBuffer);
+		glGenBuffers(1, &indexBuffer);
+	}
+	state->BindVertexArray(vertexArray);
+	state->BindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(SkinnedVertex), this->vertices.empty() ? NULL : &this->vertices[0], GL_STATIC_DRAW);
+	state->BindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(GLuint), indices, GL_STATIC_DRAW);
+	indexSize = indexCount;
+
+	glEnableVertexAttribArray(0); // 1st attribute buffer : positions
+	glEnableVertexAttribArray(1); // 2nd attribute buffer : colors
+	glEnableVertexAttribArray(2); // 3rd attribute : normals
+	glEnableVertexAttribArray(3); // 4th attribute : texture coordinate
+	glEnableVertexAttribArray(4); // 5th attribute : joint indices
+	glEnableVertexAttribArray(5); // 6th attribute : joint weights
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex), (void*)offsetof(SkinnedVertex, pos));
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex), (void*)offsetof(SkinnedVertex, color));
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex), (void*)offsetof(SkinnedVertex, normal));
+	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex), (void*)offsetof(SkinnedVertex, texCoord));
+	// Integer attribute, so the shader indexes the palette with the byte values as they are
+	glVertexAttribIPointer(4, 4, GL_UNSIGNED_BYTE, sizeof(SkinnedVertex), (void*)offsetof(SkinnedVertex, joints));
+	glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(SkinnedVertex), (void*)offsetof(SkinnedVertex, weights));
+}
+
+void SkinnedMesh::SetBindPose(const std::vector<glm::mat4>& jointBindPose)
+{
+	inverseBindPose.resize(jointBindPose.size());
+	for (size_t j = 0; j < jointBindPose.size(); ++j)
+		inverseBindPose[j] = glm::inverse(jointBindPose[j]);
+}
+
+void SkinnedMesh::SetInverseBindPose(const std::vector<glm::mat4>& jointInverseBindPose)
+{
+	inverseBindPose = jointInverseBindPose;
+}
+
+unsigned SkinnedMesh::GetNumVertices(void) const
+{
+	return static_cast<unsigned>(vertices.size());
+}
+
+unsigned SkinnedMesh::GetNumJoints(void) const
+{
+	return static_cast<unsigned>(inverseBindPose.size());
+}
+
+void SkinnedMesh::ComputePalette(const glm::mat4* jointPose, glm::mat4* palette) const
+{
+	for (size_t j = 0; j < inverseBindPose.size(); ++j)
+		palette[j] = jointPose[j] * inverseBindPose[j];
+}
+
+void SkinnedMesh::Skin(const glm::mat4* palette, std::vector<glm::vec3>& out_positions, std::vector<glm::vec3>& out_normals) const
+{
+	out_positions.resize(vertices.size());
+	out_normals.resize(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		const SkinnedVertex& v = vertices[i];
+		glm::mat4 skin = palette[v.joints[0]] * v.weights.x + palette[v.joints[1]] * v.weights.y
+			+ palette[v.joints[2]] * v.weights.z + palette[v.joints[3]] * v.weights.w;
+		out_positions[i] = glm::vec3(skin * glm::vec4(v.pos, 1.f));
+		// Joints only rotate, translate and scale uniformly, so the blended matrix is fine for normals
+		out_normals[i] = glm::mat3(skin) * v.normal;
+	}
+}
+
+/******************************************************************************/
+/*!
+\brief
+OpenGL render code; the caller sets ObjectData and SkinData first
+*/
+/******************************************************************************/
+void SkinnedMesh::Render()
+{
+	if (indexSize == 0)
+		return;
+
+	GLStateCache::GetInstance()->BindVertexArray(vertexArray);
+	glDrawElements(GL_TRIANGLES, indexSize, GL_UNSIGNED_INT, 0);
+}
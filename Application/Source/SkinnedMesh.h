@@ -0,0 +1,61 @@
+#ifndef SKINNED_MESH_H
+#define SKINNED_MESH_H
+
+#include <string>
+#include <vector>
+#include "Material.h"
+#include "Vertex.h"
+
+/******************************************************************************/
+/*!
+		Class SkinnedMesh:
+\brief	A mesh whose vertices follow the joints of a skeleton, so a whole
+		articulated character is one draw instead of one per rigid part.
+
+		Each vertex names up to four joints and weights. The joint palette,
+		world * inverse bind matrix of every joint, goes to the SkinData
+		uniform block and Skinning.vertexshader blends it per vertex.
+		Skin does the same blend on the CPU, as the reference the shader
+		is checked against.
+
+		The vertex layout differs from Vertex, so the mesh keeps its own
+		buffers rather than a GeometryArena range.
+*/
+/******************************************************************************/
+class SkinnedMesh
+{
+public:
+	SkinnedMesh(const std::string &meshName);
+	~SkinnedMesh();
+
+	// Weights are renormalized to sum to one; the CPU copy is kept for Skin
+	void Upload(const std::vector<SkinnedVertex>& vertices, const std::vector<unsigned>& indices);
+	void Upload(const SkinnedVertex* vertices, unsigned vertexCount, const unsigned* indices, unsigned indexCount);
+	// Model space transform of every joint in the pose the vertices were modelled in
+	void SetBindPose(const std::vector<glm::mat4>& jointBindPose);
+	// Same, given already inverted, as model files store it
+	void SetInverseBindPose(const std::vector<glm::mat4>& jointInverseBindPose);
+
+	unsigned GetNumVertices(void) const;
+	unsigned GetNumJoints(void) const;
+	// palette[j] = jointPose[j] * inverse bind pose of j, for both UniformBlocks::SetSkin and Skin
+	void ComputePalette(const glm::mat4* jointPose, glm::mat4* palette) const;
+	// Reference skinning of every vertex, the same math as Skinning.vertexshader
+	void Skin(const glm::mat4* palette, std::vector<glm::vec3>& out_positions, std::vector<glm::vec3>& out_normals) const;
+
+	void Render();
+
+	const std::string name;
+	unsigned vertexArray;
+	unsigned vertexBuffer;
+	unsigned indexBuffer;
+	unsigned indexSize;
+
+	Material material;
+
+private:
+	std::vector<SkinnedVertex> vertices;
+	std::vector<glm::mat4> inverseBindPose;
+};
+
+#endif
@@ -0,0 +1,191 @@
+#include "StreamBuffer.h"
+#include <GL\glew.h>
+#include <GLFW/glfw3.h>
+#include "GLStateCache.h"
+
+#include <string.h>
+
+// GL 4.4 / ARB_buffer_storage, newer than the bundled GLEW
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+namespace
+{
+	typedef void (APIENTRY* BufferStorageProc)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+	BufferStorageProc LoadBufferStorage(void)
+	{
+		GLint major = 0, minor = 0;
+		glGetIntegerv(GL_MAJOR_VERSION, &major);
+		glGetIntegerv(GL_MINOR_VERSION, &minor);
+		bool supported = major > 4 || (major == 4 && minor >= 4) || glfwExtensionSupported("GL_ARB_buffer_storage");
+		if (!supported)
+			return nullptr;
+		return reinterpret_cast<BufferStorageProc>(glfwGetProcAddress("glBufferStorage"));
+	}
+}
+
+StreamBuffer::StreamBuffer()
+	: target(0)
+	, buffer(0)
+	, regionSize(0)
+	, numRegions(0)
+	, region(0)
+	, head(0)
+	, persistent(false)
+	, mapped(nullptr)
+	, numWaits(0)
+{
+	for (unsigned i = 0; i < MAX_REGIONS; ++i)
+		fences[i] = nullptr;
+}
+
+StreamBuffer::~StreamBuffer()
+{
+}
+
+bool StreamBuffer::IsPersistentSupported(void)
+{
+	return LoadBufferStorage() != nullptr;
+}
+
+bool StreamBuffer::Init(unsigned target, unsigned regionSize, unsigned numRegions)
+{
+	if (numRegions < 1 || numRegions > MAX_REGIONS)
+		return false;
+
+	this->target = target;
+	this->regionSize = regionSize;
+	this->numRegions = numRegions;
+	region = 0;
+	head = 0;
+	numWaits = 0;
+
+	GLStateCache* state = GLStateCache::GetInstance();
+	GLsizeiptr size = static_cast<GLsizeiptr>(regionSize) * numRegions;
+	glGenBuffers(1, &buffer);
+	state->BindBuffer(target, buffer);
+
+	BufferStorageProc bufferStorage = LoadBufferStorage();
+	if (bufferStorage)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		bufferStorage(target, size, NULL, flags);
+		mapped = static_cast<unsigned char*>(glMapBufferRange(target, 0, size, flags));
+	}
+	persistent = mapped != nullptr;
+
+	if (!persistent)
+	{
+		// Immutable storage cannot be respecified, so start over with a plain buffer
+		if (bufferStorage)
+		{
+			state->DeleteBuffer(buffer);
+			glGenBuffers(1, &buffer);
+			state->BindBuffer(target, buffer);
+		}
+		glBufferData(target, size, NULL, GL_STREAM_DRAW);
+	}
+	return true;
+}
+
+void StreamBuffer::Exit(void)
+{
+	if (buffer == 0)
+		return;
+
+	for (unsigned i = 0; i < MAX_REGIONS; ++i)
+	{
+		if (fences[i])
+		{
+			glDeleteSync(static_cast<GLsync>(fences[i]));
+			fences[i] = nullptr;
+		}
+	}
+	if (persistent)
+	{
+		GLStateCache::GetInstance()->BindBuffer(target, buffer);
+		glUnmapBuffer(target);
+	}
+	GLStateCache::GetInstance()->DeleteBuffer(buffer);
+	buffer = 0;
+	mapped = nullptr;
+	persistent = false;
+}
+
+void StreamBuffer::NextRegion(void)
+{
+	if (buffer == 0)
+		return;
+
+	// Draws already issued from this region complete before the fence signals
+	if (fences[region])
+		glDeleteSync(static_cast<GLsync>(fences[region]));
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	region = (region + 1) % numRegions;
+	head = 0;
+
+	GLsync fence = static_cast<GLsync>(fences[region]);
+	if (fence == nullptr)
+		return;
+
+	// Normally signalled long ago; the flush makes sure a wait cannot hang on an unsubmitted fence
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		++numWaits;
+		while (result == GL_TIMEOUT_EXPIRED)
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+	}
+	glDeleteSync(fence);
+	fences[region] = nullptr;
+}
+
+unsigned StreamBuffer::Write(const void* data, unsigned size, unsigned alignment)
+{
+	unsigned offset = (head + alignment - 1) / alignment * alignment;
+	if (buffer == 0 || offset + size > regionSize)
+		return NO_SPACE;
+	head = offset + size;
+	offset += region * regionSize;
+
+	if (persistent)
+	{
+		memcpy(mapped + offset, data, size);
+		return offset;
+	}
+
+	// The fences already guarantee the GPU is done with this range
+	GLStateCache::GetInstance()->BindBuffer(target, buffer);
+	void* dst = glMapBufferRange(target, offset, size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+	if (dst == nullptr)
+		return NO_SPACE;
+	memcpy(dst, data, size);
+	glUnmapBuffer(target);
+	return offset;
+}
+
+unsigned StreamBuffer::GetBuffer(void) const
+{
+	return buffer;
+}
+
+unsigned StreamBuffer::GetRegionSize(void) const
+{
+	return regionSize;
+}
+
+bool StreamBuffer::IsPersistent(void) const
+{
+	return persistent;
+}
+
+unsigned StreamBuffer::GetNumWaits(void) const
+{
+	return numWaits;
+}
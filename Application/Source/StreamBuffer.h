@@ -0,0 +1,58 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+/******************************************************************************/
+/*!
+		Class StreamBuffer:
+\brief	Ring of per-frame regions in one buffer object for data the CPU
+		rewrites every frame. Writes go straight into mapped memory and a
+		fence per region keeps the CPU from overwriting a region the GPU
+		may still be reading, so the hot loop never waits on the driver.
+
+		With GL 4.4 / ARB_buffer_storage the buffer is mapped once,
+		persistent and coherent, and a write is a memcpy. Without it each
+		write maps its range unsynchronized, which costs a driver call
+		but still never stalls, since the fences do the synchronization.
+*/
+/******************************************************************************/
+class StreamBuffer
+{
+public:
+	static const unsigned MAX_REGIONS = 4;
+	static const unsigned NO_SPACE = 0xFFFFFFFF;
+
+	StreamBuffer();
+	~StreamBuffer();
+
+	// Whether the context can create persistently mapped buffers
+	static bool IsPersistentSupported(void);
+
+	// Regions are normally one per frame in flight, so 3 for triple buffering
+	bool Init(unsigned target, unsigned regionSize, unsigned numRegions = 3);
+	void Exit(void);
+
+	// Fence the region written so far, then move to the next one, waiting only if the GPU still reads it
+	void NextRegion(void);
+
+	// Copy data into the current region; returns its offset in the buffer, or NO_SPACE when the region is full
+	unsigned Write(const void* data, unsigned size, unsigned alignment);
+
+	unsigned GetBuffer(void) const;
+	unsigned GetRegionSize(void) const;
+	bool IsPersistent(void) const;
+	unsigned GetNumWaits(void) const;	// NextRegion calls that had to block on a fence
+
+private:
+	unsigned target;
+	unsigned buffer;
+	unsigned regionSize;
+	unsigned numRegions;
+	unsigned region;		// region being written
+	unsigned head;			// next free byte inside it
+	bool persistent;
+	unsigned char* mapped;	// whole buffer when persistently mapped, otherwise nullptr
+	void* fences[MAX_REGIONS];	// GLsync of the last frame that used each region
+	unsigned numWaits;
+};
+
+#endif
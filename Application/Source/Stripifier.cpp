@@ -0,0 +1,224 @@
+#include "Stripifier.h"
+
+#include <algorithm>
+#include <deque>
+
+namespace
+{
+	// Directed edge u->v of a triangle, keyed as (u << 32 | v)
+	struct EdgeEntry
+	{
+		unsigned long long key;
+		unsigned tri;
+
+		bool operator<(const EdgeEntry& that) const { return key < that.key; }
+	};
+
+	unsigned long long EdgeKey(unsigned u, unsigned v)
+	{
+		return (static_cast<unsigned long long>(u) << 32) | v;
+	}
+
+	bool IsDegenerate(unsigned a, unsigned b, unsigned c)
+	{
+		return a == b || b == c || c == a;
+	}
+
+	class StripBuilder
+	{
+	public:
+		StripBuilder(const std::vector<unsigned>& triangles)
+			: tris(triangles)
+			, numTri(static_cast<unsigned>(triangles.size() / 3))
+			, visited(numTri, 0)
+			, stamp(numTri, 0)
+			, currStamp(0)
+		{
+			edges.reserve(numTri * 3);
+			for (unsigned t = 0; t < numTri; ++t)
+			{
+				unsigned a = tris[t * 3], b = tris[t * 3 + 1], c = tris[t * 3 + 2];
+				if (IsDegenerate(a, b, c))
+				{
+					visited[t] = 1;
+					continue;
+				}
+				EdgeEntry e;
+				e.tri = t;
+				e.key = EdgeKey(a, b); edges.push_back(e);
+				e.key = EdgeKey(b, c); edges.push_back(e);
+				e.key = EdgeKey(c, a); edges.push_back(e);
+			}
+			std::sort(edges.begin(), edges.end());
+		}
+
+		void Build(std::vector<unsigned>& out)
+		{
+			std::vector<unsigned> strip;
+			for (unsigned t = 0; t < numTri; ++t)
+			{
+				if (visited[t])
+					continue;
+
+				// Try all three rotations of the seed triangle and keep the longest
+				unsigned bestRotation = 0, bestLength = 0;
+				for (unsigned r = 0; r < 3; ++r)
+				{
+					++currStamp;
+					Grow(t, r, false, strip);
+					if (strip.size() > bestLength)
+					{
+						bestLength = static_cast<unsigned>(strip.size());
+						bestRotation = r;
+					}
+				}
+				Grow(t, bestRotation, true, strip);
+
+				if (!out.empty())
+					out.push_back(STRIP_RESTART_INDEX);
+				out.insert(out.end(), strip.begin(), strip.end());
+			}
+		}
+
+	private:
+		const std::vector<unsigned>& tris;
+		unsigned numTri;
+		std::vector<EdgeEntry> edges;
+		std::vector<char> visited;
+		std::vector<unsigned> stamp;
+		unsigned currStamp;
+
+		bool IsFree(unsigned t, bool commit) const
+		{
+			return !visited[t] && (commit || stamp[t] != currStamp);
+		}
+
+		void Take(unsigned t, bool commit)
+		{
+			if (commit)
+				visited[t] = 1;
+			else
+				stamp[t] = currStamp;
+		}
+
+		// Find a free triangle containing the directed edge u->v and return its third vertex
+		bool FindNeighbour(unsigned u, unsigned v, bool commit, unsigned& tri, unsigned& third) const
+		{
+			EdgeEntry probe;
+			probe.key = EdgeKey(u, v);
+			probe.tri = 0;
+			std::vector<EdgeEntry>::const_iterator it = std::lower_bound(edges.begin(), edges.end(), probe);
+			for (; it != edges.end() && it->key == probe.key; ++it)
+			{
+				if (!IsFree(it->tri, commit))
+					continue;
+				const unsigned* t = &tris[it->tri * 3];
+				tri = it->tri;
+				third = (t[0] != u && t[0] != v) ? t[0] : (t[1] != u && t[1] != v) ? t[1] : t[2];
+				return true;
+			}
+			return false;
+		}
+
+		void Grow(unsigned seed, unsigned rotation, bool commit, std::vector<unsigned>& strip)
+		{
+			const unsigned* t = &tris[seed * 3];
+			strip.clear();
+			strip.push_back(t[rotation]);
+			strip.push_back(t[(rotation + 1) % 3]);
+			strip.push_back(t[(rotation + 2) % 3]);
+			Take(seed, commit);
+
+			for (;;)
+			{
+				// GL draws odd triangles of a strip as (i+1, i, i+2), so the
+				// shared edge flips direction every step to keep the winding
+				size_t i = strip.size() - 2;
+				unsigned u = (i % 2 == 0) ? strip[i] : strip[i + 1];
+				unsigned v = (i % 2 == 0) ? strip[i + 1] : strip[i];
+				unsigned next, third;
+				if (!FindNeighbour(u, v, commit, next, third))
+					break;
+				Take(next, commit);
+				strip.push_back(third);
+			}
+		}
+	};
+}
+
+void Stripify(
+	const std::vector<unsigned>& in_triangles,
+	std::vector<unsigned>& out_strips
+)
+{
+	out_strips.clear();
+	if (in_triangles.size() < 3)
+		return;
+
+	StripBuilder builder(in_triangles);
+	builder.Build(out_strips);
+}
+
+void StripToList(
+	const std::vector<unsigned>& in_strips,
+	std::vector<unsigned>& out_triangles
+)
+{
+	out_triangles.clear();
+	size_t start = 0;
+	for (size_t i = 0; i <= in_strips.size(); ++i)
+	{
+		if (i < in_strips.size() && in_strips[i] != STRIP_RESTART_INDEX)
+			continue;
+
+		// [start, i) is a single strip
+		for (size_t k = start; k + 2 < i; ++k)
+		{
+			unsigned a = in_strips[k], b = in_strips[k + 1], c = in_strips[k + 2];
+			if (IsDegenerate(a, b, c))
+				continue;
+			if ((k - start) % 2 == 0)
+			{
+				out_triangles.push_back(a);
+				out_triangles.push_back(b);
+			}
+			else
+			{
+				out_triangles.push_back(b);
+				out_triangles.push_back(a);
+			}
+			out_triangles.push_back(c);
+		}
+		start = i + 1;
+	}
+}
+
+float ComputeACMR(const std::vector<unsigned>& indices, bool isStrip, unsigned cacheSize)
+{
+	std::vector<unsigned> triangles;
+	if (isStrip)
+	{
+		// The cache sees the strip's indices in order, but only real triangles count
+		StripToList(indices, triangles);
+	}
+	unsigned numTriangles = static_cast<unsigned>((isStrip ? triangles.size() : indices.size()) / 3);
+	if (numTriangles == 0)
+		return 0.f;
+
+	std::deque<unsigned> cache;
+	unsigned misses = 0;
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		unsigned index = indices[i];
+		if (index == STRIP_RESTART_INDEX)
+			continue;
+		if (std::find(cache.begin(), cache.end(), index) != cache.end())
+			continue;
+
+		++misses;
+		cache.push_back(index);
+		if (cache.size() > cacheSize)
+			cache.pop_front();
+	}
+	return static_cast<float>(misses) / numTriangles;
+}
@@ -0,0 +1,55 @@
+#ifndef STRIPIFIER_H
+#define STRIPIFIER_H
+
+#include <vector>
+
+// Index value that ends the current strip (GL_PRIMITIVE_RESTART_FIXED_INDEX for GL_UNSIGNED_INT)
+const unsigned STRIP_RESTART_INDEX = 0xFFFFFFFF;
+
+/******************************************************************************/
+/*!
+\brief
+Convert an indexed triangle list into triangle strips separated by
+STRIP_RESTART_INDEX. Winding of every source triangle is preserved and
+degenerate triangles are dropped.
+
+\param in_triangles - triangle list, 3 indices per triangle
+\param out_strips - receives the strip indices
+*/
+/******************************************************************************/
+void Stripify(
+	const std::vector<unsigned> & in_triangles,
+	std::vector<unsigned> & out_strips
+);
+
+/******************************************************************************/
+/*!
+\brief
+Expand triangle strips (optionally separated by STRIP_RESTART_INDEX) back into
+a triangle list, dropping degenerate triangles
+
+\param in_strips - strip indices
+\param out_triangles - receives the triangle list
+*/
+/******************************************************************************/
+void StripToList(
+	const std::vector<unsigned> & in_strips,
+	std::vector<unsigned> & out_triangles
+);
+
+/******************************************************************************/
+/*!
+\brief
+Average cache miss ratio (vertex shader invocations per triangle) of an index
+buffer when run through a FIFO post-transform cache
+
+\param indices - triangle list, or strips if isStrip is true
+\param isStrip - whether indices are strips separated by STRIP_RESTART_INDEX
+\param cacheSize - number of entries in the simulated cache
+
+\return Cache misses divided by the number of triangles
+*/
+/******************************************************************************/
+float ComputeACMR(const std::vector<unsigned> & indices, bool isStrip, unsigned cacheSize = 16);
+
+#endif
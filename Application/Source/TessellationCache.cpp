@@ -0,0 +1,168 @@
+#include "TessellationCache.h"
+#include "MeshBuilder.h"
+
+#include <limits>
+#include <glm\gtc\constants.hpp>
+
+TessellationCache::TessellationCache()
+	: maxError(0.5f)
+	, boundingRadius(1.f)
+	, lastLevel(0)
+{
+	for (int i = 0; i < NUM_LEVELS; ++i)
+	{
+		levels[i] = nullptr;
+	}
+}
+
+TessellationCache::~TessellationCache()
+{
+	Exit();
+}
+
+/******************************************************************************/
+/*!
+\brief
+Generate every level of a sphere; stacks are half the slices so both
+directions have the same angular step
+
+\param meshName - name prefix of the level meshes
+\param color - vertex color
+\param radius - sphere radius
+*/
+/******************************************************************************/
+void TessellationCache::InitSphere(const std::string& meshName, glm::vec3 color, float radius)
+{
+	Exit();
+	boundingRadius = radius;
+	for (int i = 0; i < NUM_LEVELS; ++i)
+	{
+		int segments = MIN_SEGMENTS << i;
+		levels[i] = MeshBuilder::GenerateSphere(meshName + "_" + std::to_string(segments), color, radius, segments, segments / 2);
+	}
+}
+
+/******************************************************************************/
+/*!
+\brief
+Generate every level of a torus; the level is picked from the outer ring,
+which bounds the error of the tube ring as well
+
+\param meshName - name prefix of the level meshes
+\param color - vertex color
+\param innerR - tube radius
+\param outerR - ring radius
+*/
+/******************************************************************************/
+void TessellationCache::InitTorus(const std::string& meshName, glm::vec3 color, float innerR, float outerR)
+{
+	Exit();
+	boundingRadius = innerR + outerR;
+	for (int i = 0; i < NUM_LEVELS; ++i)
+	{
+		int segments = MIN_SEGMENTS << i;
+		levels[i] = MeshBuilder::GenerateTorus(meshName + "_" + std::to_string(segments), color, innerR, outerR, segments, segments);
+	}
+}
+
+void TessellationCache::Exit()
+{
+	for (int i = 0; i < NUM_LEVELS; ++i)
+	{
+		if (levels[i])
+		{
+			delete levels[i];
+			levels[i] = nullptr;
+		}
+	}
+}
+
+/******************************************************************************/
+/*!
+\brief
+Pick the coarsest level whose chord error stays under maxError pixels at the
+primitive's current projected size
+
+\param modelView - model view matrix the mesh will be drawn with
+\param projection - projection matrix
+\param viewportHeight - viewport height in pixels
+
+\return Mesh of the selected level
+*/
+/******************************************************************************/
+Mesh* TessellationCache::Select(const glm::mat4& modelView, const glm::mat4& projection, float viewportHeight)
+{
+	float projectedRadius = ProjectedRadius(boundingRadius, modelView, projection, viewportHeight);
+	int segments = SegmentsForChordError(projectedRadius, maxError);
+
+	lastLevel = 0;
+	while (lastLevel < NUM_LEVELS - 1 && (MIN_SEGMENTS << lastLevel) < segments)
+	{
+		++lastLevel;
+	}
+	return levels[lastLevel];
+}
+
+Mesh* TessellationCache::GetLevel(int level) const
+{
+	return levels[level];
+}
+
+int TessellationCache::GetLastLevel() const
+{
+	return lastLevel;
+}
+
+/******************************************************************************/
+/*!
+\brief
+Radius in pixels of a bounding sphere centred on the model origin
+
+\param radius - bounding radius in model space
+\param modelView - model view matrix
+\param projection - projection matrix
+\param viewportHeight - viewport height in pixels
+
+\return Projected radius, or the largest float if the camera is inside the sphere
+*/
+/******************************************************************************/
+float TessellationCache::ProjectedRadius(float radius, const glm::mat4& modelView, const glm::mat4& projection, float viewportHeight)
+{
+	// Largest axis scale of the model view, so non-uniform scaling stays conservative
+	float scale = glm::max(glm::length(glm::vec3(modelView[0])),
+		glm::max(glm::length(glm::vec3(modelView[1])), glm::length(glm::vec3(modelView[2]))));
+	float viewRadius = radius * scale;
+	float focal = projection[1][1] * 0.5f * viewportHeight;
+
+	// Orthographic projection does not divide by depth
+	if (projection[2][3] == 0.f)
+		return viewRadius * focal;
+
+	float depth = -modelView[3].z;
+	if (depth <= viewRadius)
+		return std::numeric_limits<float>::max();
+	return viewRadius * focal / depth;
+}
+
+/******************************************************************************/
+/*!
+\brief
+Number of segments a circle of the given projected radius needs so that the
+sagitta of each chord, r * (1 - cos(pi / n)), is at most maxError
+
+\param projectedRadius - circle radius in pixels
+\param maxError - allowed chord error in pixels
+
+\return Segment count, at least MIN_SEGMENTS
+*/
+/******************************************************************************/
+int TessellationCache::SegmentsForChordError(float projectedRadius, float maxError)
+{
+	if (projectedRadius <= maxError)
+		return MIN_SEGMENTS;
+	if (projectedRadius == std::numeric_limits<float>::max())
+		return MIN_SEGMENTS << (NUM_LEVELS - 1);
+
+	float segments = glm::pi<float>() / glm::acos(1.f - maxError / projectedRadius);
+	return glm::max(MIN_SEGMENTS, static_cast<int>(glm::ceil(segments)));
+}
@@ -0,0 +1,44 @@
+#ifndef TESSELLATION_CACHE_H
+#define TESSELLATION_CACHE_H
+
+#include <string>
+#include <glm\glm.hpp>
+#include "Mesh.h"
+
+/******************************************************************************/
+/*!
+		Class TessellationCache:
+\brief	Pre-generated tessellation levels of one parametric primitive, with the
+		level picked per draw from a target screen-space chord error
+*/
+/******************************************************************************/
+class TessellationCache
+{
+public:
+	// Level i has (MIN_SEGMENTS << i) segments around its largest circle
+	static const int NUM_LEVELS = 6;
+	static const int MIN_SEGMENTS = 4;
+
+	TessellationCache();
+	~TessellationCache();
+
+	void InitSphere(const std::string& meshName, glm::vec3 color, float radius = 1.f);
+	void InitTorus(const std::string& meshName, glm::vec3 color, float innerR = 1.f, float outerR = 1.f);
+	void Exit();
+
+	Mesh* Select(const glm::mat4& modelView, const glm::mat4& projection, float viewportHeight);
+	Mesh* GetLevel(int level) const;
+	int GetLastLevel() const;
+
+	static float ProjectedRadius(float radius, const glm::mat4& modelView, const glm::mat4& projection, float viewportHeight);
+	static int SegmentsForChordError(float projectedRadius, float maxError);
+
+	float maxError;		// Target chord error in pixels
+
+private:
+	Mesh* levels[NUM_LEVELS];
+	float boundingRadius;
+	int lastLevel;
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include "ThreadPool.h"
+
+ThreadPool* ThreadPool::m_instance = nullptr;
+
+ThreadPool* ThreadPool::GetInstance(void)
+{
+	if (m_instance == nullptr)
+		m_instance = new ThreadPool();
+	return m_instance;
+}
+
+void ThreadPool::DestroyInstance(void)
+{
+	if (m_instance)
+	{
+		delete m_instance;
+		m_instance = nullptr;
+	}
+}
+
+ThreadPool::ThreadPool(void)
+	: job(nullptr)
+	, numTasks(0)
+	, generation(0)
+	, nextTask(0)
+	, remaining(0)
+	, stopping(false)
+{
+	SetNumThreads(0);
+}
+
+ThreadPool::~ThreadPool(void)
+{
+	Stop();
+}
+
+unsigned ThreadPool::GetNumThreads(void) const
+{
+	return static_cast<unsigned>(workers.size()) + 1;
+}
+
+void ThreadPool::SetNumThreads(unsigned numThreads)
+{
+	if (numThreads == 0)
+		numThreads = std::thread::hardware_concurrency();
+	if (numThreads == 0)
+		numThreads = 1;
+
+	Stop();
+	Start(numThreads - 1);
+}
+
+void ThreadPool::Start(unsigned numWorkers)
+{
+	stopping = false;
+	for (unsigned i = 0; i < numWorkers; ++i)
+		workers.push_back(std::thread(&ThreadPool::WorkerLoop, this, i + 1));
+}
+
+void ThreadPool::Stop(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (size_t i = 0; i < workers.size(); ++i)
+		workers[i].join();
+	workers.clear();
+}
+
+void ThreadPool::Run(unsigned numTasks, const std::function<void(unsigned index, unsigned thread)>& task)
+{
+	if (numTasks == 0)
+		return;
+
+	// Not worth waking anyone for
+	if (numTasks == 1 || workers.empty())
+	{
+		for (unsigned i = 0; i < numTasks; ++i)
+			task(i, 0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &task;
+		this->numTasks = numTasks;
+		remaining = numTasks;
+		++generation;
+		nextTask = static_cast<unsigned long long>(generation) << 32;
+	}
+	wake.notify_all();
+
+	RunTasks(0, generation, task, numTasks);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this] { return remaining == 0; });
+	job = nullptr;
+}
+
+void ThreadPool::WorkerLoop(unsigned thread)
+{
+	unsigned seen = 0;
+	for (;;)
+	{
+		// The job is copied while it is known to be current; Run may have moved on by the time it runs
+		const std::function<void(unsigned, unsigned)>* jobTask;
+		unsigned jobTasks;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this, seen] { return stopping || (job != nullptr && generation != seen); });
+			if (stopping)
+				return;
+			seen = generation;
+			jobTask = job;
+			jobTasks = numTasks;
+		}
+		RunTasks(thread, seen, *jobTask, jobTasks);
+	}
+}
+
+void ThreadPool::RunTasks(unsigned thread, unsigned jobGeneration, const std::function<void(unsigned, unsigned)>& jobTask, unsigned jobTasks)
+{
+	// Tasks are handed out one at a time, so uneven tasks still balance
+	// Run cannot return while an index is taken and unfinished, so jobTask stays valid for the ones taken here
+	unsigned long long next = nextTask.load();
+	for (;;)
+	{
+		if (static_cast<unsigned>(next >> 32) != jobGeneration)
+			return;
+		unsigned index = static_cast<unsigned>(next);
+		if (index >= jobTasks)
+			return;
+		if (!nextTask.compare_exchange_weak(next, next + 1))
+			continue;
+		next = next + 1;
+		jobTask(index, thread);
+		if (remaining.fetch_sub(1) == 1)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			done.notify_all();
+		}
+	}
+}
@@ -0,0 +1,60 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+/******************************************************************************/
+/*!
+		Class ThreadPool:
+\brief	Fixed set of worker threads for splitting one job into tasks. The
+		calling thread runs tasks too and Run returns once all of them are
+		done, so a job looks like an ordinary (blocking) function call.
+		Workers never touch GL; only the thread owning the context may.
+*/
+/******************************************************************************/
+class ThreadPool
+{
+public:
+	static ThreadPool* GetInstance(void);
+	static void DestroyInstance(void);
+
+	// Threads taking part in a job, the caller included
+	unsigned GetNumThreads(void) const;
+	// Restart with numThreads - 1 workers; 0 means one thread per hardware thread
+	void SetNumThreads(unsigned numThreads);
+
+	// Calls task(index, thread) for every index below numTasks; thread is below GetNumThreads()
+	void Run(unsigned numTasks, const std::function<void(unsigned index, unsigned thread)>& task);
+
+private:
+	ThreadPool(void);
+	~ThreadPool(void);
+
+	static ThreadPool* m_instance;
+
+	void Start(unsigned numWorkers);
+	void Stop(void);
+	void WorkerLoop(unsigned thread);
+	void RunTasks(unsigned thread, unsigned jobGeneration, const std::function<void(unsigned, unsigned)>& jobTask, unsigned jobTasks);
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;	// a job was posted or the pool is stopping
+	std::condition_variable done;	// the last task of a job finished
+
+	const std::function<void(unsigned, unsigned)>* job;
+	unsigned numTasks;
+	unsigned generation;		// bumped per job so workers run each job once
+	// Generation in the top 32 bits, next index below, so a worker still on
+	// an earlier job can never take an index of the current one
+	std::atomic<unsigned long long> nextTask;
+	std::atomic<unsigned> remaining;
+	bool stopping;
+};
+
+#endif
@@ -0,0 +1,351 @@
+#include "UniformBlocks.h"
+#include <GL\glew.h>
+#include "GLStateCache.h"
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <glm\gtc\matrix_inverse.hpp>
+
+UniformBlocks* UniformBlocks::m_instance = nullptr;
+
+UniformBlocks* UniformBlocks::GetInstance(void)
+{
+	if (m_instance == nullptr)
+		m_instance = new UniformBlocks();
+	return m_instance;
+}
+
+void UniformBlocks::DestroyInstance(void)
+{
+	if (m_instance)
+	{
+		delete m_instance;
+		m_instance = nullptr;
+	}
+}
+
+UniformBlocks::UniformBlocks(void)
+	: frameBuffer(0)
+	, objectBuffer(0)
+	, skinBuffer(0)
+	, clusterBuffer(0)
+	, clustersEnabled(false)
+	, maxTextureBufferSize(65536)
+	, objectStride(0)
+	, objectBinding(0)
+	, skinBinding(0)
+	, offsetAlignment(256)
+	, streaming(false)
+	, numStreamed(0)
+	, numOverflows(0)
+	, lastStreamed(0)
+	, lastOverflows(0)
+{
+	for (int i = 0; i < NUM_CLUSTER_BUFFERS; ++i)
+		clusterBuffers[i] = clusterTextures[i] = 0;
+}
+
+UniformBlocks::~UniformBlocks(void)
+{
+	objectStream.Exit();
+	if (frameBuffer)
+		GLStateCache::GetInstance()->DeleteBuffer(frameBuffer);
+	if (objectBuffer)
+		GLStateCache::GetInstance()->DeleteBuffer(objectBuffer);
+	if (skinBuffer)
+		GLStateCache::GetInstance()->DeleteBuffer(skinBuffer);
+	if (clusterBuffer)
+		GLStateCache::GetInstance()->DeleteBuffer(clusterBuffer);
+	for (int i = 0; i < NUM_CLUSTER_BUFFERS; ++i)
+	{
+		if (clusterTextures[i])
+			GLStateCache::GetInstance()->DeleteTexture(clusterTextures[i]);
+		if (clusterBuffers[i])
+			GLStateCache::GetInstance()->DeleteBuffer(clusterBuffers[i]);
+	}
+}
+
+void UniformBlocks::CreateBuffers(void)
+{
+	GLStateCache* state = GLStateCache::GetInstance();
+
+	glGenBuffers(1, &frameBuffer);
+	state->BindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), NULL, GL_DYNAMIC_DRAW);
+	state->BindBufferBase(GL_UNIFORM_BUFFER, BINDING_FRAME, frameBuffer);
+
+	glGenBuffers(1, &objectBuffer);
+	state->BindBuffer(GL_UNIFORM_BUFFER, objectBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(ObjectData), NULL, GL_DYNAMIC_DRAW);
+	state->BindBufferBase(GL_UNIFORM_BUFFER, BINDING_OBJECT, objectBuffer);
+	objectBinding = objectBuffer;
+
+	glGenBuffers(1, &skinBuffer);
+	state->BindBuffer(GL_UNIFORM_BUFFER, skinBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(SkinData), NULL, GL_DYNAMIC_DRAW);
+	state->BindBufferBase(GL_UNIFORM_BUFFER, BINDING_SKIN, skinBuffer);
+	skinBinding = skinBuffer;
+
+	// Cleared, so programs reading ClusterData before any SetClusters see no clustered lights
+	ClusterData cluster;
+	memset(&cluster, 0, sizeof(cluster));
+	glGenBuffers(1, &clusterBuffer);
+	state->BindBuffer(GL_UNIFORM_BUFFER, clusterBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(ClusterData), &cluster, GL_DYNAMIC_DRAW);
+	state->BindBufferBase(GL_UNIFORM_BUFFER, BINDING_CLUSTER, clusterBuffer);
+
+	// The cluster textures stay on their own units; SetClusters only replaces their buffers' contents
+	const GLenum formats[NUM_CLUSTER_BUFFERS] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+	const unsigned zero[4] = { 0, 0, 0, 0 };
+	glGenBuffers(NUM_CLUSTER_BUFFERS, clusterBuffers);
+	glGenTextures(NUM_CLUSTER_BUFFERS, clusterTextures);
+	for (int i = 0; i < NUM_CLUSTER_BUFFERS; ++i)
+	{
+		state->BindBuffer(GL_TEXTURE_BUFFER, clusterBuffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, sizeof(zero), zero, GL_STREAM_DRAW);
+		state->ActiveTexture(GL_TEXTURE0 + UNIT_CLUSTER_LIGHTS + i);
+		state->BindTexture(GL_TEXTURE_BUFFER, clusterTextures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, formats[i], clusterBuffers[i]);
+	}
+	state->ActiveTexture(GL_TEXTURE0);
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTextureBufferSize);
+
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	offsetAlignment = alignment;
+	objectStride = (sizeof(ObjectData) + alignment - 1) / alignment * alignment;
+	streaming = objectStream.Init(GL_UNIFORM_BUFFER, OBJECTS_PER_REGION * objectStride);
+}
+
+void UniformBlocks::ReserveObjects(unsigned numObjects)
+{
+	if (frameBuffer == 0)
+		CreateBuffers();
+	if (numObjects * objectStride <= objectStream.GetRegionSize())
+		return;
+
+	// The old buffer is only released by GL once the draws reading it are done
+	objectStream.Exit();
+	objectStream.Init(GL_UNIFORM_BUFFER, numObjects * objectStride);
+}
+
+void UniformBlocks::SetStreaming(bool streaming)
+{
+	if (frameBuffer == 0)
+		CreateBuffers();
+	this->streaming = streaming && objectStream.GetBuffer() != 0;
+}
+
+bool UniformBlocks::IsStreaming(void) const
+{
+	return streaming;
+}
+
+void UniformBlocks::PrintStats(void) const
+{
+	printf("object data last frame: %u draws streamed, %u through glBufferSubData; ring %s, %u fence waits\n",
+		lastStreamed, lastOverflows, objectStream.IsPersistent() ? "persistently mapped" : "map unsynchronized", objectStream.GetNumWaits());
+}
+
+void UniformBlocks::BindProgram(unsigned programID)
+{
+	if (frameBuffer == 0)
+		CreateBuffers();
+
+	GLuint frameIndex = glGetUniformBlockIndex(programID, "FrameData");
+	if (frameIndex != GL_INVALID_INDEX)
+		glUniformBlockBinding(programID, frameIndex, BINDING_FRAME);
+
+	GLuint objectIndex = glGetUniformBlockIndex(programID, "ObjectData");
+	if (objectIndex != GL_INVALID_INDEX)
+		glUniformBlockBinding(programID, objectIndex, BINDING_OBJECT);
+
+	GLuint skinIndex = glGetUniformBlockIndex(programID, "SkinData");
+	if (skinIndex != GL_INVALID_INDEX)
+		glUniformBlockBinding(programID, skinIndex, BINDING_SKIN);
+
+	GLuint clusterIndex = glGetUniformBlockIndex(programID, "ClusterData");
+	if (clusterIndex != GL_INVALID_INDEX)
+		glUniformBlockBinding(programID, clusterIndex, BINDING_CLUSTER);
+
+	// Left at unit 0 the buffer samplers would clash with the material's 2D texture
+	const char* samplers[NUM_CLUSTER_BUFFERS] = { "clusterLights", "clusterCells", "clusterIndices" };
+	GLint locations[NUM_CLUSTER_BUFFERS];
+	bool hasSamplers = false;
+	for (int i = 0; i < NUM_CLUSTER_BUFFERS; ++i)
+	{
+		locations[i] = glGetUniformLocation(programID, samplers[i]);
+		hasSamplers = hasSamplers || locations[i] != -1;
+	}
+	if (hasSamplers)
+	{
+		// Sampler units are program state, so the program is made current just long enough to set them
+		GLint current = 0;
+		glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+		GLStateCache::GetInstance()->UseProgram(programID);
+		for (int i = 0; i < NUM_CLUSTER_BUFFERS; ++i)
+			glUniform1i(locations[i], UNIT_CLUSTER_LIGHTS + i);
+		GLStateCache::GetInstance()->UseProgram(current);
+	}
+}
+
+void UniformBlocks::SetFrame(const glm::mat4& view, const glm::mat4& projection, const Light* lights, int numLights)
+{
+	if (frameBuffer == 0)
+		CreateBuffers();
+
+	if (streaming)
+		objectStream.NextRegion();
+	lastStreamed = numStreamed;
+	lastOverflows = numOverflows;
+	numStreamed = numOverflows = 0;
+
+	FrameData frame;
+	memset(&frame, 0, sizeof(frame));
+	frame.view = view;
+	frame.projection = projection;
+	frame.numLights = std::min(numLights, static_cast<int>(MAX_LIGHTS));
+	for (int i = 0; i < frame.numLights; ++i)
+	{
+		const Light& light = lights[i];
+		LightData& data = frame.lights[i];
+
+		// A directional light's position is its direction, so it must not pick up the view translation
+		data.position_cameraspace = glm::vec3(view * glm::vec4(light.position, light.type == Light::LIGHT_DIRECTIONAL ? 0.f : 1.f));
+		data.type = light.type;
+		data.color = light.color;
+		data.power = light.power;
+		data.spotDirection = glm::vec3(view * glm::vec4(light.spotDirection, 0.f));
+		data.cosCutoff = cosf(glm::radians(light.cosCutoff));
+		data.kC = light.kC;
+		data.kL = light.kL;
+		data.kQ = light.kQ;
+		data.cosInner = cosf(glm::radians(light.cosInner));
+		data.exponent = light.exponent;
+	}
+
+	// Only the used part of the light array is uploaded
+	GLStateCache* state = GLStateCache::GetInstance();
+	size_t size = offsetof(FrameData, lights) + frame.numLights * sizeof(LightData);
+	state->BindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, size, &frame);
+	state->BindBufferBase(GL_UNIFORM_BUFFER, BINDING_FRAME, frameBuffer);
+}
+
+void UniformBlocks::SetObject(const glm::mat4& MVP, const glm::mat4& modelView, const Material& material, bool lightEnabled, bool colorTextureEnabled)
+{
+	SetObject(MVP, modelView, lightEnabled ? glm::inverseTranspose(modelView) : glm::mat4(1.f), material, lightEnabled, colorTextureEnabled);
+}
+
+void UniformBlocks::SetObject(const glm::mat4& MVP, const glm::mat4& modelView, const glm::mat4& normalMatrix, const Material& material, bool lightEnabled, bool colorTextureEnabled)
+{
+	if (objectBuffer == 0)
+		CreateBuffers();
+
+	ObjectData object;
+	object.MVP = MVP;
+	object.MV = modelView;
+	object.MV_inverse_transpose = lightEnabled ? normalMatrix : glm::mat4(1.f);
+	object.material.kAmbient = material.kAmbient;
+	object.material.kDiffuse = material.kDiffuse;
+	object.material.kSpecular = material.kSpecular;
+	object.material.kShininess = material.kShininess;
+	object.material.padding0 = object.material.padding1 = 0.f;
+	object.lightEnabled = lightEnabled ? 1 : 0;
+	object.colorTextureEnabled = colorTextureEnabled ? 1 : 0;
+	object.padding[0] = object.padding[1] = 0;
+
+	if (WriteBlock(BINDING_OBJECT, objectBuffer, objectBinding, &object, sizeof(ObjectData), objectStride))
+		++numStreamed;
+	else
+		++numOverflows;
+}
+
+void UniformBlocks::SetSkin(const glm::mat4* palette, unsigned numJoints)
+{
+	if (skinBuffer == 0)
+		CreateBuffers();
+
+	// The whole block is written so the bound range always covers the shader's array
+	SkinData skin;
+	if (numJoints > MAX_SKIN_JOINTS)
+		numJoints = MAX_SKIN_JOINTS;
+	std::copy(palette, palette + numJoints, skin.palette);
+	std::fill(skin.palette + numJoints, skin.palette + MAX_SKIN_JOINTS, glm::mat4(1.f));
+	WriteBlock(BINDING_SKIN, skinBuffer, skinBinding, &skin, sizeof(SkinData), offsetAlignment);
+}
+
+void UniformBlocks::SetClusters(const LightClusters* clusters)
+{
+	if (clusterBuffer == 0)
+		CreateBuffers();
+
+	bool enabled = clusters != nullptr && !clusters->IsEmpty();
+	if (enabled)
+	{
+		size_t limit = static_cast<size_t>(maxTextureBufferSize);
+		if (clusters->lightTexels.size() > limit || clusters->cells.size() / 2 > limit || clusters->indices.size() > limit)
+		{
+			static bool reported = false;
+			if (!reported)
+				printf("clustered lights exceed GL_MAX_TEXTURE_BUFFER_SIZE (%d texels) and are left out\n", maxTextureBufferSize);
+			reported = true;
+			enabled = false;
+		}
+	}
+	// Nothing to tell the shaders if they already have no clustered lights
+	if (!enabled && !clustersEnabled)
+		return;
+	clustersEnabled = enabled;
+
+	GLStateCache* state = GLStateCache::GetInstance();
+	ClusterData cluster;
+	memset(&cluster, 0, sizeof(cluster));
+	if (enabled)
+	{
+		cluster.depthScaleBias = clusters->depthScaleBias;
+		cluster.grid = glm::ivec4(clusters->grid, 1);
+
+		// Respecifying the stores lets the driver hand out fresh memory instead of waiting on last frame's reads
+		const unsigned zero = 0;
+		const void* data[NUM_CLUSTER_BUFFERS] = { &clusters->lightTexels[0], &clusters->cells[0], clusters->indices.empty() ? &zero : &clusters->indices[0] };
+		size_t sizes[NUM_CLUSTER_BUFFERS] = { clusters->lightTexels.size() * sizeof(glm::vec4), clusters->cells.size() * sizeof(unsigned),
+			clusters->indices.empty() ? sizeof(zero) : clusters->indices.size() * sizeof(unsigned) };
+		for (int i = 0; i < NUM_CLUSTER_BUFFERS; ++i)
+		{
+			state->BindBuffer(GL_TEXTURE_BUFFER, clusterBuffers[i]);
+			glBufferData(GL_TEXTURE_BUFFER, sizes[i], data[i], GL_STREAM_DRAW);
+		}
+	}
+	state->BindBuffer(GL_UNIFORM_BUFFER, clusterBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ClusterData), &cluster);
+	state->BindBufferBase(GL_UNIFORM_BUFFER, BINDING_CLUSTER, clusterBuffer);
+}
+
+bool UniformBlocks::WriteBlock(BINDING binding, unsigned buffer, unsigned& bound, const void* data, unsigned size, unsigned alignment)
+{
+	GLStateCache* state = GLStateCache::GetInstance();
+	if (streaming)
+	{
+		unsigned offset = objectStream.Write(data, size, alignment);
+		if (offset != StreamBuffer::NO_SPACE)
+		{
+			state->BindBufferRange(GL_UNIFORM_BUFFER, binding, objectStream.GetBuffer(), offset, size);
+			bound = objectStream.GetBuffer();
+			return true;
+		}
+	}
+
+	// Updating a buffer the previous draw reads from makes the driver copy or wait
+	if (bound != buffer)
+	{
+		state->BindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+		bound = buffer;
+	}
+	state->BindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+	return false;
+}
@@ -0,0 +1,175 @@
+#ifndef UNIFORM_BLOCKS_H
+#define UNIFORM_BLOCKS_H
+
+#include <glm\glm.hpp>
+#include "Light.h"
+#include "Material.h"
+#include "StreamBuffer.h"
+#include "LightClusters.h"
+
+/******************************************************************************/
+/*!
+		Class UniformBlocks:
+\brief	The std140 uniform buffers shared by every lit program:
+		FrameData (view, projection and the light array) is written once per
+		frame, ObjectData (matrices, material and toggles) once per draw,
+		and SkinData (a skinned mesh's joint palette) once per skinned draw.
+		The layouts are mirrored by the blocks declared in the shaders.
+
+		Clustered lights go in texture buffers instead, as GL 3.3 has no
+		storage buffers: their camera space data, each cluster's range of
+		the index list and the index list itself. ClusterData tells the
+		shaders the grid and whether there are clustered lights at all.
+
+		Per-draw ObjectData and SkinData are streamed through a triple-buffered ring:
+		each draw's copy goes to the next aligned slot and is bound with
+		glBindBufferRange, and SetFrame moves the ring to the next region.
+		If the ring is disabled or a region fills up, the single ObjectData
+		or SkinData buffer is updated with glBufferSubData instead.
+*/
+/******************************************************************************/
+class UniformBlocks
+{
+public:
+	static const int MAX_LIGHTS = 8;
+	static const unsigned OBJECTS_PER_REGION = 16384;	// draws per frame before falling back
+	static const unsigned MAX_SKIN_JOINTS = 64;		// palette size in Skinning.vertexshader
+
+	enum BINDING
+	{
+		BINDING_FRAME = 0,
+		BINDING_OBJECT,
+		BINDING_SKIN,
+		BINDING_CLUSTER,
+		NUM_BINDINGS,
+	};
+
+	// Texture units of the cluster buffers, clear of the units materials use
+	enum CLUSTER_UNIT
+	{
+		UNIT_CLUSTER_LIGHTS = 13,
+		UNIT_CLUSTER_CELLS,
+		UNIT_CLUSTER_INDICES,
+	};
+
+	static UniformBlocks* GetInstance(void);
+	static void DestroyInstance(void);
+
+	// Point the program's FrameData, ObjectData, SkinData and ClusterData blocks at the shared
+	// binding points, and its cluster samplers at their units
+	void BindProgram(unsigned programID);
+
+	// Starts a new frame for the ring as well, so call it once per frame before the draws.
+	// Lights are converted to camera space here; only the first MAX_LIGHTS are used
+	void SetFrame(const glm::mat4& view, const glm::mat4& projection, const Light* lights, int numLights);
+	void SetObject(const glm::mat4& MVP, const glm::mat4& modelView, const Material& material, bool lightEnabled, bool colorTextureEnabled);
+	// Same, with the normal matrix already computed, e.g. by BatchTransform
+	void SetObject(const glm::mat4& MVP, const glm::mat4& modelView, const glm::mat4& normalMatrix, const Material& material, bool lightEnabled, bool colorTextureEnabled);
+
+	// Joint palette of the next skinned draw; only the first MAX_SKIN_JOINTS are used
+	void SetSkin(const glm::mat4* palette, unsigned numJoints);
+
+	// Lights binned by LightClusters, lit on top of the SetFrame ones; nullptr or none turns them off
+	void SetClusters(const LightClusters* clusters);
+
+	// Grow the ring so a frame of numObjects draws does not fall back
+	void ReserveObjects(unsigned numObjects);
+	void SetStreaming(bool streaming);
+	bool IsStreaming(void) const;
+	void PrintStats(void) const;
+
+private:
+	UniformBlocks(void);
+	~UniformBlocks(void);
+
+	static UniformBlocks* m_instance;
+
+	struct LightData
+	{
+		glm::vec3 position_cameraspace;
+		int type;
+		glm::vec3 color;
+		float power;
+		glm::vec3 spotDirection;
+		float cosCutoff;
+		float kC, kL, kQ;
+		float cosInner;
+		float exponent;
+		float padding[3];
+	};
+
+	struct FrameData
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		int numLights;
+		int padding[3];
+		LightData lights[MAX_LIGHTS];
+	};
+
+	struct MaterialData
+	{
+		glm::vec3 kAmbient;
+		float padding0;
+		glm::vec3 kDiffuse;
+		float padding1;
+		glm::vec3 kSpecular;
+		float kShininess;
+	};
+
+	struct ObjectData
+	{
+		glm::mat4 MVP;
+		glm::mat4 MV;
+		glm::mat4 MV_inverse_transpose;
+		MaterialData material;
+		int lightEnabled;			// bool in GLSL, 4 bytes in std140
+		int colorTextureEnabled;
+		int padding[2];
+	};
+
+	struct SkinData
+	{
+		glm::mat4 palette[MAX_SKIN_JOINTS];
+	};
+
+	struct ClusterData
+	{
+		glm::vec2 depthScaleBias;
+		float padding[2];
+		glm::ivec4 grid;			// w is 0 when there are no clustered lights
+	};
+
+	enum CLUSTER_BUFFER
+	{
+		CLUSTER_LIGHTS = 0,
+		CLUSTER_CELLS,
+		CLUSTER_INDICES,
+		NUM_CLUSTER_BUFFERS,
+	};
+
+	void CreateBuffers(void);
+	// Stream a block through the ring and bind it, or update its own buffer when the ring is off or full.
+	// bound tracks which buffer is at the binding point; returns whether the ring took the data
+	bool WriteBlock(BINDING binding, unsigned buffer, unsigned& bound, const void* data, unsigned size, unsigned alignment);
+
+	unsigned frameBuffer;
+	unsigned objectBuffer;
+	unsigned skinBuffer;
+	unsigned clusterBuffer;
+	unsigned clusterBuffers[NUM_CLUSTER_BUFFERS];
+	unsigned clusterTextures[NUM_CLUSTER_BUFFERS];
+	bool clustersEnabled;
+	int maxTextureBufferSize;	// texels
+
+	StreamBuffer objectStream;
+	unsigned objectStride;		// sizeof(ObjectData) rounded up to the UBO offset alignment
+	unsigned objectBinding;		// buffer currently bound at BINDING_OBJECT
+	unsigned skinBinding;		// buffer currently bound at BINDING_SKIN
+	unsigned offsetAlignment;	// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	bool streaming;
+	unsigned numStreamed, numOverflows;	// draws of the last frame through the ring / through glBufferSubData
+	unsigned lastStreamed, lastOverflows;
+};
+
+#endif
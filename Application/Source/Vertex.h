@@ -25,5 +25,15 @@ struct Vertex
 	glm::vec3 normal;
 	glm::vec2 texCoord;
 };
+// Vertex that follows up to four joints of a SkinnedMesh, by weights summing to one
+struct SkinnedVertex
+{
+	glm::vec3 pos;
+	glm::vec3 color;
+	glm::vec3 normal;
+	glm::vec2 texCoord;
+	unsigned char joints[4];
+	glm::vec4 weights;
+};
 
 #endif
\ No newline at end of file
@@ -1,11 +1,39 @@
 
+#include <string.h>
+#include <stdlib.h>
 
 #include "Application.h"
+#include "Benchmark.h"
 
-int main( void )
+int main( int argc, char* argv[] )
 {
 	Application app;
 	app.Init();
-	app.Run();
+	// Application.exe --bench <name> [args...] runs a benchmark instead of the scene
+	if (argc > 2 && strcmp(argv[1], "--bench") == 0)
+		RunBenchmark(argv[2], argc - 3, argv + 3);
+	else
+	{
+		// Application.exe [--pipelined] [--crowd [count]] [--lights [count]]
+		// --pipelined overlaps updating a frame with drawing the previous one
+		// --crowd runs count (100000 by default) animated objects from an EntityStore instead of the default scene
+		// --lights adds count (256 by default) clustered point lights to the crowd, of 10000 objects unless --crowd says otherwise
+		for (int i = 1; i < argc; ++i)
+		{
+			if (strcmp(argv[i], "--pipelined") == 0)
+				app.SetPipelined(true);
+			else if (strcmp(argv[i], "--crowd") == 0)
+			{
+				bool hasCount = i + 1 < argc && argv[i + 1][0] != '-';
+				app.SetCrowd(hasCount ? static_cast<unsigned>(atoi(argv[++i])) : 100000);
+			}
+			else if (strcmp(argv[i], "--lights") == 0)
+			{
+				bool hasCount = i + 1 < argc && argv[i + 1][0] != '-';
+				app.SetLights(hasCount ? static_cast<unsigned>(atoi(argv[++i])) : 256);
+			}
+		}
+		app.Run();
+	}
 	app.Exit();
-}
\ No newline at end of file
+}
@@ -8,90 +8,209 @@ using namespace std;
 
 #include <stdlib.h>
 #include <string.h>
+#include <chrono>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
 
 #include <GL/glew.h>
 
 #include "shader.hpp"
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+// #version has to stay the first directive, so the defines follow its line
+static void InsertDefines(std::string& code, const char * defines){
+	if(defines == NULL || defines[0] == '\0')
+		return;
+	size_t version = code.find("#version");
+	if(version == std::string::npos){
+		code.insert(0, defines);
+		return;
+	}
+	size_t lineEnd = code.find('\n', version);
+	if(lineEnd == std::string::npos)
+		code += std::string("\n") + defines;
+	else
+		code.insert(lineEnd + 1, defines);
+}
 
-	// Create the shaders
-	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+// Where linked programs are kept between runs; empty turns the cache off
+static std::string ProgramBinaryDirectory = "ProgramCache";
+static ProgramBinaryStats ProgramBinaryCounts = { 0, 0, 0, 0.0, 0.0 };
 
-	// Read the Vertex Shader code from the file
-	std::string VertexShaderCode;
-	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-	if(VertexShaderStream.is_open()){
-		std::string Line = "";
-		while(getline(VertexShaderStream, Line))
-			VertexShaderCode += "\n" + Line;
-		VertexShaderStream.close();
-	}else{
-		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", vertex_file_path);
-		getchar();
-		return 0;
-	}
+static double MillisecondsSince(std::chrono::high_resolution_clock::time_point start){
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
 
-	// Read the Fragment Shader code from the file
-	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if(FragmentShaderStream.is_open()){
-		std::string Line = "";
-		while(getline(FragmentShaderStream, Line))
-			FragmentShaderCode += "\n" + Line;
-		FragmentShaderStream.close();
+static bool ReadShaderFile(const char * file_path, std::string& code){
+	std::ifstream Stream(file_path, std::ios::in);
+	if(!Stream.is_open())
+		return false;
+	std::string Line = "";
+	while(getline(Stream, Line))
+		code += "\n" + Line;
+	return true;
+}
+
+// FNV-1a, 64 bits; more than enough to tell a handful of programs apart
+static unsigned long long HashString(unsigned long long hash, const std::string& text){
+	for(size_t i = 0; i < text.size(); ++i){
+		hash ^= static_cast<unsigned char>(text[i]);
+		hash *= 1099511628211ULL;
 	}
+	return hash;
+}
 
+bool UseProgramBinaries(){
+	if(ProgramBinaryDirectory.empty() || !(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary))
+		return false;
+	// Some drivers expose the entry points with no format to save in
+	static GLint NumFormats = -1;
+	if(NumFormats < 0)
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &NumFormats);
+	return NumFormats > 0;
+}
 
+// A binary is only valid for the driver that made it, so the driver is part of the key
+// along with both sources, which already carry any permutation defines
+std::string GetProgramBinaryPath(const std::string& VertexShaderCode, const std::string& FragmentShaderCode){
+	if(!UseProgramBinaries())
+		return "";
+	static std::string Driver;
+	if(Driver.empty()){
+		const GLubyte * strings[3] = { glGetString(GL_VENDOR), glGetString(GL_RENDERER), glGetString(GL_VERSION) };
+		for(int i = 0; i < 3; ++i)
+			Driver += std::string(strings[i] ? reinterpret_cast<const char *>(strings[i]) : "") + "\n";
+	}
+	unsigned long long hash = 14695981039346656037ULL;
+	hash = HashString(hash, Driver);
+	hash = HashString(hash, VertexShaderCode);
+	hash = HashString(hash, std::string(1, '\0'));
+	hash = HashString(hash, FragmentShaderCode);
 
-	GLint Result = GL_FALSE;
-	int InfoLogLength;
+	char name[17];
+	for(int i = 0; i < 16; ++i)
+		name[i] = "0123456789abcdef"[(hash >> (60 - i * 4)) & 0xF];
+	name[16] = '\0';
+	return ProgramBinaryDirectory + "//" + name + ".bin";
+}
 
+// File layout: 'GLPB', binary format, binary length, then the binary
+static const unsigned ProgramBinaryMagic = 0x42504C47;
 
+// 0 when there is no binary or the driver refuses it; a refused file is removed so it is replaced
+GLuint LoadProgramBinary(const std::string& path){
+	if(path.empty())
+		return 0;
+	std::chrono::high_resolution_clock::time_point Start = std::chrono::high_resolution_clock::now();
+	std::ifstream Stream(path.c_str(), std::ios::in | std::ios::binary);
+	if(!Stream.is_open())
+		return 0;
+	unsigned Header[3] = { 0, 0, 0 };
+	Stream.read(reinterpret_cast<char *>(Header), sizeof(Header));
+	std::vector<char> Binary(Stream && Header[0] == ProgramBinaryMagic && Header[2] < (64u << 20) ? Header[2] : 0);
+	if(!Binary.empty())
+		Stream.read(&Binary[0], Binary.size());
+	bool Complete = !Binary.empty() && Stream;
+	Stream.close();
 
-	// Compile Vertex Shader
-	printf("Compiling shader : %s\n", vertex_file_path);
-	char const * VertexSourcePointer = VertexShaderCode.c_str();
-	glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
-	glCompileShader(VertexShaderID);
+	GLint Result = GL_FALSE;
+	GLuint ProgramID = 0;
+	if(Complete){
+		ProgramID = glCreateProgram();
+		glProgramBinary(ProgramID, Header[1], &Binary[0], static_cast<GLsizei>(Binary.size()));
+		glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
+	}
+	if(Result != GL_TRUE){
+		// Stale after a driver update, or cut short; compiling from source takes over
+		if(ProgramID != 0)
+			glDeleteProgram(ProgramID);
+		remove(path.c_str());
+		++ProgramBinaryCounts.rejected;
+		return 0;
+	}
+	++ProgramBinaryCounts.loaded;
+	ProgramBinaryCounts.loadTime += MillisecondsSince(Start);
+	return ProgramID;
+}
 
-	// Check Vertex Shader
-	glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if ( InfoLogLength > 0 ){
-		std::vector<char> VertexShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
-		printf("%s\n", &VertexShaderErrorMessage[0]);
+static void SaveProgramBinary(GLuint ProgramID, const std::string& path){
+	GLint Length = 0;
+	glGetProgramiv(ProgramID, GL_PROGRAM_BINARY_LENGTH, &Length);
+	if(Length <= 0)
+		return;
+	std::vector<char> Binary(Length);
+	GLenum Format = 0;
+	glGetProgramBinary(ProgramID, Length, &Length, &Format, &Binary[0]);
+
+	std::ofstream Stream(path.c_str(), std::ios::out | std::ios::binary);
+	if(!Stream.is_open()){
+		// First binary of all, most likely
+#ifdef _WIN32
+		_mkdir(ProgramBinaryDirectory.c_str());
+#else
+		mkdir(ProgramBinaryDirectory.c_str(), 0755);
+#endif
+		Stream.open(path.c_str(), std::ios::out | std::ios::binary);
+		if(!Stream.is_open())
+			return;
 	}
+	unsigned Header[3] = { ProgramBinaryMagic, Format, static_cast<unsigned>(Length) };
+	Stream.write(reinterpret_cast<const char *>(Header), sizeof(Header));
+	Stream.write(&Binary[0], Length);
+}
 
+void SetProgramBinaryDirectory(const char * directory){
+	ProgramBinaryDirectory = directory ? directory : "";
+}
 
+const ProgramBinaryStats& GetProgramBinaryStats(){
+	return ProgramBinaryCounts;
+}
 
-	// Compile Fragment Shader
-	printf("Compiling shader : %s\n", fragment_file_path);
-	char const * FragmentSourcePointer = FragmentShaderCode.c_str();
-	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
-	glCompileShader(FragmentShaderID);
+bool RemoveProgramBinary(const char * vertex_file_path,const char * fragment_file_path,const char * defines){
+	std::string VertexShaderCode, FragmentShaderCode;
+	if(!UseProgramBinaries() || !ReadShaderFile(vertex_file_path, VertexShaderCode) || !ReadShaderFile(fragment_file_path, FragmentShaderCode))
+		return false;
+	InsertDefines(VertexShaderCode, defines);
+	InsertDefines(FragmentShaderCode, defines);
+	return remove(GetProgramBinaryPath(VertexShaderCode, FragmentShaderCode).c_str()) == 0;
+}
 
-	// Check Fragment Shader
-	glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if ( InfoLogLength > 0 ){
-		std::vector<char> FragmentShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
-		printf("%s\n", &FragmentShaderErrorMessage[0]);
+bool ReadShaderSources(const char * vertex_file_path,const char * fragment_file_path,const char * defines,std::string& VertexShaderCode,std::string& FragmentShaderCode){
+	VertexShaderCode.clear();
+	FragmentShaderCode.clear();
+	const char * missing = !ReadShaderFile(vertex_file_path, VertexShaderCode) ? vertex_file_path :
+		!ReadShaderFile(fragment_file_path, FragmentShaderCode) ? fragment_file_path : NULL;
+	if(missing != NULL){
+		printf("Impossible to open %s. Are you in the right directory ? Don't forget to read the FAQ !\n", missing);
+		return false;
 	}
+	InsertDefines(VertexShaderCode, defines);
+	InsertDefines(FragmentShaderCode, defines);
+	return true;
+}
 
+static void PrintShaderLog(GLuint ShaderID){
+	int InfoLogLength = 0;
+	glGetShaderiv(ShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	if ( InfoLogLength > 0 ){
+		std::vector<char> ShaderErrorMessage(InfoLogLength+1);
+		glGetShaderInfoLog(ShaderID, InfoLogLength, NULL, &ShaderErrorMessage[0]);
+		printf("%s\n", &ShaderErrorMessage[0]);
+	}
+}
 
-
-	// Link the program
-	printf("Linking program\n");
-	GLuint ProgramID = glCreateProgram();
-	glAttachShader(ProgramID, VertexShaderID);
-	glAttachShader(ProgramID, FragmentShaderID);
-	glLinkProgram(ProgramID);
+bool FinishProgram(GLuint VertexShaderID,GLuint FragmentShaderID,GLuint ProgramID,const std::string& BinaryPath){
+	// Check both shaders
+	PrintShaderLog(VertexShaderID);
+	PrintShaderLog(FragmentShaderID);
 
 	// Check the program
+	GLint Result = GL_FALSE;
+	int InfoLogLength = 0;
 	glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
 	glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
 	if ( InfoLogLength > 0 ){
@@ -103,6 +222,48 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 	glDeleteShader(VertexShaderID);
 	glDeleteShader(FragmentShaderID);
 
+	if(!BinaryPath.empty() && Result == GL_TRUE)
+		SaveProgramBinary(ProgramID, BinaryPath);
+	++ProgramBinaryCounts.compiled;
+	return Result == GL_TRUE;
+}
+
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path,const char * defines){
+	std::chrono::high_resolution_clock::time_point Start = std::chrono::high_resolution_clock::now();
+
+	// Read both shaders, permutation defines included
+	std::string VertexShaderCode, FragmentShaderCode;
+	if(!ReadShaderSources(vertex_file_path, fragment_file_path, defines, VertexShaderCode, FragmentShaderCode))
+		return 0;
+
+	// Linked before from these very sources by this driver: skip compiling altogether
+	std::string BinaryPath = GetProgramBinaryPath(VertexShaderCode, FragmentShaderCode);
+	GLuint ProgramID = LoadProgramBinary(BinaryPath);
+	if(ProgramID != 0)
+		return ProgramID;
+
+	// Compile both shaders and link before asking GL anything back, so the driver
+	// is not made to finish one stage before it has even seen the next
+	printf("Compiling shaders : %s, %s\n", vertex_file_path, fragment_file_path);
+	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
+	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+	char const * VertexSourcePointer = VertexShaderCode.c_str();
+	char const * FragmentSourcePointer = FragmentShaderCode.c_str();
+	glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
+	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
+	glCompileShader(VertexShaderID);
+	glCompileShader(FragmentShaderID);
+
+	ProgramID = glCreateProgram();
+	glAttachShader(ProgramID, VertexShaderID);
+	glAttachShader(ProgramID, FragmentShaderID);
+	if(!BinaryPath.empty())
+		glProgramParameteri(ProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(ProgramID);
+
+	FinishProgram(VertexShaderID, FragmentShaderID, ProgramID, BinaryPath);
+	ProgramBinaryCounts.compileTime += MillisecondsSince(Start);
+
 	return ProgramID;
 }
 
@@ -1,6 +1,38 @@
 #ifndef SHADER_HPP
 #define SHADER_HPP
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path);
+#include <string>
+
+// defines, e.g. "#define LIGHTING 1\n", goes into both sources right after their #version line
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path,const char * defines = nullptr);
+
+// Linked programs are saved to directory ("ProgramCache" to begin with), keyed by both sources
+// with their defines and by the driver, and LoadShaders loads them from there instead of
+// compiling when it can. nullptr turns the cache off
+void SetProgramBinaryDirectory(const char * directory);
+// Delete the saved binary of these sources, so the next LoadShaders compiles them
+bool RemoveProgramBinary(const char * vertex_file_path,const char * fragment_file_path,const char * defines = nullptr);
+
+struct ProgramBinaryStats
+{
+	unsigned loaded;		// programs taken from a saved binary
+	unsigned compiled;		// programs compiled from source, by LoadShaders or a ShaderBatch
+	unsigned rejected;		// saved binaries the driver refused, compiled instead
+	double loadTime;		// ms spent loading binaries
+	double compileTime;		// ms LoadShaders waited on compiles; a ShaderBatch adds nothing here
+};
+const ProgramBinaryStats& GetProgramBinaryStats();
+
+// The steps LoadShaders is made of, for ShaderBatch to spread over frames.
+// Read both files and insert the defines; false, with the missing file printed, if one is not there
+bool ReadShaderSources(const char * vertex_file_path,const char * fragment_file_path,const char * defines,std::string& VertexShaderCode,std::string& FragmentShaderCode);
+// Where the binary of these sources goes; empty while the binary cache is off or unsupported
+std::string GetProgramBinaryPath(const std::string& VertexShaderCode,const std::string& FragmentShaderCode);
+bool UseProgramBinaries();
+// The program saved at path, or 0
+GLuint LoadProgramBinary(const std::string& path);
+// Once the program has been linked: print the logs, delete the shaders and save the binary
+// to BinaryPath if it linked. Waits for the driver if it is still compiling
+bool FinishProgram(GLuint VertexShaderID,GLuint FragmentShaderID,GLuint ProgramID,const std::string& BinaryPath);
 
 #endif